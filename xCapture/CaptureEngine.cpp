@@ -0,0 +1,380 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include "CaptureEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET socket_t;
+#define CLOSESOCKET closesocket
+#define poll WSAPoll
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET -1
+#define CLOSESOCKET close
+#endif
+
+#include <log4cpp/Category.hh>
+
+// how many packets we try to pull from the kernel per call
+#define RECV_BATCH 64
+// ask for a large kernel buffer so bursts survive while we are busy
+#define RECV_BUFFER_SIZE (8 * 1024 * 1024)
+
+static int64_t NowUS()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+#pragma region CapturedPacket
+
+bool CapturedPacket::GetDMX(int& universe, int& seq, const uint8_t*& data, int& length) const
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    const uint8_t* packet = _data;
+    int len = _length;
+
+    if (_protocol == CaptureProtocol::E131) {
+        // validate the packet
+        if (len < 126) return false;
+        if (memcmp(&packet[4], "ASC-E1.17", 9) != 0) return false;
+        if (packet[125] != 0x00) return false; // not lighting data
+
+        universe = ((int)packet[113] << 8) + (int)packet[114];
+        seq = (int)packet[111];
+        length = (((int)packet[115] - 0x70) << 8) + (int)packet[116] - 11;
+        if (length > len - 126) {
+            logger_base.warn("E131 packet of claimed length %d truncated to actual packet length %d.", length, len - 126);
+            logger_base.warn("    Packet looks unlikely to be valid.");
+            length = len - 126;
+        }
+        data = &packet[126];
+        return length >= 0;
+    }
+
+    // validate the packet
+    if (len < 18) return false;
+    if (memcmp(packet, "Art-Net", 7) != 0) return false;
+    if (packet[9] != 0x50) return false; // we only handle artdmx packets
+
+    universe = ((int)packet[15] << 8) + (int)packet[14];
+    seq = (int)packet[12];
+    length = ((int)packet[16] << 8) + (int)packet[17];
+    if (length > len - 18) {
+        logger_base.warn("ArtNet packet of claimed length %d truncated to actual packet length %d.", length, len - 18);
+        logger_base.warn("    Packet looks unlikely to be valid.");
+        length = len - 18;
+    }
+    data = &packet[18];
+    return true;
+}
+
+#pragma endregion
+
+#pragma region PacketArena
+
+uint8_t* PacketArena::Allocate(size_t size)
+{
+    if (size > _chunkSize) {
+        // oversized allocations get their own chunk at the front so the current chunk stays in use
+        _chunks.push_front(std::make_unique<uint8_t[]>(size));
+        _total += size;
+        return _chunks.front().get();
+    }
+    if (_chunks.empty() || _used + size > _chunkSize) {
+        _chunks.push_back(std::make_unique<uint8_t[]>(_chunkSize));
+        _used = 0;
+        _total += _chunkSize;
+    }
+    uint8_t* res = _chunks.back().get() + _used;
+    _used += size;
+    return res;
+}
+
+void PacketArena::Clear()
+{
+    _chunks.clear();
+    _used = 0;
+    _total = 0;
+}
+
+#pragma endregion
+
+#pragma region CaptureEngine
+
+CaptureEngine::CaptureEngine(size_t ringSlots)
+{
+    // round up to a power of 2 so we can mask rather than mod
+    size_t size = 1;
+    while (size < ringSlots) {
+        size <<= 1;
+    }
+    _ring.resize(size);
+    _mask = size - 1;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+CaptureEngine::~CaptureEngine()
+{
+    Stop();
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool CaptureEngine::IsListening(CaptureProtocol protocol) const
+{
+    return (protocol == CaptureProtocol::E131 ? _e131Socket : _artNETSocket) != -1;
+}
+
+intptr_t CaptureEngine::OpenSocket(uint16_t port, const std::string& localIP, const std::vector<int>& multicastUniverses, const std::string& name)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        logger_base.warn("Error creating socket to listen for %s data", (const char*)name.c_str());
+        return -1;
+    }
+
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    int bufSize = RECV_BUFFER_SIZE;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&bufSize, sizeof(bufSize));
+#if defined(__linux__)
+    setsockopt(s, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+#elif !defined(_WIN32)
+    setsockopt(s, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+#endif
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        logger_base.warn("Error binding socket to listen for %s data", (const char*)name.c_str());
+        CLOSESOCKET(s);
+        return -1;
+    }
+
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(s, FIONBIO, &mode);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    logger_base.debug("%s listening on %s", (const char*)name.c_str(), (const char*)localIP.c_str());
+
+    for (const auto& u : multicastUniverses) {
+        struct ip_mreq mreq;
+        std::string ip = "239.255." + std::to_string(u >> 8) + "." + std::to_string(u & 0xFF);
+        logger_base.debug("%s registering for multicast on %s.", (const char*)name.c_str(), (const char*)ip.c_str());
+        mreq.imr_multiaddr.s_addr = inet_addr(ip.c_str());
+        mreq.imr_interface.s_addr = inet_addr(localIP.c_str()); // this will only listen on the default interface
+        if (setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&mreq, sizeof(mreq)) != 0) {
+            logger_base.warn("    Error opening %s multicast listener %s.", (const char*)name.c_str(), (const char*)ip.c_str());
+        }
+    }
+
+    return (intptr_t)s;
+}
+
+void CaptureEngine::Start(bool e131, bool artNET, const std::string& localIP, const std::vector<int>& multicastUniverses)
+{
+    Stop();
+
+    if (e131) {
+        _e131Socket = OpenSocket(E131PORT, localIP, multicastUniverses, "E131");
+    }
+    if (artNET) {
+        _artNETSocket = OpenSocket(ARTNETPORT, localIP, multicastUniverses, "ARTNet");
+    }
+
+    if (IsListening()) {
+        _running = true;
+        _thread = new std::thread(&CaptureEngine::Run, this);
+    }
+}
+
+void CaptureEngine::Stop()
+{
+    if (_thread != nullptr) {
+        _running = false;
+        _thread->join();
+        delete _thread;
+        _thread = nullptr;
+    }
+    if (_e131Socket != -1) {
+        CLOSESOCKET((socket_t)_e131Socket);
+        _e131Socket = -1;
+    }
+    if (_artNETSocket != -1) {
+        CLOSESOCKET((socket_t)_artNETSocket);
+        _artNETSocket = -1;
+    }
+}
+
+void CaptureEngine::Run()
+{
+    std::vector<pollfd> fds;
+    std::vector<CaptureProtocol> protocols;
+    if (_e131Socket != -1) {
+        fds.push_back({ (socket_t)_e131Socket, POLLIN, 0 });
+        protocols.push_back(CaptureProtocol::E131);
+    }
+    if (_artNETSocket != -1) {
+        fds.push_back({ (socket_t)_artNETSocket, POLLIN, 0 });
+        protocols.push_back(CaptureProtocol::ARTNET);
+    }
+
+    while (_running) {
+        // short timeout so Stop is responsive
+        if (poll(fds.data(), (unsigned long)fds.size(), 100) <= 0) {
+            continue;
+        }
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (fds[i].revents & POLLIN) {
+                Receive((intptr_t)fds[i].fd, protocols[i]);
+            }
+            fds[i].revents = 0;
+        }
+    }
+}
+
+void CaptureEngine::Receive(intptr_t sock, CaptureProtocol protocol)
+{
+    socket_t s = (socket_t)sock;
+    static thread_local CapturedPacket overflow;
+
+    for (;;) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        size_t space = _ring.size() - (head - tail);
+
+#ifdef __linux__
+        // receive directly into free ring slots, anything beyond the free space goes to a scratch slot and is dropped
+        mmsghdr msgs[RECV_BATCH];
+        iovec iov[RECV_BATCH];
+        char control[RECV_BATCH][CMSG_SPACE(sizeof(timespec))];
+        size_t batch = space == 0 ? 1 : std::min(space, (size_t)RECV_BATCH);
+        memset(msgs, 0, sizeof(mmsghdr) * batch);
+        for (size_t i = 0; i < batch; i++) {
+            CapturedPacket& p = space == 0 ? overflow : _ring[(head + i) & _mask];
+            iov[i].iov_base = p._data;
+            iov[i].iov_len = sizeof(p._data);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = control[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+        }
+        int n = recvmmsg(s, msgs, (unsigned int)batch, MSG_DONTWAIT, nullptr);
+        if (n <= 0) {
+            return;
+        }
+        _received += n;
+        if (space == 0) {
+            _dropped += n;
+            continue;
+        }
+        int64_t now = NowUS();
+        for (int i = 0; i < n; i++) {
+            CapturedPacket& p = _ring[(head + i) & _mask];
+            p._length = (uint16_t)msgs[i].msg_len;
+            p._protocol = protocol;
+            p._timeStampUS = now;
+            for (cmsghdr* c = CMSG_FIRSTHDR(&msgs[i].msg_hdr); c != nullptr; c = CMSG_NXTHDR(&msgs[i].msg_hdr, c)) {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                    timespec ts;
+                    memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                    p._timeStampUS = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+                }
+            }
+        }
+        _head.store(head + n, std::memory_order_release);
+        if (n < (int)batch) {
+            return;
+        }
+#else
+        CapturedPacket& p = space == 0 ? overflow : _ring[head & _mask];
+#ifdef _WIN32
+        int n = recv(s, (char*)p._data, sizeof(p._data), 0);
+        p._timeStampUS = NowUS();
+#else
+        iovec iov;
+        iov.iov_base = p._data;
+        iov.iov_len = sizeof(p._data);
+        char control[CMSG_SPACE(sizeof(timeval))];
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        int n = (int)recvmsg(s, &msg, 0);
+        p._timeStampUS = NowUS();
+        if (n > 0) {
+            for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c)) {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMP) {
+                    timeval tv;
+                    memcpy(&tv, CMSG_DATA(c), sizeof(tv));
+                    p._timeStampUS = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+                }
+            }
+        }
+#endif
+        if (n <= 0) {
+            return;
+        }
+        _received++;
+        if (space == 0) {
+            _dropped++;
+            continue;
+        }
+        p._length = (uint16_t)n;
+        p._protocol = protocol;
+        _head.store(head + 1, std::memory_order_release);
+#endif
+    }
+}
+
+size_t CaptureEngine::Drain(const std::function<void(const CapturedPacket&)>& handler, size_t max)
+{
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    size_t head = _head.load(std::memory_order_acquire);
+    size_t count = std::min(head - tail, max);
+    for (size_t i = 0; i < count; i++) {
+        handler(_ring[(tail + i) & _mask]);
+    }
+    _tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+#pragma endregion
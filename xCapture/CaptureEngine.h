@@ -0,0 +1,100 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define E131PORT 5568
+#define ARTNETPORT 0x1936
+
+// big enough for a full e1.31 data packet
+#define CAPTURE_MAX_PACKET (126 + 512)
+
+enum class CaptureProtocol : uint8_t {
+    E131,
+    ARTNET
+};
+
+struct CapturedPacket
+{
+    int64_t _timeStampUS = 0; // wall clock receive time in microseconds, from the kernel where supported
+    uint16_t _length = 0;
+    CaptureProtocol _protocol = CaptureProtocol::E131;
+    uint8_t _data[CAPTURE_MAX_PACKET];
+
+    // extract the dmx payload, returns false if this is not a lighting data packet
+    bool GetDMX(int& universe, int& seq, const uint8_t*& data, int& length) const;
+};
+
+// Bump allocator for captured packet payloads. Nothing is freed individually;
+// Clear releases everything at once when the captured data is purged.
+class PacketArena
+{
+    std::list<std::unique_ptr<uint8_t[]>> _chunks;
+    size_t _used = 0;
+    size_t _chunkSize;
+    size_t _total = 0;
+
+public:
+    PacketArena(size_t chunkSize = 4 * 1024 * 1024) : _chunkSize(chunkSize) {}
+    uint8_t* Allocate(size_t size);
+    void Clear();
+    size_t GetAllocated() const { return _total; }
+};
+
+// Receives E1.31 and ArtNET packets on a dedicated thread.
+//
+// Packets are received in batches (recvmmsg on linux) straight into a
+// preallocated single producer/single consumer ring so receiving never waits
+// on the GUI or on disk. One consumer at a time drains the ring with Drain.
+// If the ring is full the packet is counted as dropped rather than blocking.
+class CaptureEngine
+{
+public:
+    CaptureEngine(size_t ringSlots = 32768);
+    virtual ~CaptureEngine();
+
+    void Start(bool e131, bool artNET, const std::string& localIP, const std::vector<int>& multicastUniverses);
+    void Stop();
+    bool IsListening() const { return IsListening(CaptureProtocol::E131) || IsListening(CaptureProtocol::ARTNET); }
+    bool IsListening(CaptureProtocol protocol) const;
+
+    size_t Drain(const std::function<void(const CapturedPacket&)>& handler, size_t max = SIZE_MAX);
+
+    uint64_t GetReceivedCount() const { return _received; }
+    uint64_t GetDroppedCount() const { return _dropped; }
+    size_t GetBacklog() const { return _head - _tail; }
+
+private:
+    intptr_t OpenSocket(uint16_t port, const std::string& localIP, const std::vector<int>& multicastUniverses, const std::string& name);
+    void Run();
+    void Receive(intptr_t socket, CaptureProtocol protocol);
+
+    std::vector<CapturedPacket> _ring;
+    size_t _mask;
+    std::atomic<size_t> _head = 0;
+    std::atomic<size_t> _tail = 0;
+
+    intptr_t _e131Socket = -1;
+    intptr_t _artNETSocket = -1;
+    std::thread* _thread = nullptr;
+    std::atomic<bool> _running = false;
+
+    std::atomic<uint64_t> _received = 0;
+    std::atomic<uint64_t> _dropped = 0;
+};
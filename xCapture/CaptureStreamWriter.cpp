@@ -0,0 +1,339 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include "CaptureStreamWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <log4cpp/Category.hh>
+
+// how long we watch the incoming data to work out the universes and frame time
+#define LEARN_US 1000000
+// stop learning early if we have this many packets ... there is plenty to go on
+#define LEARN_MAX_PACKETS 20000
+
+static long RoundTo4(long i)
+{
+    long remainder = i % 4;
+    if (remainder == 0) {
+        return i;
+    }
+    return i + 4 - remainder;
+}
+
+CaptureStreamWriter::CaptureStreamWriter(CaptureEngine& engine, const std::string& file, bool eseq, int frameMS, long eseqStartChannel, bool fillMissingFrames, const std::vector<std::pair<int, int>>& universes) :
+    _engine(engine), _file(file), _eseq(eseq), _frameMS(frameMS), _eseqStartChannel(eseqStartChannel), _fillMissingFrames(fillMissingFrames), _universes(universes)
+{
+}
+
+CaptureStreamWriter::~CaptureStreamWriter()
+{
+    if (_thread != nullptr) {
+        Stop();
+    }
+}
+
+void CaptureStreamWriter::WriteFSEQHeader(uint8_t* buf, uint32_t stepSize, uint32_t frames, uint16_t stepTime)
+{
+    uint8_t vMinor = 0;
+    uint8_t vMajor = 1;
+    uint16_t fixedHeaderLength = FSEQ_HEADER_SIZE;
+    uint16_t numUniverses = 0;
+    uint16_t universeSize = 0;
+    uint8_t gamma = 1;
+    uint8_t colorEncoding = 2;
+
+    memset(buf, 0x00, FSEQ_HEADER_SIZE);
+
+    buf[0] = 'P';
+    buf[1] = 'S';
+    buf[2] = 'E';
+    buf[3] = 'Q';
+    // data offset
+    buf[4] = (uint8_t)(fixedHeaderLength % 256);
+    buf[5] = (uint8_t)(fixedHeaderLength / 256);
+    buf[6] = vMinor;
+    buf[7] = vMajor;
+    // Fixed header length
+    buf[8] = (uint8_t)(fixedHeaderLength % 256);
+    buf[9] = (uint8_t)(fixedHeaderLength / 256);
+    // Step Size
+    buf[10] = (uint8_t)(stepSize & 0xFF);
+    buf[11] = (uint8_t)((stepSize >> 8) & 0xFF);
+    buf[12] = (uint8_t)((stepSize >> 16) & 0xFF);
+    buf[13] = (uint8_t)((stepSize >> 24) & 0xFF);
+    // Number of Steps
+    buf[14] = (uint8_t)(frames & 0xFF);
+    buf[15] = (uint8_t)((frames >> 8) & 0xFF);
+    buf[16] = (uint8_t)((frames >> 16) & 0xFF);
+    buf[17] = (uint8_t)((frames >> 24) & 0xFF);
+    // Step time in ms
+    buf[18] = (uint8_t)(stepTime & 0xFF);
+    buf[19] = (uint8_t)((stepTime >> 8) & 0xFF);
+    // universe count
+    buf[20] = (uint8_t)(numUniverses & 0xFF);
+    buf[21] = (uint8_t)((numUniverses >> 8) & 0xFF);
+    // universe Size
+    buf[22] = (uint8_t)(universeSize & 0xFF);
+    buf[23] = (uint8_t)((universeSize >> 8) & 0xFF);
+    // gamma
+    buf[24] = gamma;
+    // color encoding
+    buf[25] = colorEncoding;
+    buf[26] = 0;
+    buf[27] = 0;
+}
+
+void CaptureStreamWriter::WriteESEQHeader(uint8_t* buf, uint32_t frameSize, uint32_t startAddr, uint32_t modelSize)
+{
+    memset(buf, 0x00, ESEQ_HEADER_SIZE);
+
+    buf[0] = 'E';
+    buf[1] = 'S';
+    buf[2] = 'E';
+    buf[3] = 'Q';
+    // Data offset
+    buf[4] = (uint8_t)1; //Hard coded to export a single model for now
+    buf[5] = 0; //Pad byte
+    buf[6] = 0; //Pad byte
+    buf[7] = 0; //Pad byte
+    // Step Size
+    buf[8] = (uint8_t)(frameSize & 0xFF);
+    buf[9] = (uint8_t)((frameSize >> 8) & 0xFF);
+    buf[10] = (uint8_t)((frameSize >> 16) & 0xFF);
+    buf[11] = (uint8_t)((frameSize >> 24) & 0xFF);
+    //Model Start address
+    buf[12] = (uint8_t)(startAddr & 0xFF);
+    buf[13] = (uint8_t)((startAddr >> 8) & 0xFF);
+    buf[14] = (uint8_t)((startAddr >> 16) & 0xFF);
+    buf[15] = (uint8_t)((startAddr >> 24) & 0xFF);
+    // Model Size
+    buf[16] = (uint8_t)(modelSize & 0xFF);
+    buf[17] = (uint8_t)((modelSize >> 8) & 0xFF);
+    buf[18] = (uint8_t)((modelSize >> 16) & 0xFF);
+    buf[19] = (uint8_t)((modelSize >> 24) & 0xFF);
+}
+
+bool CaptureStreamWriter::Start()
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    if (!_f.Create(_file, true)) {
+        logger_base.error("Unable to create capture stream file %s.", (const char*)_file.c_str());
+        return false;
+    }
+
+    logger_base.debug("Streaming capture to %s.", (const char*)_file.c_str());
+    _running = true;
+    _thread = new std::thread(&CaptureStreamWriter::Run, this);
+    return true;
+}
+
+std::string CaptureStreamWriter::Stop()
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    if (_thread != nullptr) {
+        _running = false;
+        _thread->join();
+        delete _thread;
+        _thread = nullptr;
+    }
+
+    // a capture shorter than the learning period still gets written
+    if (_f.IsOpened()) {
+        if (_learning) {
+            FixLayout();
+        }
+        if (_frameDirty) {
+            WriteFrame(1);
+        }
+    }
+
+    std::string log = "Streamed to " + std::string(_eseq ? "ESEQ" : "FSEQ") + " file " + _file + "\n";
+    if (_f.IsOpened()) {
+        if (!_eseq) {
+            // now we know how many frames there are
+            uint8_t header[FSEQ_HEADER_SIZE];
+            WriteFSEQHeader(header, _stepSize, _frames, _frameMS);
+            _f.Seek(0);
+            _f.Write(header, sizeof(header));
+        }
+        _f.Close();
+    }
+
+    log += "Frame Time: " + std::to_string(_frameMS) + "ms\n";
+    log += "Universes: " + std::to_string(_layout.size()) + "\n";
+    log += "Channels Per Frame: " + std::to_string(_stepSize) + "\n";
+    log += "Frames: " + std::to_string(_frames) + "\n";
+    log += "Channel Structure Start:\n";
+    for (const auto& it : _layout) {
+        log += "Channel " + std::to_string(it.second.startChannel + 1) + ", Protocol " + (it.first.second == CaptureProtocol::E131 ? "E131" : "ArtNET") +
+               ", Universe " + std::to_string(it.first.first) + ", Size " + std::to_string(it.second.length) + "\n";
+    }
+    log += "Channel Structure End!\n";
+    if (_ignored > 0) {
+        log += "Packets ignored from universes that started after capture began: " + std::to_string(_ignored) + "\n";
+    }
+    if (_engine.GetDroppedCount() > 0) {
+        log += "WARNING: " + std::to_string(_engine.GetDroppedCount()) + " packets were dropped as the capture buffer was full.\n";
+    }
+    if (_writeError) {
+        log += "ERROR: Failed writing to file.\n";
+    }
+
+    logger_base.debug(log);
+    return log;
+}
+
+void CaptureStreamWriter::Run()
+{
+    auto handler = [this](const CapturedPacket& p) { Process(p); };
+    while (_running) {
+        if (_engine.Drain(handler, 4096) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    _engine.Drain(handler);
+}
+
+bool CaptureStreamWriter::IsUniverseToBeCaptured(int universe) const
+{
+    for (const auto& it : _universes) {
+        if (universe >= it.first && universe <= it.second) return true;
+    }
+    return false;
+}
+
+void CaptureStreamWriter::FixLayout()
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    _learning = false;
+
+    // sorted by universe with e131 ahead of artnet the same as a normal save
+    long channels = 0;
+    size_t index = 0;
+    const UniverseStats* busiest = nullptr;
+    for (const auto& it : _stats) {
+        UniverseSlot& slot = _layout[it.first];
+        slot.index = index++;
+        slot.startChannel = channels;
+        slot.length = it.second.length;
+        channels += it.second.length;
+        if (busiest == nullptr || it.second.packets > busiest->packets) {
+            busiest = &it.second;
+        }
+    }
+    _universeCount = _layout.size();
+    _channels = channels;
+    _stepSize = RoundTo4(channels);
+
+    if (_frameMS == 0) {
+        // same rounding as the xCapture frame time guess
+        _frameMS = 50;
+        if (busiest != nullptr && busiest->packets > 1) {
+            double intervalMS = (double)(busiest->lastUS - busiest->firstUS) / 1000.0 / (busiest->packets - 1);
+            _frameMS = std::max(5, ((int)(intervalMS / 5)) * 5);
+        }
+    }
+
+    logger_base.debug("Capture stream layout fixed. Universes %d, Channels %ld, Frame Time %dms.", (int)_layout.size(), (long)_stepSize, _frameMS);
+
+    _frame.resize(std::max((uint32_t)1, _stepSize));
+    std::fill(_frame.begin(), _frame.end(), 0);
+    _filled.resize(_layout.size());
+
+    if (_eseq) {
+        uint8_t header[ESEQ_HEADER_SIZE];
+        // the model is the captured channels, the rest of the step is padding
+        WriteESEQHeader(header, _stepSize, _eseqStartChannel, _channels);
+        _writeError |= _f.Write(header, sizeof(header)) != sizeof(header);
+    } else {
+        // frame count is filled in when we stop
+        uint8_t header[FSEQ_HEADER_SIZE];
+        WriteFSEQHeader(header, _stepSize, 0, _frameMS);
+        _writeError |= _f.Write(header, sizeof(header)) != sizeof(header);
+    }
+
+    // now replay what we saw while learning
+    std::vector<CapturedPacket> learnt;
+    std::swap(learnt, _learnPackets);
+    for (const auto& it : learnt) {
+        Process(it);
+    }
+}
+
+void CaptureStreamWriter::WriteFrame(int count)
+{
+    for (int i = 0; i < count; i++) {
+        _writeError |= _f.Write(_frame.data(), _stepSize) != _stepSize;
+    }
+    _frames += count;
+    std::fill(_filled.begin(), _filled.end(), false);
+    _frameDirty = false;
+}
+
+void CaptureStreamWriter::Process(const CapturedPacket& packet)
+{
+    int universe = 0;
+    int seq = 0;
+    int length = 0;
+    const uint8_t* data = nullptr;
+    if (!packet.GetDMX(universe, seq, data, length)) return;
+    if (!IsUniverseToBeCaptured(universe)) return;
+
+    UniverseKey key(universe, packet._protocol);
+
+    if (_learning) {
+        if (_learnStartUS == 0) {
+            _learnStartUS = packet._timeStampUS;
+        }
+        auto& s = _stats[key];
+        s.length = std::max(s.length, length);
+        if (s.packets == 0) {
+            s.firstUS = packet._timeStampUS;
+        }
+        s.lastUS = packet._timeStampUS;
+        s.packets++;
+        _learnPackets.push_back(packet);
+
+        if (packet._timeStampUS - _learnStartUS >= LEARN_US || _learnPackets.size() >= LEARN_MAX_PACKETS) {
+            FixLayout();
+        }
+        return;
+    }
+
+    auto it = _layout.find(key);
+    if (it == _layout.end()) {
+        _ignored++;
+        return;
+    }
+    const UniverseSlot& slot = it->second;
+
+    // a universe we already have for this frame means the controller has moved on to the next frame
+    if (_filled[slot.index]) {
+        int count = 1;
+        if (_fillMissingFrames && _frameMS > 0) {
+            int64_t gapMS = (packet._timeStampUS - _frameStartUS) / 1000;
+            count = std::max(1, (int)((gapMS + _frameMS / 2) / _frameMS));
+        }
+        WriteFrame(count);
+    }
+
+    if (!_frameDirty) {
+        _frameStartUS = packet._timeStampUS;
+        _frameDirty = true;
+    }
+    memcpy(&_frame[slot.startChannel], data, std::min(length, slot.length));
+    _filled[slot.index] = true;
+}
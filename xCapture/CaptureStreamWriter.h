@@ -0,0 +1,99 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <wx/file.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CaptureEngine.h"
+
+// Drains a CaptureEngine on its own thread and writes frames straight to an
+// FSEQ or ESEQ file so memory use does not grow with the length of the capture.
+//
+// The first second of data is used to learn the universes present, their
+// sizes and (unless given) the frame interval. After that the channel layout
+// is fixed and a frame is written each time a universe repeats.
+class CaptureStreamWriter
+{
+public:
+    CaptureStreamWriter(CaptureEngine& engine, const std::string& file, bool eseq, int frameMS, long eseqStartChannel, bool fillMissingFrames, const std::vector<std::pair<int, int>>& universes);
+    virtual ~CaptureStreamWriter();
+
+    bool Start();
+    // stops the writer, finalises the file and returns a description of what was written
+    std::string Stop();
+
+    uint32_t GetFrames() const { return _frames; }
+    size_t GetUniverses() const { return _universeCount; }
+    bool IsLearning() const { return _learning; }
+
+    static void WriteFSEQHeader(uint8_t* buf, uint32_t stepSize, uint32_t frames, uint16_t stepTime);
+    static void WriteESEQHeader(uint8_t* buf, uint32_t frameSize, uint32_t startAddr, uint32_t modelSize);
+    static const int FSEQ_HEADER_SIZE = 28;
+    static const int ESEQ_HEADER_SIZE = 20;
+
+private:
+    typedef std::pair<int, CaptureProtocol> UniverseKey;
+
+    struct UniverseStats {
+        int length = 0;
+        int packets = 0;
+        int64_t firstUS = 0;
+        int64_t lastUS = 0;
+    };
+
+    struct UniverseSlot {
+        size_t index = 0;
+        long startChannel = 0; // 0 based
+        int length = 0;
+    };
+
+    void Run();
+    void Process(const CapturedPacket& packet);
+    bool IsUniverseToBeCaptured(int universe) const;
+    void FixLayout();
+    void WriteFrame(int count);
+
+    CaptureEngine& _engine;
+    std::string _file;
+    bool _eseq;
+    int _frameMS;
+    long _eseqStartChannel;
+    bool _fillMissingFrames;
+    std::vector<std::pair<int, int>> _universes;
+
+    wxFile _f;
+    std::thread* _thread = nullptr;
+    std::atomic<bool> _running = false;
+
+    std::atomic<bool> _learning = true;
+    int64_t _learnStartUS = 0;
+    std::map<UniverseKey, UniverseStats> _stats;
+    std::vector<CapturedPacket> _learnPackets;
+    std::map<UniverseKey, UniverseSlot> _layout;
+    std::atomic<size_t> _universeCount = 0;
+
+    std::vector<uint8_t> _frame;
+    std::vector<bool> _filled;
+    int64_t _frameStartUS = 0;
+    bool _frameDirty = false;
+    std::atomic<uint32_t> _frames = 0;
+    uint64_t _ignored = 0;
+    uint32_t _channels = 0;
+    uint32_t _stepSize = 0;
+    bool _writeError = false;
+};
@@ -8,8 +8,6 @@
  **************************************************************/
 
 #define ZERO 0
-#define E131PORT 5568
-#define ARTNETPORT 0x1936
 
 #include "xCaptureMain.h"
 #include <wx/msgdlg.h>
@@ -17,6 +15,7 @@
 #include <log4cpp/Category.hh>
 #include <wx/file.h>
 #include <wx/filename.h>
+#include <wx/socket.h>
 #include "../xLights/xLightsVersion.h"
 #include <wx/debugrpt.h>
 #include <wx/protocol/http.h>
@@ -24,16 +23,9 @@
 #include <wx/filedlg.h>
 #include <wx/numdlg.h>
 #include "ResultDialog.h"
+#include "CaptureStreamWriter.h"
 #include "../xLights/IPEntryDialog.h"
 
-#ifndef __WXMSW__
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#else
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#endif
-
 #include "../include/xLights.xpm"
 #include "../include/xLights-16.xpm"
 #include "../include/xLights-32.xpm"
@@ -74,6 +66,7 @@ const long xCaptureFrame::ID_STATICTEXT9 = wxNewId();
 const long xCaptureFrame::ID_CHOICE1 = wxNewId();
 const long xCaptureFrame::ID_SPINCTRL1 = wxNewId();
 const long xCaptureFrame::ID_CHECKBOX1 = wxNewId();
+const long xCaptureFrame::ID_CHECKBOX2 = wxNewId();
 const long xCaptureFrame::ID_BUTTON1 = wxNewId();
 const long xCaptureFrame::ID_BUTTON8 = wxNewId();
 const long xCaptureFrame::ID_BUTTON2 = wxNewId();
@@ -84,6 +77,7 @@ const long xCaptureFrame::ID_TIMER1 = wxNewId();
 
 const long xCaptureFrame::ID_E131SOCKET = wxNewId();
 const long xCaptureFrame::ID_ARTNETSOCKET = wxNewId();
+const long xCaptureFrame::ID_DRAINTIMER = wxNewId();
 
 BEGIN_EVENT_TABLE(xCaptureFrame,wxFrame)
     //(*EventTable(xCaptureFrame)
@@ -98,30 +92,24 @@ void xCaptureFrame::PurgeCollectedData()
         _capturedData.pop_front();
         delete toDelete;
     }
+    _arena.Clear();
 }
 
-void xCaptureFrame::StashPacket(long type, wxByte* packet, int len)
+void xCaptureFrame::StashPacket(const CapturedPacket& packet)
 {
+    long type = packet._protocol == CaptureProtocol::E131 ? ID_E131SOCKET : ID_ARTNETSOCKET;
     int universe = -1;
-    if (type == ID_E131SOCKET)
-    {
-        universe = ((int)packet[113] << 8) + (int)packet[114];
-    }
-    else if (type == ID_ARTNETSOCKET)
-    {
-        // we only handle artdmx packets
-        if (packet[9] != 0x50) return;
-
-        universe = ((int)packet[15] << 8) + (int)packet[14];
-    }
-
-    if (universe == -1) return;
+    int seq = 0;
+    int length = 0;
+    const wxByte* data = nullptr;
+    if (!packet.GetDMX(universe, seq, data, length)) return;
 
     if (CheckBox_TriggerOnChannel->GetValue())
     {
         if (universe == SpinCtrl_Universe->GetValue())
         {
-            wxByte c = packet[125 + SpinCtrl_Channel->GetValue()];
+            int channel = SpinCtrl_Channel->GetValue();
+            wxByte c = (channel >= 1 && channel <= length) ? data[channel - 1] : 0;
 
             if (c >= SpinCtrl_TriggerStart->GetValue())
             {
@@ -145,7 +133,7 @@ void xCaptureFrame::StashPacket(long type, wxByte* packet, int len)
         if (it->_protocol == type && it->_universe == universe)
         {
             _capturedPackets++;
-            it->AddPacket(type, packet, len);
+            it->AddPacket(packet._timeStampUS, seq, data, length, _arena);
             return;
         }
     }
@@ -155,7 +143,7 @@ void xCaptureFrame::StashPacket(long type, wxByte* packet, int len)
 
     Collector* c = new Collector(type, universe);
     _capturedData.push_back(c);
-    c->AddPacket(type, packet, len);
+    c->AddPacket(packet._timeStampUS, seq, data, length, _arena);
     _capturedPackets++;
 }
 
@@ -215,8 +203,6 @@ xCaptureFrame::xCaptureFrame(wxWindow* parent, const std::string& showdir, const
 {
     // static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
 
-    _e131Socket = nullptr;
-    _artNETSocket = nullptr;
     _capturing = false;
     _capturedPackets = 0;
     _capturedDesc = "";
@@ -322,6 +308,9 @@ xCaptureFrame::xCaptureFrame(wxWindow* parent, const std::string& showdir, const
     CheckBox_FillInMissingFrames = new wxCheckBox(this, ID_CHECKBOX1, _("Fill in missing frames with prior frame data"), wxDefaultPosition, wxDefaultSize, 0, wxDefaultValidator, _T("ID_CHECKBOX1"));
     CheckBox_FillInMissingFrames->SetValue(false);
     FlexGridSizer8->Add(CheckBox_FillInMissingFrames, 1, wxALL|wxEXPAND, 5);
+    CheckBox_StreamToFile = new wxCheckBox(this, ID_CHECKBOX2, _("Stream directly to file (for long captures)"), wxDefaultPosition, wxDefaultSize, 0, wxDefaultValidator, _T("ID_CHECKBOX2"));
+    CheckBox_StreamToFile->SetValue(false);
+    FlexGridSizer8->Add(CheckBox_StreamToFile, 1, wxALL|wxEXPAND, 5);
     FlexGridSizer1->Add(FlexGridSizer8, 1, wxALL|wxEXPAND, 5);
     FlexGridSizer2 = new wxFlexGridSizer(0, 4, 0, 0);
     Button_StartStop = new wxButton(this, ID_BUTTON1, _("Start Capture"), wxDefaultPosition, wxDefaultSize, 0, wxDefaultValidator, _T("ID_BUTTON1"));
@@ -363,6 +352,7 @@ xCaptureFrame::xCaptureFrame(wxWindow* parent, const std::string& showdir, const
     Connect(ID_BUTTON4,wxEVT_COMMAND_BUTTON_CLICKED,(wxObjectEventFunction)&xCaptureFrame::OnButton_EditClick);
     Connect(ID_BUTTON5,wxEVT_COMMAND_BUTTON_CLICKED,(wxObjectEventFunction)&xCaptureFrame::OnButton_DeleteClick);
     Connect(ID_CHOICE1,wxEVT_COMMAND_CHOICE_SELECTED,(wxObjectEventFunction)&xCaptureFrame::OnChoice_TimingSelect);
+    Connect(ID_CHECKBOX2,wxEVT_COMMAND_CHECKBOX_CLICKED,(wxObjectEventFunction)&xCaptureFrame::OnCheckBox_StreamToFileClick);
     Connect(ID_BUTTON1,wxEVT_COMMAND_BUTTON_CLICKED,(wxObjectEventFunction)&xCaptureFrame::OnButton_StartStopClick);
     Connect(ID_BUTTON8,wxEVT_COMMAND_BUTTON_CLICKED,(wxObjectEventFunction)&xCaptureFrame::OnButton_AnalyseClick);
     Connect(ID_BUTTON2,wxEVT_COMMAND_BUTTON_CLICKED,(wxObjectEventFunction)&xCaptureFrame::OnButton_SaveClick);
@@ -381,8 +371,8 @@ xCaptureFrame::xCaptureFrame(wxWindow* parent, const std::string& showdir, const
     FileMenu->Append(quitMenItem1);
     Connect(wxID_EXIT,wxEVT_COMMAND_MENU_SELECTED,(wxObjectEventFunction)&xCaptureFrame::OnQuit);
 #endif
-    Connect(ID_E131SOCKET, wxEVT_SOCKET, (wxObjectEventFunction)&xCaptureFrame::OnE131SocketEvent);
-    Connect(ID_ARTNETSOCKET, wxEVT_SOCKET, (wxObjectEventFunction)&xCaptureFrame::OnArtNETSocketEvent);
+    _drainTimer.SetOwner(this, ID_DRAINTIMER);
+    Connect(ID_DRAINTIMER, wxEVT_TIMER, (wxObjectEventFunction)&xCaptureFrame::OnDrainTimerTrigger);
 
     SetTitle("xLights Capture " + GetDisplayVersionString());
 
@@ -412,8 +402,8 @@ xCaptureFrame::xCaptureFrame(wxWindow* parent, const std::string& showdir, const
 
     UITimer.Start(1000, wxTIMER_CONTINUOUS);
 
-    if (CheckBox_ArtNET->GetValue()) CreateArtNETListener();
-    if (CheckBox_E131->GetValue()) CreateE131Listener();
+    RestartInterfaces();
+    _drainTimer.Start(20, wxTIMER_CONTINUOUS);
 
     Button_StartStop->SetLabel("Start");
 
@@ -497,7 +487,14 @@ xCaptureFrame::~xCaptureFrame()
 {
     SaveState();
 
-    CloseSockets(true);
+    _drainTimer.Stop();
+    if (_streamWriter != nullptr)
+    {
+        _streamWriter->Stop();
+        delete _streamWriter;
+        _streamWriter = nullptr;
+    }
+    _engine.Stop();
 
     PurgeCollectedData();
 
@@ -565,95 +562,22 @@ void xCaptureFrame::FillInMissingFrames(int frameTime)
     }
 }
 
-// close not required sockets
-void xCaptureFrame::CloseSockets(bool force)
-{
-    if (force || !CheckBox_E131->GetValue())
-    {
-        if (_e131Socket != nullptr)
-        {
-            _e131Socket->Close();
-            delete _e131Socket;
-            _e131Socket = nullptr;
-        }
-    }
-
-    if (force || !CheckBox_ArtNET->GetValue())
-    {
-        if (_artNETSocket != nullptr)
-        {
-            _artNETSocket->Close();
-            delete _artNETSocket;
-            _artNETSocket = nullptr;
-        }
-    }
-}
-
 void xCaptureFrame::OnAbout(wxCommandEvent& event)
 {
     auto about = wxString::Format(wxT("xCapture v%s, the xLights packet capturer."), GetDisplayVersionString());
     wxMessageBox(about, _("Welcome to..."));
 }
 
-PacketData::PacketData(long type, wxByte* packet, int len)
+PacketData::PacketData(int64_t timeStampUS, int seq, const wxByte* data, int length, PacketArena& arena)
 {
-    static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
-    _timeStamp = wxDateTime::UNow();
+    _timeStamp = wxDateTime((time_t)(timeStampUS / 1000000));
+    _timeStamp.SetMillisecond((timeStampUS / 1000) % 1000);
     _frameTimeMS = -1;
-    _seq = 0;
-    _length = 0;
-    _pdata = nullptr;
-
-    if (type == xCaptureFrame::ID_E131SOCKET)
-    {
-        // validate the packet
-        if (len < 126) return;
-        if (packet[4] != 0x41) return;
-        if (packet[5] != 0x53) return;
-        if (packet[6] != 0x43) return;
-        if (packet[7] != 0x2d) return;
-        if (packet[8] != 0x45) return;
-        if (packet[9] != 0x31) return;
-        if (packet[10] != 0x2e) return;
-        if (packet[11] != 0x31) return;
-        if (packet[12] != 0x37) return;
-        if (packet[125] != 0x00) return; // not lighting data
-
-        _seq = (int)packet[111];
-        _length = (((int)packet[115] - 0x70) << 8) + (int)packet[116] - 11;
-        if (_length > len - 126)
-        {
-            logger_base.warn("E131 packet of claimed length %d truncated to actual packet length %d.", _length, len - 126);
-            logger_base.warn("    Packet looks unlikely to be valid.");
-            _length = len - 126;
-        }
-        _pdata = (wxByte*)malloc(_length);
-        memcpy(_pdata, &packet[126], _length);
-    }
-    else if (type == xCaptureFrame::ID_ARTNETSOCKET)
-    {
-        // validate the packet
-        if (len < 18) return;
-        if (packet[0] != 'A') return;
-        if (packet[1] != 'r') return;
-        if (packet[2] != 't') return;
-        if (packet[3] != '-') return;
-        if (packet[4] != 'N') return;
-        if (packet[5] != 'e') return;
-        if (packet[6] != 't') return;
-        if (packet[9] != 0x50) return;
-
-        _seq = (int)packet[12];
-        _length = ((int)packet[16] << 8) + (int)packet[17];
-        if (_length > len - 18)
-        {
-            logger_base.warn("ArtNet packet of claimed length %d truncated to actual packet length %d.", _length, len - 18);
-            logger_base.warn("    Packet looks unlikely to be valid.");
-            _length = len - 18;
-        }
-        _pdata = (wxByte*)malloc(_length);
-        memcpy(_pdata, &packet[18], _length);
-    }
+    _seq = seq;
+    _length = length;
+    wxByte* p = arena.Allocate(length);
+    memcpy(p, data, length);
+    _pdata = p;
 }
 
 // Duplicate a packet but update its sequence number and time
@@ -661,8 +585,8 @@ PacketData::PacketData(PacketData& pd, int seq, int time)
 {
     _seq = seq;
     _length = pd._length;
-    _pdata = (wxByte*)malloc(_length);
-    memcpy(_pdata, pd._pdata, _length);
+    // the data lives in the arena and is never modified so it can be shared
+    _pdata = pd._pdata;
     _frameTimeMS = time;
 }
 
@@ -838,11 +762,18 @@ void xCaptureFrame::ValidateWindow()
         Button_StartStop->Enable(true);
     }
 
-    if (_artNETSocket == nullptr && _e131Socket == nullptr)
+    if (!_engine.IsListening())
     {
         Button_StartStop->Enable(false);
     }
 
+    // streaming captures everything from start to stop so it cant be combined with triggering
+    if (CheckBox_TriggerOnChannel->GetValue())
+    {
+        CheckBox_StreamToFile->SetValue(false);
+    }
+    CheckBox_StreamToFile->Enable(!_capturing && !CheckBox_TriggerOnChannel->GetValue());
+
     if (_capturedData.size() > 0 && !_capturing)
     {
         Button_Save->Enable(true);
@@ -875,110 +806,21 @@ void xCaptureFrame::ValidateWindow()
     }
 }
 
-void xCaptureFrame::CreateE131Listener()
+std::vector<std::pair<int, int>> xCaptureFrame::GetUniverseRanges()
 {
-    static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
-    if (_e131Socket != nullptr) return;
-
-    //Local address to bind to
-    wxIPV4address addr;
-    addr.AnyAddress();
-    addr.Service(E131PORT);
-    //create and bind to the address above
-    _e131Socket = new wxDatagramSocket(addr);
-
-    if (_e131Socket->IsOk())
+    std::vector<std::pair<int, int>> res;
+    for (int i = 0; i < ListView_Universes->GetItemCount(); i++)
     {
-        logger_base.debug("E131 listening on %s", (const char*)_localIP.c_str());
-
-        for (int i = 0; i < ListView_Universes->GetItemCount(); i++)
+        if (ListView_Universes->GetItemText(i) == "All")
         {
-            if (ListView_Universes->GetItemText(i) != "All")
-            {
-                int start = wxAtoi(ListView_Universes->GetItemText(i));
-                int end = wxAtoi(ListView_Universes->GetItemText(i, 1));
-                for (int u = start; u <= end; u++)
-                {
-                    struct ip_mreq mreq;
-                    wxString ip = wxString::Format("239.255.%d.%d", u >> 8, u & 0xFF);
-                    logger_base.debug("E131 registering for multicast on %s.", (const char *)ip.c_str());
-                    mreq.imr_multiaddr.s_addr = inet_addr(ip.c_str());
-                    mreq.imr_interface.s_addr = inet_addr(_localIP.c_str()); // this will only listen on the default interface
-                    if (!_e131Socket->SetOption(IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *)&mreq, sizeof(mreq)))
-                    {
-                        logger_base.warn("    Error opening E131 multicast listener %s.", (const char *)ip.c_str());
-                    }
-                }
-            }
+            res.push_back({ 0, 65535 });
         }
-
-        //enable event handling
-        _e131Socket->SetEventHandler(*this, ID_E131SOCKET);
-        //Notify us about incomming data
-        _e131Socket->SetNotify(wxSOCKET_INPUT_FLAG);
-        //enable event handling
-        _e131Socket->Notify(true);
-    }
-    else
-    {
-        delete _e131Socket;
-        _e131Socket = nullptr;
-        logger_base.warn("Error opening socket to listen for e131 data");
-        wxMessageBox("Error listening for E1.31 data.");
-    }
-}
-
-void xCaptureFrame::CreateArtNETListener()
-{
-    static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
-    if (_artNETSocket != nullptr) return;
-
-    //Local address to bind to
-    wxIPV4address addr;
-    addr.AnyAddress();
-    addr.Service(ARTNETPORT);
-    //create and bind to the address above
-    _artNETSocket = new wxDatagramSocket(addr);
-
-    if (_artNETSocket->IsOk())
-    {
-        logger_base.debug("ARTNet listening on %s", (const char*)_localIP.c_str());
-
-        for (int i = 0; i < ListView_Universes->GetItemCount(); i++)
+        else
         {
-            if (ListView_Universes->GetItemText(i) != "All")
-            {
-                int start = wxAtoi(ListView_Universes->GetItemText(i));
-                int end = wxAtoi(ListView_Universes->GetItemText(i, 1));
-                for (int u = start; u <= end; u++)
-                {
-                    struct ip_mreq mreq;
-                    wxString ip = wxString::Format("239.255.%d.%d", u >> 8, u & 0xFF);
-                    logger_base.debug("ARTNet registering for multicast on %s.", (const char *)ip.c_str());
-                    mreq.imr_multiaddr.s_addr = inet_addr(ip.c_str());
-                    mreq.imr_interface.s_addr = inet_addr(_localIP.c_str()); // this will only listen on the default interface
-                    if (!_artNETSocket->SetOption(IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *)&mreq, sizeof(mreq)))
-                    {
-                        logger_base.warn("    Error opening ARTNet multicast listener %s.", (const char *)ip.c_str());
-                    }
-                }
-            }
+            res.push_back({ wxAtoi(ListView_Universes->GetItemText(i)), wxAtoi(ListView_Universes->GetItemText(i, 1)) });
         }
-
-        //enable event handling
-        _artNETSocket->SetEventHandler(*this, ID_ARTNETSOCKET);
-        //Notify us about incomming data
-        _artNETSocket->SetNotify(wxSOCKET_INPUT_FLAG);
-        //enable event handling
-        _artNETSocket->Notify(true);
-    }
-    else
-    {
-        delete _artNETSocket;
-        _artNETSocket = nullptr;
-        logger_base.warn("Error opening socket to listen for ArtNET data");
-        wxMessageBox("Error listening for E1.ArtNET data.");
     }
+    return res;
 }
 
 void xCaptureFrame::AddUniverseRange(int low, int high)
@@ -1077,8 +919,25 @@ void xCaptureFrame::OnButton_StartStopClick(wxCommandEvent& event)
 {
     static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
 
+    if (!_capturing && CheckBox_StreamToFile->GetValue())
+    {
+        if (!StartStreaming()) return;
+    }
+
     _capturing = !_capturing;
-    if (_capturing)
+    if (_streamWriter != nullptr)
+    {
+        if (_capturing)
+        {
+            Button_StartStop->SetLabel("Stop");
+        }
+        else
+        {
+            Button_StartStop->SetLabel("Start");
+            StopStreaming();
+        }
+    }
+    else if (_capturing)
     {
         _capturedDesc = "";
         _capturedPackets = 0;
@@ -1266,78 +1125,79 @@ void xCaptureFrame::OnButton_ClearClick(wxCommandEvent& event)
 
 void xCaptureFrame::OnCheckBox_E131Click(wxCommandEvent& event)
 {
-    CloseSockets();
-    if (CheckBox_E131->GetValue())
-    {
-        CreateE131Listener();
-    }
-    ValidateWindow();
+    RestartInterfaces();
 }
 
 void xCaptureFrame::OnCheckBox_ArtNETClick(wxCommandEvent& event)
 {
-    CloseSockets();
-    if (CheckBox_ArtNET->GetValue())
-    {
-        CreateArtNETListener();
-    }
+    RestartInterfaces();
+}
+
+void xCaptureFrame::OnCheckBox_StreamToFileClick(wxCommandEvent& event)
+{
     ValidateWindow();
 }
 
-void xCaptureFrame::OnE131SocketEvent(wxSocketEvent& event)
+void xCaptureFrame::OnDrainTimerTrigger(wxTimerEvent& event)
 {
-    static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+    // while streaming the writer thread is draining the capture buffer
+    if (_streamWriter != nullptr) return;
 
-    wxIPV4address addr;
-    addr.Service(E131PORT);
-    wxByte buf[126+512];
-    switch (event.GetSocketEvent())
-    {
-    case wxSOCKET_INPUT:
+    _engine.Drain([this](const CapturedPacket& packet) { StashPacket(packet); });
+}
+
+bool xCaptureFrame::StartStreaming()
+{
+    wxFileDialog dlg(this, _("Stream capture to"), "", "",
+        "FSEQ (*.fseq)|*.fseq|ESEQ (*.eseq)|*.eseq", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (dlg.ShowModal() != wxID_OK) return false;
+
+    wxFileName fn(dlg.GetDirectory() + "/" + dlg.GetFilename());
+    bool eseq = fn.GetExt().Lower() == "eseq";
+
+    long startAddr = 1;
+    if (eseq)
     {
-        _e131Socket->Notify(false);
-        size_t n = _e131Socket->RecvFrom(addr, buf, sizeof(buf)).LastCount();
-        if (!n) {
-            logger_base.error("ERROR: failed to receive E131 data");
-            return;
+        startAddr = wxGetNumberFromUser("Start channel for the model", "", "Start Channel", 1, 1, 10000000, this);
+        if (startAddr == -1)
+        {
+            startAddr = 1;
         }
-        //logger_base.debug("E131 packet received.");
-        StashPacket(ID_E131SOCKET, buf, n);
-        _e131Socket->Notify(true);
     }
-        break;
-    default:
-        logger_base.warn("OnE131SocketEvent: Unexpected event !");
-        break;
+
+    // throw away anything received before the capture started
+    _engine.Drain([](const CapturedPacket&) {});
+
+    _streamWriter = new CaptureStreamWriter(_engine, fn.GetFullPath().ToStdString(), eseq, GetFrameTimeOverride(), startAddr, CheckBox_FillInMissingFrames->GetValue(), GetUniverseRanges());
+    if (!_streamWriter->Start())
+    {
+        delete _streamWriter;
+        _streamWriter = nullptr;
+        wxMessageBox("Unable to create file " + fn.GetFullPath());
+        return false;
     }
+    return true;
 }
 
-void xCaptureFrame::OnArtNETSocketEvent(wxSocketEvent & event)
+void xCaptureFrame::StopStreaming()
 {
-    static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+    if (_streamWriter == nullptr) return;
 
-    wxIPV4address addr;
-    addr.Service(ARTNETPORT);
-    wxByte buf[18 + 512];
-    switch (event.GetSocketEvent())
-    {
-    case wxSOCKET_INPUT:
+    wxString log = _streamWriter->Stop();
+    delete _streamWriter;
+    _streamWriter = nullptr;
+
+    ResultDialog dlgLog(this, log);
+    dlgLog.ShowModal();
+}
+
+int xCaptureFrame::GetFrameTimeOverride()
+{
+    if (Choice_Timing->GetStringSelection() == "Manual")
     {
-        _artNETSocket->Notify(false);
-        size_t n = _artNETSocket->RecvFrom(addr, buf, sizeof(buf)).LastCount();
-        if (!n) {
-            logger_base.error("ERROR: failed to receive ArtNET data");
-            return;
-        }
-        //logger_base.debug("ArtNet packet received.");
-        StashPacket(ID_ARTNETSOCKET, buf, n);
-        _artNETSocket->Notify(true);
-    }
-        break;
-    default:
-        logger_base.warn("OnArtNETSocketEvent: Unexpected event !");
-        break;
+        return SpinCtrl_ManualTime->GetValue();
     }
+    return wxAtoi(Choice_Timing->GetStringSelection());
 }
 
 void xCaptureFrame::OnButton_AddClick(wxCommandEvent& event)
@@ -1374,32 +1234,38 @@ void xCaptureFrame::OnButton_DeleteClick(wxCommandEvent& event)
 
 void xCaptureFrame::OnUITimerTrigger(wxTimerEvent& event)
 {
-    StatusBar1->SetStatusText(wxString::Format("Universes: %d Total Packets: %ld %s", (int)_capturedData.size(), _capturedPackets, _capturedDesc));
+    wxString dropped;
+    if (_engine.GetDroppedCount() > 0)
+    {
+        dropped = wxString::Format(" Dropped: %llu", (unsigned long long)_engine.GetDroppedCount());
+    }
+
+    if (_streamWriter != nullptr)
+    {
+        if (_streamWriter->IsLearning())
+        {
+            StatusBar1->SetStatusText("Streaming: Detecting universes and frame time ..." + dropped);
+        }
+        else
+        {
+            StatusBar1->SetStatusText(wxString::Format("Streaming: Universes: %d Frames: %u", (int)_streamWriter->GetUniverses(), _streamWriter->GetFrames()) + dropped);
+        }
+    }
+    else
+    {
+        StatusBar1->SetStatusText(wxString::Format("Universes: %d Total Packets: %ld %s", (int)_capturedData.size(), _capturedPackets, _capturedDesc) + dropped);
+    }
 }
 
 void xCaptureFrame::SaveFSEQ(wxString file, int frameMS, long channelsPerFrame, int frames, wxString& log)
 {
     static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
 
-    wxUint8 vMinor = 0;
-    wxUint8 vMajor = 1;
-    wxUint16 fixedHeaderLength = 28;
+    wxUint16 fixedHeaderLength = CaptureStreamWriter::FSEQ_HEADER_SIZE;
     wxUint32 stepSize = channelsPerFrame;
     wxUint16 stepTime = frameMS;
-    wxUint16 numUniverses = 0;
-    wxUint16 universeSize = 0;
-    wxUint8 gamma = 1;
-    wxUint8 colorEncoding = 2;
 
-    int overrideFrameMS = 0;
-    if (Choice_Timing->GetStringSelection() == "Manual")
-    {
-        overrideFrameMS = SpinCtrl_ManualTime->GetValue();
-    }
-    else
-    {
-        overrideFrameMS = wxAtoi(Choice_Timing->GetStringSelection());
-    }
+    int overrideFrameMS = GetFrameTimeOverride();
 
     if (overrideFrameMS != 0)
     {
@@ -1416,44 +1282,7 @@ void xCaptureFrame::SaveFSEQ(wxString file, int frameMS, long channelsPerFrame,
         wxUint8* buf = (wxUint8 *)calloc(sizeof(wxUint8), bufsize);
         memset(buf, 0x00, bufsize);
 
-        buf[0] = 'P';
-        buf[1] = 'S';
-        buf[2] = 'E';
-        buf[3] = 'Q';
-
-        buf[6] = vMinor;
-        buf[7] = vMajor;
-        // Fixed header length
-        buf[8] = (wxUint8)(fixedHeaderLength % 256);
-        buf[9] = (wxUint8)(fixedHeaderLength / 256);
-        // Step Size
-        buf[10] = (wxUint8)(stepSize & 0xFF);
-        buf[11] = (wxUint8)((stepSize >> 8) & 0xFF);
-        buf[12] = (wxUint8)((stepSize >> 16) & 0xFF);
-        buf[13] = (wxUint8)((stepSize >> 24) & 0xFF);
-        // Number of Steps
-        buf[14] = (wxUint8)(frames & 0xFF);
-        buf[15] = (wxUint8)((frames >> 8) & 0xFF);
-        buf[16] = (wxUint8)((frames >> 16) & 0xFF);
-        buf[17] = (wxUint8)((frames >> 24) & 0xFF);
-        // Step time in ms
-        buf[18] = (wxUint8)(stepTime & 0xFF);
-        buf[19] = (wxUint8)((stepTime >> 8) & 0xFF);
-        // universe count
-        buf[20] = (wxUint8)(numUniverses & 0xFF);
-        buf[21] = (wxUint8)((numUniverses >> 8) & 0xFF);
-        // universe Size
-        buf[22] = (wxUint8)(universeSize & 0xFF);
-        buf[23] = (wxUint8)((universeSize >> 8) & 0xFF);
-        // universe Size
-        buf[24] = gamma;
-        // universe Size
-        buf[25] = colorEncoding;
-        buf[26] = 0;
-        buf[27] = 0;
-
-        buf[4] = (wxUint8)(fixedHeaderLength % 256);
-        buf[5] = (wxUint8)(fixedHeaderLength / 256);
+        CaptureStreamWriter::WriteFSEQHeader(buf, stepSize, frames, stepTime);
         f.Write(buf, fixedHeaderLength);
 
         for (int i = 0; i < frames; i++)
@@ -1484,14 +1313,29 @@ void xCaptureFrame::SaveFSEQ(wxString file, int frameMS, long channelsPerFrame,
 
 void xCaptureFrame::RestartInterfaces()
 {
-    CloseSockets(true);
-    if (CheckBox_E131->GetValue())
+    std::vector<int> multicastUniverses;
+    for (int i = 0; i < ListView_Universes->GetItemCount(); i++)
     {
-        CreateE131Listener();
+        if (ListView_Universes->GetItemText(i) != "All")
+        {
+            int start = wxAtoi(ListView_Universes->GetItemText(i));
+            int end = wxAtoi(ListView_Universes->GetItemText(i, 1));
+            for (int u = start; u <= end; u++)
+            {
+                multicastUniverses.push_back(u);
+            }
+        }
     }
-    if (CheckBox_ArtNET->GetValue())
+
+    _engine.Start(CheckBox_E131->GetValue(), CheckBox_ArtNET->GetValue(), _localIP.ToStdString(), multicastUniverses);
+
+    if (CheckBox_E131->GetValue() && !_engine.IsListening(CaptureProtocol::E131))
     {
-        CreateArtNETListener();
+        wxMessageBox("Error listening for E1.31 data.");
+    }
+    if (CheckBox_ArtNET->GetValue() && !_engine.IsListening(CaptureProtocol::ARTNET))
+    {
+        wxMessageBox("Error listening for ArtNET data.");
     }
     ValidateWindow();
 }
@@ -1521,15 +1365,7 @@ void xCaptureFrame::SaveESEQ(wxString file, int frameMS, long channelsPerFrame,
         startAddr = 1;
     }
 
-    int overrideFrameMS = 0;
-    if (Choice_Timing->GetStringSelection() == "Manual")
-    {
-        overrideFrameMS = SpinCtrl_ManualTime->GetValue();
-    }
-    else
-    {
-        overrideFrameMS = wxAtoi(Choice_Timing->GetStringSelection());
-    }
+    int overrideFrameMS = GetFrameTimeOverride();
 
     if (overrideFrameMS != 0)
     {
@@ -1538,7 +1374,7 @@ void xCaptureFrame::SaveESEQ(wxString file, int frameMS, long channelsPerFrame,
         frameMS = overrideFrameMS;
     }
 
-    wxUint16 fixedHeaderLength = 20;
+    wxUint16 fixedHeaderLength = CaptureStreamWriter::ESEQ_HEADER_SIZE;
     wxUint32 modelSize = channelsPerFrame;
     wxUint32 frameSize = RoundTo4(channelsPerFrame);
     wxFile f;
@@ -1549,30 +1385,7 @@ void xCaptureFrame::SaveESEQ(wxString file, int frameMS, long channelsPerFrame,
         wxUint8* buf = (wxUint8 *)calloc(sizeof(wxUint8), bufsize);
         memset(buf, 0x00, bufsize);
 
-        buf[0] = 'E';
-        buf[1] = 'S';
-        buf[2] = 'E';
-        buf[3] = 'Q';
-        // Data offset
-        buf[4] = (wxUint8)1; //Hard coded to export a single model for now
-        buf[5] = 0; //Pad byte
-        buf[6] = 0; //Pad byte
-        buf[7] = 0; //Pad byte
-                    // Step Size
-        buf[8] = (wxUint8)(frameSize & 0xFF);
-        buf[9] = (wxUint8)((frameSize >> 8) & 0xFF);
-        buf[10] = (wxUint8)((frameSize >> 16) & 0xFF);
-        buf[11] = (wxUint8)((frameSize >> 24) & 0xFF);
-        //Model Start address
-        buf[12] = (wxUint8)(startAddr & 0xFF);
-        buf[13] = (wxUint8)((startAddr >> 8) & 0xFF);
-        buf[14] = (wxUint8)((startAddr >> 16) & 0xFF);
-        buf[15] = (wxUint8)((startAddr >> 24) & 0xFF);
-        // Model Size
-        buf[16] = (wxUint8)(modelSize & 0xFF);
-        buf[17] = (wxUint8)((modelSize >> 8) & 0xFF);
-        buf[18] = (wxUint8)((modelSize >> 16) & 0xFF);
-        buf[19] = (wxUint8)((modelSize >> 24) & 0xFF);
+        CaptureStreamWriter::WriteESEQHeader(buf, frameSize, startAddr, modelSize);
         f.Write(buf, fixedHeaderLength);
 
         for (int i = 0; i < frames; i++)
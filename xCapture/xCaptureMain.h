@@ -39,11 +39,12 @@
 
 #include "../common/xlBaseApp.h"
 #include "../xLights/xLightsTimer.h"
+#include "CaptureEngine.h"
 #include <list>
-#include <wx/socket.h>
+#include <vector>
 
 class wxDebugReportCompress;
-class wxDatagramSocket;
+class CaptureStreamWriter;
 
 class PacketData
 {
@@ -51,10 +52,10 @@ public:
     wxDateTime _timeStamp;
     int _seq;
     int _length;
-    wxByte* _pdata;
+    const wxByte* _pdata; // owned by the capture arena
     int _frameTimeMS;
-    virtual ~PacketData() { if (_pdata != nullptr) free(_pdata); }
-    PacketData(long type, wxByte* packet, int len);
+    virtual ~PacketData() {}
+    PacketData(int64_t timeStampUS, int seq, const wxByte* data, int length, PacketArena& arena);
     PacketData(PacketData& pd, int seq, int time);
 };
 
@@ -69,7 +70,7 @@ public:
     std::list<PacketData*> _packets;
     virtual ~Collector();
     Collector(long type, int universe) { _startChannel = -1; _universe = universe; _protocol = type; }
-    void AddPacket(long type, wxByte* packet, int len) { _packets.push_back(new PacketData(type, packet, len)); }
+    void AddPacket(int64_t timeStampUS, int seq, const wxByte* data, int length, PacketArena& arena) { _packets.push_back(new PacketData(timeStampUS, seq, data, length, arena)); }
     void CalculateFrames(wxDateTime startTime, int frameMS);
     PacketData* GetPacket(long ms);
     bool operator<(const Collector& c) const;
@@ -81,8 +82,10 @@ class xCaptureFrame : public xlFrame
     void ValidateWindow();
 
     std::list<Collector*> _capturedData;
-    wxDatagramSocket* _e131Socket;
-    wxDatagramSocket* _artNETSocket;
+    CaptureEngine _engine;
+    PacketArena _arena;
+    CaptureStreamWriter* _streamWriter = nullptr;
+    wxTimer _drainTimer;
     bool _capturing;
     long _capturedPackets;
     std::string _capturedDesc;
@@ -90,12 +93,13 @@ class xCaptureFrame : public xlFrame
     wxString _defaultIP;
 
     void RestartInterfaces();
-    void CloseSockets(bool force = false);
-    void CreateE131Listener();
-    void CreateArtNETListener();
+    std::vector<std::pair<int, int>> GetUniverseRanges();
     void AddUniverseRange(int low, int high);
     void PurgeCollectedData();
-    void StashPacket(long type, wxByte* packet, int len);
+    void StashPacket(const CapturedPacket& packet);
+    bool StartStreaming();
+    void StopStreaming();
+    int GetFrameTimeOverride();
     bool IsUniverseToBeCaptured(int universe, bool ignoreall = false);
     int GuessFrameMS();
     long GetChannelsPerFrame();
@@ -116,6 +120,7 @@ public:
 
         static const long ID_E131SOCKET;
         static const long ID_ARTNETSOCKET;
+        static const long ID_DRAINTIMER;
 
 private:
 
@@ -141,6 +146,7 @@ private:
         void OnButton1Click(wxCommandEvent& event);
         void OnChoice_TimingSelect(wxCommandEvent& event);
         void OnClose(wxCloseEvent& event);
+        void OnCheckBox_StreamToFileClick(wxCommandEvent& event);
         //*)
 
         //(*Identifiers(xCaptureFrame)
@@ -171,6 +177,7 @@ private:
         static const long ID_CHOICE1;
         static const long ID_SPINCTRL1;
         static const long ID_CHECKBOX1;
+        static const long ID_CHECKBOX2;
         static const long ID_BUTTON1;
         static const long ID_BUTTON8;
         static const long ID_BUTTON2;
@@ -192,6 +199,7 @@ private:
         wxCheckBox* CheckBox_ArtNET;
         wxCheckBox* CheckBox_E131;
         wxCheckBox* CheckBox_FillInMissingFrames;
+        wxCheckBox* CheckBox_StreamToFile;
         wxCheckBox* CheckBox_TriggerOnChannel;
         wxChoice* Choice_Timing;
         wxListView* ListView_Universes;
@@ -221,8 +229,7 @@ private:
 
         DECLARE_EVENT_TABLE()
 
-        void OnE131SocketEvent(wxSocketEvent& event);
-        void OnArtNETSocketEvent(wxSocketEvent& event);
+        void OnDrainTimerTrigger(wxTimerEvent& event);
 };
 
 #endif // xCAPTUREMAIN_H
@@ -7,10 +7,15 @@
 #include "xFadeMain.h"
 #include "Settings.h"
 #include "PacketData.h"
+#include "UniverseData.h"
 #include "../xLights/UtilFunctions.h"
 
 #include <log4cpp/Category.hh>
 
+#include <chrono>
+#include <thread>
+#include <vector>
+
 class EmitterThread : public wxThread
 {
     Emitter* _emitter;
@@ -34,6 +39,20 @@ public:
         }
     }
 
+    void WaitUntil(std::chrono::steady_clock::time_point deadline)
+    {
+        int spinUS = _emitter->GetSettings() == nullptr ? DEFAULT_EMIT_SPIN_US : _emitter->GetSettings()->_emitSpinUS;
+        auto sleepUntil = deadline - std::chrono::microseconds(spinUS);
+        if (std::chrono::steady_clock::now() < sleepUntil)
+        {
+            std::this_thread::sleep_until(sleepUntil);
+        }
+        while (!_stop && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+    }
+
     void Stop()
     {
         static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
@@ -95,13 +114,31 @@ public:
             artNETSocketSend = nullptr;
         }
 
-        PacketData sendData;
-        auto universes = _emitter->GetUniverses();
+        std::vector<UniverseData*> universes;
+        for (const auto& it : _emitter->GetUniverses())
+        {
+            universes.push_back(it.second);
+        }
+        std::vector<PacketData> sendData(universes.size());
+        std::vector<bool> ready(universes.size(), false);
 
+        EmissionStats& stats = _emitter->GetStats();
+        stats.Reset();
+
+        // frames go out against fixed deadlines so a slow frame does not push all later frames back
+        auto deadline = std::chrono::steady_clock::now();
         while (!_stop)
         {
-            auto start = wxDateTime::UNow();
-            int diffMS = 0;
+            int frameMS = _emitter->GetFrameMS();
+            deadline += std::chrono::milliseconds(frameMS);
+            auto now = std::chrono::steady_clock::now();
+            if (now > deadline + std::chrono::milliseconds(frameMS))
+            {
+                // we have fallen more than a frame behind so dont try to catch up with a burst of frames
+                deadline = now;
+            }
+            WaitUntil(deadline);
+            int64_t lateUS = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - deadline).count();
 
             int lb = _emitter->GetLeftBrightness();
             int rb = _emitter->GetRightBrightness();
@@ -111,19 +148,25 @@ public:
             wxASSERT(rb >= 0 && rb <= 100);
             wxASSERT(pos >= 0.0 && pos <= 1.0);
 
-            // output the frames now
-            for (const auto& it : universes)
+            // merge the whole frame first so every universe reflects the same fader position
+            MERGE_MODE mode = _emitter->GetMergeMode();
+            MergeWeights weights = MergeEngine::GetWeights(mode, lb, rb, pos);
+            for (size_t i = 0; i < universes.size(); i++)
             {
-                it.second->GetOutput(&sendData, lb, rb, pos);
-                sendData.Send(e131SocketSend, artNETSocketSend, it.second->GetTargetIP());
-                _emitter->IncrementSent();
+                ready[i] = universes[i]->GetOutput(&sendData[i], mode, weights);
             }
 
-            auto diff = wxDateTime::UNow() - start;
-            diffMS = _emitter->GetFrameMS() - diff.GetMilliseconds().ToLong();
+            // then output it
+            for (size_t i = 0; i < universes.size(); i++)
+            {
+                if (ready[i])
+                {
+                    sendData[i].Send(e131SocketSend, artNETSocketSend, universes[i]->GetTargetIP());
+                    _emitter->IncrementSent();
+                }
+            }
 
-            if (diffMS > 0)
-                wxMilliSleep(diffMS);
+            stats.RecordFrame(lateUS, frameMS);
         }
 
         if (e131SocketSend != nullptr)
@@ -140,7 +183,7 @@ public:
             artNETSocketSend = nullptr;
         }
 
-        logger_base.debug("Emitter thread exiting.");
+        logger_base.debug("Emitter thread exiting. Average jitter %dus, max %dus, %u late frames.", stats.GetJitterAvgUS(), stats.GetJitterMaxUS(), stats.GetLateFrames());
         return nullptr;
     }
 };
@@ -156,6 +199,7 @@ Emitter::Emitter(const std::map<int, UniverseData*>& universes, std::string loca
     _frameMS = 50;
     _leftBrightness = 100;
     _rightBrightness = 100;
+    _mergeMode = (int)MERGE_MODE::CROSSFADE;
 
     _emitterThread = new EmitterThread(this);
     _emitterThread->Create();
@@ -5,6 +5,7 @@
 #include <map>
 #include <atomic>
 #include "PacketData.h"
+#include "MergeEngine.h"
 
 #define PINGINTERVAL 60
 
@@ -25,6 +26,8 @@ class Emitter
     std::string _localIP;
     std::atomic<int> _leftBrightness;
     std::atomic<int> _rightBrightness;
+    std::atomic<int> _mergeMode; // = CROSSFADE
+    EmissionStats _stats;
     Settings* _settings = nullptr;
 
     public:
@@ -43,6 +46,9 @@ class Emitter
     void SetRightBrightness(int brightness) { _rightBrightness = brightness; }
     int GetLeftBrightness() const { return _leftBrightness; }
     int GetRightBrightness() const { return _rightBrightness; }
+    void SetMergeMode(MERGE_MODE mode) { _mergeMode = (int)mode; }
+    MERGE_MODE GetMergeMode() const { return (MERGE_MODE)(int)_mergeMode; }
+    EmissionStats& GetStats() { return _stats; }
     uint32_t GetSent() const { return _sent; }
     void IncrementSent() { _sent++; }
     void ZeroSent() { _sent = 0; }
@@ -0,0 +1,310 @@
+#include "MergeEngine.h"
+
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define MERGE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MERGE_NEON
+#include <arm_neon.h>
+#endif
+
+#define MERGE_BLOCK 16
+
+MergeWeights MergeEngine::GetWeights(MERGE_MODE mode, int leftBrightness, int rightBrightness, float pos)
+{
+    MergeWeights w;
+    float l = 1.0f - pos;
+    float r = pos;
+    if (mode != MERGE_MODE::CROSSFADE)
+    {
+        // for HTP and LTP both sides stay at full level through the middle of the fade
+        l = l * 2.0f > 1.0f ? 1.0f : l * 2.0f;
+        r = r * 2.0f > 1.0f ? 1.0f : r * 2.0f;
+    }
+    w.left = (uint16_t)(leftBrightness * 256 * l / 100.0f + 0.5f);
+    w.right = (uint16_t)(rightBrightness * 256 * r / 100.0f + 0.5f);
+    w.excludeFromRight = pos >= 0.5f;
+    return w;
+}
+
+static inline uint8_t ScaleChannel(uint8_t v, uint16_t w)
+{
+    return (uint8_t)(((uint32_t)v * w) >> 8);
+}
+
+static inline uint8_t ExcludedChannel(uint8_t merged, uint8_t l, uint8_t r, const uint8_t* excludeMask, size_t i, const MergeWeights& w)
+{
+    if (excludeMask == nullptr || excludeMask[i] == 0) return merged;
+    return w.excludeFromRight ? r : l;
+}
+
+void MergeEngine::Crossfade(uint8_t* output, const uint8_t* left, const uint8_t* right, const uint8_t* excludeMask, size_t channels, const MergeWeights& w)
+{
+    size_t i = 0;
+
+#if defined(MERGE_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i wl = _mm_set1_epi16(w.left);
+    __m128i wr = _mm_set1_epi16(w.right);
+    for (; i + MERGE_BLOCK <= channels; i += MERGE_BLOCK)
+    {
+        __m128i l = _mm_loadu_si128((const __m128i*)(left + i));
+        __m128i r = _mm_loadu_si128((const __m128i*)(right + i));
+
+        // weights add up to at most 257 so the sums fit in 16 bits
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(l, zero), wl), _mm_mullo_epi16(_mm_unpacklo_epi8(r, zero), wr));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(l, zero), wl), _mm_mullo_epi16(_mm_unpackhi_epi8(r, zero), wr));
+        __m128i res = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+
+        if (excludeMask != nullptr)
+        {
+            __m128i m = _mm_loadu_si128((const __m128i*)(excludeMask + i));
+            res = _mm_or_si128(_mm_and_si128(m, w.excludeFromRight ? r : l), _mm_andnot_si128(m, res));
+        }
+        _mm_storeu_si128((__m128i*)(output + i), res);
+    }
+#elif defined(MERGE_NEON)
+    uint16x8_t wl = vdupq_n_u16(w.left);
+    uint16x8_t wr = vdupq_n_u16(w.right);
+    for (; i + MERGE_BLOCK <= channels; i += MERGE_BLOCK)
+    {
+        uint8x16_t l = vld1q_u8(left + i);
+        uint8x16_t r = vld1q_u8(right + i);
+
+        uint16x8_t lo = vmlaq_u16(vmulq_u16(vmovl_u8(vget_low_u8(l)), wl), vmovl_u8(vget_low_u8(r)), wr);
+        uint16x8_t hi = vmlaq_u16(vmulq_u16(vmovl_u8(vget_high_u8(l)), wl), vmovl_u8(vget_high_u8(r)), wr);
+        uint8x16_t res = vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+
+        if (excludeMask != nullptr)
+        {
+            res = vbslq_u8(vld1q_u8(excludeMask + i), w.excludeFromRight ? r : l, res);
+        }
+        vst1q_u8(output + i, res);
+    }
+#endif
+
+    for (; i < channels; ++i)
+    {
+        uint8_t merged = (uint8_t)(((uint32_t)left[i] * w.left + (uint32_t)right[i] * w.right) >> 8);
+        output[i] = ExcludedChannel(merged, left[i], right[i], excludeMask, i, w);
+    }
+}
+
+void MergeEngine::HTP(uint8_t* output, const uint8_t* left, const uint8_t* right, const uint8_t* excludeMask, size_t channels, const MergeWeights& w)
+{
+    size_t i = 0;
+
+#if defined(MERGE_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i wl = _mm_set1_epi16(w.left);
+    __m128i wr = _mm_set1_epi16(w.right);
+    for (; i + MERGE_BLOCK <= channels; i += MERGE_BLOCK)
+    {
+        __m128i l = _mm_loadu_si128((const __m128i*)(left + i));
+        __m128i r = _mm_loadu_si128((const __m128i*)(right + i));
+
+        __m128i sl = _mm_packus_epi16(_mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(l, zero), wl), 8), _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(l, zero), wl), 8));
+        __m128i sr = _mm_packus_epi16(_mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(r, zero), wr), 8), _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(r, zero), wr), 8));
+        __m128i res = _mm_max_epu8(sl, sr);
+
+        if (excludeMask != nullptr)
+        {
+            __m128i m = _mm_loadu_si128((const __m128i*)(excludeMask + i));
+            res = _mm_or_si128(_mm_and_si128(m, w.excludeFromRight ? r : l), _mm_andnot_si128(m, res));
+        }
+        _mm_storeu_si128((__m128i*)(output + i), res);
+    }
+#elif defined(MERGE_NEON)
+    uint16x8_t wl = vdupq_n_u16(w.left);
+    uint16x8_t wr = vdupq_n_u16(w.right);
+    for (; i + MERGE_BLOCK <= channels; i += MERGE_BLOCK)
+    {
+        uint8x16_t l = vld1q_u8(left + i);
+        uint8x16_t r = vld1q_u8(right + i);
+
+        uint8x16_t sl = vcombine_u8(vshrn_n_u16(vmulq_u16(vmovl_u8(vget_low_u8(l)), wl), 8), vshrn_n_u16(vmulq_u16(vmovl_u8(vget_high_u8(l)), wl), 8));
+        uint8x16_t sr = vcombine_u8(vshrn_n_u16(vmulq_u16(vmovl_u8(vget_low_u8(r)), wr), 8), vshrn_n_u16(vmulq_u16(vmovl_u8(vget_high_u8(r)), wr), 8));
+        uint8x16_t res = vmaxq_u8(sl, sr);
+
+        if (excludeMask != nullptr)
+        {
+            res = vbslq_u8(vld1q_u8(excludeMask + i), w.excludeFromRight ? r : l, res);
+        }
+        vst1q_u8(output + i, res);
+    }
+#endif
+
+    for (; i < channels; ++i)
+    {
+        uint8_t sl = ScaleChannel(left[i], w.left);
+        uint8_t sr = ScaleChannel(right[i], w.right);
+        output[i] = ExcludedChannel(sl > sr ? sl : sr, left[i], right[i], excludeMask, i, w);
+    }
+}
+
+void MergeEngine::LTP(uint8_t* output, const uint8_t* left, const uint8_t* right, uint8_t* lastLeft, uint8_t* lastRight, uint8_t* owner, const uint8_t* excludeMask, size_t channels, const MergeWeights& w)
+{
+    size_t i = 0;
+
+#if defined(MERGE_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i ones = _mm_cmpeq_epi8(zero, zero);
+    __m128i wl = _mm_set1_epi16(w.left);
+    __m128i wr = _mm_set1_epi16(w.right);
+    for (; i + MERGE_BLOCK <= channels; i += MERGE_BLOCK)
+    {
+        __m128i l = _mm_loadu_si128((const __m128i*)(left + i));
+        __m128i r = _mm_loadu_si128((const __m128i*)(right + i));
+        __m128i changedL = _mm_xor_si128(_mm_cmpeq_epi8(l, _mm_loadu_si128((const __m128i*)(lastLeft + i))), ones);
+        __m128i changedR = _mm_xor_si128(_mm_cmpeq_epi8(r, _mm_loadu_si128((const __m128i*)(lastRight + i))), ones);
+
+        // right wins if both sides changed the channel in the same frame
+        __m128i o = _mm_or_si128(changedR, _mm_andnot_si128(changedL, _mm_loadu_si128((const __m128i*)(owner + i))));
+        _mm_storeu_si128((__m128i*)(owner + i), o);
+        _mm_storeu_si128((__m128i*)(lastLeft + i), l);
+        _mm_storeu_si128((__m128i*)(lastRight + i), r);
+
+        __m128i sl = _mm_packus_epi16(_mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(l, zero), wl), 8), _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(l, zero), wl), 8));
+        __m128i sr = _mm_packus_epi16(_mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(r, zero), wr), 8), _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(r, zero), wr), 8));
+        __m128i res = _mm_or_si128(_mm_and_si128(o, sr), _mm_andnot_si128(o, sl));
+
+        if (excludeMask != nullptr)
+        {
+            __m128i m = _mm_loadu_si128((const __m128i*)(excludeMask + i));
+            res = _mm_or_si128(_mm_and_si128(m, w.excludeFromRight ? r : l), _mm_andnot_si128(m, res));
+        }
+        _mm_storeu_si128((__m128i*)(output + i), res);
+    }
+#elif defined(MERGE_NEON)
+    uint16x8_t wl = vdupq_n_u16(w.left);
+    uint16x8_t wr = vdupq_n_u16(w.right);
+    for (; i + MERGE_BLOCK <= channels; i += MERGE_BLOCK)
+    {
+        uint8x16_t l = vld1q_u8(left + i);
+        uint8x16_t r = vld1q_u8(right + i);
+        uint8x16_t changedL = vmvnq_u8(vceqq_u8(l, vld1q_u8(lastLeft + i)));
+        uint8x16_t changedR = vmvnq_u8(vceqq_u8(r, vld1q_u8(lastRight + i)));
+
+        // right wins if both sides changed the channel in the same frame
+        uint8x16_t o = vorrq_u8(changedR, vbicq_u8(vld1q_u8(owner + i), changedL));
+        vst1q_u8(owner + i, o);
+        vst1q_u8(lastLeft + i, l);
+        vst1q_u8(lastRight + i, r);
+
+        uint8x16_t sl = vcombine_u8(vshrn_n_u16(vmulq_u16(vmovl_u8(vget_low_u8(l)), wl), 8), vshrn_n_u16(vmulq_u16(vmovl_u8(vget_high_u8(l)), wl), 8));
+        uint8x16_t sr = vcombine_u8(vshrn_n_u16(vmulq_u16(vmovl_u8(vget_low_u8(r)), wr), 8), vshrn_n_u16(vmulq_u16(vmovl_u8(vget_high_u8(r)), wr), 8));
+        uint8x16_t res = vbslq_u8(o, sr, sl);
+
+        if (excludeMask != nullptr)
+        {
+            res = vbslq_u8(vld1q_u8(excludeMask + i), w.excludeFromRight ? r : l, res);
+        }
+        vst1q_u8(output + i, res);
+    }
+#endif
+
+    for (; i < channels; ++i)
+    {
+        if (right[i] != lastRight[i])
+        {
+            owner[i] = 0xFF;
+        }
+        else if (left[i] != lastLeft[i])
+        {
+            owner[i] = 0x00;
+        }
+        lastLeft[i] = left[i];
+        lastRight[i] = right[i];
+
+        uint8_t merged = owner[i] ? ScaleChannel(right[i], w.right) : ScaleChannel(left[i], w.left);
+        output[i] = ExcludedChannel(merged, left[i], right[i], excludeMask, i, w);
+    }
+}
+
+void MergeEngine::Merge(MERGE_MODE mode, uint8_t* output, const uint8_t* left, const uint8_t* right, uint8_t* lastLeft, uint8_t* lastRight, uint8_t* owner, const uint8_t* excludeMask, size_t channels, const MergeWeights& w)
+{
+    switch (mode)
+    {
+    case MERGE_MODE::HTP:
+        HTP(output, left, right, excludeMask, channels, w);
+        break;
+    case MERGE_MODE::LTP:
+        LTP(output, left, right, lastLeft, lastRight, owner, excludeMask, channels, w);
+        break;
+    case MERGE_MODE::CROSSFADE:
+    default:
+        Crossfade(output, left, right, excludeMask, channels, w);
+        break;
+    }
+}
+
+int64_t EmissionStats::GetThreadCPUTimeUS()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (int64_t)((k.QuadPart + u.QuadPart) / 10);
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+int64_t EmissionStats::GetTimeUS()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void EmissionStats::Reset()
+{
+    _windowStartUS = GetTimeUS();
+    _windowStartCPUUS = GetThreadCPUTimeUS();
+    _jitterTotalUS = 0;
+    _jitterMax = 0;
+    _frames = 0;
+    _jitterAvgUS = 0;
+    _jitterMaxUS = 0;
+    _cpuPercent = 0;
+    _lateFrames = 0;
+}
+
+void EmissionStats::RecordFrame(int64_t lateUS, int frameMS)
+{
+    if (lateUS < 0) lateUS = -lateUS;
+    _jitterTotalUS += lateUS;
+    if (lateUS > _jitterMax) _jitterMax = (int)lateUS;
+    _frames++;
+
+    // more than a quarter of a frame late is noticeable on the lights
+    if (lateUS > frameMS * 250) _lateFrames++;
+
+    // publish once a second so the numbers are stable enough to read
+    int64_t now = GetTimeUS();
+    if (now - _windowStartUS >= 1000000)
+    {
+        int64_t cpu = GetThreadCPUTimeUS();
+        _jitterAvgUS = (int)(_jitterTotalUS / _frames);
+        _jitterMaxUS = _jitterMax;
+        _cpuPercent = (int)((cpu - _windowStartCPUUS) * 100 / (now - _windowStartUS));
+
+        _windowStartUS = now;
+        _windowStartCPUUS = cpu;
+        _jitterTotalUS = 0;
+        _jitterMax = 0;
+        _frames = 0;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define MERGE_MAX_CHANNELS 512
+
+enum class MERGE_MODE
+{
+    CROSSFADE,
+    HTP,
+    LTP
+};
+
+// Per frame channel weights in 1/256ths. Worked out once per frame from the
+// brightness sliders and fader position and then used for every universe.
+struct MergeWeights
+{
+    uint16_t left = 256;
+    uint16_t right = 0;
+    bool excludeFromRight = false; // excluded channels snap to the right once the fader passes half way
+};
+
+// Whole universe merge kernels. These work on 16 channels at a time using
+// SSE2 or NEON where available and fall back to plain loops otherwise.
+// Excluded channels are never scaled, they just take the raw value from
+// whichever side the fader is closer to.
+class MergeEngine
+{
+public:
+    static MergeWeights GetWeights(MERGE_MODE mode, int leftBrightness, int rightBrightness, float pos);
+
+    // output = left * w.left + right * w.right
+    static void Crossfade(uint8_t* output, const uint8_t* left, const uint8_t* right, const uint8_t* excludeMask, size_t channels, const MergeWeights& w);
+    // output = max(left * w.left, right * w.right)
+    static void HTP(uint8_t* output, const uint8_t* left, const uint8_t* right, const uint8_t* excludeMask, size_t channels, const MergeWeights& w);
+    // output = whichever side changed the channel most recently. owner and the prior
+    // values are kept by the caller between frames (owner 0x00 = left, 0xFF = right)
+    static void LTP(uint8_t* output, const uint8_t* left, const uint8_t* right, uint8_t* lastLeft, uint8_t* lastRight, uint8_t* owner, const uint8_t* excludeMask, size_t channels, const MergeWeights& w);
+
+    static void Merge(MERGE_MODE mode, uint8_t* output, const uint8_t* left, const uint8_t* right, uint8_t* lastLeft, uint8_t* lastRight, uint8_t* owner, const uint8_t* excludeMask, size_t channels, const MergeWeights& w);
+};
+
+// Tracks how late each frame went out against its deadline and how much of a
+// core the emitter is using. Written by the emitter thread, read by the UI.
+class EmissionStats
+{
+    std::atomic<int> _jitterAvgUS = 0;
+    std::atomic<int> _jitterMaxUS = 0;
+    std::atomic<int> _cpuPercent = 0;
+    std::atomic<uint32_t> _lateFrames = 0;
+
+    int64_t _windowStartUS = 0;
+    int64_t _windowStartCPUUS = 0;
+    int64_t _jitterTotalUS = 0;
+    int _jitterMax = 0;
+    int _frames = 0;
+
+public:
+    void Reset();
+    // call once per frame from the emitting thread with how late the frame was
+    void RecordFrame(int64_t lateUS, int frameMS);
+
+    int GetJitterAvgUS() const { return _jitterAvgUS; }
+    int GetJitterMaxUS() const { return _jitterMaxUS; }
+    int GetCPUPercent() const { return _cpuPercent; }
+    uint32_t GetLateFrames() const { return _lateFrames; }
+
+    static int64_t GetThreadCPUTimeUS();
+    static int64_t GetTimeUS();
+};
@@ -355,7 +355,7 @@ void PacketData::CopyFrom(PacketData* source, long targetType)
             // converting from ARTNET
             _length = E131_PACKET_HEADERLEN + source->GetDataLength();
             InitialiseE131Header();
-            memcpy(source->GetDataPtr(), GetDataPtr(), GetDataLength());
+            memcpy(GetDataPtr(), source->GetDataPtr(), GetDataLength());
             memset(&_data[44], 0x00, 64);
             strncpy((char*)&_data[44], _tag.c_str(), 64);
             _data[111] = GetNextSequenceNum(_universe);
@@ -365,7 +365,7 @@ void PacketData::CopyFrom(PacketData* source, long targetType)
             // converting from E131
             _length = ARTNET_PACKET_HEADERLEN + source->GetDataLength();
             InitialiseArtNETHeader();
-            memcpy(source->GetDataPtr(), GetDataPtr(), GetDataLength());
+            memcpy(GetDataPtr(), source->GetDataPtr(), GetDataLength());
             _data[12] = GetNextSequenceNum(_universe);
         }
     }
@@ -8,6 +8,8 @@
 
 #include <log4cpp/Category.hh>
 
+#include <algorithm>
+
 Settings::Settings(std::string settings)
 {
     wxIPV4address addr;
@@ -29,6 +31,8 @@ Settings::Settings(std::string settings)
     _ArtNET = false;
     _defaultMIDIDevice = "";
     _frameMS = 50;
+    _mergeMode = 0;
+    _emitSpinUS = DEFAULT_EMIT_SPIN_US;
     Load(settings);
 }
 
@@ -182,6 +186,14 @@ std::string Settings::Serialise()
     {
         res += "|FRM:" + wxString::Format("%d", _frameMS);
     }
+    if (_mergeMode != 0)
+    {
+        res += "|MRG:" + wxString::Format("%d", _mergeMode);
+    }
+    if (_emitSpinUS != DEFAULT_EMIT_SPIN_US)
+    {
+        res += "|SPN:" + wxString::Format("%d", _emitSpinUS);
+    }
 
     res += "|TGT:";
     auto itd = _targetDesc.begin();
@@ -321,6 +333,14 @@ void Settings::Load(std::string settings)
             {
                 _frameMS = wxAtoi(s2[1]);
             }
+            else if (s2[0] == "MRG")
+            {
+                _mergeMode = wxAtoi(s2[1]);
+            }
+            else if (s2[0] == "SPN")
+            {
+                _emitSpinUS = std::max(0, wxAtoi(s2[1]));
+            }
             else if (s2[0] == "LOIP")
             {
                 _localOutputIP = s2[1];
@@ -4,11 +4,16 @@
 #include <map>
 #include <list>
 
+// sleeps can overshoot by a fraction of a millisecond so the emitter yields for this long before each frame
+#define DEFAULT_EMIT_SPIN_US 200
+
 class Settings
 {
 public:
 
     int _frameMS;
+    int _mergeMode; // MERGE_MODE
+    int _emitSpinUS; // how long before each frame the emitter stops sleeping and yields
     bool _minimiseUIUpdates;
     std::string _leftIP;
     std::string _rightIP;
@@ -31,6 +31,8 @@ const long SettingsDialog::ID_STATICTEXT11 = wxNewId();
 const long SettingsDialog::ID_TEXTCTRL2 = wxNewId();
 const long SettingsDialog::ID_STATICTEXT9 = wxNewId();
 const long SettingsDialog::ID_CHOICE1 = wxNewId();
+const long SettingsDialog::ID_STATICTEXT12 = wxNewId();
+const long SettingsDialog::ID_CHOICE2 = wxNewId();
 const long SettingsDialog::ID_CHECKBOX1 = wxNewId();
 const long SettingsDialog::ID_STATICTEXT4 = wxNewId();
 const long SettingsDialog::ID_LISTVIEW_UNIVERSES = wxNewId();
@@ -118,6 +120,14 @@ SettingsDialog::SettingsDialog(wxWindow* parent, Settings* settings, wxWindowID
     Choice_FrameTiming->Append(_("100ms"));
     FlexGridSizer6->Add(Choice_FrameTiming, 1, wxALL|wxEXPAND, 5);
     FlexGridSizer6->Add(-1,-1,1, wxALL|wxALIGN_CENTER_HORIZONTAL|wxALIGN_CENTER_VERTICAL, 5);
+    StaticText_MergeMode = new wxStaticText(this, ID_STATICTEXT12, _("Merge:"), wxDefaultPosition, wxDefaultSize, 0, _T("ID_STATICTEXT12"));
+    FlexGridSizer6->Add(StaticText_MergeMode, 1, wxALL|wxALIGN_LEFT|wxALIGN_CENTER_VERTICAL, 5);
+    Choice_MergeMode = new wxChoice(this, ID_CHOICE2, wxDefaultPosition, wxDefaultSize, 0, 0, 0, wxDefaultValidator, _T("ID_CHOICE2"));
+    Choice_MergeMode->SetSelection( Choice_MergeMode->Append(_("Crossfade")) );
+    Choice_MergeMode->Append(_("Highest takes precedence (HTP)"));
+    Choice_MergeMode->Append(_("Latest takes precedence (LTP)"));
+    FlexGridSizer6->Add(Choice_MergeMode, 1, wxALL|wxEXPAND, 5);
+    FlexGridSizer6->Add(-1,-1,1, wxALL|wxALIGN_CENTER_HORIZONTAL|wxALIGN_CENTER_VERTICAL, 5);
     FlexGridSizer6->Add(0,0,1, wxALL|wxALIGN_CENTER_HORIZONTAL|wxALIGN_CENTER_VERTICAL, 5);
     CheckBox_minimiseUIupdates = new wxCheckBox(this, ID_CHECKBOX1, _("Minimise UI updates for performance"), wxDefaultPosition, wxDefaultSize, 0, wxDefaultValidator, _T("ID_CHECKBOX1"));
     CheckBox_minimiseUIupdates->SetValue(false);
@@ -369,6 +379,8 @@ void SettingsDialog::Apply()
         _settings->_frameMS = 50;
     }
 
+    _settings->_mergeMode = Choice_MergeMode->GetSelection() == wxNOT_FOUND ? 0 : Choice_MergeMode->GetSelection();
+
     _settings->_localOutputIP = _localOutputIPCopy;
     _settings->_localInputIP = _localInputIPCopy;
     _settings->_E131 = CheckBox_E131->GetValue();
@@ -388,6 +400,10 @@ void SettingsDialog::PopulateFields()
     TextCtrl_LeftIP->SetValue(_settings->_leftIP);
     TextCtrl_RightIP->SetValue(_settings->_rightIP);
     CheckBox_minimiseUIupdates->SetValue(_settings->_minimiseUIUpdates);
+    if (_settings->_mergeMode >= 0 && _settings->_mergeMode < (int)Choice_MergeMode->GetCount())
+    {
+        Choice_MergeMode->SetSelection(_settings->_mergeMode);
+    }
 
     LoadUniverses();
     LoadFadeExclude();
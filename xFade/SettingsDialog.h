@@ -54,6 +54,7 @@ class SettingsDialog: public wxDialog
 		wxCheckBox* CheckBox_E131;
 		wxCheckBox* CheckBox_minimiseUIupdates;
 		wxChoice* Choice_FrameTiming;
+		wxChoice* Choice_MergeMode;
 		wxListView* ListViewFadeExclude;
 		wxListView* ListView_Universes;
 		wxStaticText* StaticText2;
@@ -64,6 +65,7 @@ class SettingsDialog: public wxDialog
 		wxStaticText* StaticText7;
 		wxStaticText* StaticText8;
 		wxStaticText* StaticText9;
+		wxStaticText* StaticText_MergeMode;
 		wxStaticText* StaticText_InputIP;
 		wxStaticText* StaticText_OutputIP;
 		wxTextCtrl* TextCtrl_LeftIP;
@@ -88,6 +90,8 @@ class SettingsDialog: public wxDialog
 		static const long ID_TEXTCTRL2;
 		static const long ID_STATICTEXT9;
 		static const long ID_CHOICE1;
+		static const long ID_STATICTEXT12;
+		static const long ID_CHOICE2;
 		static const long ID_CHECKBOX1;
 		static const long ID_STATICTEXT4;
 		static const long ID_LISTVIEW_UNIVERSES;
@@ -1,5 +1,8 @@
 #include "UniverseData.h"
 
+#define SLOT_INDEX 0x03
+#define SLOT_FRESH 0x80
+
 std::string UniverseData::__leftTag = "";
 std::string UniverseData::__rightTag = "";
 
@@ -24,91 +27,92 @@ UniverseData::UniverseData(int universe, const std::string& targetIP, const std:
     {
         wxASSERT(false);
     }
+
+    memset(_excludeMask, 0x00, sizeof(_excludeMask));
+    for (const auto& it : _excludedChannels)
+    {
+        if (it >= 1 && it <= MERGE_MAX_CHANNELS)
+        {
+            _excludeMask[it - 1] = 0xFF;
+            _hasExcluded = true;
+        }
+    }
+    memset(_lastLeft, 0x00, sizeof(_lastLeft));
+    memset(_lastRight, 0x00, sizeof(_lastRight));
+    memset(_owner, 0x00, sizeof(_owner));
 }
 
-int UniverseData::GetLeftSequenceNum()
+bool UniverseSlot::Update(int type, uint8_t* buffer, int size)
 {
-    std::unique_lock<std::mutex> lock(_lock);
-    return _left.GetSequenceNum();
+    // only ever contended if both protocols deliver the same side
+    while (_writing.test_and_set(std::memory_order_acquire)) {}
+
+    PacketData& back = _buffers[_back];
+    back._length = 0;
+    bool res = back.Update(type, buffer, size);
+    if (res && back._length > 0)
+    {
+        _sequenceNum = back.GetSequenceNum();
+        _back = _middle.exchange(_back | SLOT_FRESH, std::memory_order_acq_rel) & SLOT_INDEX;
+    }
+
+    _writing.clear(std::memory_order_release);
+    return res;
 }
 
-int UniverseData::GetRightSequenceNum()
+PacketData& UniverseSlot::Read()
 {
-    std::unique_lock<std::mutex> lock(_lock);
-    return _right.GetSequenceNum();
+    if (_middle.load(std::memory_order_relaxed) & SLOT_FRESH)
+    {
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & SLOT_INDEX;
+    }
+    return _buffers[_front];
 }
 
 bool UniverseData::UpdateLeft(int type, uint8_t* buffer, int size)
 {
-    std::unique_lock<std::mutex> lock(_lock);
     return _left.Update(type, buffer, size);
 }
 
 bool UniverseData::UpdateRight(int type, uint8_t* buffer, int size)
 {
-    std::unique_lock<std::mutex> lock(_lock);
     return _right.Update(type, buffer, size);
 }
 
-PacketData* UniverseData::GetOutput(PacketData* output, int leftBrightness, int rightBrightness, float pos)
+bool UniverseData::GetOutput(PacketData* output, MERGE_MODE mode, const MergeWeights& weights)
 {
-    std::unique_lock<std::mutex> lock(_lock);
+    static const uint8_t zero[MERGE_MAX_CHANNELS] = { 0 };
 
-    if (_left._length == 0 && _right._length > 0)
-    {
-        _left.InitialiseLength(_right._type, _right._length, _universe);
-    }
-    else if (_right._length == 0 && _left._length > 0)
-    {
-        _right.InitialiseLength(_left._type, _left._length, _universe);
-    }
+    PacketData& left = _left.Read();
+    PacketData& right = _right.Read();
+    int leftChannels = left.GetDataLength();
+    int rightChannels = right.GetDataLength();
 
-    if (pos == 0.0)
-    {
-        PrepareData(output, &_left, _targetProtocol);
-        output->ApplyBrightness(leftBrightness, _excludedChannels);
-    }
-    else if (pos == 1.0)
-    {
-        PrepareData(output, &_right, _targetProtocol);
-        output->ApplyBrightness(rightBrightness, _excludedChannels);
-    }
-    else
-    {
-        int sz = std::min(_left.GetDataLength(), _right.GetDataLength());
+    // the header comes from the side the fader is closest to unless it has not received anything yet
+    PacketData* base = weights.excludeFromRight ? &right : &left;
+    if (base->GetDataLength() == 0) base = (base == &left) ? &right : &left;
+    if (base->GetDataLength() == 0) return false;
 
-        PacketData l = _left;
-        PacketData r = _right;
-        l.ApplyBrightness(leftBrightness, _excludedChannels);
-        r.ApplyBrightness(rightBrightness, _excludedChannels);
+    PrepareData(output, base, _targetProtocol);
 
-        Blend(l.GetDataPtr(), r.GetDataPtr(), sz, pos, _excludedChannels);
-        PrepareData(output, &l, _targetProtocol);
-    }
-    return output;
-}
+    // a side which has not received data yet, or has fewer channels, merges as zeros
+    int channels = output->GetDataLength();
+    const uint8_t* l = leftChannels > 0 ? left.GetDataPtr() : zero;
+    const uint8_t* r = rightChannels > 0 ? right.GetDataPtr() : zero;
+    int lc = leftChannels > 0 ? leftChannels : channels;
+    int rc = rightChannels > 0 ? rightChannels : channels;
+    int common = std::min(channels, std::min(lc, rc));
+    const uint8_t* mask = _hasExcluded ? _excludeMask : nullptr;
+    uint8_t* out = output->GetDataPtr();
 
-void UniverseData::Blend(uint8_t* buffer, uint8_t* blendBuffer, size_t channels, float pos, std::list<int> excludeChannels)
-{
-    float inv = 1.0 - pos;
-    for (size_t i = 0; i < channels; ++i)
+    MergeEngine::Merge(mode, out, l, r, _lastLeft, _lastRight, _owner, mask, common, weights);
+    if (common < channels)
     {
-        if (std::find(excludeChannels.begin(), excludeChannels.end(), i + 1) != excludeChannels.end())
-        {
-            if (pos < 0.5)
-            {
-                // dont change anything
-            }
-            else
-            {
-                *(buffer + i) = *(blendBuffer + i);
-            }
-        }
-        else
-        {
-            *(buffer + i) = (uint8_t)((float) * (buffer + i) * inv + (float) * (blendBuffer + i) * pos);
-        }
+        const uint8_t* lt = lc >= channels ? l + common : zero;
+        const uint8_t* rt = rc >= channels ? r + common : zero;
+        MergeEngine::Merge(mode, out + common, lt, rt, _lastLeft + common, _lastRight + common, _owner + common, mask == nullptr ? nullptr : mask + common, channels - common, weights);
     }
+    return true;
 }
 
 void UniverseData::PrepareData(PacketData* target, PacketData* source, int protocol)
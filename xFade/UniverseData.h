@@ -1,21 +1,48 @@
 #pragma once
 
-#include <mutex>
+#include <atomic>
 
 #include "PacketData.h"
+#include "MergeEngine.h"
+
+// Hands the latest packet for one side of a universe from the receiver threads
+// to the emitter without either side blocking the other. Three buffers rotate:
+// the receiver fills the back buffer and swaps it into the middle, the emitter
+// swaps the middle into the front only when something new has arrived.
+class UniverseSlot
+{
+    PacketData _buffers[3];
+    std::atomic<uint8_t> _middle; // = 1 plus SLOT_FRESH when unread
+    uint8_t _back = 2;
+    uint8_t _front = 0;
+    std::atomic<int> _sequenceNum; // = -1;
+    std::atomic_flag _writing = ATOMIC_FLAG_INIT; // E1.31 and ArtNET receivers may both feed the same side
+
+public:
+
+    UniverseSlot() : _middle(1), _sequenceNum(-1) {}
+    bool Update(int type, uint8_t* buffer, int size);
+    PacketData& Read(); // emitter thread only
+    int GetSequenceNum() const { return _sequenceNum; }
+};
 
 class UniverseData
 {
     int _universe = 0;
     int _targetProtocol = 0;
-    std::mutex _lock;
-    PacketData _left;
-    PacketData _right;
+    UniverseSlot _left;
+    UniverseSlot _right;
     std::string _targetIP;
     std::list<int> _excludedChannels;
+    bool _hasExcluded = false;
+    uint8_t _excludeMask[MERGE_MAX_CHANNELS];
+
+    // LTP state, only touched by the emitter thread
+    uint8_t _lastLeft[MERGE_MAX_CHANNELS];
+    uint8_t _lastRight[MERGE_MAX_CHANNELS];
+    uint8_t _owner[MERGE_MAX_CHANNELS];
 
     void PrepareData(PacketData* target, PacketData* source, int protocol);
-    void Blend(uint8_t* buffer, uint8_t* blendBuffer, size_t channels, float pos, std::list<int> excludeChannels);
 
 public:
 
@@ -26,14 +53,14 @@ public:
     static void SetLeftTag(const std::string& left) { __leftTag = left; }
     static void SetRightTag(const std::string& right) { __rightTag = right; }
     int GetUniverse() const { return _universe; }
-    std::mutex& GetLock() { return _lock; }
     std::string GetTargetIP() const { return _targetIP; }
     bool UpdateLeft(int type, uint8_t* buffer, int size);
     bool UpdateRight(int type, uint8_t* buffer, int size);
-    int GetLeftSequenceNum();
-    int GetRightSequenceNum();
+    int GetLeftSequenceNum() const { return _left.GetSequenceNum(); }
+    int GetRightSequenceNum() const { return _right.GetSequenceNum(); }
     int GetOutputFormat() const { return _targetProtocol; }
     UniverseData(int universe, const std::string& targetIP, const std::string& targetProtocol, std::list<int> excludedChannels);
     virtual ~UniverseData() {}
-    PacketData* GetOutput(PacketData* output, int leftBrightness, int rightBrightness, float pos);
+    // merges the latest left and right data into output, returns false if there is nothing to send yet
+    bool GetOutput(PacketData* output, MERGE_MODE mode, const MergeWeights& weights);
 };
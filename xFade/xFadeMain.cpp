@@ -704,6 +704,7 @@ void xFadeFrame::SetTiming()
 {
     if (_emitter != nullptr) {
         _emitter->SetFrameMS(_settings._frameMS);
+        _emitter->SetMergeMode((MERGE_MODE)_settings._mergeMode);
     }
 }
 
@@ -1145,9 +1146,10 @@ void xFadeFrame::OnTimer_StatusTrigger(wxTimerEvent& event)
     StatusBar1->SetStatusText(wxString::Format("Left: %u", leftReceived), 0);
     StatusBar1->SetStatusText(wxString::Format("Right: %u", rightReceived), 2);
     if (_emitter != nullptr) {
-        StatusBar1->SetStatusText(wxString::Format("Sent: %u", _emitter->GetSent()), 1);
+        const EmissionStats& stats = _emitter->GetStats();
+        StatusBar1->SetStatusText(wxString::Format("Sent: %u Jitter: %.1f/%.1fms CPU: %d%%", _emitter->GetSent(), stats.GetJitterAvgUS() / 1000.0, stats.GetJitterMaxUS() / 1000.0, stats.GetCPUPercent()), 1);
         if (count % 60 == 0) {
-            logger_base.debug("Activity - Left Received %u, Right Received %u, Sent %u.", leftReceived, rightReceived, _emitter->GetSent());
+            logger_base.debug("Activity - Left Received %u, Right Received %u, Sent %u, Jitter avg %dus max %dus, Late frames %u, Emitter CPU %d%%.", leftReceived, rightReceived, _emitter->GetSent(), stats.GetJitterAvgUS(), stats.GetJitterMaxUS(), stats.GetLateFrames(), stats.GetCPUPercent());
         }
     } else {
         StatusBar1->SetStatusText("Sending disabled", 1);
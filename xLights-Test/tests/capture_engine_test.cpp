@@ -0,0 +1,195 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include "pch.h"
+
+#include "../xCapture/CaptureEngine.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET socket_t;
+#define CLOSESOCKET closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define CLOSESOCKET close
+#endif
+
+// small so the ring wraps many times during a test
+#define TEST_RING_SLOTS 128
+#define TEST_PACKETS 20000
+#define TEST_UNIVERSES 8
+#define TEST_DMX_SIZE 512
+
+// Sends numbered E1.31 packets to the engine over loopback. The packet number
+// is carried in the first four channels so the consumer can check each one.
+struct Capture_Engine_Tests : public ::testing::Test
+{
+    CaptureEngine engine;
+    socket_t sender;
+    sockaddr_in dest;
+
+    Capture_Engine_Tests() : engine(TEST_RING_SLOTS)
+    {
+        sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        memset(&dest, 0, sizeof(dest));
+        dest.sin_family = AF_INET;
+        dest.sin_addr.s_addr = inet_addr("127.0.0.1");
+        dest.sin_port = htons(E131PORT);
+    }
+
+    ~Capture_Engine_Tests()
+    {
+        engine.Stop();
+        CLOSESOCKET(sender);
+    }
+
+    void Send(uint32_t number)
+    {
+        uint8_t packet[126 + TEST_DMX_SIZE];
+        memset(packet, 0, sizeof(packet));
+        memcpy(&packet[4], "ASC-E1.17", 9);
+        packet[111] = (uint8_t)number;
+        int universe = 1 + number % TEST_UNIVERSES;
+        packet[113] = (uint8_t)(universe >> 8);
+        packet[114] = (uint8_t)(universe & 0xFF);
+        packet[115] = (uint8_t)(0x70 + ((TEST_DMX_SIZE + 11) >> 8));
+        packet[116] = (uint8_t)((TEST_DMX_SIZE + 11) & 0xFF);
+        packet[126] = (uint8_t)(number >> 24);
+        packet[127] = (uint8_t)(number >> 16);
+        packet[128] = (uint8_t)(number >> 8);
+        packet[129] = (uint8_t)number;
+        sendto(sender, (const char*)packet, sizeof(packet), 0, (sockaddr*)&dest, sizeof(dest));
+    }
+
+    // checks the packet is what Send built and returns its number
+    static uint32_t Check(const CapturedPacket& p)
+    {
+        int universe = 0;
+        int seq = 0;
+        const uint8_t* data = nullptr;
+        int length = 0;
+        EXPECT_TRUE(p.GetDMX(universe, seq, data, length));
+        EXPECT_EQ(TEST_DMX_SIZE, length);
+        if (data == nullptr || length < 4) {
+            return 0xFFFFFFFF;
+        }
+        uint32_t number = ((uint32_t)data[0] << 24) + ((uint32_t)data[1] << 16) + ((uint32_t)data[2] << 8) + data[3];
+        EXPECT_EQ((int)(1 + number % TEST_UNIVERSES), universe);
+        EXPECT_EQ((int)(uint8_t)number, seq);
+        return number;
+    }
+
+    // wait up to 10 seconds for a condition the other threads will make true
+    template<typename T>
+    static bool WaitFor(T condition)
+    {
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > until) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+};
+
+TEST_F(Capture_Engine_Tests, EveryPacketDeliveredWhileDraining) {
+    engine.Start(true, false, "127.0.0.1", {});
+    ASSERT_TRUE(engine.IsListening(CaptureProtocol::E131));
+
+    std::atomic<uint32_t> delivered = 0;
+    std::atomic<bool> outOfOrder = false;
+    std::atomic<bool> stop = false;
+
+    // drains a few packets at a time so it is always racing the receive thread
+    std::thread consumer([&]() {
+        uint32_t next = 0;
+        auto handler = [&](const CapturedPacket& p) {
+            if (Check(p) != next) {
+                outOfOrder = true;
+            }
+            next++;
+        };
+        size_t count = 0;
+        while (!stop) {
+            delivered += (uint32_t)engine.Drain(handler, 1 + count++ % 7);
+            if (count % 64 == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        delivered += (uint32_t)engine.Drain(handler);
+    });
+
+    // keep less than a ring full outstanding so nothing has to be dropped
+    bool sent = true;
+    for (uint32_t i = 0; i < TEST_PACKETS && sent; i++) {
+        sent = WaitFor([&]() { return i - delivered < TEST_RING_SLOTS / 2; });
+        Send(i);
+    }
+    bool all = sent && WaitFor([&]() { return delivered == TEST_PACKETS; });
+    stop = true;
+    consumer.join();
+
+    ASSERT_TRUE(all) << "delivered " << delivered << " received " << engine.GetReceivedCount();
+    ASSERT_FALSE(outOfOrder);
+    ASSERT_EQ(TEST_PACKETS, delivered);
+    ASSERT_EQ(TEST_PACKETS, engine.GetReceivedCount());
+    ASSERT_EQ(0, engine.GetDroppedCount());
+    ASSERT_EQ(0, engine.GetBacklog());
+}
+
+TEST_F(Capture_Engine_Tests, PacketsOnlyLostWhenRingIsFullAreCountedAsDropped) {
+    engine.Start(true, false, "127.0.0.1", {});
+    ASSERT_TRUE(engine.IsListening(CaptureProtocol::E131));
+
+    // fill the ring and then some with nobody draining
+    uint32_t sent = 0;
+    for (; sent < TEST_RING_SLOTS * 3; sent++) {
+        ASSERT_TRUE(WaitFor([&]() { return sent - engine.GetReceivedCount() < 16; }));
+        Send(sent);
+    }
+    ASSERT_TRUE(WaitFor([&]() { return engine.GetReceivedCount() == sent; }));
+    ASSERT_EQ(TEST_RING_SLOTS, engine.GetBacklog());
+    ASSERT_EQ(sent - TEST_RING_SLOTS, engine.GetDroppedCount());
+
+    // what made it into the ring is the oldest packets, in order
+    uint32_t next = 0;
+    size_t drained = engine.Drain([&next](const CapturedPacket& p) {
+        EXPECT_EQ(next, Check(p));
+        next++;
+    });
+    ASSERT_EQ(TEST_RING_SLOTS, drained);
+
+    // and once there is room again nothing more is lost
+    for (uint32_t i = 0; i < TEST_RING_SLOTS / 2; i++) {
+        Send(sent + i);
+    }
+    ASSERT_TRUE(WaitFor([&]() { return engine.GetBacklog() == TEST_RING_SLOTS / 2; }));
+    next = sent;
+    drained = engine.Drain([&next](const CapturedPacket& p) {
+        EXPECT_EQ(next, Check(p));
+        next++;
+    });
+    ASSERT_EQ(TEST_RING_SLOTS / 2, drained);
+    ASSERT_EQ(engine.GetReceivedCount(), TEST_RING_SLOTS + drained + engine.GetDroppedCount());
+}
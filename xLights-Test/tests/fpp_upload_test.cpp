@@ -0,0 +1,436 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include "pch.h"
+
+#include "../xLights/controllers/FPPUploadManifest.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET socket_t;
+#define CLOSESOCKET closesocket
+#define poll WSAPoll
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define CLOSESOCKET close
+#endif
+
+#define CHUNK_SIZE (512 * 1024)
+
+struct HttpMessage
+{
+    std::string start;
+    std::map<std::string, std::string> headers;
+    std::string body;
+};
+
+// reads a request or response with a Content-Length body off a blocking socket
+static bool ReadMessage(socket_t s, HttpMessage& msg)
+{
+    std::string data;
+    char buf[65536];
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+        int r = recv(s, buf, sizeof(buf), 0);
+        if (r <= 0) {
+            return false;
+        }
+        data.append(buf, r);
+    }
+    size_t pos = data.find("\r\n");
+    msg.start = data.substr(0, pos);
+    while (pos < end) {
+        size_t next = data.find("\r\n", pos + 2);
+        std::string line = data.substr(pos + 2, next - pos - 2);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            msg.headers[line.substr(0, colon)] = line.substr(line.find_first_not_of(' ', colon + 1));
+        }
+        pos = next;
+    }
+    size_t length = msg.headers.count("Content-Length") ? std::stoull(msg.headers["Content-Length"]) : 0;
+    msg.body = data.substr(end + 4);
+    while (msg.body.size() < length) {
+        int r = recv(s, buf, sizeof(buf), 0);
+        if (r <= 0) {
+            return false;
+        }
+        msg.body.append(buf, r);
+    }
+    return true;
+}
+
+static bool SendAll(socket_t s, const std::string& data)
+{
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int r = send(s, data.c_str() + sent, (int)(data.size() - sent), 0);
+        if (r <= 0) {
+            return false;
+        }
+        sent += r;
+    }
+    return true;
+}
+
+// Stands in for the parts of the FPP file api uploadFileV7 uses. PATCH /api/file/<dir> adds to a
+// partial upload which is moved into the directory once it has Upload-Length bytes, and
+// GET /api/files/<dir> lists what is there.
+class FakeFPP
+{
+    socket_t _listener;
+    uint16_t _port = 0;
+    std::atomic<bool> _stop = false;
+    std::thread _thread;
+
+    std::mutex _lock;
+    std::map<std::string, std::string> _partials;
+    std::map<std::string, std::string> _files;
+    size_t _patches = 0;
+    size_t _rejected = 0;
+    size_t _bytesReceived = 0;
+
+    std::string Handle(const HttpMessage& req)
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        if (req.start.rfind("PATCH /api/file/", 0) == 0) {
+            ++_patches;
+            std::string dir = req.start.substr(16, req.start.find(' ', 16) - 16);
+            std::string name = dir + "/" + req.headers.at("Upload-Name");
+            size_t offset = std::stoull(req.headers.at("Upload-Offset"));
+            size_t length = std::stoull(req.headers.at("Upload-Length"));
+            std::string& partial = _partials[name];
+            if (offset > partial.size()) {
+                // nothing to append to, the player lost or never had the start
+                ++_rejected;
+                return "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+            }
+            _bytesReceived += req.body.size();
+            partial.resize(offset);
+            partial += req.body;
+            if (partial.size() >= length) {
+                _files[name] = partial;
+                _partials.erase(name);
+            }
+            return "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+        }
+        if (req.start.rfind("GET /api/files/", 0) == 0) {
+            std::string dir = req.start.substr(15, req.start.find(' ', 15) - 15);
+            std::string body = "{\"files\":[";
+            bool first = true;
+            for (const auto& it : _files) {
+                if (it.first.rfind(dir + "/", 0) == 0) {
+                    body += std::string(first ? "" : ",") + "{\"name\":\"" + it.first.substr(dir.size() + 1) + "\",\"sizeBytes\":" + std::to_string(it.second.size()) + "}";
+                    first = false;
+                }
+            }
+            body += "]}";
+            return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        }
+        return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    }
+
+    void Serve()
+    {
+        pollfd pfd;
+        pfd.fd = _listener;
+        pfd.events = POLLIN;
+        while (!_stop) {
+            pfd.revents = 0;
+            if (poll(&pfd, 1, 20) <= 0 || !(pfd.revents & POLLIN)) {
+                continue;
+            }
+            socket_t c = accept(_listener, nullptr, nullptr);
+            HttpMessage req;
+            if (ReadMessage(c, req)) {
+                SendAll(c, Handle(req));
+            }
+            CLOSESOCKET(c);
+        }
+    }
+
+public:
+    FakeFPP()
+    {
+        _listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        bind(_listener, (sockaddr*)&addr, sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(_listener, (sockaddr*)&addr, &len);
+        _port = ntohs(addr.sin_port);
+        listen(_listener, 16);
+        _thread = std::thread(&FakeFPP::Serve, this);
+    }
+
+    ~FakeFPP()
+    {
+        _stop = true;
+        _thread.join();
+        CLOSESOCKET(_listener);
+    }
+
+    uint16_t GetPort() const { return _port; }
+
+    std::string GetFile(const std::string& name)
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        auto it = _files.find(name);
+        return it == _files.end() ? "" : it->second;
+    }
+    // as if the player was rebooted part way through an upload
+    void DropPartials()
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _partials.clear();
+    }
+    size_t GetPatches()
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        return _patches;
+    }
+    size_t GetRejected()
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        return _rejected;
+    }
+    size_t GetBytesReceived()
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        return _bytesReceived;
+    }
+};
+
+// Sends data to the player the way FPP::uploadFileV7 does, stopping after maxChunks
+// acknowledged chunks to stand in for xLights being closed part way through.
+class Uploader
+{
+    uint16_t _port;
+
+    int Request(const std::string& request, HttpMessage& resp)
+    {
+        socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(_port);
+        int rc = 0;
+        if (connect(s, (sockaddr*)&addr, sizeof(addr)) == 0 && SendAll(s, request) && ReadMessage(s, resp)) {
+            rc = std::stoi(resp.start.substr(resp.start.find(' ') + 1, 3));
+        }
+        CLOSESOCKET(s);
+        return rc;
+    }
+
+public:
+    Uploader(uint16_t port) :
+        _port(port) {}
+
+    std::string Key(const std::string& dir, const std::string& filename) const
+    {
+        return "127.0.0.1:" + std::to_string(_port) + "/" + dir + "/" + filename;
+    }
+
+    void Upload(const std::string& dir, const std::string& filename, const std::string& data, int maxChunks = -1)
+    {
+        std::string key = Key(dir, filename);
+        size_t pos = 0;
+        FPPUploadManifest manifest = FPPUploadManifest::ForData(data.size(), [&](uint8_t* buf, size_t size) {
+            size = std::min(size, data.size() - pos);
+            memcpy(buf, data.data() + pos, size);
+            pos += size;
+            return size;
+        });
+        FPPUploadManifest last;
+        bool haveLast = FPPUploadManifest::Find(key, last);
+        if (haveLast && manifest.IsUploaded(last)) {
+            HttpMessage resp;
+            std::string listing = "\"name\":\"" + filename + "\",\"sizeBytes\":" + std::to_string(data.size()) + "}";
+            if (Request("GET /api/files/" + dir + " HTTP/1.1\r\nContent-Length: 0\r\n\r\n", resp) == 200 && resp.body.find(listing) != std::string::npos) {
+                return;
+            }
+        }
+        size_t offset = haveLast ? manifest.ResumeOffset(last) : 0;
+        int errorCount = 0;
+        int chunks = 0;
+        while (offset < data.size() && chunks != maxChunks) {
+            size_t remaining = std::min((size_t)CHUNK_SIZE, data.size() - offset);
+            std::string request = "PATCH /api/file/" + dir + " HTTP/1.1\r\n" +
+                                  "Upload-Offset: " + std::to_string(offset) + "\r\n" +
+                                  "Upload-Length: " + std::to_string(data.size()) + "\r\n" +
+                                  "Upload-Name: " + filename + "\r\n" +
+                                  "Content-Length: " + std::to_string(remaining) + "\r\n\r\n" +
+                                  data.substr(offset, remaining);
+            HttpMessage resp;
+            int rc = Request(request, resp);
+            if (rc != 200 && errorCount < 3) {
+                offset = 0;
+                ++errorCount;
+                FPPUploadManifest::Record(key, manifest, 0);
+            } else if (rc != 200) {
+                return;
+            } else {
+                offset += remaining;
+                FPPUploadManifest::Record(key, manifest, offset);
+                ++chunks;
+            }
+        }
+    }
+};
+
+struct FPP_Upload_Tests : public ::testing::Test
+{
+    std::string manifestFile;
+
+    FPP_Upload_Tests()
+    {
+#ifdef _WIN32
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+        manifestFile = (std::filesystem::temp_directory_path() / ("xlights_fppuploads_" + std::to_string((uintptr_t)this) + ".dat")).string();
+        std::filesystem::remove(manifestFile);
+        FPPUploadManifest::SetFile(manifestFile);
+    }
+
+    ~FPP_Upload_Tests()
+    {
+        FPPUploadManifest::SetFile("");
+        std::filesystem::remove(manifestFile);
+    }
+
+    // forgets everything held in memory and loads the manifests back as a new xLights would
+    void Restart()
+    {
+        FPPUploadManifest::SetFile("");
+        FPPUploadManifest::SetFile(manifestFile);
+    }
+
+    static std::string MakeData(size_t size)
+    {
+        std::string data(size, 0);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = (char)((i * 2654435761u) >> 13);
+        }
+        return data;
+    }
+};
+
+TEST_F(FPP_Upload_Tests, UnchangedFileIsSkippedAfterRestart) {
+    FakeFPP fpp;
+    Uploader uploader(fpp.GetPort());
+    std::string data = MakeData(3 * FPPUploadManifest::BLOCK_SIZE + 1234);
+
+    uploader.Upload("sequences", "show.fseq", data);
+    ASSERT_EQ(data, fpp.GetFile("sequences/show.fseq"));
+    size_t patches = fpp.GetPatches();
+
+    Restart();
+    uploader.Upload("sequences", "show.fseq", data);
+    ASSERT_EQ(patches, fpp.GetPatches());
+}
+
+TEST_F(FPP_Upload_Tests, InterruptedUploadResumesAfterRestart) {
+    FakeFPP fpp;
+    Uploader uploader(fpp.GetPort());
+    std::string data = MakeData(3 * FPPUploadManifest::BLOCK_SIZE + 1234);
+
+    uploader.Upload("sequences", "show.fseq", data, 3);
+    ASSERT_EQ("", fpp.GetFile("sequences/show.fseq"));
+    ASSERT_EQ(3 * CHUNK_SIZE, fpp.GetBytesReceived());
+
+    Restart();
+    uploader.Upload("sequences", "show.fseq", data);
+    ASSERT_EQ(data, fpp.GetFile("sequences/show.fseq"));
+    ASSERT_EQ(data.size(), fpp.GetBytesReceived());
+    ASSERT_EQ(0, fpp.GetRejected());
+}
+
+TEST_F(FPP_Upload_Tests, InterruptedUploadResumesFromFirstChangedBlock) {
+    FakeFPP fpp;
+    Uploader uploader(fpp.GetPort());
+    std::string data = MakeData(3 * FPPUploadManifest::BLOCK_SIZE + 1234);
+
+    uploader.Upload("sequences", "show.fseq", data, 3);
+    data[FPPUploadManifest::BLOCK_SIZE + 10] ^= 0xFF;
+
+    Restart();
+    uploader.Upload("sequences", "show.fseq", data);
+    ASSERT_EQ(data, fpp.GetFile("sequences/show.fseq"));
+    ASSERT_EQ(3 * CHUNK_SIZE + data.size() - FPPUploadManifest::BLOCK_SIZE, fpp.GetBytesReceived());
+}
+
+TEST_F(FPP_Upload_Tests, ChangedFileIsSentAgainInFull) {
+    FakeFPP fpp;
+    Uploader uploader(fpp.GetPort());
+    std::string data = MakeData(3 * FPPUploadManifest::BLOCK_SIZE + 1234);
+
+    uploader.Upload("sequences", "show.fseq", data);
+    data[data.size() - 10] ^= 0xFF;
+
+    Restart();
+    uploader.Upload("sequences", "show.fseq", data);
+    ASSERT_EQ(data, fpp.GetFile("sequences/show.fseq"));
+    ASSERT_EQ(2 * data.size(), fpp.GetBytesReceived());
+}
+
+TEST_F(FPP_Upload_Tests, LostPartialIsSentFromStart) {
+    FakeFPP fpp;
+    Uploader uploader(fpp.GetPort());
+    std::string data = MakeData(3 * FPPUploadManifest::BLOCK_SIZE + 1234);
+
+    uploader.Upload("sequences", "show.fseq", data, 3);
+    fpp.DropPartials();
+
+    Restart();
+    uploader.Upload("sequences", "show.fseq", data);
+    ASSERT_EQ(data, fpp.GetFile("sequences/show.fseq"));
+    ASSERT_EQ(1, fpp.GetRejected());
+}
+
+TEST_F(FPP_Upload_Tests, DamagedManifestIsIgnored) {
+    FakeFPP fpp;
+    Uploader uploader(fpp.GetPort());
+    std::string data = MakeData(FPPUploadManifest::BLOCK_SIZE / 2);
+
+    uploader.Upload("sequences", "show.fseq", data);
+    FPPUploadManifest::SetFile("");
+    {
+        std::ofstream out(manifestFile, std::ios::app);
+        out << uploader.Key("sequences", "other.fseq") << "\n12 not numbers\n";
+    }
+    FPPUploadManifest::SetFile(manifestFile);
+
+    FPPUploadManifest last;
+    ASSERT_FALSE(FPPUploadManifest::Find(uploader.Key("sequences", "show.fseq"), last));
+    uploader.Upload("sequences", "show.fseq", data);
+    ASSERT_EQ(2 * data.size(), fpp.GetBytesReceived());
+}
@@ -0,0 +1,183 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include "pch.h"
+
+#include "../xLights/utils/ProbeEngine.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET socket_t;
+#define CLOSESOCKET closesocket
+#define poll WSAPoll
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define CLOSESOCKET close
+#endif
+
+#define FAKE_CONTROLLERS 64
+#define CLOSED_PORTS 16
+
+// A fleet of fake web based controllers listening on loopback ports all served from one thread
+class FakeControllerFleet
+{
+    std::vector<socket_t> _listeners;
+    std::vector<uint16_t> _ports;
+    std::vector<uint16_t> _closedPorts;
+    std::atomic<bool> _stop = false;
+    std::thread _thread;
+
+    static socket_t Listen(uint16_t& port)
+    {
+        socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        bind(s, (sockaddr*)&addr, sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(s, (sockaddr*)&addr, &len);
+        port = ntohs(addr.sin_port);
+        return s;
+    }
+
+    void Serve()
+    {
+        static const std::string page = "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\n\r\n<html><head><title>ESPixelStick</title></head><body>ESPixelStick</body></html>";
+        std::vector<pollfd> fds;
+        for (const auto& it : _listeners) {
+            pollfd pfd;
+            pfd.fd = it;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+        }
+        while (!_stop) {
+            if (poll(fds.data(), (unsigned long)fds.size(), 20) <= 0) {
+                continue;
+            }
+            for (auto& it : fds) {
+                if (it.revents & POLLIN) {
+                    socket_t c = accept(it.fd, nullptr, nullptr);
+                    char buf[1024];
+                    recv(c, buf, sizeof(buf), 0);
+                    send(c, page.c_str(), (int)page.size(), 0);
+                    CLOSESOCKET(c);
+                }
+                it.revents = 0;
+            }
+        }
+    }
+
+public:
+    FakeControllerFleet(size_t controllers, size_t closed)
+    {
+        for (size_t i = 0; i < controllers; i++) {
+            uint16_t port = 0;
+            socket_t s = Listen(port);
+            listen(s, 16);
+            _listeners.push_back(s);
+            _ports.push_back(port);
+        }
+        // bind and release so we get ports nothing is listening on
+        for (size_t i = 0; i < closed; i++) {
+            uint16_t port = 0;
+            CLOSESOCKET(Listen(port));
+            _closedPorts.push_back(port);
+        }
+        _thread = std::thread(&FakeControllerFleet::Serve, this);
+    }
+
+    ~FakeControllerFleet()
+    {
+        _stop = true;
+        _thread.join();
+        for (const auto& it : _listeners) {
+            CLOSESOCKET(it);
+        }
+    }
+
+    const std::vector<uint16_t>& GetPorts() const { return _ports; }
+    const std::vector<uint16_t>& GetClosedPorts() const { return _closedPorts; }
+};
+
+struct Probe_Engine_Tests : public ::testing::Test
+{
+    Probe_Engine_Tests()
+    {
+#ifdef _WIN32
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+    }
+};
+
+TEST_F(Probe_Engine_Tests, LoopbackFleet) {
+    FakeControllerFleet fleet(FAKE_CONTROLLERS, CLOSED_PORTS);
+
+    std::mutex lock;
+    std::set<uint16_t> found;
+    std::atomic<int> done = 0;
+
+    // allow plenty in flight per host as the whole fleet is on 127.0.0.1
+    ProbeEngine engine(2048, FAKE_CONTROLLERS + CLOSED_PORTS, 0);
+    auto start = std::chrono::steady_clock::now();
+    engine.Start();
+
+    auto submit = [&](uint16_t port) {
+        ProbeRequest req;
+        req.type = ProbeType::HTTP;
+        req.ip = "127.0.0.1";
+        req.port = port;
+        req.timeoutMS = 2000;
+        req.callback = [&](const ProbeResult& res) {
+            if (res.ok && res.response.find("ESPixelStick") != std::string::npos) {
+                std::unique_lock<std::mutex> l(lock);
+                found.insert(res.port);
+            }
+            done++;
+        };
+        engine.Submit(std::move(req));
+    };
+    for (const auto& it : fleet.GetPorts()) {
+        submit(it);
+    }
+    for (const auto& it : fleet.GetClosedPorts()) {
+        submit(it);
+    }
+
+    while (done < FAKE_CONTROLLERS + CLOSED_PORTS && std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    engine.Stop();
+
+    RecordProperty("ElapsedMS", (int)elapsed);
+
+    EXPECT_EQ(done, FAKE_CONTROLLERS + CLOSED_PORTS);
+    EXPECT_EQ(found.size(), (size_t)FAKE_CONTROLLERS);
+    EXPECT_TRUE(engine.IsIdle());
+}
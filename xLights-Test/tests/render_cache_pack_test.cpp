@@ -0,0 +1,239 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include "pch.h"
+
+#include "../xLights/RenderCachePack.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::shared_ptr<const std::vector<uint8_t>> Record;
+
+// run once with a memory mapped pack and once with a compressed one
+struct Render_Cache_Pack_Tests : public ::testing::TestWithParam<bool>
+{
+    std::string packFile;
+
+    Render_Cache_Pack_Tests()
+    {
+        packFile = (std::filesystem::temp_directory_path() / ("xlights_rendercache_" + std::to_string((uintptr_t)this) + "." + RenderCachePack::GetExtension())).string();
+        std::filesystem::remove(packFile);
+    }
+
+    ~Render_Cache_Pack_Tests()
+    {
+        std::filesystem::remove(packFile);
+        std::filesystem::remove(packFile + ".tmp");
+    }
+
+    bool UseMMap() const
+    {
+        return GetParam();
+    }
+
+    // does not compress so is stored the same size either way
+    static Record MakeRecord(size_t size, uint8_t seed)
+    {
+        auto data = std::make_shared<std::vector<uint8_t>>(size);
+        uint32_t v = seed;
+        for (size_t i = 0; i < size; i++) {
+            v = v * 1664525u + 1013904223u;
+            (*data)[i] = (uint8_t)(v >> 24);
+        }
+        return data;
+    }
+
+    static Record MakeCompressibleRecord(size_t size, uint8_t seed)
+    {
+        auto data = std::make_shared<std::vector<uint8_t>>(size);
+        for (size_t i = 0; i < size; i++) {
+            (*data)[i] = (uint8_t)(seed + i / 64);
+        }
+        return data;
+    }
+
+    // opens the pack as a new xLights would and reads back everything in it
+    std::map<std::string, std::vector<uint8_t>> Reopen()
+    {
+        std::map<std::string, std::vector<uint8_t>> items;
+        RenderCachePack pack(packFile, UseMMap());
+        pack.Load([&items](const std::string& key, const uint8_t* data, size_t size, const std::shared_ptr<const void>& keepAlive) {
+            EXPECT_EQ(0, items.count(key));
+            items[key] = std::vector<uint8_t>(data, data + size);
+            return true;
+        });
+        return items;
+    }
+
+    uint64_t FileSize() const
+    {
+        return std::filesystem::file_size(packFile);
+    }
+};
+
+TEST_P(Render_Cache_Pack_Tests, WriteReopenLoad) {
+    Record a1 = MakeRecord(100, 1);
+    Record b = MakeCompressibleRecord(50000, 2);
+    Record c = MakeRecord(33, 3);
+    Record a2 = MakeCompressibleRecord(20000, 4);
+    {
+        RenderCachePack pack(packFile, UseMMap());
+        pack.Write("a", a1);
+        pack.Write("b", b);
+        pack.Write("c", c);
+        pack.Remove("b");
+        pack.Remove("never saved");
+        pack.Write("a", a2);
+    }
+
+    auto items = Reopen();
+    ASSERT_EQ(2, items.size());
+    ASSERT_EQ(*a2, items["a"]);
+    ASSERT_EQ(*c, items["c"]);
+}
+
+TEST_P(Render_Cache_Pack_Tests, WritesQueuedBeforeLoadFollowExistingRecords) {
+    Record a = MakeRecord(5000, 1);
+    Record b = MakeRecord(6000, 2);
+    Record c = MakeRecord(7000, 3);
+    {
+        RenderCachePack pack(packFile, UseMMap());
+        pack.Write("a", a);
+    }
+    {
+        RenderCachePack pack(packFile, UseMMap());
+        pack.Write("b", b);
+        std::map<std::string, size_t> loaded;
+        pack.Load([&loaded](const std::string& key, const uint8_t* data, size_t size, const std::shared_ptr<const void>& keepAlive) {
+            loaded[key] = size;
+            return true;
+        });
+        // only what was in the file when it was opened
+        ASSERT_EQ(1, loaded.size());
+        ASSERT_EQ(a->size(), loaded["a"]);
+        pack.Write("c", c);
+    }
+
+    auto items = Reopen();
+    ASSERT_EQ(3, items.size());
+    ASSERT_EQ(*a, items["a"]);
+    ASSERT_EQ(*b, items["b"]);
+    ASSERT_EQ(*c, items["c"]);
+}
+
+TEST_P(Render_Cache_Pack_Tests, TruncatedTailIsDiscarded) {
+    Record a = MakeRecord(3000, 1);
+    Record b = MakeRecord(4000, 2);
+    Record c = MakeRecord(5000, 3);
+    {
+        RenderCachePack pack(packFile, UseMMap());
+        pack.Write("a", a);
+        pack.Write("b", b);
+        pack.Flush();
+    }
+    // cut the last record short as a crash part way through writing it would
+    uint64_t whole = FileSize();
+    std::filesystem::resize_file(packFile, whole - 100);
+
+    auto items = Reopen();
+    ASSERT_EQ(1, items.size());
+    ASSERT_EQ(*a, items["a"]);
+    ASSERT_LT(FileSize(), whole - 100);
+
+    // a record written after the damage is found again
+    {
+        RenderCachePack pack(packFile, UseMMap());
+        pack.Write("c", c);
+    }
+    {
+        std::ofstream out(packFile, std::ios::binary | std::ios::app);
+        out << "RCRDjunk";
+    }
+    items = Reopen();
+    ASSERT_EQ(2, items.size());
+    ASSERT_EQ(*a, items["a"]);
+    ASSERT_EQ(*c, items["c"]);
+}
+
+TEST_P(Render_Cache_Pack_Tests, TrimCompactsReplacedItems) {
+    Record last = MakeRecord(20000, 9);
+    {
+        RenderCachePack pack(packFile, UseMMap());
+        for (uint8_t i = 0; i < 10; i++) {
+            pack.Write("a", MakeRecord(20000, i));
+        }
+        pack.Write("a", last);
+        pack.Flush();
+        uint64_t before = FileSize();
+        pack.Trim(1024 * 1024 * 1024, 1024 * 1024 * 1024);
+        pack.Flush();
+        ASSERT_LT(FileSize(), before);
+        ASSERT_EQ(FileSize(), pack.GetSize());
+    }
+
+    auto items = Reopen();
+    ASSERT_EQ(1, items.size());
+    ASSERT_EQ(*last, items["a"]);
+}
+
+TEST_P(Render_Cache_Pack_Tests, TrimEvictsLargeAndLeastRecentlyUsed) {
+    Record a = MakeRecord(10000, 1);
+    Record b = MakeRecord(10000, 2);
+    Record c = MakeRecord(10000, 3);
+    Record big = MakeRecord(100000, 4);
+    {
+        RenderCachePack pack(packFile, UseMMap());
+        pack.Write("a", a);
+        pack.Write("b", b);
+        pack.Write("c", c);
+        pack.Write("big", big);
+        pack.Flush();
+        pack.Touch("a");
+        // big is too big on its own and there is only room for two of the rest
+        pack.Trim(125000, 50000);
+        pack.Flush();
+    }
+
+    auto items = Reopen();
+    ASSERT_EQ(2, items.size());
+    ASSERT_EQ(*a, items["a"]);
+    ASSERT_EQ(*c, items["c"]);
+}
+
+#ifndef _WIN32
+TEST_P(Render_Cache_Pack_Tests, WrittenRecordIsHandedBackMapped) {
+    Record a = MakeRecord(100000, 1);
+    std::vector<uint8_t> written;
+    std::shared_ptr<const void> mapping;
+    {
+        RenderCachePack pack(packFile, UseMMap());
+        pack.Write("a", a, [&written, &mapping](const uint8_t* data, size_t size, const std::shared_ptr<const void>& keepAlive) {
+            written.assign(data, data + size);
+            mapping = keepAlive;
+        });
+        pack.Flush();
+    }
+    if (UseMMap()) {
+        ASSERT_NE(nullptr, mapping);
+        ASSERT_EQ(*a, written);
+    } else {
+        // a compressed pack can't be used in place
+        ASSERT_EQ(nullptr, mapping);
+    }
+}
+#endif
+
+INSTANTIATE_TEST_SUITE_P(MappedAndCompressed, Render_Cache_Pack_Tests, ::testing::Bool());
@@ -0,0 +1,89 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include "pch.h"
+
+#include "../xLights/models/Node.h"
+
+#define NODES_PER_STRING 10
+
+// the nodes of a model with a string per start channel, laid out as Model::SetFromXml would
+static std::vector<NodeBaseClassPtr> BuildNodes(const std::vector<int32_t>& stringStarts)
+{
+    std::vector<NodeBaseClassPtr> nodes;
+    for (size_t s = 0; s < stringStarts.size(); s++) {
+        for (int n = 0; n < NODES_PER_STRING; n++) {
+            NodeBaseClassPtr node(new NodeBaseClass(s, 1));
+            node->ActChan = stringStarts[s] + n * NODE_RGB_CHAN_CNT;
+            nodes.push_back(std::move(node));
+        }
+    }
+    return nodes;
+}
+
+// copies of some of the parent's nodes, as SubModel::Setup takes them
+static std::vector<NodeBaseClassPtr> BuildSubModel(const std::vector<NodeBaseClassPtr>& parent, const std::vector<int>& nodeIndexes)
+{
+    std::vector<NodeBaseClassPtr> nodes;
+    for (auto idx : nodeIndexes) {
+        nodes.push_back(NodeBaseClassPtr(parent[idx]->clone()));
+    }
+    return nodes;
+}
+
+static void MoveModel(std::vector<NodeBaseClassPtr>& parent, std::vector<NodeBaseClassPtr>& subModel, const std::vector<int32_t>& oldStarts, const std::vector<int32_t>& starts)
+{
+    MoveNodesWithStrings(parent, oldStarts, starts);
+    MoveNodesWithStrings(subModel, oldStarts, starts);
+}
+
+TEST(SubModel_Start_Channel_Tests, FollowsModelStartChannel) {
+    std::vector<int32_t> oldStarts = { 0, NODES_PER_STRING * NODE_RGB_CHAN_CNT };
+    std::vector<int32_t> starts = { 600, 600 + NODES_PER_STRING * NODE_RGB_CHAN_CNT };
+    std::vector<int> subModelNodes = { 14, 12, 13, 3 };
+
+    auto parent = BuildNodes(oldStarts);
+    auto subModel = BuildSubModel(parent, subModelNodes);
+    ASSERT_EQ(3 * NODE_RGB_CHAN_CNT, GetFirstNodeChannel(subModel));
+
+    MoveModel(parent, subModel, oldStarts, starts);
+
+    // the same as a submodel built from scratch on the moved model
+    auto rebuilt = BuildSubModel(BuildNodes(starts), subModelNodes);
+    ASSERT_EQ(GetFirstNodeChannel(rebuilt), GetFirstNodeChannel(subModel));
+    ASSERT_EQ(600 + 3 * NODE_RGB_CHAN_CNT, GetFirstNodeChannel(subModel));
+    for (size_t i = 0; i < subModel.size(); i++) {
+        ASSERT_EQ(rebuilt[i]->ActChan, subModel[i]->ActChan);
+    }
+}
+
+TEST(SubModel_Start_Channel_Tests, FollowsOneStringsStartChannel) {
+    std::vector<int32_t> oldStarts = { 0, 1000 };
+    std::vector<int32_t> starts = { 0, 2000 };
+    std::vector<int> firstString = { 1, 2 };
+    std::vector<int> secondString = { 15, 11 };
+
+    auto parent = BuildNodes(oldStarts);
+    auto onFirst = BuildSubModel(parent, firstString);
+    auto onSecond = BuildSubModel(parent, secondString);
+
+    MoveNodesWithStrings(parent, oldStarts, starts);
+    MoveNodesWithStrings(onFirst, oldStarts, starts);
+    MoveNodesWithStrings(onSecond, oldStarts, starts);
+
+    ASSERT_EQ(1 * NODE_RGB_CHAN_CNT, GetFirstNodeChannel(onFirst));
+    ASSERT_EQ(2000 + 1 * NODE_RGB_CHAN_CNT, GetFirstNodeChannel(onSecond));
+    ASSERT_EQ(GetFirstNodeChannel(BuildSubModel(BuildNodes(starts), secondString)), GetFirstNodeChannel(onSecond));
+}
+
+TEST(SubModel_Start_Channel_Tests, EmptySubModel) {
+    std::vector<NodeBaseClassPtr> none;
+    ASSERT_EQ(UINT32_MAX, GetFirstNodeChannel(none));
+}
@@ -0,0 +1,339 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "AudioAnalysisCache.h"
+#include "ExternalHooks.h"
+#include "UtilFunctions.h"
+
+#include <log4cpp/Category.hh>
+
+#ifndef __WXMSW__
+#include <sys/mman.h>
+#define USE_MMAP_AUDIO_CACHE
+#endif
+
+#define AUDIO_CACHE_VERSION 1
+#define AUDIO_CACHE_LIMIT_MB 2048
+
+namespace
+{
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t blockCount;
+        uint32_t descriptionLength;
+    };
+
+    struct BlockEntry {
+        uint32_t id;
+        uint32_t pad;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static const char CACHE_MAGIC[4] = { 'X', 'L', 'A', 'C' };
+
+    // blocks start on a 16 byte boundary so they can be used in place as arrays of anything
+    size_t Align16(size_t v)
+    {
+        return (v + 15) & ~(size_t)15;
+    }
+
+    uint64_t Hash(const uint8_t* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL)
+    {
+        // FNV-1a
+        for (size_t i = 0; i < size; i++) {
+            hash ^= data[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    std::string ToHex(uint64_t v)
+    {
+        char buf[17];
+        snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)v);
+        return buf;
+    }
+}
+
+static std::mutex __audioCacheLock;
+static std::string __audioCacheFolder;
+
+void AudioAnalysisCache::SetFolder(const std::string& folder)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    std::unique_lock<std::mutex> lock(__audioCacheLock);
+    __audioCacheFolder = folder;
+    if (folder.empty() || !wxDir::Exists(folder)) {
+        return;
+    }
+
+    // drop the least recently used entries once the cache is over its limit
+    wxArrayString files;
+    wxDir::GetAllFiles(folder, &files, "*.xlac", wxDIR_FILES);
+    std::vector<std::pair<time_t, wxString>> entries;
+    wxULongLong total = 0;
+    for (const auto& f : files) {
+        wxFileName fn(f);
+        total += fn.GetSize();
+        entries.push_back({ fn.GetModificationTime().GetTicks(), f });
+    }
+    std::sort(entries.begin(), entries.end());
+    const wxULongLong limit = (wxULongLong)AUDIO_CACHE_LIMIT_MB * 1024 * 1024;
+    for (const auto& it : entries) {
+        if (total <= limit) {
+            break;
+        }
+        wxULongLong size = wxFileName(it.second).GetSize();
+        if (wxRemoveFile(it.second)) {
+            logger_base.debug("Audio analysis cache removed %s.", (const char*)it.second.c_str());
+            total -= size;
+        }
+    }
+}
+
+bool AudioAnalysisCache::IsEnabled()
+{
+    std::unique_lock<std::mutex> lock(__audioCacheLock);
+    return !__audioCacheFolder.empty();
+}
+
+static std::string GetEntryFile(const std::string& fingerprint, const std::string& description)
+{
+    std::unique_lock<std::mutex> lock(__audioCacheLock);
+    if (__audioCacheFolder.empty() || fingerprint.empty()) {
+        return "";
+    }
+    return __audioCacheFolder + GetPathSeparator() + fingerprint + "_" + ToHex(Hash((const uint8_t*)description.c_str(), description.size())) + ".xlac";
+}
+
+std::string AudioAnalysisCache::Fingerprint(const std::string& audioFile)
+{
+    wxFile f;
+    if (!FileExists(audioFile) || !f.Open(audioFile)) {
+        return "";
+    }
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint64_t size = 0;
+    std::vector<uint8_t> buf(1024 * 1024);
+    for (;;) {
+        ssize_t read = f.Read(buf.data(), buf.size());
+        if (read <= 0) {
+            break;
+        }
+        hash = Hash(buf.data(), read, hash);
+        size += read;
+    }
+    return ToHex(hash) + ToHex(size);
+}
+
+void AudioAnalysisCache::Writer::AddStrings(uint32_t id, const std::vector<std::string>& strings)
+{
+    // each string is its length followed by its bytes
+    std::vector<uint8_t> encoded;
+    for (const auto& s : strings) {
+        uint32_t len = (uint32_t)s.size();
+        size_t at = encoded.size();
+        encoded.resize(at + sizeof(len) + len);
+        memcpy(&encoded[at], &len, sizeof(len));
+        memcpy(&encoded[at + sizeof(len)], s.data(), len);
+    }
+    _owned.push_back(std::move(encoded));
+    _blocks.push_back({ id, _owned.back().data(), _owned.back().size() });
+}
+
+bool AudioAnalysisCache::Writer::Write(const std::string& fingerprint, const std::string& description) const
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    std::string file = GetEntryFile(fingerprint, description);
+    if (file.empty()) {
+        return false;
+    }
+    wxFileName fn(file);
+    if (!wxDir::Exists(fn.GetPath()) && !wxFileName::Mkdir(fn.GetPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) {
+        logger_base.warn("Unable to create the audio analysis cache folder %s.", (const char*)fn.GetPath().c_str());
+        return false;
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = AUDIO_CACHE_VERSION;
+    header.blockCount = (uint32_t)_blocks.size();
+    header.descriptionLength = (uint32_t)description.size();
+
+    std::vector<BlockEntry> table(_blocks.size());
+    size_t tableOffset = Align16(sizeof(CacheHeader) + description.size());
+    size_t offset = Align16(tableOffset + sizeof(BlockEntry) * table.size());
+    for (size_t i = 0; i < _blocks.size(); i++) {
+        table[i].id = _blocks[i].id;
+        table[i].pad = 0;
+        table[i].offset = offset;
+        table[i].size = _blocks[i].size;
+        offset = Align16(offset + _blocks[i].size);
+    }
+
+    // written under another name first so a reader never maps a half written entry
+    std::string temp = file + ".tmp";
+    bool ok;
+    {
+        wxFile f;
+        if (!f.Create(temp, true)) {
+            return false;
+        }
+        static const uint8_t zeros[16] = { 0 };
+        size_t written = 0;
+        auto write = [&f, &written](const void* data, size_t size) {
+            if (size > 0 && f.Write(data, size) != size) {
+                return false;
+            }
+            written += size;
+            return true;
+        };
+        ok = write(&header, sizeof(header)) && write(description.data(), description.size()) &&
+             write(zeros, tableOffset - written) && write(table.data(), sizeof(BlockEntry) * table.size());
+        for (size_t i = 0; ok && i < _blocks.size(); i++) {
+            ok = write(zeros, table[i].offset - written) && write(_blocks[i].data, _blocks[i].size);
+        }
+    }
+    if (!ok || !wxRenameFile(temp, file, true)) {
+        logger_base.warn("Unable to write audio analysis cache entry %s.", (const char*)file.c_str());
+        wxRemoveFile(temp);
+        return false;
+    }
+    logger_base.debug("Audio analysis cache saved %s: %s.", (const char*)file.c_str(), (const char*)description.c_str());
+    return true;
+}
+
+std::shared_ptr<AudioAnalysisCache> AudioAnalysisCache::Open(const std::string& fingerprint, const std::string& description)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    std::string file = GetEntryFile(fingerprint, description);
+    if (file.empty() || !FileExists(file)) {
+        return nullptr;
+    }
+
+    std::shared_ptr<AudioAnalysisCache> res(new AudioAnalysisCache());
+    if (!res->Map(file) || !res->Validate(description)) {
+        logger_base.debug("Audio analysis cache entry %s is not usable.", (const char*)file.c_str());
+        return nullptr;
+    }
+    // keeps recently used entries from being removed when the cache is trimmed
+    wxFileName(file).Touch();
+    logger_base.debug("Audio analysis cache hit %s: %s.", (const char*)file.c_str(), (const char*)description.c_str());
+    return res;
+}
+
+AudioAnalysisCache::~AudioAnalysisCache()
+{
+#ifdef USE_MMAP_AUDIO_CACHE
+    if (_mapped && _data != nullptr) {
+        munmap((void*)_data, _size);
+    }
+#endif
+    _data = nullptr;
+}
+
+bool AudioAnalysisCache::Map(const std::string& file)
+{
+    wxFile f;
+    if (!f.Open(file)) {
+        return false;
+    }
+    _size = f.Length();
+    if (_size < sizeof(CacheHeader)) {
+        return false;
+    }
+#ifdef USE_MMAP_AUDIO_CACHE
+    // private so callers can treat the data as their own without it ever reaching the file
+    void* m = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, f.fd(), 0);
+    if (m != MAP_FAILED) {
+        _data = (uint8_t*)m;
+        _mapped = true;
+        return true;
+    }
+#endif
+    _buffer.resize(_size);
+    if (f.Read(_buffer.data(), _size) != (ssize_t)_size) {
+        _buffer.clear();
+        return false;
+    }
+    _data = _buffer.data();
+    return true;
+}
+
+bool AudioAnalysisCache::Validate(const std::string& description) const
+{
+    const CacheHeader* h = (const CacheHeader*)_data;
+    if (memcmp(h->magic, CACHE_MAGIC, 4) != 0 || h->version != AUDIO_CACHE_VERSION) {
+        return false;
+    }
+    uint64_t tableOffset = Align16(sizeof(CacheHeader) + (size_t)h->descriptionLength);
+    if (tableOffset + (uint64_t)h->blockCount * sizeof(BlockEntry) > _size) {
+        return false;
+    }
+    // the file name is a hash of the description, make sure it was not a collision
+    if (h->descriptionLength != description.size() || memcmp(_data + sizeof(CacheHeader), description.data(), description.size()) != 0) {
+        return false;
+    }
+    const BlockEntry* table = (const BlockEntry*)(_data + tableOffset);
+    for (uint32_t i = 0; i < h->blockCount; i++) {
+        if (table[i].offset > _size || table[i].size > _size - table[i].offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t* AudioAnalysisCache::GetBlock(uint32_t id, size_t& size) const
+{
+    const CacheHeader* h = (const CacheHeader*)_data;
+    const BlockEntry* table = (const BlockEntry*)(_data + Align16(sizeof(CacheHeader) + h->descriptionLength));
+    for (uint32_t i = 0; i < h->blockCount; i++) {
+        if (table[i].id == id) {
+            size = table[i].size;
+            return _data + table[i].offset;
+        }
+    }
+    size = 0;
+    return nullptr;
+}
+
+bool AudioAnalysisCache::GetStrings(uint32_t id, std::vector<std::string>& strings) const
+{
+    size_t size = 0;
+    const uint8_t* data = GetBlock(id, size);
+    if (data == nullptr) {
+        return false;
+    }
+    size_t pos = 0;
+    while (pos + sizeof(uint32_t) <= size) {
+        uint32_t len;
+        memcpy(&len, data + pos, sizeof(len));
+        pos += sizeof(len);
+        if (len > size - pos) {
+            return false;
+        }
+        strings.emplace_back((const char*)data + pos, len);
+        pos += len;
+    }
+    return pos == size;
+}
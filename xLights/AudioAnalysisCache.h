@@ -0,0 +1,89 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Binary cache of the analysis AudioManager and the VAMP plugins do on a track: frame data
+// and spectrogram, note filtered tracks and plugin timings. It is kept in the AudioCache
+// folder next to the render cache so the work is done once per song rather than every
+// time a sequence is opened.
+//
+// Each entry is one file holding a few blocks of plain arrays. The entry is named by a
+// fingerprint of the audio file's content plus a description of the analysis and what
+// it depended on, so a changed file or different parameters simply miss. Entries are
+// memory mapped and used in place where the platform allows it.
+class AudioAnalysisCache
+{
+public:
+    // "" disables the cache, entries beyond the size limit are removed least recently used first
+    static void SetFolder(const std::string& folder);
+    static bool IsEnabled();
+
+    // fingerprint of the content of the audio file, "" if it cannot be read
+    static std::string Fingerprint(const std::string& audioFile);
+
+    // nullptr if the entry does not exist or is not for this fingerprint and description
+    static std::shared_ptr<AudioAnalysisCache> Open(const std::string& fingerprint, const std::string& description);
+
+    // Collects the blocks of an entry. The data is not copied, it must stay valid until Write.
+    class Writer
+    {
+    public:
+        template<class T>
+        void Add(uint32_t id, const T* data, size_t count)
+        {
+            _blocks.push_back({ id, (const uint8_t*)data, count * sizeof(T) });
+        }
+        void AddStrings(uint32_t id, const std::vector<std::string>& strings);
+
+        bool Write(const std::string& fingerprint, const std::string& description) const;
+
+    private:
+        struct Block {
+            uint32_t id;
+            const uint8_t* data;
+            size_t size;
+        };
+        std::vector<Block> _blocks;
+        std::vector<std::vector<uint8_t>> _owned; // encoded strings
+    };
+
+    ~AudioAnalysisCache();
+    AudioAnalysisCache(const AudioAnalysisCache&) = delete;
+    AudioAnalysisCache& operator=(const AudioAnalysisCache&) = delete;
+
+    // the block as an array, nullptr if there is no such block. The data is writable but
+    // changes are private to this process and never reach the file.
+    template<class T>
+    T* Get(uint32_t id, size_t& count) const
+    {
+        size_t size = 0;
+        uint8_t* data = GetBlock(id, size);
+        count = size / sizeof(T);
+        return (T*)data;
+    }
+    bool GetStrings(uint32_t id, std::vector<std::string>& strings) const;
+
+private:
+    AudioAnalysisCache() {}
+    bool Map(const std::string& file);
+    bool Validate(const std::string& description) const;
+    uint8_t* GetBlock(uint32_t id, size_t& size) const;
+
+    uint8_t* _data = nullptr;
+    size_t _size = 0;
+    bool _mapped = false;
+    std::vector<uint8_t> _buffer;
+};
@@ -14,14 +14,19 @@
 #include <wx/wx.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 #include <math.h>
 #include <stdlib.h>
 
 #include "AudioManager.h"
+#include "AudioAnalysisCache.h"
 #include "ExternalHooks.h"
 #include "Parallel.h"
 #include "UtilFunctions.h"
@@ -66,6 +71,12 @@ SDLManager __sdlManager;
 
 #define PCMFUDGE 32768
 
+// Tracks are decoded in segments of about this many seconds, each starting this many
+// packets early so the decoder has settled by the segment's first frame
+#define AUDIO_SEGMENT_SECONDS 15
+#define AUDIO_SEGMENT_PREROLL 8
+#define MAX_AUDIO_DECODERS 8
+
 // Due to Ubuntu still using FFMpeg 4.x, we have to use some deprecated API's
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
@@ -1235,47 +1246,50 @@ AudioManager::AudioManager(const std::string& audio_file, int intervalMS, const
     AddAudioDeviceChangeListener([this]() { AudioDeviceChanged(); });
 }
 
-void AudioManager::CalculateSpectrumAnalysis(const float* in, int n, float& max, int id, std::vector<float>& res) const {
-    res.clear();
-    res.reserve(127);
+#define SPECTRUM_NOTES 127
+#define SPECTRUM_WINDOW 2048
+
+// FFT bin range [first, last] covering each MIDI note for the spectrogram. An empty
+// range (first > last) means the note is above what the window can resolve.
+static std::vector<std::pair<int, int>> GetSpectrumBuckets(int n, long rate) {
+    std::vector<std::pair<int, int>> buckets(SPECTRUM_NOTES);
     int outcount = n / 2 + 1;
-    kiss_fftr_cfg cfg;
-    kiss_fft_cpx* out = (kiss_fft_cpx*)malloc(sizeof(kiss_fft_cpx) * (outcount));
-    if (out != nullptr) {
-        if ((cfg = kiss_fftr_alloc(n, 0 /*is_inverse_fft*/, nullptr, nullptr)) != nullptr) {
-            kiss_fftr(cfg, in, out);
-            free(cfg);
+    for (int j = 0; j < SPECTRUM_NOTES; j++) {
+        double freq = 440.0 * exp2f(((double)j - 69.0) / 12.0);
+        int start = freq * (double)n / (double)rate;
+        double freqnext = 440.0 * exp2f(((double)j + 1.0 - 69.0) / 12.0);
+        int end = freqnext * (double)n / (double)rate;
+        if (end < outcount - 1) {
+            buckets[j] = { start, end };
+        } else {
+            buckets[j] = { 1, 0 };
         }
+    }
+    return buckets;
+}
 
-        for (int j = 0; j < 127; j++) {
-            // choose the right bucket for this MIDI note
-            double freq = 440.0 * exp2f(((double)j - 69.0) / 12.0);
-            int start = freq * (double)n / (double)_rate;
-            double freqnext = 440.0 * exp2f(((double)j + 1.0 - 69.0) / 12.0);
-            int end = freqnext * (double)n / (double)_rate;
-
-            float val = 0.0;
+// Max merges the per note log magnitude of one window into res. cfg and out belong to
+// the calling thread, kiss plans keep scratch space so cannot be shared.
+static void CalculateSpectrumAnalysis(kiss_fftr_cfg cfg, kiss_fft_cpx* out, const float* in, const std::vector<std::pair<int, int>>& buckets, float* res, float& max) {
+    kiss_fftr(cfg, in, out);
 
-            // got through all buckets up to the next note and take the maximums
-            if (end < outcount - 1) {
-                for (int k = start; k <= end; k++) {
-                    kiss_fft_cpx* cur = out + k;
-                    val = std::max(val, sqrtf(cur->r * cur->r + cur->i * cur->i));
-                    // float valscaled = valnew * scaling;
-                }
-            }
+    for (int j = 0; j < SPECTRUM_NOTES; j++) {
+        // got through all buckets up to the next note and take the maximums
+        float val = 0.0;
+        for (int k = buckets[j].first; k <= buckets[j].second; k++) {
+            kiss_fft_cpx* cur = out + k;
+            val = std::max(val, sqrtf(cur->r * cur->r + cur->i * cur->i));
+        }
 
-            float db = log10(val);
-            if (db < 0.0) {
-                db = 0.0;
-            }
+        float db = log10(val);
+        if (db < 0.0) {
+            db = 0.0;
+        }
 
-            res.push_back(db);
-            if (db > max) {
-                max = db;
-            }
+        res[j] = std::max(res[j], db);
+        if (db > max) {
+            max = db;
         }
-        free(out);
     }
 }
 
@@ -1327,85 +1341,106 @@ void AudioManager::DoPolyphonicTranscription(wxProgressDialog* dlg, AudioManager
         logger_pianodata.debug("Block %d.", pref_block);
         pt->initialise(channels, pref_step, pref_block);
 
-        bool first = true;
-        int start = 0;
-        long len = GetTrackSize();
-        float totalLen = len;
-        int lastProgress = 0;
-        while (len) {
-            int progress = (((float)(totalLen - len) * 25) / totalLen);
-            if (lastProgress < progress) {
-                fn(dlg, progress);
-                lastProgress = progress;
-            }
-            pdata[0] = GetRawLeftDataPtr(start);
-            wxASSERT(pdata[0] != nullptr);
-            pdata[1] = GetRawRightDataPtr(start);
+        // each note found as start and end ms and its midi note
+        std::vector<int> starts;
+        std::vector<int> ends;
+        std::vector<std::string> labels;
+        std::vector<float> notes;
+        std::string cacheDescription = xLightsVamp::DescribePlugin(pt, 0, pref_step, pref_block, channels, "polyphonic transcription");
+        if (xLightsVamp::LoadCachedTimings(this, cacheDescription, starts, ends, labels, notes) && notes.size() == starts.size()) {
+            logger_base.info("DoPolyphonicTranscription: Polyphonic transcription loaded from the analysis cache.");
+        } else {
+            starts.clear();
+            ends.clear();
+            labels.clear();
+            notes.clear();
+
+            bool first = true;
+            int start = 0;
+            long len = GetTrackSize();
+            float totalLen = len;
+            int lastProgress = 0;
+            while (len) {
+                int progress = (((float)(totalLen - len) * 25) / totalLen);
+                if (lastProgress < progress) {
+                    fn(dlg, progress);
+                    lastProgress = progress;
+                }
+                pdata[0] = GetRawLeftDataPtr(start);
+                wxASSERT(pdata[0] != nullptr);
+                pdata[1] = GetRawRightDataPtr(start);
 
-            Vamp::RealTime timestamp = Vamp::RealTime::frame2RealTime(start, GetRate());
-            Vamp::Plugin::FeatureSet features = pt->process(pdata, timestamp);
+                Vamp::RealTime timestamp = Vamp::RealTime::frame2RealTime(start, GetRate());
+                Vamp::Plugin::FeatureSet features = pt->process(pdata, timestamp);
 
-            if (first && features.size() > 0) {
-                logger_base.warn("DoPolyphonicTranscription: Polyphonic transcription data process oddly retrieved data.");
-                first = false;
+                if (first && features.size() > 0) {
+                    logger_base.warn("DoPolyphonicTranscription: Polyphonic transcription data process oddly retrieved data.");
+                    first = false;
+                }
+                if (len > pref_step) {
+                    len -= pref_step;
+                } else {
+                    len = 0;
+                }
+                start += pref_step;
             }
-            if (len > pref_step) {
-                len -= pref_step;
-            } else {
-                len = 0;
+
+            try {
+                logger_pianodata.debug("About to extract Polyphonic Transcription result.");
+                Vamp::Plugin::FeatureSet features = pt->getRemainingFeatures();
+                logger_pianodata.debug("Polyphonic Transcription result retrieved.");
+                for (size_t j = 0; j < features[0].size(); j++) {
+                    long currentstart = features[0][j].timestamp.sec * 1000 + features[0][j].timestamp.msec();
+                    long currentend = currentstart + features[0][j].duration.sec * 1000 + features[0][j].duration.msec();
+                    starts.push_back(currentstart);
+                    ends.push_back(currentend);
+                    labels.push_back("");
+                    notes.push_back(features[0][j].values[0]);
+                }
+                xLightsVamp::SaveCachedTimings(this, cacheDescription, starts, ends, labels, notes);
+            } catch (...) {
+                logger_base.warn("DoPolyphonicTranscription: Polyphonic Transcription threw an error getting the remaining features.");
             }
-            start += pref_step;
         }
 
         // Process the Polyphonic Transcription
-        try {
-            unsigned int total = 0;
-            logger_pianodata.debug("About to extract Polyphonic Transcription result.");
-            Vamp::Plugin::FeatureSet features = pt->getRemainingFeatures();
-            logger_pianodata.debug("Polyphonic Transcription result retrieved.");
-            logger_pianodata.debug("Start,Duration,CalcStart,CalcEnd,midinote");
-            for (size_t j = 0; j < features[0].size(); j++) {
-                if (j % 10 == 0) {
-                    fn(dlg, (int)(((float)j * 75.0) / (float)features[0].size()) + 25.0);
-                }
+        logger_pianodata.debug("CalcStart,CalcEnd,midinote");
+        for (size_t j = 0; j < starts.size(); j++) {
+            if (j % 10 == 0) {
+                fn(dlg, (int)(((float)j * 75.0) / (float)starts.size()) + 25.0);
+            }
 
-                long currentstart = features[0][j].timestamp.sec * 1000 + features[0][j].timestamp.msec();
-                long currentend = currentstart + features[0][j].duration.sec * 1000 + features[0][j].duration.msec();
+            long currentstart = starts[j];
+            long currentend = ends[j];
 
-                // printf("%f\t%f\t%f\n",(float)currentstart/1000.0, (float)currentend/1000.0, features[0][j].values[0]);
-                if (logger_pianodata.isDebugEnabled()) {
-                    logger_pianodata.debug("%d.%03d,%d.%03d,%d,%d,%f", features[0][j].timestamp.sec, features[0][j].timestamp.msec(), features[0][j].duration.sec, features[0][j].duration.msec(), currentstart, currentend, features[0][j].values[0]);
-                }
-                total += features[0][j].values.size();
+            if (logger_pianodata.isDebugEnabled()) {
+                logger_pianodata.debug("%ld,%ld,%f", currentstart, currentend, notes[j]);
+            }
 
-                int sframe = currentstart / _intervalMS;
-                if (currentstart - sframe * _intervalMS > _intervalMS / 2) {
-                    sframe++;
-                }
-                int eframe = currentend / _intervalMS;
-                while (sframe <= eframe) {
-                    _frameData[sframe].notes.push_back(features[0][j].values[0]);
-                    sframe++;
-                }
+            int sframe = currentstart / _intervalMS;
+            if (currentstart - sframe * _intervalMS > _intervalMS / 2) {
+                sframe++;
+            }
+            int eframe = currentend / _intervalMS;
+            while (sframe <= eframe) {
+                _frameData[sframe].notes.push_back(notes[j]);
+                sframe++;
             }
+        }
 
-            fn(dlg, 100);
+        fn(dlg, 100);
 
-            if (logger_pianodata.isDebugEnabled()) {
-                logger_pianodata.debug("Piano data calculated:");
-                logger_pianodata.debug("Time MS, Keys");
-                for (size_t i = 0; i < _frameData.size(); i++) {
-                    long ms = i * _intervalMS;
-                    std::string keys = "";
-                    for (const auto& it2 : _frameData[i].notes) {
-                        keys += " " + std::string(wxString::Format("%f", it2).c_str());
-                    }
-                    logger_pianodata.debug("%ld,%s", ms, (const char*)keys.c_str());
+        if (logger_pianodata.isDebugEnabled()) {
+            logger_pianodata.debug("Piano data calculated:");
+            logger_pianodata.debug("Time MS, Keys");
+            for (size_t i = 0; i < _frameData.size(); i++) {
+                long ms = i * _intervalMS;
+                std::string keys = "";
+                for (const auto& it2 : _frameData[i].notes) {
+                    keys += " " + std::string(wxString::Format("%f", it2).c_str());
                 }
+                logger_pianodata.debug("%ld,%s", ms, (const char*)keys.c_str());
             }
-            // printf("Total points: %u", total);
-        } catch (...) {
-            logger_base.warn("DoPolyphonicTranscription: Polyphonic Transcription threw an error getting the remaining features.");
         }
 
         // done with VAMP Polyphonic Transcriber ... but dont delete it as the VAMP code manages its lifetime
@@ -1441,22 +1476,14 @@ void AudioManager::DoPrepareFrameData() {
 
     _frameDataPreparedForInterval = _intervalMS;
 
-    // wait for the data to load
-    while (!IsDataLoaded()) {
-        logger_base.info("DoPrepareFrameData: waiting for audio data to load.");
-        wxMilliSleep(1000);
-    }
-
-    logger_base.info("DoPrepareFrameData: Data is loaded.");
-
-    // we need to ensure at least the raw data is available
-    if (_filtered.size() == 0) {
-        locker.unlock();
-        SwitchTo(AUDIOSAMPLETYPE::RAW, 0, 0);
-        locker.lock();
-    }
+    // Until a filter has been applied the raw audio is the data being loaded, so each frame can be
+    // analysed as soon as its samples have been decoded rather than once the whole track has loaded.
+    // The raw copy is taken once the analysis is done.
+    bool progressive = _filtered.empty();
 
     _frameData.clear();
+    _spectrogram.clear();
+    _frameDataCache = nullptr;
 
     // samples per frame
     int samplesperframe = _rate * _intervalMS / 1000;
@@ -1472,102 +1499,102 @@ void AudioManager::DoPrepareFrameData() {
     logger_base.info("    Frames %d", frames);
     logger_base.info("    Total samples %d", totalsamples);
 
+    if (LoadCachedFrameData(frames)) {
+        if (progressive) {
+            locker.unlock();
+            SwitchTo(AUDIOSAMPLETYPE::RAW, 0, 0);
+            locker.lock();
+        }
+        _frameDataPrepared = true;
+        logger_base.info("DoPrepareFrameData: Audio frame data loaded from the analysis cache in %ld. Frames: %d", sw.Time(), frames);
+        return;
+    }
+
     // these are used to normalise output
     _bigmax = -1;
     _bigspread = -1;
     _bigmin = 1;
     _bigspectogrammax = -1;
 
-    size_t step = 2048;
-    float* pdata[2];
+    FilteredAudioData* raw = progressive ? nullptr : GetFilteredAudioData(AUDIOSAMPLETYPE::RAW, -1, -1);
+    const float* rawdata = progressive ? _data[0] : (raw == nullptr ? nullptr : raw->data0);
+    if (rawdata == nullptr || frames <= 0 || samplesperframe <= 0) {
+        logger_base.warn("    DoPrepareFrameData: No raw audio to analyse.");
+        _frameDataPrepared = true;
+        return;
+    }
 
-    int pos = 0;
-    std::vector<float> spectrogram;
-    std::vector<float> subspectrogram;
+    // The spectrogram uses fixed windows which do not line up with our frames. A window
+    // belongs to the frame it starts in and a frame takes the maximum of each note across
+    // its windows. A frame which no window starts in repeats the frame before it.
+    const long step = SPECTRUM_WINDOW;
+    const long windows = totalsamples > step ? (totalsamples - step + step - 1) / step : 0;
+    const int outcount = step / 2 + 1;
+    auto buckets = GetSpectrumBuckets(step, _rate);
 
-    // process each frome of the song
+    enum { NO_WINDOWS, HAS_SPECTRUM, NO_SPECTRUM };
+    std::vector<uint8_t> rowState(frames, NO_WINDOWS);
+    std::vector<float> rowMax(frames, 0.0f);
+    _spectrogram.resize((size_t)frames * SPECTRUM_NOTES, 0.0f);
     _frameData.resize(frames);
-    for (int i = 0; i < frames; i++) {
-        // accumulators
-        float max = -100.0;
-        float min = 100.0;
-        float spread = -100;
-
-        // clear the data if we are about to get new data ... dont clear it if we wont
-        // this happens because the spectrogram function has a fixed window based on the parameters we set and it
-        // does not match our time slices exactly so we have to select which one to use
-        if (pos < i * samplesperframe + samplesperframe && pos + step < totalsamples) {
-            spectrogram.clear();
-        }
-
-        // only get the data if we are not ahead of the music
-        while (pos < i * samplesperframe + samplesperframe && pos + step < totalsamples) {
-            pdata[0] = GetRawLeftDataPtr(pos);
-            wxASSERT(pdata[0] != nullptr);
-            pdata[1] = GetRawRightDataPtr(pos);
-            float max2 = 0;
-
-            if (pdata[0] == nullptr) {
-                subspectrogram.clear();
-            } else {
-                CalculateSpectrumAnalysis(pdata[0], step, max2, i, subspectrogram);
-            }
 
-            // and keep track of the larges value so we can normalise it
-            if (max2 > _bigspectogrammax) {
-                _bigspectogrammax = max2;
-            }
-            pos += step;
+    static const int FRAMES_PER_JOB = 32;
+    int jobs = (frames + FRAMES_PER_JOB - 1) / FRAMES_PER_JOB;
+    parallel_for(0, jobs, [&](int job) {
+        kiss_fftr_cfg cfg = kiss_fftr_alloc(step, 0 /*is_inverse_fft*/, nullptr, nullptr);
+        std::vector<kiss_fft_cpx> out(outcount);
 
-            // either take the newly calculated values or if we are merging two results take the maximum of each value
-            if (spectrogram.size() == 0) {
-                spectrogram = subspectrogram;
-            } else {
-                if (subspectrogram.size() > 0) {
-                    std::vector<float>::iterator sub = subspectrogram.begin();
-                    for (std::vector<float>::iterator fr = spectrogram.begin(); fr != spectrogram.end(); ++fr) {
-                        if (*sub > *fr) {
-                            *fr = *sub;
-                        }
-                        ++sub;
+        int lastFrame = std::min(frames, (job + 1) * FRAMES_PER_JOB);
+        while (!IsDataLoaded((long)lastFrame * samplesperframe + step)) {
+            wxMilliSleep(10);
+        }
+        for (int i = job * FRAMES_PER_JOB; i < lastFrame; i++) {
+            long firstWindow = ((long)i * samplesperframe + step - 1) / step;
+            long endWindow = std::min(windows, ((long)(i + 1) * samplesperframe + step - 1) / step);
+            if (firstWindow < endWindow) {
+                rowState[i] = NO_SPECTRUM;
+                for (long w = firstWindow; w < endWindow && cfg != nullptr; w++) {
+                    long pos = w * step;
+                    if (pos <= _trackSize) {
+                        CalculateSpectrumAnalysis(cfg, &out[0], rawdata + pos, buckets, &_spectrogram[(size_t)i * SPECTRUM_NOTES], rowMax[i]);
+                        rowState[i] = HAS_SPECTRUM;
                     }
                 }
             }
-        }
 
-        // now do the raw data analysis for the frame
-        for (int j = 0; j < samplesperframe; j++) {
-            float data = GetRawLeftData(i * samplesperframe + j);
-
-            // Max data
-            if (data > max) {
-                max = data;
+            // now do the raw data analysis for the frame
+            float max = -100.0;
+            float min = 100.0;
+            float spread = -100;
+            for (int j = 0; j < samplesperframe; j++) {
+                long offset = (long)i * samplesperframe + j;
+                float data = offset <= _trackSize ? rawdata[offset] : 0;
+                max = std::max(max, data);
+                min = std::min(min, data);
+                spread = std::max(spread, max - min);
             }
-
-            // Min data
-            if (data < min) {
-                min = data;
-            }
-
-            // Spread data
-            if (max - min > spread) {
-                spread = max - min;
-            }
-        }
-
-        if (max > _bigmax) {
-            _bigmax = max;
+            _frameData[i].min = min;
+            _frameData[i].max = max;
+            _frameData[i].spread = spread;
         }
-        if (min < _bigmin) {
-            _bigmin = min;
+        if (cfg != nullptr) {
+            kiss_fftr_free(cfg);
         }
-        if (spread > _bigspread) {
-            _bigspread = spread;
+    });
+
+    SpectrumView last;
+    for (int i = 0; i < frames; i++) {
+        if (rowState[i] == HAS_SPECTRUM) {
+            last = SpectrumView(&_spectrogram[(size_t)i * SPECTRUM_NOTES], SPECTRUM_NOTES);
+            _bigspectogrammax = std::max(_bigspectogrammax, rowMax[i]);
+        } else if (rowState[i] == NO_SPECTRUM) {
+            last = SpectrumView();
         }
-        _frameData[i].min = min;
-        _frameData[i].max = max;
-        _frameData[i].spread = spread;
-        _frameData[i].vu = spectrogram;
+        _frameData[i].vu = last;
+
+        _bigmax = std::max(_bigmax, _frameData[i].max);
+        _bigmin = std::min(_bigmin, _frameData[i].min);
+        _bigspread = std::max(_bigspread, _frameData[i].spread);
     }
 
     // normalise data ... basically scale the data so the highest value is the scale value.
@@ -1580,16 +1607,162 @@ void AudioManager::DoPrepareFrameData() {
         fr.max *= bigmaxscale;
         fr.min *= bigminscale;
         fr.spread *= bigspreadscale;
+    }
+    // rows are shared between frames so scale the backing array rather than each view
+    for (auto& vu : _spectrogram) {
+        vu *= bigspectrogramscale;
+    }
 
-        for (auto& vu : fr.vu) {
-            vu *= bigspectrogramscale;
-        }
+    // we need to ensure at least the raw data is available
+    if (progressive) {
+        locker.unlock();
+        SwitchTo(AUDIOSAMPLETYPE::RAW, 0, 0);
+        locker.lock();
     }
 
+    SaveCachedFrameData();
+
     // flag the fact that the data is all ready
     _frameDataPrepared = true;
     logger_base.info("DoPrepareFrameData: Audio frame data processing complete in %ld. Frames: %d", sw.Time(), frames);
 }
+// Blocks of the analysis cache entries
+#define CACHE_FRAMES 1
+#define CACHE_SPECTROGRAM 2
+#define CACHE_DATA0 3
+#define CACHE_DATA1 4
+#define CACHE_PCM 5
+#define CACHE_STARTS 6
+#define CACHE_ENDS 7
+#define CACHE_LABELS 8
+#define CACHE_VALUES 9
+
+struct CachedFrameData {
+    float min;
+    float max;
+    float spread;
+    int32_t spectrogramRow; // -1 for no spectrum
+};
+
+std::string AudioManager::GetAnalysisFingerprint() {
+    std::unique_lock<std::mutex> lock(_fingerprintLock);
+    if (_fingerprint.empty()) {
+        _fingerprint = AudioAnalysisCache::Fingerprint(_audio_file);
+    }
+    return _fingerprint;
+}
+
+// Frame data is prepared before the track has finished loading so it is described by the length and rate
+// which are known once the file is open rather than the exact sample count
+static std::string DescribeFrameData(int intervalMS, long rate, long lengthMS) {
+    return wxString::Format("frames %d %ld %ld %d %d", intervalMS, rate, lengthMS, SPECTRUM_WINDOW, SPECTRUM_NOTES).ToStdString();
+}
+
+bool AudioManager::LoadCachedFrameData(int frames) {
+    if (!AudioAnalysisCache::IsEnabled()) {
+        return false;
+    }
+    auto cache = AudioAnalysisCache::Open(GetAnalysisFingerprint(), DescribeFrameData(_intervalMS, _rate, _lengthMS));
+    if (cache == nullptr) {
+        return false;
+    }
+
+    size_t count = 0;
+    size_t spectrogramSize = 0;
+    const CachedFrameData* cached = cache->Get<CachedFrameData>(CACHE_FRAMES, count);
+    const float* spectrogram = cache->Get<float>(CACHE_SPECTROGRAM, spectrogramSize);
+    if (cached == nullptr || (int)count != frames || spectrogram == nullptr) {
+        return false;
+    }
+
+    size_t rows = spectrogramSize / SPECTRUM_NOTES;
+    _frameData.resize(frames);
+    for (int i = 0; i < frames; i++) {
+        _frameData[i].min = cached[i].min;
+        _frameData[i].max = cached[i].max;
+        _frameData[i].spread = cached[i].spread;
+        if (cached[i].spectrogramRow >= 0 && (size_t)cached[i].spectrogramRow < rows) {
+            _frameData[i].vu = SpectrumView(spectrogram + (size_t)cached[i].spectrogramRow * SPECTRUM_NOTES, SPECTRUM_NOTES);
+        }
+    }
+    _frameDataCache = cache;
+    return true;
+}
+
+void AudioManager::SaveCachedFrameData() {
+    if (!AudioAnalysisCache::IsEnabled() || _frameData.empty()) {
+        return;
+    }
+
+    std::vector<CachedFrameData> cached(_frameData.size());
+    for (size_t i = 0; i < _frameData.size(); i++) {
+        cached[i].min = _frameData[i].min;
+        cached[i].max = _frameData[i].max;
+        cached[i].spread = _frameData[i].spread;
+        cached[i].spectrogramRow = _frameData[i].vu.empty() ? -1 : (int32_t)((_frameData[i].vu.begin() - _spectrogram.data()) / SPECTRUM_NOTES);
+    }
+
+    AudioAnalysisCache::Writer writer;
+    writer.Add(CACHE_FRAMES, cached.data(), cached.size());
+    writer.Add(CACHE_SPECTROGRAM, _spectrogram.data(), _spectrogram.size());
+    writer.Write(GetAnalysisFingerprint(), DescribeFrameData(_intervalMS, _rate, _lengthMS));
+}
+
+static std::string DescribeFilteredAudio(AUDIOSAMPLETYPE type, int lowNote, int highNote, long rate, long trackSize, int extra, int channels, long pcmdatasize) {
+    return wxString::Format("filter %d %d %d %ld %ld %d %d %ld", (int)type, lowNote, highNote, rate, trackSize, extra, channels, pcmdatasize).ToStdString();
+}
+
+FilteredAudioData* AudioManager::LoadCachedFilteredAudio(AUDIOSAMPLETYPE type, int lowNote, int highNote) {
+    if (!AudioAnalysisCache::IsEnabled()) {
+        return nullptr;
+    }
+    auto cache = AudioAnalysisCache::Open(GetAnalysisFingerprint(), DescribeFilteredAudio(type, lowNote, highNote, _rate, _trackSize, _extra, _channels, _pcmdatasize));
+    if (cache == nullptr) {
+        return nullptr;
+    }
+
+    size_t datasize = _trackSize + _extra;
+    size_t size0 = 0;
+    size_t size1 = 0;
+    size_t pcmsize = 0;
+    float* data0 = cache->Get<float>(CACHE_DATA0, size0);
+    float* data1 = cache->Get<float>(CACHE_DATA1, size1);
+    int16_t* pcmdata = cache->Get<int16_t>(CACHE_PCM, pcmsize);
+    if (data0 == nullptr || size0 != datasize || (_data[1] != nullptr && (data1 == nullptr || size1 != datasize)) ||
+        pcmdata == nullptr || pcmsize * sizeof(int16_t) < (size_t)_pcmdatasize + PCMFUDGE) {
+        return nullptr;
+    }
+
+    FilteredAudioData* fad = new FilteredAudioData();
+    fad->data0 = data0;
+    fad->data1 = _data[1] != nullptr ? data1 : nullptr;
+    fad->pcmdata = pcmdata;
+    fad->lowNote = lowNote;
+    fad->highNote = highNote;
+    fad->type = type;
+    fad->cache = cache;
+    return fad;
+}
+
+void AudioManager::SaveCachedFilteredAudio(const FilteredAudioData* fad) {
+    if (!AudioAnalysisCache::IsEnabled()) {
+        return;
+    }
+    AudioAnalysisCache::Writer writer;
+    writer.Add(CACHE_DATA0, fad->data0, _trackSize + _extra);
+    if (fad->data1 != nullptr) {
+        writer.Add(CACHE_DATA1, fad->data1, _trackSize + _extra);
+    }
+    writer.Add(CACHE_PCM, fad->pcmdata, (_pcmdatasize + PCMFUDGE) / sizeof(int16_t));
+    writer.Write(GetAnalysisFingerprint(), DescribeFilteredAudio(fad->type, fad->lowNote, fad->highNote, _rate, _trackSize, _extra, _channels, _pcmdatasize));
+}
+
+void AudioManager::AddFilteredAudioData(FilteredAudioData* fad) {
+    _filtered.push_back(fad);
+    long size = _trackSize;
+    fad->minMaxBuilt = std::async(std::launch::async, [fad, size]() { fad->minMax.Build(fad->data0, size); }).share();
+}
+
 // Called to trigger frame data creation
 void AudioManager::PrepareFrameData(bool separateThread) {
     // if frame data is already being processed, wait for that one to finish, otherwise
@@ -1864,14 +2037,19 @@ AudioManager::~AudioManager() {
     }
 
     while (_filtered.size() > 0) {
-        if (_filtered.back()->data0) {
-            free(_filtered.back()->data0);
+        if (_filtered.back()->minMaxBuilt.valid()) {
+            _filtered.back()->minMaxBuilt.wait();
         }
-        if (_filtered.back()->data1) {
-            free(_filtered.back()->data1);
-        }
-        if (_filtered.back()->pcmdata) {
-            free(_filtered.back()->pcmdata);
+        if (_filtered.back()->cache == nullptr) {
+            if (_filtered.back()->data0) {
+                free(_filtered.back()->data0);
+            }
+            if (_filtered.back()->data1) {
+                free(_filtered.back()->data1);
+            }
+            if (_filtered.back()->pcmdata) {
+                free(_filtered.back()->pcmdata);
+            }
         }
         delete _filtered.back();
         _filtered.pop_back();
@@ -2181,38 +2359,44 @@ void AudioManager::DoLoadAudioData(AVFormatContext* formatContext, AVCodecContex
 
     swr_init(au_convert_ctx);
 
-    // start at the beginning
-    av_seek_frame(formatContext, 0, 0, AVSEEK_FLAG_ANY);
-
-    // Read the packets in a loop
-    while ((status = av_read_frame(formatContext, readingPacket)) == 0) {
-        if (readingPacket->stream_index == audioStream->index)
-            LoadAudioFromFrame(formatContext, codecContext, readingPacket, frame, au_convert_ctx,
-                               false, out_channels, out_buffer, read, lastpct);
-
-        // You *must* call av_free_packet() after each call to av_read_frame() or else you'll leak memory
-        av_packet_unref(readingPacket);
-    }
-
-    if (status == AVERROR_EOF && readingPacket->stream_index == audioStream->index)
-        LoadAudioFromFrame(formatContext, codecContext, readingPacket, frame, au_convert_ctx,
-                           true, out_channels, out_buffer, read, lastpct);
+    if (!_segments.empty()) {
+        if (!LoadSegmentedAudio(formatContext, audioStream, au_convert_ctx, out_channels, out_buffer, read, lastpct)) {
+            logger_base.error("DoLoadAudioData: Decoding the audio in segments failed, the track has been cut short.");
+        }
+    } else {
+        // start at the beginning
+        av_seek_frame(formatContext, 0, 0, AVSEEK_FLAG_ANY);
 
-    // Some codecs will cause frames to be buffered up in the decoding process. If the CODEC_CAP_DELAY flag
-    // is set, there can be buffered up frames that need to be flushed, so we'll do that
-    if (codecContext->codec != nullptr && (codecContext->codec->capabilities & CODEC_CAP_DELAY) != 0) {
-        // Decode all the remaining frames in the buffer, until the end is reached
+        // Read the packets in a loop
         while ((status = av_read_frame(formatContext, readingPacket)) == 0) {
             if (readingPacket->stream_index == audioStream->index)
                 LoadAudioFromFrame(formatContext, codecContext, readingPacket, frame, au_convert_ctx,
                                    false, out_channels, out_buffer, read, lastpct);
 
+            // You *must* call av_free_packet() after each call to av_read_frame() or else you'll leak memory
             av_packet_unref(readingPacket);
         }
 
         if (status == AVERROR_EOF && readingPacket->stream_index == audioStream->index)
             LoadAudioFromFrame(formatContext, codecContext, readingPacket, frame, au_convert_ctx,
                                true, out_channels, out_buffer, read, lastpct);
+
+        // Some codecs will cause frames to be buffered up in the decoding process. If the CODEC_CAP_DELAY flag
+        // is set, there can be buffered up frames that need to be flushed, so we'll do that
+        if (codecContext->codec != nullptr && (codecContext->codec->capabilities & CODEC_CAP_DELAY) != 0) {
+            // Decode all the remaining frames in the buffer, until the end is reached
+            while ((status = av_read_frame(formatContext, readingPacket)) == 0) {
+                if (readingPacket->stream_index == audioStream->index)
+                    LoadAudioFromFrame(formatContext, codecContext, readingPacket, frame, au_convert_ctx,
+                                       false, out_channels, out_buffer, read, lastpct);
+
+                av_packet_unref(readingPacket);
+            }
+
+            if (status == AVERROR_EOF && readingPacket->stream_index == audioStream->index)
+                LoadAudioFromFrame(formatContext, codecContext, readingPacket, frame, au_convert_ctx,
+                                   true, out_channels, out_buffer, read, lastpct);
+        }
     }
 
     int numDrained = swr_convert(au_convert_ctx, &out_buffer, CONVERSION_BUFFER_SIZE, nullptr, 0);
@@ -2323,6 +2507,225 @@ SDLManager* AudioManager::GetSDLManager() {
     return &__sdlManager;
 }
 
+// Decodes one segment of the stream with a demuxer and decoder of its own, passing each of its frames
+// to onFrame. Frames decoded ahead of the segment only prime the decoder. Fails if the file could not be
+// opened or if the seek landed after the segment's first frame, in which case the segments would not
+// join up exactly.
+static bool DecodeAudioSegment(const std::string& file, int streamIndex, const AudioSegment& segment, const std::function<void(AVFrame*)>& onFrame) {
+    AVFormatContext* formatContext = nullptr;
+    if (avformat_open_input(&formatContext, file.c_str(), nullptr, nullptr) != 0) {
+        return false;
+    }
+    if (avformat_find_stream_info(formatContext, nullptr) < 0 || streamIndex >= (int)formatContext->nb_streams) {
+        avformat_close_input(&formatContext);
+        return false;
+    }
+    AVStream* audioStream = formatContext->streams[streamIndex];
+    const AVCodec* cdc = avcodec_find_decoder(audioStream->codecpar->codec_id);
+    AVCodecContext* codecContext = cdc == nullptr ? nullptr : avcodec_alloc_context3(cdc);
+    if (codecContext == nullptr || avcodec_parameters_to_context(codecContext, audioStream->codecpar) < 0 || avcodec_open2(codecContext, cdc, nullptr) < 0) {
+        avcodec_free_context(&codecContext);
+        avformat_close_input(&formatContext);
+        return false;
+    }
+
+    bool ok = true;
+    if (segment.seekPts != INT64_MIN && av_seek_frame(formatContext, streamIndex, segment.seekPts, AVSEEK_FLAG_BACKWARD) < 0) {
+        ok = false;
+    }
+
+    AVPacket* packet = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    bool started = segment.startPts == INT64_MIN;
+    bool done = false;
+    int64_t expectedPts = AV_NOPTS_VALUE;
+    auto receiveFrames = [&]() {
+        while (!done && avcodec_receive_frame(codecContext, frame) == 0) {
+            // frames without a timestamp follow on from the one before
+            int64_t pts = frame->best_effort_timestamp;
+            if (pts == AV_NOPTS_VALUE) {
+                pts = expectedPts;
+            }
+            if (pts != AV_NOPTS_VALUE) {
+                expectedPts = pts + av_rescale_q(frame->nb_samples, AVRational{ 1, frame->sample_rate }, audioStream->time_base);
+            }
+
+            if (!started) {
+                if (pts == AV_NOPTS_VALUE || pts < segment.startPts) {
+                    av_frame_unref(frame);
+                    continue;
+                }
+                if (pts != segment.startPts) {
+                    ok = false;
+                    done = true;
+                    av_frame_unref(frame);
+                    break;
+                }
+                started = true;
+            }
+            if (pts != AV_NOPTS_VALUE && pts >= segment.endPts) {
+                done = true;
+            } else {
+                onFrame(frame);
+            }
+            av_frame_unref(frame);
+        }
+    };
+    while (ok && !done && av_read_frame(formatContext, packet) == 0) {
+        if (packet->stream_index == streamIndex && avcodec_send_packet(codecContext, packet) == 0) {
+            receiveFrames();
+        }
+        av_packet_unref(packet);
+    }
+    if (ok && !done) {
+        // end of the file, flush out anything the decoder is holding back
+        avcodec_send_packet(codecContext, nullptr);
+        receiveFrames();
+    }
+
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&codecContext);
+    avformat_close_input(&formatContext);
+    return ok && started;
+}
+
+static int GetAudioDecoderCount(size_t segments) {
+    int decoders = std::clamp((int)std::thread::hardware_concurrency(), 2, MAX_AUDIO_DECODERS);
+    return std::min(decoders, (int)segments);
+}
+
+// Splits the track into segments at packet boundaries. Only the packets are read, nothing is decoded. Leaves
+// _segments empty if the track is too short to be worth splitting, or if it can not be seeked accurately
+// because the packets do not all carry increasing timestamps.
+void AudioManager::FindAudioSegments(AVFormatContext* formatContext, AVStream* audioStream) {
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    _segments.clear();
+    if (formatContext->pb == nullptr || (formatContext->pb->seekable & AVIO_SEEKABLE_NORMAL) == 0 ||
+        audioStream->time_base.num <= 0 || audioStream->time_base.den <= 0) {
+        return;
+    }
+
+    std::vector<int64_t> packetPts;
+    AVPacket* packet = av_packet_alloc();
+    av_seek_frame(formatContext, 0, 0, AVSEEK_FLAG_ANY);
+    bool ok = true;
+    while (av_read_frame(formatContext, packet) == 0) {
+        if (packet->stream_index == audioStream->index) {
+            if (packet->pts == AV_NOPTS_VALUE || (!packetPts.empty() && packet->pts <= packetPts.back())) {
+                ok = false;
+            }
+            packetPts.push_back(packet->pts);
+        }
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    if (!ok) {
+        logger_base.debug("Audio packets do not have increasing timestamps, the track will be decoded in one pass.");
+        return;
+    }
+
+    const int64_t segmentLength = av_rescale_q(AUDIO_SEGMENT_SECONDS, AVRational{ 1, 1 }, audioStream->time_base);
+    AudioSegment segment;
+    segment.seekPts = INT64_MIN;
+    segment.startPts = INT64_MIN;
+    int64_t segmentFirstPts = packetPts.empty() ? 0 : packetPts.front();
+    for (size_t i = AUDIO_SEGMENT_PREROLL; i < packetPts.size(); ++i) {
+        if (packetPts[i] - segmentFirstPts >= segmentLength && packetPts.back() - packetPts[i] >= segmentLength / 2) {
+            segment.endPts = packetPts[i];
+            _segments.push_back(segment);
+            segment.seekPts = packetPts[i - AUDIO_SEGMENT_PREROLL];
+            segment.startPts = packetPts[i];
+            segmentFirstPts = packetPts[i];
+        }
+    }
+    segment.endPts = INT64_MAX;
+    _segments.push_back(segment);
+
+    if (_segments.size() < 2) {
+        _segments.clear();
+    }
+}
+
+// Counts the samples in the track, decoding the segments in parallel
+bool AudioManager::CountSegmentedSamples(AVStream* audioStream) {
+    std::string file = ToUTF8(_audio_file);
+    int streamIndex = audioStream->index;
+    std::vector<long> samples(_segments.size(), 0);
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+
+    std::vector<std::future<void>> decoders;
+    for (int i = 0; i < GetAudioDecoderCount(_segments.size()); ++i) {
+        decoders.push_back(std::async(std::launch::async, [&]() {
+            for (size_t s = next++; s < _segments.size() && !failed; s = next++) {
+                long& count = samples[s];
+                if (!DecodeAudioSegment(file, streamIndex, _segments[s], [&count](AVFrame* frame) { count += frame->nb_samples; })) {
+                    failed = true;
+                }
+            }
+        }));
+    }
+    for (auto& d : decoders) {
+        d.wait();
+    }
+    if (failed) {
+        return false;
+    }
+
+    for (auto s : samples) {
+        _trackSize += s;
+    }
+    return true;
+}
+
+// Decodes the segments in parallel, a few ahead of the one being loaded, and feeds their frames in order through
+// the one resampler so the resampled audio is identical to decoding the track in one pass. The audio becomes
+// available as each segment is loaded. Returns false if a segment failed to decode, the load stops there.
+bool AudioManager::LoadSegmentedAudio(AVFormatContext* formatContext, AVStream* audioStream, SwrContext* au_convert_ctx,
+                                      int out_channels, uint8_t* out_buffer, long& read, int& lastpct) {
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    struct DecodedSegment {
+        bool ok = false;
+        std::vector<AVFrame*> frames;
+    };
+    std::string file = ToUTF8(_audio_file);
+    int streamIndex = audioStream->index;
+    auto decode = [this, file, streamIndex](size_t s) {
+        DecodedSegment d;
+        d.ok = DecodeAudioSegment(file, streamIndex, _segments[s], [&d](AVFrame* frame) { d.frames.push_back(av_frame_clone(frame)); });
+        return d;
+    };
+
+    size_t decoders = GetAudioDecoderCount(_segments.size());
+    logger_base.debug("Loading %d audio segments with %d decoders.", (int)_segments.size(), (int)decoders);
+
+    std::deque<std::future<DecodedSegment>> pending;
+    size_t queued = 0;
+    bool ok = true;
+    for (size_t s = 0; s < _segments.size(); ++s) {
+        while (queued < _segments.size() && pending.size() < decoders) {
+            pending.push_back(std::async(std::launch::async, decode, queued++));
+        }
+        DecodedSegment d = pending.front().get();
+        pending.pop_front();
+
+        if (!d.ok) {
+            logger_base.error("Audio segment %d of %d failed to decode.", (int)s + 1, (int)_segments.size());
+            ok = false;
+        }
+        for (auto frame : d.frames) {
+            if (ok && frame != nullptr) {
+                LoadDecodedAudioFromFrame(frame, formatContext, au_convert_ctx, out_channels, out_buffer, read, lastpct);
+            }
+            av_frame_free(&frame);
+        }
+    }
+    return ok;
+}
+
 void AudioManager::GetTrackMetrics(AVFormatContext* formatContext, AVCodecContext* codecContext, AVStream* audioStream) {
     static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
 
@@ -2340,32 +2743,41 @@ void AudioManager::GetTrackMetrics(AVFormatContext* formatContext, AVCodecContex
     } else
         logger_base.info("av_frame_alloc okay");
 
-    AVPacket* readingPacket = av_packet_alloc();
-    // av_init_packet( readingPacket );
-
-    // start at the beginning
-    av_seek_frame(formatContext, 0, 0, AVSEEK_FLAG_ANY);
-
-    // Read the packets in a loop
-    while (av_read_frame(formatContext, readingPacket) == 0) {
-        if (readingPacket->stream_index == audioStream->index) {
-            int status = avcodec_send_packet(codecContext, readingPacket);
-            if (status == 0) {
-                do {
-                    status = avcodec_receive_frame(codecContext, frame);
-                    if (status == AVERROR_EOF)
-                        break;
-                    _trackSize += frame->nb_samples;
-                } while (status != AVERROR(EAGAIN));
+    FindAudioSegments(formatContext, audioStream);
+    if (!_segments.empty() && !CountSegmentedSamples(audioStream)) {
+        logger_base.debug("Audio segments could not be seeked to exactly, the track will be decoded in one pass.");
+        _segments.clear();
+        _trackSize = 0;
+    }
+
+    if (_segments.empty()) {
+        AVPacket* readingPacket = av_packet_alloc();
+        // av_init_packet( readingPacket );
+
+        // start at the beginning
+        av_seek_frame(formatContext, 0, 0, AVSEEK_FLAG_ANY);
+
+        // Read the packets in a loop
+        while (av_read_frame(formatContext, readingPacket) == 0) {
+            if (readingPacket->stream_index == audioStream->index) {
+                int status = avcodec_send_packet(codecContext, readingPacket);
+                if (status == 0) {
+                    do {
+                        status = avcodec_receive_frame(codecContext, frame);
+                        if (status == AVERROR_EOF)
+                            break;
+                        _trackSize += frame->nb_samples;
+                    } while (status != AVERROR(EAGAIN));
+                }
             }
+
+            // You *must* call av_free_packet() after each call to av_read_frame() or else you'll leak memory
+            av_packet_unref(readingPacket);
         }
 
-        // You *must* call av_free_packet() after each call to av_read_frame() or else you'll leak memory
-        av_packet_unref(readingPacket);
+        av_packet_free(&readingPacket);
     }
 
-    av_packet_free(&readingPacket);
-
     // Clean up!
     av_frame_free(&frame);
 
@@ -2522,6 +2934,176 @@ void AudioManager::NormaliseFilteredAudioData(FilteredAudioData* fad) {
     }
 }
 
+// Applies an FIR filter to a whole track using overlap-save FFT convolution.
+// output[i] = sum(taps[k] * input[i - 1 - k]) which matches the direct convolution
+// this replaced but is O(N log M) rather than O(N * M). Each block of output only
+// depends on the input so blocks are spread across threads, each thread with its own
+// kiss plans as they hold scratch space and cannot be shared.
+static void FFTFilter(const float* input, float* output, long size, const float* taps, int order) {
+    static const int FFT_SIZE = 4096;
+    static const int BLOCKS_PER_JOB = 16;
+    wxASSERT(order < FFT_SIZE / 2);
+
+    const int hop = FFT_SIZE - order + 1;
+    const int bins = FFT_SIZE / 2 + 1;
+    const long blocks = (size + hop - 1) / hop;
+
+    // frequency response of the filter, shared read only by all the jobs
+    std::vector<kiss_fft_cpx> response(bins);
+    {
+        std::vector<float> padded(FFT_SIZE, 0.0f);
+        for (int k = 0; k < order; k++) {
+            padded[k] = taps[k] / FFT_SIZE; // fold the inverse fft scaling in here
+        }
+        kiss_fftr_cfg cfg = kiss_fftr_alloc(FFT_SIZE, 0, nullptr, nullptr);
+        if (cfg == nullptr) {
+            return;
+        }
+        kiss_fftr(cfg, &padded[0], &response[0]);
+        kiss_fftr_free(cfg);
+    }
+
+    const long jobs = (blocks + BLOCKS_PER_JOB - 1) / BLOCKS_PER_JOB;
+    parallel_for(0, jobs, [&](int job) {
+        kiss_fftr_cfg fwd = kiss_fftr_alloc(FFT_SIZE, 0, nullptr, nullptr);
+        kiss_fftr_cfg inv = kiss_fftr_alloc(FFT_SIZE, 1, nullptr, nullptr);
+        if (fwd == nullptr || inv == nullptr) {
+            kiss_fftr_free(fwd);
+            kiss_fftr_free(inv);
+            return;
+        }
+        std::vector<float> segment(FFT_SIZE);
+        std::vector<kiss_fft_cpx> spectrum(bins);
+
+        long lastBlock = std::min(blocks, (long)(job + 1) * BLOCKS_PER_JOB);
+        for (long b = (long)job * BLOCKS_PER_JOB; b < lastBlock; b++) {
+            long outStart = b * hop;
+            long inStart = outStart - order; // one sample behind the output plus the filter history
+            for (int i = 0; i < FFT_SIZE; i++) {
+                long ii = inStart + i;
+                segment[i] = (ii >= 0 && ii < size) ? input[ii] : 0.0f;
+            }
+            kiss_fftr(fwd, &segment[0], &spectrum[0]);
+            for (int i = 0; i < bins; i++) {
+                float re = spectrum[i].r * response[i].r - spectrum[i].i * response[i].i;
+                float im = spectrum[i].r * response[i].i + spectrum[i].i * response[i].r;
+                spectrum[i].r = re;
+                spectrum[i].i = im;
+            }
+            kiss_fftri(inv, &spectrum[0], &segment[0]);
+
+            // the first order - 1 samples have wrapped around and are discarded
+            long count = std::min((long)hop, size - outStart);
+            memcpy(output + outStart, &segment[order - 1], count * sizeof(float));
+        }
+        kiss_fftr_free(fwd);
+        kiss_fftr_free(inv);
+    });
+}
+
+// blocks of the base level per job
+#define MINMAX_BUILD_CHUNK 8192
+
+void MinMaxPyramid::Build(const float* data, long size) {
+    _levels.clear();
+    if (data == nullptr || size <= 0) {
+        return;
+    }
+
+    Level base;
+    base.block = BASE_BLOCK;
+    long blocks = (size + BASE_BLOCK - 1) / BASE_BLOCK;
+    base.minimums.resize(blocks);
+    base.maximums.resize(blocks);
+    int chunks = (int)((blocks + MINMAX_BUILD_CHUNK - 1) / MINMAX_BUILD_CHUNK);
+    parallel_for(0, chunks, [&base, data, size, blocks](int c) {
+        long last = std::min(blocks, (long)(c + 1) * MINMAX_BUILD_CHUNK);
+        for (long b = (long)c * MINMAX_BUILD_CHUNK; b < last; b++) {
+            long start = b * BASE_BLOCK;
+            long end = std::min(size, start + BASE_BLOCK);
+            float mn = data[start];
+            float mx = data[start];
+            for (long i = start + 1; i < end; i++) {
+                mn = std::min(mn, data[i]);
+                mx = std::max(mx, data[i]);
+            }
+            base.minimums[b] = mn;
+            base.maximums[b] = mx;
+        }
+    });
+    _levels.push_back(std::move(base));
+
+    while (_levels.back().minimums.size() > 1) {
+        const Level& below = _levels.back();
+        size_t count = below.minimums.size();
+        Level level;
+        level.block = below.block * 2;
+        level.minimums.resize((count + 1) / 2);
+        level.maximums.resize((count + 1) / 2);
+        for (size_t i = 0; i < count / 2; i++) {
+            level.minimums[i] = std::min(below.minimums[i * 2], below.minimums[i * 2 + 1]);
+            level.maximums[i] = std::max(below.maximums[i * 2], below.maximums[i * 2 + 1]);
+        }
+        if (count % 2 != 0) {
+            level.minimums.back() = below.minimums.back();
+            level.maximums.back() = below.maximums.back();
+        }
+        _levels.push_back(std::move(level));
+    }
+}
+
+void MinMaxPyramid::GetMinMax(const float* data, long size, float samplesPerPixel, std::vector<float>& minimums, std::vector<float>& maximums) const {
+    minimums.clear();
+    maximums.clear();
+    if (data == nullptr || size <= 0 || samplesPerPixel <= 0) {
+        return;
+    }
+
+    // pixels start where the waveform has always put them, using float maths so the rounding does not compound
+    std::vector<long> starts;
+    int total = (int)((float)size / samplesPerPixel) + 1;
+    for (int i = 0; i < total; i++) {
+        long start = (long)((float)i * samplesPerPixel);
+        if (start >= size) {
+            break;
+        }
+        starts.push_back(start);
+    }
+    minimums.resize(starts.size(), 0);
+    maximums.resize(starts.size(), 0);
+
+    // the coarsest level with at least two blocks to a pixel, if the pixels are too small scan the samples
+    const Level* level = nullptr;
+    for (const auto& l : _levels) {
+        if (l.block * 2 > samplesPerPixel) {
+            break;
+        }
+        level = &l;
+    }
+
+    if (level == nullptr) {
+        for (size_t p = 0; p < starts.size(); p++) {
+            long end = std::min(size, (long)(starts[p] + samplesPerPixel));
+            for (long i = starts[p]; i < end; i++) {
+                minimums[p] = std::min(minimums[p], data[i]);
+                maximums[p] = std::max(maximums[p], data[i]);
+            }
+        }
+        return;
+    }
+
+    // each block goes to the pixel its first sample is in
+    long blocks = (long)level->minimums.size();
+    for (size_t p = 0; p < starts.size(); p++) {
+        long first = starts[p] / level->block;
+        long last = p + 1 < starts.size() ? starts[p + 1] / level->block : blocks;
+        for (long b = first; b < last; b++) {
+            minimums[p] = std::min(minimums[p], level->minimums[b]);
+            maximums[p] = std::max(maximums[p], level->maximums[b]);
+        }
+    }
+}
+
 void AudioManager::SwitchTo(AUDIOSAMPLETYPE type, int lowNote, int highNote) {
     while (!IsDataLoaded()) {
         static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
@@ -2566,7 +3148,7 @@ void AudioManager::SwitchTo(AUDIOSAMPLETYPE type, int lowNote, int highNote) {
         fad->lowNote = 0;
         fad->highNote = 0;
         fad->type = AUDIOSAMPLETYPE::RAW;
-        _filtered.push_back(fad);
+        AddFilteredAudioData(fad);
     }
 
     FilteredAudioData* fad = nullptr;
@@ -2576,6 +3158,13 @@ void AudioManager::SwitchTo(AUDIOSAMPLETYPE type, int lowNote, int highNote) {
         // grab it from my cache if i have it
         fad = GetFilteredAudioData(type, -1, -1);
         if (fad == nullptr) {
+            fad = LoadCachedFilteredAudio(type, 0, 0);
+            if (fad != nullptr) {
+                AddFilteredAudioData(fad);
+            }
+        }
+        if (fad == nullptr) {
+            const FilteredAudioData* raw = _filtered.front();
             fad = new FilteredAudioData();
             long datasize = sizeof(float) * (_trackSize + _extra);
             fad->data0 = (float*)malloc(datasize);
@@ -2585,9 +3174,9 @@ void AudioManager::SwitchTo(AUDIOSAMPLETYPE type, int lowNote, int highNote) {
             fad->pcmdata = (int16_t*)calloc(_pcmdatasize + PCMFUDGE, 1);
 
             for (int i = 0; i < _trackSize; ++i) {
-                float v = _data[0][i];
+                float v = raw->data0[i];
                 if (_data[1]) {
-                    float v1 = _data[1][i];
+                    float v1 = raw->data1[i];
                     v = (v - v1);
                 }
                 fad->data0[i] = v;
@@ -2605,7 +3194,8 @@ void AudioManager::SwitchTo(AUDIOSAMPLETYPE type, int lowNote, int highNote) {
             fad->highNote = 0;
             fad->type = type;
             NormaliseFilteredAudioData(fad);
-            _filtered.push_back(fad);
+            AddFilteredAudioData(fad);
+            SaveCachedFilteredAudio(fad);
         }
     } break;
     case AUDIOSAMPLETYPE::RAW:
@@ -2619,8 +3209,16 @@ void AudioManager::SwitchTo(AUDIOSAMPLETYPE type, int lowNote, int highNote) {
         // grab it from my cache if i have it
         fad = GetFilteredAudioData(AUDIOSAMPLETYPE::ANY, lowNote, highNote);
 
+        if (fad == nullptr) {
+            fad = LoadCachedFilteredAudio(type, lowNote, highNote);
+            if (fad != nullptr) {
+                AddFilteredAudioData(fad);
+            }
+        }
+
         // if we didnt find it ... create it
         if (fad == nullptr) {
+            const FilteredAudioData* raw = _filtered.front();
             double lowHz = MidiToFrequency(lowNote);
             double highHz = MidiToFrequency(highNote);
 
@@ -2648,41 +3246,28 @@ void AudioManager::SwitchTo(AUDIOSAMPLETYPE type, int lowNote, int highNote) {
                     a[i + middle] = sin(w2_c * i) / (M_PI * i) - sin(w1_c * i) / (M_PI * i);
                 }
             }
-            // Now apply a windowing function to taper the edges of the filter, e.g.
-            parallel_for(0, _trackSize, [fad, this, a, order](int i) {
-                float lvalue = 0;
-                float rvalue = 0;
-                for (int j = 0; j < order; j++) {
-                    int jj = i + j - order;
-                    if (jj >= 0 && jj < _trackSize) {
-                        lvalue += _data[0][jj] * a[order - j - 1];
-                        if (_data[1]) {
-                            rvalue += _data[1][jj] * a[order - j - 1];
-                        }
-                    }
-                }
-                fad->data0[i] = lvalue;
+            FFTFilter(raw->data0, fad->data0, _trackSize, a, order);
+            if (_data[1]) {
+                FFTFilter(raw->data1, fad->data1, _trackSize, a, order);
+            }
 
-                lvalue = lvalue * 32768;
-                int v2 = (int)lvalue;
+            for (long i = 0; i < _trackSize; i++) {
+                int v2 = (int)(fad->data0[i] * 32768);
                 fad->pcmdata[i * _channels] = v2;
                 if (_channels > 1) {
                     if (_data[1]) {
-                        fad->data1[i] = rvalue;
-                        rvalue = rvalue * 32768;
-                        v2 = (int)rvalue;
-                        fad->pcmdata[i * _channels + 1] = v2;
-                    } else {
-                        fad->pcmdata[i * _channels + 1] = v2;
+                        v2 = (int)(fad->data1[i] * 32768);
                     }
+                    fad->pcmdata[i * _channels + 1] = v2;
                 }
-            });
+            }
 
             fad->lowNote = lowNote;
             fad->highNote = highNote;
             fad->type = type;
             NormaliseFilteredAudioData(fad);
-            _filtered.push_back(fad);
+            AddFilteredAudioData(fad);
+            SaveCachedFilteredAudio(fad);
         }
     } break;
     case AUDIOSAMPLETYPE::ANY:
@@ -2692,6 +3277,9 @@ void AudioManager::SwitchTo(AUDIOSAMPLETYPE type, int lowNote, int highNote) {
     if (fad && _pcmdata && fad->pcmdata) {
         memcpy(_pcmdata, fad->pcmdata, _pcmdatasize);
     }
+    if (fad) {
+        _filterDescription = wxString::Format("%d %d %d", (int)fad->type, fad->lowNote, fad->highNote).ToStdString();
+    }
 
     {
         long datasize = sizeof(float) * (_trackSize + _extra);
@@ -2743,6 +3331,27 @@ void AudioManager::GetLeftDataMinMax(long start, long end, float& minimum, float
     }
 }
 
+void AudioManager::GetLeftDataMinMaxSet(float samplesPerPixel, std::vector<float>& minimums, std::vector<float>& maximums, AUDIOSAMPLETYPE type, int lowNote, int highNote) {
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+    while (!IsDataLoaded()) {
+        logger_base.debug("GetLeftDataMinMaxSet waiting for data to be loaded.");
+        wxMilliSleep(100);
+    }
+
+    minimums.clear();
+    maximums.clear();
+
+    FilteredAudioData* fad = GetFilteredAudioData(type, lowNote, highNote);
+    if (!fad) {
+        return;
+    }
+    std::shared_future<void> built = fad->minMaxBuilt;
+    if (built.valid()) {
+        built.wait();
+    }
+    fad->minMax.GetMinMax(fad->data0, _trackSize, samplesPerPixel, minimums, maximums);
+}
+
 // Access a single piece of track data
 float AudioManager::GetFilteredRightData(long offset) {
     static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
@@ -3001,6 +3610,59 @@ Vamp::Plugin* xLightsVamp::GetPlugin(std::string name) {
     return p;
 }
 
+std::string xLightsVamp::DescribePlugin(Vamp::Plugin* p, int output, size_t step, size_t block, int channels, const std::string& extra) {
+    std::string res = wxString::Format("vamp %s %d output %d step %d block %d channels %d",
+                                       p->getIdentifier(), p->getPluginVersion(), output, (int)step, (int)block, channels)
+                          .ToStdString();
+    for (const auto& param : p->getParameterDescriptors()) {
+        res += wxString::Format(" %s=%g", param.identifier, p->getParameter(param.identifier)).ToStdString();
+    }
+    return res + " " + extra;
+}
+
+bool xLightsVamp::LoadCachedTimings(AudioManager* paudio, const std::string& description, std::vector<int>& starts, std::vector<int>& ends,
+                                    std::vector<std::string>& labels, std::vector<float>& values) {
+    if (!AudioAnalysisCache::IsEnabled()) {
+        return false;
+    }
+    auto cache = AudioAnalysisCache::Open(paudio->GetAnalysisFingerprint(), description);
+    if (cache == nullptr) {
+        return false;
+    }
+    size_t startCount = 0;
+    size_t endCount = 0;
+    size_t valueCount = 0;
+    const int32_t* s = cache->Get<int32_t>(CACHE_STARTS, startCount);
+    const int32_t* e = cache->Get<int32_t>(CACHE_ENDS, endCount);
+    const float* v = cache->Get<float>(CACHE_VALUES, valueCount);
+    std::vector<std::string> l;
+    if (s == nullptr || e == nullptr || endCount != startCount || !cache->GetStrings(CACHE_LABELS, l) || l.size() != startCount) {
+        return false;
+    }
+    starts.insert(starts.end(), s, s + startCount);
+    ends.insert(ends.end(), e, e + endCount);
+    labels.insert(labels.end(), l.begin(), l.end());
+    if (v != nullptr) {
+        values.insert(values.end(), v, v + valueCount);
+    }
+    return true;
+}
+
+void xLightsVamp::SaveCachedTimings(AudioManager* paudio, const std::string& description, const std::vector<int>& starts, const std::vector<int>& ends,
+                                    const std::vector<std::string>& labels, const std::vector<float>& values) {
+    if (!AudioAnalysisCache::IsEnabled() || starts.size() != ends.size() || starts.size() != labels.size()) {
+        return;
+    }
+    std::vector<int32_t> s(starts.begin(), starts.end());
+    std::vector<int32_t> e(ends.begin(), ends.end());
+    AudioAnalysisCache::Writer writer;
+    writer.Add(CACHE_STARTS, s.data(), s.size());
+    writer.Add(CACHE_ENDS, e.data(), e.size());
+    writer.AddStrings(CACHE_LABELS, labels);
+    writer.Add(CACHE_VALUES, values.data(), values.size());
+    writer.Write(paudio->GetAnalysisFingerprint(), description);
+}
+
 std::list<std::string> AudioManager::GetAudioDevices() {
     return OutputSDL::GetAudioDevices();
 }
@@ -13,6 +13,7 @@
 #include <future>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
 #include <vector>
@@ -37,6 +38,7 @@ extern "C" {
 #include <wx/progdlg.h>
 
 class AudioManager;
+class AudioAnalysisCache;
 
 enum class AUDIOSAMPLETYPE {
     RAW,
@@ -69,6 +71,14 @@ public:
     std::list<std::string> GetAvailablePlugins(AudioManager* paudio);
     std::list<std::string> GetAllAvailablePlugins(AudioManager* paudio);
     Vamp::Plugin* GetPlugin(std::string name);
+
+    // Timings a plugin found in a track are kept in the audio analysis cache. The description is built
+    // from the plugin's current parameters plus whatever else the caller passes that changed the result.
+    static std::string DescribePlugin(Vamp::Plugin* p, int output, size_t step, size_t block, int channels, const std::string& extra);
+    static bool LoadCachedTimings(AudioManager* paudio, const std::string& description, std::vector<int>& starts, std::vector<int>& ends,
+                                  std::vector<std::string>& labels, std::vector<float>& values);
+    static void SaveCachedTimings(AudioManager* paudio, const std::string& description, const std::vector<int>& starts, const std::vector<int>& ends,
+                                  const std::vector<std::string>& labels, const std::vector<float>& values);
 };
 
 typedef enum MEDIAPLAYINGSTATE {
@@ -218,6 +228,30 @@ public:
     }
 };
 
+// Minimum and maximum of a track over blocks of 32, 64, 128 ... samples, each level built
+// from the one below it, so the waveform can be drawn at any zoom from the level nearest
+// its scale rather than by scanning every sample under every pixel.
+class MinMaxPyramid {
+public:
+    static const long BASE_BLOCK = 32;
+
+    void Build(const float* data, long size);
+    bool IsBuilt() const { return !_levels.empty(); }
+
+    // Minimum and maximum, both including 0, of each run of samplesPerPixel samples of the
+    // size samples in data. Served from the coarsest level whose blocks are no bigger than
+    // a pixel so pixel edges are accurate to that block size.
+    void GetMinMax(const float* data, long size, float samplesPerPixel, std::vector<float>& minimums, std::vector<float>& maximums) const;
+
+private:
+    struct Level {
+        long block = 0;
+        std::vector<float> minimums;
+        std::vector<float> maximums;
+    };
+    std::vector<Level> _levels;
+};
+
 typedef struct FilteredAudioData {
     AUDIOSAMPLETYPE type;
     int lowNote = 0;
@@ -225,14 +259,48 @@ typedef struct FilteredAudioData {
     float* data0 = nullptr;
     float* data1 = nullptr;
     int16_t* pcmdata = nullptr;
+    std::shared_ptr<AudioAnalysisCache> cache; // when set the data is in place in the analysis cache and is not freed
+    MinMaxPyramid minMax;                       // of data0, built in the background once the data is added
+    std::shared_future<void> minMaxBuilt;
 } FilteredAudioData;
 
+// A run of the audio stream's packets decoded by a demuxer and decoder of its own, so
+// a track can be decoded on several threads at once. Timestamps are in the stream's
+// time base, INT64_MIN / INT64_MAX mark the start and end of the track.
+struct AudioSegment {
+    int64_t seekPts = 0;  // decoding starts a few packets ahead of the segment
+    int64_t startPts = 0; // timestamp of the segment's first frame
+    int64_t endPts = 0;   // timestamp of the next segment's first frame
+};
+
+// Read only view of one frame's row of the spectrogram which AudioManager keeps
+// for the whole track in a single array. Frames with no analysis window of
+// their own share the row of the frame before them.
+class SpectrumView {
+    const float* _data = nullptr;
+    size_t _size = 0;
+
+public:
+    SpectrumView() {}
+    SpectrumView(const float* data, size_t size) :
+        _data(data), _size(size) {}
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const float* begin() const { return _data; }
+    const float* end() const { return _data + _size; }
+    const float* cbegin() const { return _data; }
+    const float* cend() const { return _data + _size; }
+    float operator[](size_t i) const { return _data[i]; }
+    operator std::vector<float>() const { return std::vector<float>(begin(), end()); }
+};
+
 class FrameData {
 public:
     float max = 0;
     float min = 0;
     float spread = 0;
-    std::vector<float> vu;
+    SpectrumView vu;
     std::vector<float> notes;
 };
 
@@ -241,6 +309,8 @@ class AudioManager {
     std::shared_timed_mutex _mutexAudioLoad;
     long _loadedData = 0;
     std::vector<FrameData> _frameData;
+    std::vector<float> _spectrogram; // frames x SPECTRUM_NOTES, viewed by _frameData[].vu
+    std::shared_ptr<AudioAnalysisCache> _frameDataCache; // holds the spectrogram instead when it came from the cache
     std::string _audio_file;
     xLightsVamp _vamp;
     long _rate = 44100;
@@ -271,14 +341,22 @@ class AudioManager {
     int _sdlid = 0;
     bool _ok = false;
     std::string _hash;
+    std::string _fingerprint;
+    std::mutex _fingerprintLock;
+    std::string _filterDescription = "raw";
     std::future<void> _prepFrameData;
     std::future<void> _loadingAudio;
+    std::vector<AudioSegment> _segments; // empty when the track has to be decoded in one pass
     std::string _device;
     
     long _bitRate = 0;
     std::map<std::string, std::string> _metaData;
 
     void GetTrackMetrics(AVFormatContext* formatContext, AVCodecContext* codecContext, AVStream* audioStream);
+    void FindAudioSegments(AVFormatContext* formatContext, AVStream* audioStream);
+    bool CountSegmentedSamples(AVStream* audioStream);
+    bool LoadSegmentedAudio(AVFormatContext* formatContext, AVStream* audioStream, SwrContext* au_convert_ctx,
+                            int out_channels, uint8_t* out_buffer, long& read, int& lastpct);
     void LoadTrackData(AVFormatContext* formatContext, AVCodecContext* codecContext, AVStream* audioStream);
     void ExtractMP3Tags(AVFormatContext* formatContext);
     long CalcLengthMS() const;
@@ -289,7 +367,6 @@ class AudioManager {
     static int decodebitrateindex(int bitrateindex, int version, int layertype);
     int decodesamplerateindex(int samplerateindex, int version) const;
     static int decodesideinfosize(int version, int mono);
-    void CalculateSpectrumAnalysis(const float* in, int n, float& max, int id, std::vector<float>& d) const;
 
     void LoadAudioFromFrame(AVFormatContext* formatContext, AVCodecContext* codecContext, AVPacket* decodingPacket, AVFrame* frame, SwrContext* au_convert_ctx,
                             bool receivedEOF, int out_channels, uint8_t* out_buffer, long& read, int& lastpct);
@@ -299,6 +376,11 @@ class AudioManager {
     void SetLoadedData(long pos);
 
     void NormaliseFilteredAudioData(FilteredAudioData* fad);
+    bool LoadCachedFrameData(int frames);
+    void SaveCachedFrameData();
+    FilteredAudioData* LoadCachedFilteredAudio(AUDIOSAMPLETYPE type, int lowNote, int highNote);
+    void SaveCachedFilteredAudio(const FilteredAudioData* fad);
+    void AddFilteredAudioData(FilteredAudioData* fad);
 
 public:
     static double MidiToFrequency(int midi);
@@ -367,6 +449,12 @@ public:
         return _audio_file;
     };
     std::string Hash();
+    // identifies the audio file's content for the analysis cache, "" if it cannot be read
+    std::string GetAnalysisFingerprint();
+    // the filter the data returned by GetFiltered...Data has been through
+    std::string GetFilterDescription() const {
+        return _filterDescription;
+    }
     long LengthMS() const {
         return _lengthMS;
     };
@@ -376,6 +464,8 @@ public:
     float GetRawLeftData(long offset);
     void SwitchTo(AUDIOSAMPLETYPE type, int lowNote = 0, int highNote = 127);
     void GetLeftDataMinMax(long start, long end, float& minimum, float& maximum, AUDIOSAMPLETYPE type = AUDIOSAMPLETYPE::ANY, int lowNote = -1, int highNote = -1);
+    // GetLeftDataMinMax for every pixel across the track in one pass over the min max pyramid
+    void GetLeftDataMinMaxSet(float samplesPerPixel, std::vector<float>& minimums, std::vector<float>& maximums, AUDIOSAMPLETYPE type = AUDIOSAMPLETYPE::ANY, int lowNote = -1, int highNote = -1);
     float* GetFilteredRightDataPtr(long offset);
     float* GetFilteredLeftDataPtr(long offset);
     float* GetRawRightDataPtr(long offset);
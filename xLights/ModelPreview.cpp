@@ -20,6 +20,7 @@
 #endif
 
 #include "ModelPreview.h"
+#include "PreviewGatherTable.h"
 #include "models/Model.h"
 #include "models/ViewObject.h"
 #include "PreviewPane.h"
@@ -28,6 +29,7 @@
 #include "xLightsMain.h"
 #include "models/ModelGroup.h"
 #include "ExternalHooks.h"
+#include "graphics/software/xlSoftwareGraphicsContext.h"
 
 #include <log4cpp/Category.hh>
 
@@ -761,20 +763,23 @@ void ModelPreview::Render(uint32_t frameTime, const unsigned char *data, bool sw
     currentFrameTime = frameTime;
     if (StartDrawing(mPointSize)) {
         const std::vector<Model*> &models = GetModels();
+        if (gatherTable == nullptr) {
+            gatherTable = std::make_unique<PreviewGatherTable>();
+        }
+        gatherTable->Update(models, xlights->_seqData.NumChannels());
+        gatherTable->Gather(data);
+
         std::map<int32_t, std::list<Model*>> sortedModels;
         for (auto m : models) {
-            int NodeCnt = m->GetNodeCount();
-            for (size_t n = 0; n < NodeCnt; ++n) {
-                int start = m->NodeStartChannel(n);
-                m->SetNodeChannelValues(n, &data[start]);
-            }
             auto p = ProjViewMatrix * glm::vec4(m->GetHcenterPos(), m->GetVcenterPos(), m->GetDcenterPos(), 1);
             int z = std::round(p.z * 100);
             sortedModels[z].push_back(m);
         }
         for (auto iter = sortedModels.rbegin(); iter != sortedModels.rend(); ++iter) {
             for (auto m : iter->second) {
+                m->SetPreviewColors(gatherTable->GetColors(m));
                 m->DisplayModelOnWindow(this, currentContext, solidProgram, transparentProgram, is3d);
+                m->SetPreviewColors(nullptr);
             }
         }
         // draw all the view objects
@@ -788,6 +793,60 @@ void ModelPreview::Render(uint32_t frameTime, const unsigned char *data, bool sw
     }
 }
 
+bool ModelPreview::CanRenderOffscreen()
+{
+    for (auto m : GetModels()) {
+        if (!m->CanGatherPreviewColors()) {
+            return false;
+        }
+    }
+    return !is3d || xlights == nullptr || xlights->AllObjects.size() == 0;
+}
+
+void ModelPreview::StartOffscreenRendering(int width, int height)
+{
+    if (offscreenContext != nullptr) {
+        EndOffscreenRendering();
+    }
+    offscreenContext = new xlSoftwareGraphicsContext(this, width, height, ClearBackgroundColor());
+    std::swap(background, offscreenBackground);
+    std::swap(grid2d, offscreenGrid2d);
+}
+
+std::shared_ptr<xlSoftwareFrame> ModelPreview::RenderOffscreen(uint32_t frameTime, const unsigned char* data)
+{
+    if (offscreenContext == nullptr) {
+        return nullptr;
+    }
+    renderingOffscreen = true;
+    Render(frameTime, data, false);
+    renderingOffscreen = false;
+    return offscreenContext->TakeFrame();
+}
+
+void ModelPreview::EndOffscreenRendering()
+{
+    if (offscreenContext == nullptr) {
+        return;
+    }
+    std::swap(background, offscreenBackground);
+    std::swap(grid2d, offscreenGrid2d);
+    if (offscreenBackground != nullptr) {
+        delete offscreenBackground;
+        offscreenBackground = nullptr;
+    }
+    if (offscreenGrid2d != nullptr) {
+        delete offscreenGrid2d;
+        offscreenGrid2d = nullptr;
+    }
+    for (auto m : GetModels()) {
+        m->DeleteOffscreenUIObjects();
+    }
+    delete offscreenContext;
+    offscreenContext = nullptr;
+    mWindowResized = true;
+}
+
 void ModelPreview::rightClick(wxMouseEvent& event) {
     if (xlights != nullptr) {
         if (currentLayoutGroup != "") {
@@ -959,6 +1018,7 @@ ModelPreview::~ModelPreview()
         delete camera3d;
     }
 
+    EndOffscreenRendering();
     if (background) {
         texturesToDelete.push_back(background);
     }
@@ -1142,12 +1202,16 @@ bool ModelPreview::StartDrawing(wxDouble pointSize, bool fromPaint)
 {
     static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
 
-    if (!fromPaint && !IsShownOnScreen()) return false;
-    if (!mIsInitialized) {
-        PrepareCanvas();
-        mIsInitialized = true;
+    if (renderingOffscreen) {
+        currentContext = offscreenContext;
+    } else {
+        if (!fromPaint && !IsShownOnScreen()) return false;
+        if (!mIsInitialized) {
+            PrepareCanvas();
+            mIsInitialized = true;
+        }
+        currentContext = PrepareContextForDrawing();
     }
-    currentContext = PrepareContextForDrawing();
     if (currentContext == nullptr) {
         return false;
     }
@@ -1305,7 +1369,9 @@ void ModelPreview::EndDrawing(bool swapBuffers/*=true*/)
     }
     
     currentContext->popDebugContext();
-    FinishDrawing(currentContext, swapBuffers);
+    if (!renderingOffscreen) {
+        FinishDrawing(currentContext, swapBuffers);
+    }
     currentContext = nullptr;
     mIsDrawing = false;
 }
@@ -37,6 +37,9 @@ class PreviewPane;
 class LayoutGroup;
 class xLightsFrame;
 class xlVertex3Accumulator;
+class PreviewGatherTable;
+class xlSoftwareGraphicsContext;
+class xlSoftwareFrame;
 
 class ModelPreview : public GRAPHICS_BASE_CLASS
 {
@@ -94,6 +97,16 @@ public:
     void RenderModels(const std::vector<Model*>& models, bool selected, bool showFirstPixel);
     void RenderModel(Model* m, bool wiring = false, bool highlightFirst = false, int highlightpixel = 0);
 
+    // Draws frames of sequence data with the software renderer instead of to the window, so
+    // they can be rasterized on worker threads. Needs every model to draw through
+    // Model::DisplayModelOnWindow and, in 3D, no view objects as those hold on to the
+    // resources of the window's context.
+    bool CanRenderOffscreen();
+    void StartOffscreenRendering(int width, int height);
+    std::shared_ptr<xlSoftwareFrame> RenderOffscreen(uint32_t frameTime, const unsigned char* data);
+    void EndOffscreenRendering();
+    bool IsRenderingOffscreen() const { return renderingOffscreen; }
+
     double calcPixelSize(double i);
 
     void SetModel(const Model* model, bool wiring = false, bool highlightFirst = false);
@@ -202,6 +215,7 @@ private:
     std::vector<Model*> tmpModelList;
     Model *additionalModel = nullptr;
     uint32_t currentFrameTime = 0;
+    std::unique_ptr<PreviewGatherTable> gatherTable;
 
     xlGraphicsProgram *solidProgram = nullptr;
     xlGraphicsProgram *transparentProgram = nullptr;
@@ -240,6 +254,12 @@ private:
     xlGraphicsContext *currentContext = nullptr;
     std::list<xlTexture *> texturesToDelete;
 
+    // swapped with background and grid2d while rendering offscreen
+    xlSoftwareGraphicsContext *offscreenContext = nullptr;
+    bool renderingOffscreen = false;
+    xlTexture *offscreenBackground = nullptr;
+    xlVertexAccumulator *offscreenGrid2d = nullptr;
+
 
 	DECLARE_EVENT_TABLE()
 };
@@ -0,0 +1,253 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <algorithm>
+#include <typeinfo>
+
+#include "PreviewGatherTable.h"
+#include "DimmingCurve.h"
+#include "Parallel.h"
+#include "models/Model.h"
+#include "models/Node.h"
+
+#include <log4cpp/Category.hh>
+
+// colour slots per job, small enough to spread a large layout over the pool
+static const size_t GATHER_CHUNK = 16384;
+
+// Works out what the curve's reverse does to each of red, green and blue on its own. Fails
+// for curves where a channel depends on the others, such as the white only curves, which
+// are then reversed colour by colour.
+static bool BuildReverseTable(DimmingCurve* curve, std::vector<uint8_t>& table)
+{
+    table.resize(256 * 3);
+    for (int v = 0; v < 256; ++v) {
+        xlColor r((uint8_t)v, 0, 0);
+        xlColor g(0, (uint8_t)v, 0);
+        xlColor b(0, 0, (uint8_t)v);
+        curve->reverse(r);
+        curve->reverse(g);
+        curve->reverse(b);
+        if (r.green != 0 || r.blue != 0 || g.red != 0 || g.blue != 0 || b.red != 0 || b.green != 0) {
+            return false;
+        }
+        table[v] = r.red;
+        table[256 + v] = g.green;
+        table[512 + v] = b.blue;
+    }
+    for (int v = 0; v < 256; ++v) {
+        xlColor grey((uint8_t)v, (uint8_t)v, (uint8_t)v);
+        xlColor mixed((uint8_t)v, (uint8_t)(255 - v), (uint8_t)(v / 2));
+        xlColor expGrey(table[grey.red], table[256 + grey.green], table[512 + grey.blue]);
+        xlColor expMixed(table[mixed.red], table[256 + mixed.green], table[512 + mixed.blue]);
+        curve->reverse(grey);
+        curve->reverse(mixed);
+        if (grey != expGrey || mixed != expMixed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PreviewGatherTable::IsCurrent(const std::vector<Model*>& models, size_t numChannels) const
+{
+    if (numChannels != _numChannels || models.size() != _runs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < models.size(); ++i) {
+        const Model* m = models[i];
+        const ModelRun& run = _runs[i];
+        if (run.model != m || run.changeCount != m->GetChangeCount() || run.nodeCount != m->GetNodeCount() ||
+            run.firstNode != (run.nodeCount == 0 ? nullptr : m->GetNode(0)) || run.curve != m->modelDimmingCurve) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PreviewGatherTable::Update(const std::vector<Model*>& models, size_t numChannels)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    if (IsCurrent(models, numChannels)) {
+        return;
+    }
+
+    _numChannels = numChannels;
+    _runs.clear();
+    _runIndex.clear();
+    _nodeEntries.clear();
+    for (int x = 0; x < 3; ++x) {
+        _chan[x].clear();
+        _mask[x].clear();
+    }
+
+    size_t tabled = 0;
+    for (auto m : models) {
+        ModelRun run;
+        run.model = m;
+        run.changeCount = m->GetChangeCount();
+        run.nodeCount = m->GetNodeCount();
+        run.firstNode = run.nodeCount == 0 ? nullptr : m->GetNode(0);
+        run.first = _chan[0].size();
+        run.gathered = m->CanGatherPreviewColors();
+        run.curve = m->modelDimmingCurve;
+        if (run.gathered && run.curve != nullptr && !BuildReverseTable(run.curve, run.reverseTable)) {
+            run.reverseTable.clear();
+        }
+        _runIndex[m] = _runs.size();
+
+        for (size_t n = 0; n < run.nodeCount; ++n) {
+            NodeBaseClass* node = m->GetNode(n);
+            if (!run.gathered) {
+                if (node->ActChan + node->GetChanCount() <= numChannels) {
+                    _nodeEntries.push_back({ node, NO_SLOT });
+                }
+                continue;
+            }
+
+            // channels and masks to read red, green and blue from, masked out components read as 0
+            uint32_t chan[3] = { 0, 0, 0 };
+            uint8_t mask[3] = { 0, 0, 0 };
+            bool direct = false;
+            uint32_t start = node->ActChan;
+            const std::type_info& type = typeid(*node);
+            if (type == typeid(NodeBaseClass) || type == typeid(NodeClassRed) || type == typeid(NodeClassGreen) || type == typeid(NodeClassBlue)) {
+                direct = true;
+                for (int x = 0; x < 3; ++x) {
+                    uint8_t offset = node->GetChannelOffset(x);
+                    if (offset != 255) {
+                        chan[x] = start + offset;
+                        mask[x] = 0xFF;
+                        if (chan[x] >= numChannels) {
+                            direct = false;
+                        }
+                    }
+                }
+            } else if (type == typeid(NodeClassWhite) && start < numChannels) {
+                chan[0] = chan[1] = chan[2] = start;
+                mask[0] = mask[1] = mask[2] = 0xFF;
+                direct = true;
+            }
+            if (!direct) {
+                chan[0] = chan[1] = chan[2] = 0;
+                mask[0] = mask[1] = mask[2] = 0;
+                if (start + node->GetChanCount() <= numChannels) {
+                    _nodeEntries.push_back({ node, (uint32_t)_chan[0].size() });
+                }
+            } else {
+                ++tabled;
+            }
+            for (int x = 0; x < 3; ++x) {
+                _chan[x].push_back(chan[x]);
+                _mask[x].push_back(mask[x]);
+            }
+        }
+        _runs.push_back(std::move(run));
+    }
+    _colors.resize(_chan[0].size());
+
+    logger_base.debug("Preview gather table rebuilt: %d models, %d nodes gathered directly, %d through the node.",
+                      (int)_runs.size(), (int)tabled, (int)_nodeEntries.size());
+}
+
+void PreviewGatherTable::ReverseDimming(size_t start, size_t end)
+{
+    // runs are in slot order, find the first one overlapping the chunk
+    auto it = std::upper_bound(_runs.begin(), _runs.end(), start, [](size_t s, const ModelRun& r) { return s < r.first; });
+    if (it != _runs.begin()) {
+        --it;
+    }
+    for (; it != _runs.end() && it->first < end; ++it) {
+        if (!it->gathered || it->curve == nullptr) {
+            continue;
+        }
+        size_t s = std::max(start, (size_t)it->first);
+        size_t e = std::min(end, (size_t)it->first + it->nodeCount);
+        if (!it->reverseTable.empty()) {
+            const uint8_t* rt = &it->reverseTable[0];
+            const uint8_t* gt = rt + 256;
+            const uint8_t* bt = rt + 512;
+            xlColor* colors = &_colors[0];
+            for (size_t i = s; i < e; ++i) {
+                colors[i].red = rt[colors[i].red];
+                colors[i].green = gt[colors[i].green];
+                colors[i].blue = bt[colors[i].blue];
+            }
+        } else {
+            for (size_t i = s; i < e; ++i) {
+                it->curve->reverse(_colors[i]);
+            }
+        }
+    }
+}
+
+void PreviewGatherTable::Gather(const unsigned char* data)
+{
+    if (_numChannels == 0) {
+        return;
+    }
+
+    size_t count = _colors.size();
+    if (count > 0) {
+        int chunks = (int)((count + GATHER_CHUNK - 1) / GATHER_CHUNK);
+        parallel_for(0, chunks, [this, data, count](int c) {
+            size_t start = c * GATHER_CHUNK;
+            size_t end = std::min(count, start + GATHER_CHUNK);
+            const uint32_t* rc = &_chan[0][0];
+            const uint32_t* gc = &_chan[1][0];
+            const uint32_t* bc = &_chan[2][0];
+            const uint8_t* rm = &_mask[0][0];
+            const uint8_t* gm = &_mask[1][0];
+            const uint8_t* bm = &_mask[2][0];
+            xlColor* colors = &_colors[0];
+            for (size_t i = start; i < end; ++i) {
+                colors[i].red = data[rc[i]] & rm[i];
+                colors[i].green = data[gc[i]] & gm[i];
+                colors[i].blue = data[bc[i]] & bm[i];
+                colors[i].alpha = 255;
+            }
+            ReverseDimming(start, end);
+        });
+    }
+
+    size_t nodes = _nodeEntries.size();
+    if (nodes > 0) {
+        int chunks = (int)((nodes + GATHER_CHUNK - 1) / GATHER_CHUNK);
+        parallel_for(0, chunks, [this, data, nodes](int c) {
+            size_t start = c * GATHER_CHUNK;
+            size_t end = std::min(nodes, start + GATHER_CHUNK);
+            for (size_t i = start; i < end; ++i) {
+                NodeEntry& e = _nodeEntries[i];
+                e.node->SetFromChannels(&data[e.node->ActChan]);
+                if (e.slot != NO_SLOT) {
+                    xlColor& color = _colors[e.slot];
+                    e.node->GetColor(color);
+                    if (e.node->model->modelDimmingCurve != nullptr) {
+                        e.node->model->modelDimmingCurve->reverse(color);
+                    }
+                }
+            }
+        });
+    }
+}
+
+const xlColor* PreviewGatherTable::GetColors(const Model* model) const
+{
+    auto it = _runIndex.find(model);
+    if (it == _runIndex.end()) {
+        return nullptr;
+    }
+    const ModelRun& run = _runs[it->second];
+    if (!run.gathered || run.nodeCount == 0) {
+        return nullptr;
+    }
+    return &_colors[run.first];
+}
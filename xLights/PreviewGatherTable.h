@@ -0,0 +1,77 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "Color.h"
+
+class Model;
+class NodeBaseClass;
+class DimmingCurve;
+
+// Maps the channels of a frame of sequence data straight to the node colours a preview
+// draws. It is built once for the set of models in the preview and only rebuilt when
+// one of them changes, so each frame of playback is a flat gather over the channel
+// offsets followed by the dimming curve lookups, split across the job pool, rather than
+// a virtual call per node to load the channels and another to read the colour back.
+//
+// Plain RGB, single colour and white nodes are gathered directly. Every other kind of
+// node, and the nodes of models that draw from their node state (DMX and image models),
+// still has its channels loaded into the node.
+class PreviewGatherTable
+{
+public:
+    // rebuilds the table if the models, their nodes or the number of channels have changed
+    void Update(const std::vector<Model*>& models, size_t numChannels);
+
+    // converts one frame of sequence data
+    void Gather(const unsigned char* data);
+
+    // the node colours for the model from the last Gather, dimming curve already
+    // reversed, or nullptr if the model is not in the table or draws from its nodes
+    const xlColor* GetColors(const Model* model) const;
+
+private:
+    struct ModelRun {
+        const Model* model = nullptr;
+        unsigned long changeCount = 0;
+        size_t nodeCount = 0;
+        const NodeBaseClass* firstNode = nullptr;
+
+        uint32_t first = 0; // first colour slot
+        bool gathered = false;
+        DimmingCurve* curve = nullptr;     // reversed colour by colour when it could not be tabled
+        std::vector<uint8_t> reverseTable; // 256 entries for each of red, green, blue
+    };
+
+    // nodes whose channels are loaded into the node, slot is NO_SLOT if the model draws from the node
+    struct NodeEntry {
+        NodeBaseClass* node = nullptr;
+        uint32_t slot = 0;
+    };
+    static const uint32_t NO_SLOT = 0xFFFFFFFF;
+
+    bool IsCurrent(const std::vector<Model*>& models, size_t numChannels) const;
+    void ReverseDimming(size_t start, size_t end);
+
+    size_t _numChannels = 0;
+    std::vector<ModelRun> _runs;
+    std::map<const Model*, size_t> _runIndex;
+
+    // one entry per colour slot for red, green and blue, kept as separate arrays so the gather vectorises
+    std::vector<uint32_t> _chan[3];
+    std::vector<uint8_t> _mask[3];
+    std::vector<xlColor> _colors;
+    std::vector<NodeEntry> _nodeEntries;
+};
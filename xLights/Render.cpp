@@ -27,11 +27,21 @@
 #include "Parallel.h"
 #include "ExternalHooks.h"
 #include "GPURenderUtils.h"
+#include "RenderBufferPool.h"
+#include "effects/ImageCache.h"
+#include "RenderProfiler.h"
+#include "RenderLayerCache.h"
 
 #include <log4cpp/Category.hh>
 
 #define END_OF_RENDER_FRAME INT_MAX
 
+// the run of frames an effect has rendered on one layer since it was last recorded
+struct RenderProfileSpan {
+    Effect* effect = nullptr;
+    RenderProfiler::Event event;
+};
+
 
 class EffectLayerInfo {
 public:
@@ -51,10 +61,13 @@ public:
     void resize(int l) {
         numLayers = l;
         currentEffects.resize(l);
-        currentEffectIdxs.resize(l);
         settingsMaps.resize(l);
         effectStates.resize(l);
         validLayers.resize(l + 1); //extra one for the blending layer
+        profile.resize(l);
+        layerGeneration.resize(l);
+        reuseChecked.resize(l);
+        reuse.resize(l);
     }
 
     int numLayers;
@@ -63,10 +76,13 @@ public:
     Element *element;
     PixelBufferClassPtr buffer;
     std::vector<Effect*> currentEffects;
-    std::vector<int> currentEffectIdxs;
     std::vector<SettingsMap> settingsMaps;
     std::vector<bool> effectStates;
     std::vector<bool> validLayers;
+    std::vector<RenderProfileSpan> profile;
+    std::vector<uint64_t> layerGeneration; // RenderLayerCache generation when the current effect was initialized
+    std::vector<Effect*> reuseChecked;     // the effect reuse was last decided for
+    std::vector<RenderLayerCache::PinnedFrames> reuse; // the current effect's frames, when they are coming from the RenderLayerCache
 };
 
 class RenderEvent {
@@ -238,7 +254,8 @@ public:
                             static const std::string DEFAULT("Default");
                             static const std::string PER_MODEL("Per Model");
                             static const std::string DEEP("Deep");
-                            const std::string& bt = layer->GetEffect(e)->GetSettings().Get(CHOICE_BufferStyle, DEFAULT);
+                            SettingsView settings = layer->GetEffect(e)->GetSettingsView();
+                            const std::string& bt = settings.Get(CHOICE_BufferStyle, DEFAULT);
                             if (bt.compare(0, 9, PER_MODEL) == 0) {
                                 if (bt.compare(bt.length() - 4, 4, DEEP) == 0) {
                                     perModelEffectsDeep = true;
@@ -433,12 +450,11 @@ public:
 
     wxString GetStatusForUser()
     {
-        int lastIdx = 0;
         int submodel = -1;
         if (statusType >= 1 && statusType <= 3) {
             submodel = statusSubmodel;
         }
-        Effect* effect = findEffectForFrame(this->statusLayer, GetCurrentFrame(), submodel, lastIdx);
+        Effect* effect = findEffectForFrame(this->statusLayer, GetCurrentFrame(), submodel);
 
         if (effect != nullptr) {
             std::string mname = "";
@@ -540,6 +556,17 @@ public:
         supportsModelBlending = true;
     }
 
+    void SetReuseLayers() {
+        reuseLayers = true;
+    }
+
+    // a layer's output can be kept in the RenderLayerCache if it depends on nothing but its own effect
+    bool IsLayerCacheable(PixelBufferClass* buffer, int layer, Effect* ef, Effect* copy) {
+        return reuseLayers && ef != nullptr && copy == nullptr &&
+               !buffer->IsPersistent(layer) && buffer->GetFreezeFrame(layer) == 999999 &&
+               !buffer->IsCanvasMix(layer) && !buffer->IsVariableSubBuffer(layer) && !buffer->IsRenderingDisabled(layer);
+    }
+
     int GetEffectFrame(Effect* ef, int frame, int frameTime)
     {
         return frame - (ef->GetStartTimeMS() / frameTime);
@@ -562,14 +589,14 @@ public:
             EffectLayer* elayer = el->GetEffectLayer(layer);
             //must lock the layer so the Effect* stays valid
             std::unique_lock<std::recursive_mutex> elayerLock(elayer->GetLock());
-            Effect* ef = findEffectForFrame(elayer, frame, info.currentEffectIdxs[layer]);
+            Effect* ef = findEffectForFrame(elayer, frame);
             Effect* copy = nullptr;
 
             if (ef != nullptr && ef->GetEffectIndex() == EffectManager::eff_DUPLICATE) {
                 // we are mirroring another model ... so find the right effect on that model/layer
                 Effect* orig = ef;
                 
-                ef = findEffectForFrame(orig->GetSetting("E_CHOICE_Duplicate_Model"), orig->GetSettings().GetInt("E_SPINCTRL_Duplicate_Layer"), frame);
+                ef = findEffectForFrame(orig->GetSetting("E_CHOICE_Duplicate_Model"), orig->GetSettingsView().GetInt("E_SPINCTRL_Duplicate_Layer"), frame);
 
                 if (ef != nullptr) {
 
@@ -584,21 +611,21 @@ public:
 
                         if (orig->GetSetting("E_CHECKBOX_Duplicate_Override_Buffer") == "1") {
                             ef->EraseSettingsStartingWith("B_");
-                            for (const auto& it : orig->GetSettings()) {
+                            for (const auto& it : orig->GetSettingsView()) {
                                 if (StartsWith(it.first, "B_"))
                                     ef->GetSettings()[it.first] = it.second;
                             }
                         }
                         if (orig->GetSetting("E_CHECKBOX_Duplicate_Override_Timing") == "1") {
                             ef->EraseSettingsStartingWith("T_");
-                            for (const auto& it : orig->GetSettings()) {
+                            for (const auto& it : orig->GetSettingsView()) {
                                 if (StartsWith(it.first, "T_"))
                                     ef->GetSettings()[it.first] = it.second;
                             }
                         }
                         if (orig->GetSetting("E_CHECKBOX_Duplicate_Override_Palette") == "1") {
                             ef->ErasePalette();
-                            for (const auto& it : orig->GetPaletteMap()) {
+                            for (const auto& it : orig->GetPaletteView()) {
                                 if (StartsWith(it.first, "C_BUTTON_Palette") || StartsWith(it.first, "C_CHECKBOX_Palette"))
                                     ef->GetPaletteMap()[it.first] = it.second;
                             }
@@ -606,7 +633,7 @@ public:
                         }
                         if (orig->GetSetting("E_CHECKBOX_Duplicate_Override_Color") == "1") {
                             ef->EraseColourSettings();
-                            for (const auto& it : orig->GetPaletteMap()) {
+                            for (const auto& it : orig->GetPaletteView()) {
                                 if (!StartsWith(it.first, "C_BUTTON_Palette") && !StartsWith(it.first, "C_CHECKBOX_Palette"))
                                     ef->GetPaletteMap()[it.first] = it.second;
                             }
@@ -624,6 +651,7 @@ public:
                     info.currentEffects[layer] = ef;
                 }
                 SetInializingStatus(frame, layer, info.submodel, strand, -1);
+                info.layerGeneration[layer] = RenderLayerCache::GetGeneration();
                 initialize(layer, frame, ef, info.settingsMaps[layer], buffer);
                 info.effectStates[layer] = true;
             }
@@ -650,7 +678,47 @@ public:
             SetRenderingStatus(frame, &info.settingsMaps[layer], layer, info.submodel, strand, -1, true);
             bool b = info.effectStates[layer];
 
-            if (!freeze) {
+            bool cacheable = IsLayerCacheable(buffer, layer, ef, copy);
+            int frameTime = mainBuffer->GetFrameTimeInMS();
+            if (info.reuseChecked[layer] != info.currentEffects[layer]) {
+                // only worth reusing if every frame of the effect we still need is there, they are pinned
+                // so the cache dropping them part way through can't leave the effect rendering from the middle
+                info.reuseChecked[layer] = info.currentEffects[layer];
+                info.reuse[layer] = nullptr;
+                if (cacheable) {
+                    buffer->SetLayer(layer, frame, false);
+                    info.reuse[layer] = RenderLayerCache::Pin(elayer, frame, std::min(endFrame, (ef->GetEndTimeMS() - 1) / frameTime), ef->GetID(), frameTime, buffer->BufferForLayer(layer, -1));
+                }
+            }
+            bool reused = false;
+            if (info.reuse[layer] != nullptr) {
+                bool valid = false;
+                buffer->SetLayer(layer, frame, false);
+                reused = RenderLayerCache::Get(info.reuse[layer], frame, buffer->BufferForLayer(layer, -1), valid);
+                if (reused) {
+                    info.validLayers[layer] = valid;
+                    effectsToUpdate |= valid;
+                    if (valid) {
+                        // blur and rotozoom were applied before it was stored
+                        buffer->HandleLayerTransitions(frame, layer);
+                    }
+                } else {
+                    // past the frames pinned when the effect started, the effect has no state yet so
+                    // run it from its first frame to get back to where it would have been
+                    info.reuse[layer] = nullptr;
+                    info.layerGeneration[layer] = RenderLayerCache::GetGeneration();
+                    b = true;
+                    for (int f = ef->GetStartTimeMS() / frameTime; f < frame; ++f) {
+                        buffer->Clear(layer);
+                        xLights->RenderEffectFromMap(false, ef, layer, f, info.settingsMaps[layer], *buffer, b, true, &renderEvent);
+                    }
+                    buffer->Clear(layer);
+                }
+            }
+
+            if (reused) {
+                // nothing more to do
+            } else if (!freeze) {
                 // Mix canvas pre-loads the buffer with data from underlying layers
                 if (buffer->IsCanvasMix(layer) && layer < numLayers - 1 && !buffer->IsRenderingDisabled(layer)) {
                     maybeWaitForFrame(frame);
@@ -715,7 +783,11 @@ public:
                     buffer->UnMergeBuffersForLayer(layer);
                 }
 
+                int64_t profileStart = profiling ? RenderProfiler::INSTANCE.NowUS() : 0;
                 info.validLayers[layer] = xLights->RenderEffectFromMap(suppress, ef, layer, frame, info.settingsMaps[layer], *buffer, b, true, &renderEvent);
+                if (profiling) {
+                    ProfileEffect(info.profile[layer], info.element != nullptr ? info.element->GetFullName() : name, layer, ef, frame, profileStart);
+                }
                 effectsToUpdate |= info.validLayers[layer];
                 info.effectStates[layer] = b;
 
@@ -723,6 +795,11 @@ public:
                     info.validLayers[layer] = false;
                 } else if (info.validLayers[layer]) {
                     buffer->HandleLayerBlurZoom(frame, layer);
+                }
+                if (cacheable) {
+                    RenderLayerCache::Put(elayer, info.layerGeneration[layer], frame, frameTime, ef->GetID(), buffer->BufferForLayer(layer, -1), info.validLayers[layer]);
+                }
+                if (info.validLayers[layer]) {
                     buffer->HandleLayerTransitions(frame, layer);
                 }
             } else {
@@ -761,7 +838,11 @@ public:
         //make sure we can do this frame
         if (frame >= maxFrameBeforeCheck) {
             SetWaitingStatus(frame);
+            int64_t waitStart = profiling ? RenderProfiler::INSTANCE.NowUS() : 0;
             maxFrameBeforeCheck = waitForFrame(frame);
+            if (profiling) {
+                jobWaitUS += RenderProfiler::INSTANCE.NowUS() - waitStart;
+            }
             SetGenericStatus("%s: Processing frame %d ", frame, true, true);
         }
     }
@@ -809,7 +890,13 @@ public:
         std::map<SNPair, Effect*> nodeEffects;
         std::map<SNPair, SettingsMap> nodeSettingsMaps;
         std::map<SNPair, bool> nodeEffectStates;
-        std::map<SNPair, int> nodeEffectIdxs;
+        std::map<SNPair, RenderProfileSpan> nodeProfiles;
+
+        profiling = RenderProfiler::INSTANCE.IsEnabled();
+        jobStartUS = profiling ? RenderProfiler::INSTANCE.NowUS() : 0;
+        jobWaitUS = 0;
+        jobMainThreadUS = 0;
+        RenderProfiler::TakeMainThreadTime();
 
         try {
             //for (int layer = 0; layer < numLayers; ++layer) {
@@ -817,8 +904,9 @@ public:
                 SetGenericStatus("Finding starting effect for %s, startFrame %d, and layer %d ", (int)startFrame, layer, false, true);
                 EffectLayer *elayer = rowToRender->GetEffectLayer(layer);
                 std::unique_lock<std::recursive_mutex> elock(elayer->GetLock());
-                mainModelInfo.currentEffects[layer] = findEffectForFrame(elayer, startFrame, mainModelInfo.currentEffectIdxs[layer]);
+                mainModelInfo.currentEffects[layer] = findEffectForFrame(elayer, startFrame);
                 SetGenericStatus("Initializing starting effect for %s, startFrame %d, and layer %d ", (int)startFrame, layer, false, true);
+                mainModelInfo.layerGeneration[layer] = RenderLayerCache::GetGeneration();
                 initialize(layer, startFrame, mainModelInfo.currentEffects[layer], mainModelInfo.settingsMaps[layer], mainBuffer);
                 mainModelInfo.effectStates[layer] = true;
             }
@@ -884,7 +972,7 @@ public:
                             continue;
                         }
                         std::unique_lock<std::recursive_mutex> nlayerLock(nlayer->GetLock());
-                        Effect *el = findEffectForFrame(nlayer, frame, nodeEffectIdxs[node]);
+                        Effect *el = findEffectForFrame(nlayer, frame);
                         if (el != nodeEffects[node] || frame == startFrame) {
                             nodeEffects[node] = el;
                             SetInializingStatus(frame, -1, -1, strand, inode);
@@ -897,7 +985,12 @@ public:
                         }
 
                         SetRenderingStatus(frame, &nodeSettingsMaps[node], -1, -1, strand, inode, cleared);
-                        if (xLights->RenderEffectFromMap(false, el, 0, frame, nodeSettingsMaps[node], *buffer, nodeEffectStates[node], true, &renderEvent)) {
+                        int64_t profileStart = profiling ? RenderProfiler::INSTANCE.NowUS() : 0;
+                        bool rendered = xLights->RenderEffectFromMap(false, el, 0, frame, nodeSettingsMaps[node], *buffer, nodeEffectStates[node], true, &renderEvent);
+                        if (profiling) {
+                            ProfileEffect(nodeProfiles[node], name + " Strand " + std::to_string(strand + 1) + " Node " + std::to_string(inode + 1), 0, el, frame, profileStart);
+                        }
+                        if (rendered) {
                             SetCalOutputStatus(frame, -1, strand, inode);
                             buffer->HandleLayerBlurZoom(frame, 0);
                             buffer->HandleLayerTransitions(frame, 0);
@@ -927,11 +1020,28 @@ public:
 			renderLog.error("Caught an unknown exception on rendering thread.");
             logger_base.error("Caught an unknown exception on rendering thread.");
         }
+        if (profiling) {
+            for (auto& it : mainModelInfo.profile) {
+                FlushProfile(it);
+            }
+            for (const auto& a : subModelInfos) {
+                for (auto& it : a->profile) {
+                    FlushProfile(it);
+                }
+            }
+            for (auto& it : nodeProfiles) {
+                FlushProfile(it.second);
+            }
+        }
         if (HasNext()) {
             //make sure the previous has told us we're at the end.  If we return before waiting, the previous
             //may try sending the END_OF_RENDER_FRAME to us and we'll have been deleted
             SetGenericStatus("%s: Waiting on previous renderer for final frame", 0, true);
+            int64_t waitStart = profiling ? RenderProfiler::INSTANCE.NowUS() : 0;
             waitForFrame(END_OF_RENDER_FRAME);
+            if (profiling) {
+                jobWaitUS += RenderProfiler::INSTANCE.NowUS() - waitStart;
+            }
 
             //let the next know we're done
             SetGenericStatus("%s: Notifying next renderer of final frame", 0, true);
@@ -941,6 +1051,17 @@ public:
         } else {
             xLights->CallAfter(&xLightsFrame::RenderDone);
         }
+        if (profiling) {
+            RenderProfiler::Event e;
+            e.model = name;
+            e.startFrame = startFrame;
+            e.endFrame = endFrame;
+            e.startUS = jobStartUS;
+            e.endUS = RenderProfiler::INSTANCE.NowUS();
+            e.waitUS = jobWaitUS;
+            e.mainThreadUS = jobMainThreadUS;
+            RenderProfiler::INSTANCE.Record(e);
+        }
         rowToRender->CleanupAfterRender();
         currentFrame = END_OF_RENDER_FRAME;
         //printf("Done rendering %lx (next %lx)\n", (unsigned long)this, (unsigned long)next);
@@ -955,6 +1076,38 @@ public:
 
 private:
 
+    // consecutive frames of the same effect are merged into a single profile event
+    void ProfileEffect(RenderProfileSpan& span, const std::string& model, int layer, Effect* ef, int frame, int64_t startUS) {
+        if (span.effect != ef || span.event.endFrame != frame - 1) {
+            FlushProfile(span);
+            if (ef == nullptr) {
+                return;
+            }
+            span.effect = ef;
+            span.event.model = model;
+            span.event.effect = ef->GetEffectName();
+            span.event.layer = layer;
+            span.event.startFrame = frame;
+            span.event.startUS = startUS;
+            span.event.renderUS = 0;
+            span.event.mainThreadUS = 0;
+        }
+        int64_t now = RenderProfiler::INSTANCE.NowUS();
+        int64_t mainThread = RenderProfiler::TakeMainThreadTime();
+        span.event.endFrame = frame;
+        span.event.endUS = now;
+        span.event.renderUS += now - startUS;
+        span.event.mainThreadUS += mainThread;
+        jobMainThreadUS += mainThread;
+    }
+
+    void FlushProfile(RenderProfileSpan& span) {
+        if (span.effect != nullptr) {
+            RenderProfiler::INSTANCE.Record(span.event);
+            span.effect = nullptr;
+        }
+    }
+
     void initialize(int layer, int frame, Effect *el, SettingsMap &settingsMap, PixelBufferClass *buffer) {
         bool layerEnabled = true;
         if (el == nullptr || el->GetEffectIndex() == -1) {
@@ -989,21 +1142,19 @@ private:
             EffectLayer* el = e->GetEffectLayer(layer - 1);
 
             if (el != nullptr) {
-                int discard = 0;
-                res = findEffectForFrame(el, frame, discard);
+                res = findEffectForFrame(el, frame);
             }
         }
 
         return res;
     }
 
-    Effect *findEffectForFrame(EffectLayer* layer, int frame, int &lastIdx) {
+    Effect *findEffectForFrame(EffectLayer* layer, int frame) {
         if (layer == nullptr) {
             return nullptr;
         }
         int time = frame * seqData->FrameTime();
-        for (int e = lastIdx; e < layer->GetEffectCount(); ++e) {
-            Effect *effect = layer->GetEffect(e);
+        for (Effect* effect : layer->GetEffectsInTimeRange(time, time)) {
             int st = effect->GetStartTimeMS();
             int et = effect->GetEndTimeMS();
             if (et > time && st <= time) {
@@ -1013,14 +1164,14 @@ private:
         return nullptr;
     }
 
-    Effect *findEffectForFrame(int layer, int frame, int &lastIdx) {
-        return findEffectForFrame(rowToRender->GetEffectLayer(layer), frame, lastIdx);
+    Effect *findEffectForFrame(int layer, int frame) {
+        return findEffectForFrame(rowToRender->GetEffectLayer(layer), frame);
     }
-    Effect *findEffectForFrame(int layer, int frame, int submodel, int &lastIdx) {
+    Effect *findEffectForFrame(int layer, int frame, int submodel) {
         if (submodel == -1) {
-            return findEffectForFrame(rowToRender->GetEffectLayer(layer), frame, lastIdx);
+            return findEffectForFrame(rowToRender->GetEffectLayer(layer), frame);
         }
-        return findEffectForFrame(subModelInfos[submodel]->element->GetEffectLayer(layer), frame, lastIdx);
+        return findEffectForFrame(subModelInfos[submodel]->element->GetEffectLayer(layer), frame);
     }
 
     void loadSettingsMap(const std::string &effectName,
@@ -1040,6 +1191,7 @@ private:
     SequenceData *seqData;
     std::vector<bool> rangeRestriction;
     bool supportsModelBlending;
+    bool reuseLayers = false;
     RenderEvent renderEvent;
 
     //stuff for handling the status;
@@ -1061,6 +1213,11 @@ private:
     std::vector<EffectLayerInfo *> subModelInfos;
 
     std::map<SNPair, PixelBufferClassPtr> nodeBuffers;
+
+    bool profiling = false;
+    int64_t jobStartUS = 0;
+    int64_t jobWaitUS = 0;
+    int64_t jobMainThreadUS = 0;
 };
 
 
@@ -1139,6 +1296,9 @@ void xLightsFrame::LogRenderStatus()
     static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
     logger_base.debug("Logging render status ***************");
     logger_base.debug("Render tree size. %d entries.", renderTree.data.size());
+    logger_base.debug(RenderBufferPool::GetStatsString());
+    logger_base.debug(ImageCache::GetStatsString());
+    logger_base.debug(RenderLayerCache::GetStatsString());
     logger_base.debug("Render Thread status:\n%s", (const char *)GetThreadStatusReport().c_str());
     for (const auto& it : renderProgressInfo) {
         int frames = it->endFrame - it->startFrame + 1;
@@ -1444,6 +1604,8 @@ void xLightsFrame::BuildRenderTree() {
         }
         renderTree.Print();
         renderTree.renderTreeChangeCount = curChangeCount;
+        // models or their buffers may have changed
+        RenderLayerCache::Clear();
     }
 }
 
@@ -1468,6 +1630,8 @@ void xLightsFrame::Render(SequenceElements& seqElements,
     }
     std::list<NodeRange> ranges;
     if (restrictToModels.empty()) {
+        // a full render may be picking up media or other changes the layers know nothing about
+        RenderLayerCache::Clear();
         ranges.push_back(NodeRange(0, seqData.NumChannels()));
     } else {
         for (const auto& it : restrictToModels) {
@@ -1512,6 +1676,9 @@ void xLightsFrame::Render(SequenceElements& seqElements,
                     if (seqElements.SupportsModelBlending()) {
                         job->SetModelBlending();
                     }
+                    if (!restrictToModels.empty()) {
+                        job->SetReuseLayers();
+                    }
                     PixelBufferClass *buffer = job->getBuffer();
                     if (buffer == nullptr) {
                         delete job;
@@ -1619,42 +1786,6 @@ void xLightsFrame::Render(SequenceElements& seqElements,
     }
 }
 
-static void addModelsUpTo(std::list<Model*> &models, const std::list<Model *> &toAdd, Model *upTo) {
-    for (auto it = toAdd.begin(); it != toAdd.end(); ++it) {
-        bool add = true;
-        for (auto it2 = models.begin(); it2 != models.end() && add; ++it2) {
-            if (*it2 == *it) {
-                add = false;
-            }
-        }
-        if (add) {
-            models.push_back(*it);
-        }
-        if (upTo == *it) {
-            return;
-        }
-    }
-}
-
-static void addModelsFrom(std::list<Model*> &models, const std::list<Model *> &toAdd, Model *from) {
-    bool found = false;
-    for (auto it = toAdd.begin(); it != toAdd.end(); ++it) {
-        if (!found && from != *it) {
-            continue;
-        }
-        found = true;
-        bool add = true;
-        for (auto it2 = models.begin(); it2 != models.end() && add; ++it2) {
-            if (*it2 == *it) {
-                add = false;
-            }
-        }
-        if (add) {
-            models.push_back(*it);
-        }
-    }
-}
-
 void xLightsFrame::RenderDirtyModels() {
 
     if (_suspendRender) return; // dont render if suspended
@@ -1668,55 +1799,75 @@ void xLightsFrame::RenderDirtyModels() {
     if (numRows == 0) {
         return;
     }
-    int startms = 9999999;
-    int endms = -1;
-    std::list<Model *> models;
-    std::list<Model *> restricts;
+
+    // A dirty model only needs the models sharing its channels rendering, and only over
+    // its own dirty range. Dirty models with any of those in common are rendered together
+    // so the shared models are only rendered once.
+    struct DirtyGroup {
+        int startms;
+        int endms;
+        std::list<Model*> restricts;
+        std::set<Model*> models;
+    };
+    std::list<DirtyGroup> groups;
     for (int x = 0; x < numRows; x++) {
         Element *el = _sequenceElements.GetElement(x);
         if (el->GetType() != ElementType::ELEMENT_TYPE_TIMING) {
             int st, ed;
             el->GetDirtyRange(st, ed);
             if (st != -1) {
-                startms = std::min(startms, st);
-                endms = std::max(endms, ed);
-                for (auto it = renderTree.data.begin(); it != renderTree.data.end(); ++it) {
-                    if ((*it)->model->GetName() == el->GetModelName()) {
-                        restricts.push_back((*it)->model);
-                        addModelsUpTo(models, (*it)->renderOrder, (*it)->model);
+                for (const auto& it : renderTree.data) {
+                    if (it->model->GetName() == el->GetModelName()) {
+                        DirtyGroup group;
+                        group.startms = st;
+                        group.endms = ed;
+                        group.restricts.push_back(it->model);
+                        group.models.insert(it->renderOrder.begin(), it->renderOrder.end());
+                        for (auto git = groups.begin(); git != groups.end();) {
+                            bool shared = false;
+                            for (auto m = git->models.begin(); m != git->models.end() && !shared; ++m) {
+                                shared = group.models.find(*m) != group.models.end();
+                            }
+                            if (shared) {
+                                group.startms = std::min(group.startms, git->startms);
+                                group.endms = std::max(group.endms, git->endms);
+                                group.restricts.splice(group.restricts.end(), git->restricts);
+                                group.models.insert(git->models.begin(), git->models.end());
+                                git = groups.erase(git);
+                            } else {
+                                ++git;
+                            }
+                        }
+                        groups.push_back(std::move(group));
                     }
                 }
             }
         }
     }
-    if (restricts.empty()) {
-        return;
-    }
-    for (auto x = models.begin(); x != models.end(); ++x) {
-        for (auto it = renderTree.data.begin(); it != renderTree.data.end(); ++it) {
-            if ((*it)->model == *x) {
-                addModelsFrom(models, (*it)->renderOrder, (*it)->model);
+
+    for (const auto& group : groups) {
+        int startms = std::max(group.startms, 0);
+        int endms = std::max(group.endms, 0);
+        int startframe = startms /_seqData.FrameTime() - 1;
+        if (startframe < 0) {
+            startframe = 0;
+        }
+        int endframe = endms / _seqData.FrameTime() + 1;
+        if (endframe >= (int)_seqData.NumFrames()) {
+            endframe = _seqData.NumFrames() - 1;
+        }
+        if (endframe < startframe) {
+            continue;
+        }
+        // keep the render tree order so models blend onto each other the same way
+        std::list<Model *> models;
+        for (const auto& it : renderTree.data) {
+            if (group.models.find(it->model) != group.models.end()) {
+                models.push_back(it->model);
             }
         }
+        Render(_sequenceElements, _seqData, models, group.restricts, startframe, endframe, false, true, [] (bool) {});
     }
-    if (startms < 0) {
-        startms = 0;
-    }
-    if (endms < 0) {
-        endms = 0;
-    }
-    int startframe = startms /_seqData.FrameTime() - 1;
-    if (startframe < 0) {
-        startframe = 0;
-    }
-    int endframe = endms / _seqData.FrameTime() + 1;
-    if (endframe >= (int)_seqData.NumFrames()) {
-        endframe = _seqData.NumFrames() - 1;
-    }
-    if (endframe < startframe) {
-        return;
-    }
-    Render(_sequenceElements, _seqData, models, restricts, startframe, endframe, false, true, [] (bool) {});
 }
 
 bool xLightsFrame::AbortRender(int maxTimeMS, int* numThreadsAborted)
@@ -1949,6 +2100,9 @@ void xLightsFrame::RenderTimeSlice(int startms, int endms, bool clear) {
     Render(_sequenceElements, _seqData, models, restricts, startframe, endframe, true, clear, [this, sw] (bool aborted) {
         static log4cpp::Category &logger_base2 = log4cpp::Category::getInstance(std::string("log_base"));
         logger_base2.info("   Effects done.");
+        logger_base2.debug(RenderBufferPool::GetStatsString());
+        logger_base2.debug(ImageCache::GetStatsString());
+        logger_base2.debug(RenderLayerCache::GetStatsString());
         ProgressBar->SetValue(100);
         float elapsedTime = sw.Time()/1000.0; // now stop stopwatch timer and get elapsed time. change into seconds from ms
         wxString displayBuff = wxString::Format(_("Rendered in %7.3f seconds"),elapsedTime);
@@ -2210,6 +2364,7 @@ bool xLightsFrame::RenderEffectFromMap(bool suppress, Effect* effectObj, int lay
                     qlock.unlock();
 
                     CallAfter(&xLightsFrame::RenderMainThreadEffects);
+                    auto waitStart = std::chrono::steady_clock::now();
                     if (event->signal.wait_for(lock, std::chrono::seconds(10)) == std::cv_status::no_timeout) {
                         retval = event->returnVal == 1;
                     }
@@ -2226,6 +2381,9 @@ bool xLightsFrame::RenderEffectFromMap(bool suppress, Effect* effectObj, int lay
                             printf("DOUBLE HELP!!!!   Frame #%d render on model %s (%dx%d) layer %d effect %s from %dms (#%d) to %dms (#%d) timed out 70 secs.\n", b->curPeriod, (const char*)buffer.GetModelName().c_str(), b->BufferWi, b->BufferHt, layer, (const char*)reff->Name().c_str(), effectObj->GetStartTimeMS(), b->curEffStartPer, effectObj->GetEndTimeMS(), b->curEffEndPer);
                         }
                     }
+                    if (RenderProfiler::INSTANCE.IsEnabled()) {
+                        RenderProfiler::AddMainThreadTime(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - waitStart).count());
+                    }
                     if (period % 10 == 0) {
                         //constantly putting stuff on CallAfter can result in the main
                         //dispatch thread never being able to empty the CallAfter
@@ -2254,7 +2412,7 @@ bool xLightsFrame::RenderEffectFromMap(bool suppress, Effect* effectObj, int lay
                                 oldBuffer = rb;
                                 rb = newBuffer;
                                 rb->needToInit = oldBuffer->needToInit;
-                                rb->infoCache = oldBuffer->infoCache;
+                                rb->infoCache.swap(oldBuffer->infoCache);
                             }
 
                             wxStopWatch sw;
@@ -2276,8 +2434,7 @@ bool xLightsFrame::RenderEffectFromMap(bool suppress, Effect* effectObj, int lay
 
                             if (suppress && oldBuffer != nullptr) {
                                 oldBuffer->needToInit = rb->needToInit;
-                                oldBuffer->infoCache = rb->infoCache;
-                                rb->infoCache.clear();
+                                oldBuffer->infoCache.swap(rb->infoCache);
                                 delete newBuffer;
                                 rb = oldBuffer;
                                 newBuffer = nullptr;
@@ -0,0 +1,255 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <wx/file.h>
+#include <wx/xml/xml.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <set>
+
+#include "RenderBenchmark.h"
+#include "xLightsMain.h"
+#include "xLightsVersion.h"
+#include "PixelBuffer.h"
+#include "UtilFunctions.h"
+#include "effects/EffectManager.h"
+#include "effects/RenderableEffect.h"
+#include "models/Model.h"
+#include "sequencer/Effect.h"
+#include "sequencer/EffectLayer.h"
+#include "sequencer/Element.h"
+#include "sequencer/SequenceElements.h"
+
+#include <log4cpp/Category.hh>
+
+#define BENCHMARK_FRAME_MS 50
+
+namespace
+{
+    struct BenchmarkSize {
+        int width;
+        int height;
+    };
+    static const std::vector<BenchmarkSize> SIZES = { { 50, 50 }, { 300, 100 }, { 1000, 1000 } };
+
+    struct BenchmarkPreset {
+        std::string effect;
+        std::string name;
+        std::string settings;
+    };
+    // Effects listed here run these presets instead of their defaults
+    static const std::vector<BenchmarkPreset> PRESETS = {
+        { "Bars", "Default", "" },
+        { "Bars", "Gradient Highlight", "E_CHECKBOX_Bars_Gradient=1,E_CHECKBOX_Bars_Highlight=1" },
+        { "Butterfly", "Default", "" },
+        { "Butterfly", "Style 5", "E_SLIDER_Butterfly_Style=5" },
+        { "Fireworks", "Default", "" },
+        { "Fireworks", "50 Explosions", "E_SLIDER_Fireworks_Explosions=50" },
+        { "Meteors", "Default", "" },
+        { "Meteors", "Explode", "E_CHOICE_Meteors_Effect=Explode" },
+        { "Plasma", "Default", "" },
+        { "Plasma", "Style 4", "E_SLIDER_Plasma_Style=4,E_SLIDER_Plasma_Line_Density=4" },
+        { "Ripple", "Default", "" },
+        { "Ripple", "Star", "E_CHOICE_Ripple_Object_To_Draw=Star" },
+        { "Text", "Default", "E_TEXTCTRL_Text=xLights Benchmark" },
+        { "Wave", "Default", "" },
+        { "Wave", "Fractal", "E_CHOICE_Wave_Type=Fractal/ivy" }
+    };
+
+    // these need media, files, other models or a GPU context so a bare matrix tells us nothing
+    static const std::set<std::string> SKIPPED = { "DMX", "Duplicate", "Faces", "Glediator", "Guitar", "Moving Head",
+                                                   "Music", "Piano", "Pictures", "Servo", "Shader", "State", "Video", "VU Meter" };
+
+    static const std::string PALETTE = "C_BUTTON_Palette1=#FF0000,C_CHECKBOX_Palette1=1,"
+                                       "C_BUTTON_Palette2=#00FF00,C_CHECKBOX_Palette2=1,"
+                                       "C_BUTTON_Palette3=#0000FF,C_CHECKBOX_Palette3=1";
+
+    static const std::vector<std::string> MIXES = { "Normal", "Effect 1", "1 is Mask", "1 reveals 2", "Shadow 1 on 2",
+                                                    "Layered", "Average", "Additive", "Max", "Highlight" };
+}
+
+RenderBenchmark::RenderBenchmark(xLightsFrame* frame, int frames) :
+    _frame(frame), _frames(frames)
+{
+}
+
+bool RenderBenchmark::Run(const std::string& file)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    _results.clear();
+    int endMS = _frames * BENCHMARK_FRAME_MS;
+
+    SequenceElements elements(_frame);
+    elements.SetFrequency(1000.0 / BENCHMARK_FRAME_MS);
+    elements.SetViewsManager(_frame->GetViewsManager());
+
+    for (const auto& size : SIZES) {
+        std::string name = "Benchmark " + std::to_string(size.width) + "x" + std::to_string(size.height);
+        logger_base.info("Render benchmark: %s.", (const char*)name.c_str());
+
+        std::unique_ptr<wxXmlNode> node = std::make_unique<wxXmlNode>(wxXML_ELEMENT_NODE, "model");
+        node->AddAttribute("name", name);
+        node->AddAttribute("DisplayAs", "Horiz Matrix");
+        node->AddAttribute("StringType", "RGB Nodes");
+        node->AddAttribute("StartSide", "T");
+        node->AddAttribute("Dir", "L");
+        node->AddAttribute("parm1", std::to_string(size.height));
+        node->AddAttribute("parm2", std::to_string(size.width));
+        node->AddAttribute("parm3", "1");
+        node->AddAttribute("StartChannel", "1");
+        node->AddAttribute("LayoutGroup", "Unassigned");
+        std::unique_ptr<Model> model(_frame->AllModels.CreateModel(node.get()));
+        if (model == nullptr) {
+            logger_base.error("Render benchmark: unable to create the %s model.", (const char*)name.c_str());
+            continue;
+        }
+
+        Element* element = elements.AddElement(name, "model", true, false, false, false, false);
+        while (element->GetEffectLayerCount() < 2) {
+            element->AddEffectLayer();
+        }
+        EffectLayer* top = element->GetEffectLayer(0);
+        EffectLayer* bottom = element->GetEffectLayer(1);
+
+        PixelBufferClass buffer(_frame);
+        buffer.InitBuffer(*model, 2, BENCHMARK_FRAME_MS);
+        std::vector<unsigned char> channels(model->GetActChanCount() + 3);
+        std::vector<bool> noRestriction;
+        std::vector<SettingsMap> settings(2);
+        std::vector<bool> resetState(2, true);
+        int pixels = buffer.BufferForLayer(0, -1).GetPixelCount();
+
+        auto setup = [&buffer, &settings, &resetState](int layer, Effect* effect) {
+            settings[layer].clear();
+            effect->CopySettingsMap(settings[layer], true);
+            buffer.SetLayerSettings(layer, settings[layer], true);
+            xlColorVector colors;
+            xlColorCurveVector cc;
+            effect->CopyPalette(colors, cc);
+            buffer.SetPalette(layer, colors, cc);
+            buffer.SetTimes(layer, effect->GetStartTimeMS(), effect->GetEndTimeMS());
+            resetState[layer] = true;
+        };
+        auto render = [this, &buffer, &settings, &resetState](int layer, Effect* effect, int frame) {
+            return _frame->RenderEffectFromMap(false, effect, layer, frame, settings[layer], buffer, resetState[layer], false, nullptr);
+        };
+        auto record = [this, &size, pixels](const std::string& group, const std::string& name, const std::string& preset, int64_t ns) {
+            Result r;
+            r.group = group;
+            r.name = name;
+            r.preset = preset;
+            r.width = size.width;
+            r.height = size.height;
+            r.frames = _frames;
+            r.totalMS = ns / 1000000.0;
+            r.nsPerPixelFrame = pixels > 0 ? (double)ns / ((double)pixels * _frames) : 0.0;
+            _results.push_back(r);
+        };
+
+        // effects on their own
+        for (auto reff : _frame->GetEffectManager()) {
+            const std::string& effectName = reff->Name();
+            if (SKIPPED.find(effectName) != SKIPPED.end()) {
+                continue;
+            }
+            std::vector<BenchmarkPreset> presets;
+            for (const auto& p : PRESETS) {
+                if (p.effect == effectName) {
+                    presets.push_back(p);
+                }
+            }
+            if (presets.empty()) {
+                presets.push_back({ effectName, "Default", "" });
+            }
+            for (const auto& p : presets) {
+                Effect* effect = top->AddEffect(0, effectName, p.settings, PALETTE, 0, endMS, 0, false, false, true);
+                setup(0, effect);
+                int64_t ns = 0;
+                for (int frame = 0; frame < _frames; ++frame) {
+                    buffer.Clear(0);
+                    auto start = std::chrono::steady_clock::now();
+                    render(0, effect, frame);
+                    ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                }
+                record("effect", effectName, p.name, ns);
+                top->DeleteEffect(effect->GetID());
+            }
+        }
+
+        // layer processing, the two layers are rendered outside the timed section
+        Effect* base = bottom->AddEffect(0, "Butterfly", "", PALETTE, 0, endMS, 0, false, false, true);
+        setup(1, base);
+        auto timeLayers = [&](const std::string& group, const std::string& name, const std::string& layerSettings, bool blurZoom) {
+            Effect* effect = top->AddEffect(0, "Bars", layerSettings, PALETTE, 0, endMS, 0, false, false, true);
+            setup(0, effect);
+            resetState[1] = true;
+            std::vector<bool> valid(3, true);
+            valid[2] = false;
+            int64_t ns = 0;
+            for (int frame = 0; frame < _frames; ++frame) {
+                buffer.Clear(0);
+                buffer.Clear(1);
+                render(1, base, frame);
+                render(0, effect, frame);
+                auto start = std::chrono::steady_clock::now();
+                if (blurZoom) {
+                    buffer.HandleLayerBlurZoom(frame, 0);
+                } else {
+                    buffer.CalcOutput(frame, valid);
+                    buffer.GetColors(&channels[0], noRestriction);
+                }
+                ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            }
+            record(group, name, "", ns);
+            top->DeleteEffect(effect->GetID());
+        };
+        for (const auto& mix : MIXES) {
+            timeLayers("blend", mix, "T_CHOICE_LayerMethod=" + mix, false);
+        }
+        timeLayers("blur", "Blur 10", "B_SLIDER_Blur=10", true);
+        timeLayers("rotozoom", "Rotate", "B_SLIDER_Rotations=10", true);
+        timeLayers("rotozoom", "Rotate and Zoom", "B_SLIDER_Rotations=10,B_SLIDER_Zoom=20", true);
+        bottom->DeleteEffect(base->GetID());
+    }
+
+    for (const auto& r : _results) {
+        logger_base.info("Render benchmark: %-8s %-20s %-20s %4dx%-4d %10.1fms %8.2f ns/pixel/frame", (const char*)r.group.c_str(), (const char*)r.name.c_str(),
+                         (const char*)r.preset.c_str(), r.width, r.height, r.totalMS, r.nsPerPixelFrame);
+    }
+    return WriteResults(file);
+}
+
+bool RenderBenchmark::WriteResults(const std::string& file) const
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    wxFile f;
+    if (!f.Create(file, true) || !f.IsOpened()) {
+        logger_base.error("Render benchmark: unable to create results file %s.", (const char*)file.c_str());
+        return false;
+    }
+
+    f.Write("{\"version\":\"" + xlights_version_string + "\",\"frames\":" + std::to_string(_frames) +
+            ",\"frameMS\":" + std::to_string(BENCHMARK_FRAME_MS) + ",\"results\":[\n");
+    for (size_t i = 0; i < _results.size(); ++i) {
+        const auto& r = _results[i];
+        f.Write(wxString::Format("{\"group\":\"%s\",\"name\":\"%s\",\"preset\":\"%s\",\"width\":%d,\"height\":%d,\"frames\":%d,\"totalMS\":%.3f,\"nsPerPixelFrame\":%.3f}%s\n",
+                                 JSONSafe(r.group), JSONSafe(r.name), JSONSafe(r.preset), r.width, r.height, r.frames, r.totalMS, r.nsPerPixelFrame,
+                                 i + 1 < _results.size() ? "," : ""));
+    }
+    f.Write("]}\n");
+    f.Close();
+
+    logger_base.info("Render benchmark: %d results written to %s.", (int)_results.size(), (const char*)file.c_str());
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <string>
+#include <vector>
+
+class xLightsFrame;
+
+// Renders every built in effect, and the layer blend, blur and rotozoom paths,
+// into matrix models of a few fixed sizes so effect performance can be tracked
+// between builds. Run from the command line with -bm <file>.
+class RenderBenchmark
+{
+public:
+    struct Result {
+        std::string group;  // effect, blend, blur or rotozoom
+        std::string name;
+        std::string preset;
+        int width = 0;
+        int height = 0;
+        int frames = 0;
+        double totalMS = 0;
+        double nsPerPixelFrame = 0;
+    };
+
+    RenderBenchmark(xLightsFrame* frame, int frames = 40);
+
+    // runs everything and writes the results as JSON, returns false if the file could not be written
+    bool Run(const std::string& file);
+
+    const std::vector<Result>& GetResults() const { return _results; }
+
+private:
+    bool WriteResults(const std::string& file) const;
+
+    xLightsFrame* _frame = nullptr;
+    int _frames = 40;
+    std::vector<Result> _results;
+};
@@ -24,6 +24,7 @@
 #include "models/DMX/DmxModel.h"
 #include "models/DMX/DmxColorAbility.h"
 #include "GPURenderUtils.h"
+#include "RenderBufferPool.h"
 #include "BufferPanel.h"
 
 #include <log4cpp/Category.hh>
@@ -137,6 +138,16 @@ void TextDrawingContext::ReleaseContext(TextDrawingContext* pdc) {
 
 EffectRenderCache::EffectRenderCache() {}
 EffectRenderCache::~EffectRenderCache() {}
+
+void EffectRenderCaches::DeleteAll()
+{
+    for (auto& it : caches) {
+        delete it;
+        it = nullptr;
+    }
+    caches.clear();
+}
+
 void RenderBuffer::SetAllowAlphaChannel(bool a) { allowAlpha = a; }
 void RenderBuffer::SetFrameTimeInMs(int i) { frameTimeInMs = i; }
 
@@ -729,14 +740,13 @@ RenderBuffer::~RenderBuffer()
     if (_pathDrawingContext != nullptr) {
         PathDrawingContext::ReleaseContext(_pathDrawingContext);
     }
-    for (auto& it : infoCache) {
-        delete it.second;
-        it.second = nullptr;
-    }
+    infoCache.DeleteAll();
     if (gpuRenderData) {
         GPURenderUtils::cleanUp(this);
         gpuRenderData = nullptr;
     }
+    RenderBufferPool::Release(pixelVector);
+    RenderBufferPool::Release(tempbufVector);
 }
 
 PathDrawingContext * RenderBuffer::GetPathDrawingContext()
@@ -785,8 +795,8 @@ void RenderBuffer::InitBuffer(int newBufferHt, int newBufferWi, const std::strin
     if (NumPixels != pixelVector.size()) {
         bool resetPtr = pixelVector.size() == 0 || pixels == &pixelVector[0];
         bool resetTPtr = tempbufVector.size() == 0 || tempbuf == &tempbufVector[0];
-        pixelVector.resize(NumPixels);
-        tempbufVector.resize(NumPixels);
+        RenderBufferPool::Resize(pixelVector, NumPixels);
+        RenderBufferPool::Resize(tempbufVector, NumPixels);
         if (resetPtr) {
             // If the pixels or tempbuf ptr did not point to the first element
             // originally, then it is pointing into GPU memory and we need
@@ -1663,8 +1673,12 @@ double RenderBuffer::calcAccel(double ratio, double accel)
 }
 
 // create a copy of the buffer suitable only for copying out pixel data and fake rendering
-RenderBuffer::RenderBuffer(RenderBuffer& buffer) : pixelVector(buffer.pixels, &buffer.pixels[buffer.pixelVector.size()])
+RenderBuffer::RenderBuffer(RenderBuffer& buffer)
 {
+    RenderBufferPool::Acquire(pixelVector, buffer.pixelVector.size());
+    if (!pixelVector.empty()) {
+        memcpy(&pixelVector[0], buffer.pixels, pixelVector.size() * sizeof(xlColor));
+    }
     _isCopy = true;
     parent = buffer.parent;
     model = buffer.model;
@@ -442,6 +442,26 @@ public:
 	virtual ~EffectRenderCache();
 };
 
+// The caches effects keep on a buffer, indexed directly by effect id. Looking one
+// up is an array index rather than a map search and only the first use of an id
+// on a buffer allocates.
+class EffectRenderCaches {
+public:
+    EffectRenderCache*& operator[](int id) {
+        if (id >= (int)caches.size()) {
+            caches.resize(id + 1, nullptr);
+        }
+        return caches[id];
+    }
+    // forgets the caches without deleting them
+    void clear() { caches.clear(); }
+    void DeleteAll();
+    void swap(EffectRenderCaches& other) { caches.swap(other.caches); }
+
+private:
+    std::vector<EffectRenderCache*> caches;
+};
+
 class /*NCCDLLEXPORT*/ RenderBuffer {
 public:
     RenderBuffer(xLightsFrame *frame, PixelBufferClass *pbc, const Model *m);
@@ -554,7 +574,7 @@ private:
 
     friend class MetalRenderBufferComputeData;
 public:
-    uint32_t GetPixelCount() { return pixelVector.size(); }
+    uint32_t GetPixelCount() const { return pixelVector.size(); }
     xlColor *GetPixels() { return pixels; }
     xlColor *GetTempBuf() { return tempbuf; }
     void CopyTempBufToPixels();
@@ -583,7 +603,7 @@ public:
     bool _isCopy = false;
 
     /* Places to store and data that is needed from one frame to another */
-    std::map<int, EffectRenderCache*> infoCache;
+    EffectRenderCaches infoCache;
 
     //place for GPU Renderers to attach extra data/objects it needs
     void *gpuRenderData = nullptr;
@@ -0,0 +1,159 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include <wx/string.h>
+
+#include "RenderBufferPool.h"
+
+#define POOL_CLASSES 24
+
+namespace
+{
+    std::atomic<uint64_t> __acquired = 0;
+    std::atomic<uint64_t> __reused = 0;
+    std::atomic<uint64_t> __released = 0;
+    std::atomic<uint64_t> __discarded = 0;
+    std::atomic<int64_t> __pooledBytes = 0;
+
+    class ThreadPool
+    {
+    public:
+        ~ThreadPool()
+        {
+            __pooledBytes -= bytes;
+        }
+
+        std::array<std::vector<xlColorVector>, POOL_CLASSES> classes;
+        size_t bytes = 0;
+    };
+    thread_local ThreadPool __pool;
+
+    // the smallest class whose capacity holds pixels
+    int SizeClass(size_t pixels)
+    {
+        int c = 0;
+        size_t cap = RenderBufferPool::MIN_PIXELS;
+        while (cap < pixels && c < POOL_CLASSES - 1) {
+            cap <<= 1;
+            ++c;
+        }
+        return c;
+    }
+
+    size_t ClassPixels(int c)
+    {
+        return RenderBufferPool::MIN_PIXELS << c;
+    }
+}
+
+void RenderBufferPool::Acquire(xlColorVector& v, size_t pixels)
+{
+    Release(v);
+    ++__acquired;
+    if (pixels == 0) {
+        return;
+    }
+
+    int c = SizeClass(pixels);
+    if (ClassPixels(c) >= pixels) {
+        auto& cls = __pool.classes[c];
+        if (!cls.empty()) {
+            v = std::move(cls.back());
+            cls.pop_back();
+            size_t bytes = v.capacity() * sizeof(xlColor);
+            __pool.bytes -= bytes;
+            __pooledBytes -= bytes;
+            ++__reused;
+            v.resize(pixels);
+            return;
+        }
+        // round up so this storage can serve anything else in its class when it comes back
+        v.reserve(ClassPixels(c));
+    }
+    v.resize(pixels);
+}
+
+void RenderBufferPool::Release(xlColorVector& v)
+{
+    if (v.capacity() == 0) {
+        return;
+    }
+    ++__released;
+
+    // file it under the largest class it can fully serve
+    size_t cap = v.capacity();
+    int c = SizeClass(cap);
+    if (ClassPixels(c) > cap) {
+        --c;
+    }
+    size_t bytes = cap * sizeof(xlColor);
+    auto& cls = c >= 0 ? __pool.classes[c] : __pool.classes[0];
+    if (c < 0 || cls.size() >= MAX_PER_CLASS || __pool.bytes + bytes > MAX_THREAD_BYTES) {
+        ++__discarded;
+        xlColorVector().swap(v);
+        return;
+    }
+
+    v.clear();
+    cls.push_back(std::move(v));
+    v = xlColorVector();
+    __pool.bytes += bytes;
+    __pooledBytes += bytes;
+}
+
+void RenderBufferPool::Resize(xlColorVector& v, size_t pixels)
+{
+    if (pixels <= v.capacity()) {
+        v.resize(pixels);
+        return;
+    }
+
+    xlColorVector n;
+    Acquire(n, pixels);
+    if (!v.empty()) {
+        memcpy(&n[0], &v[0], std::min(v.size(), pixels) * sizeof(xlColor));
+    }
+    Release(v);
+    v.swap(n);
+}
+
+RenderBufferPool::Stats RenderBufferPool::GetStats()
+{
+    Stats s;
+    s.acquired = __acquired;
+    s.reused = __reused;
+    s.released = __released;
+    s.discarded = __discarded;
+    s.pooledBytes = __pooledBytes;
+    return s;
+}
+
+std::string RenderBufferPool::GetStatsString()
+{
+    Stats s = GetStats();
+    return wxString::Format("Render buffer pool: %llu acquired, %llu reused (%.1f%%), %llu released, %llu freed, %.1fMB pooled.",
+                            (unsigned long long)s.acquired, (unsigned long long)s.reused, s.acquired > 0 ? 100.0 * s.reused / s.acquired : 0.0,
+                            (unsigned long long)s.released, (unsigned long long)s.discarded, s.pooledBytes / (1024.0 * 1024.0))
+        .ToStdString();
+}
+
+void RenderBufferPool::ResetStats()
+{
+    __acquired = 0;
+    __reused = 0;
+    __released = 0;
+    __discarded = 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <cstdint>
+#include <string>
+
+#include "Color.h"
+
+// Recycles render buffer pixel storage. Released vectors keep their capacity and
+// are held by the releasing thread in power of two size classes so the next buffer
+// of a similar size on that thread (usually a render job on the same worker) gets
+// its memory back without touching the allocator. Each thread holds at most
+// MAX_THREAD_BYTES, anything over that is freed.
+class RenderBufferPool
+{
+public:
+    struct Stats {
+        uint64_t acquired = 0;   // buffers handed out
+        uint64_t reused = 0;     // ... of which came from the pool
+        uint64_t released = 0;   // buffers handed back
+        uint64_t discarded = 0;  // ... of which were freed as the pool was full
+        int64_t pooledBytes = 0; // currently held across all threads
+    };
+
+    // v ends up holding pixels zeroed colors, its previous storage is released
+    static void Acquire(xlColorVector& v, size_t pixels);
+    // hands v's storage to the pool, v is left empty
+    static void Release(xlColorVector& v);
+    // resizes v keeping its contents, swapping in pooled storage if it has to grow
+    static void Resize(xlColorVector& v, size_t pixels);
+
+    static Stats GetStats();
+    static std::string GetStatsString();
+    static void ResetStats();
+
+    static const size_t MAX_THREAD_BYTES = 64 * 1024 * 1024;
+    static const size_t MAX_PER_CLASS = 16;
+    static const size_t MIN_PIXELS = 64;
+};
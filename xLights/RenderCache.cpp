@@ -9,6 +9,7 @@
  **************************************************************/
 
 #include "RenderCache.h"
+#include "RenderCachePack.h"
 #include "sequencer/SequenceElements.h"
 #include "RenderBuffer.h"
 #include "models/Model.h"
@@ -24,7 +25,6 @@
 #include "ExternalHooks.h"
 
 #ifdef __WXOSX__
-#include <sys/mman.h>
 #define USE_MMAP_RENDERCACHE
 #endif
 
@@ -49,33 +49,33 @@ private:
 
         logger_base.debug("Loading cache.");
 
-        wxString cacheFolder = _cache->GetCacheFolder();
-
-        wxDir dir(cacheFolder);
-        wxArrayString files;
-        GetAllFilesInDir(cacheFolder, files, "*.cache");
+        std::shared_ptr<RenderCachePack> pack = _cache->GetPack();
+        if (pack == nullptr) {
+            return nullptr;
+        }
 
-        for (const auto& it : files) {
+        int items = 0;
+        pack->Load([this, &pack, &items](const std::string& key, const uint8_t* data, size_t size, const std::shared_ptr<const void>& keepAlive) {
             // allow up to 3 times physical memory
             // This means the render cache will be swapped out ... but I think that is still better than re-rendering
             // Abandon loading render cache if we use too much memory
             if (IsExcessiveMemoryUsage(3.0)) {
                 logger_base.warn("Render cache loading abandoned due to too much memory use.");
-                break;
+                return false;
             }
 
-            auto rci = new RenderCacheItem(_cache, it);
-            if (rci != nullptr && !rci->IsPurged()) {
+            auto rci = new RenderCacheItem(_cache, pack, key, data, size, keepAlive);
+            if (!rci->IsPurged()) {
                 _cache->AddCacheItem(rci);
+                items++;
             } else {
-                if (rci != nullptr) {
-                    delete rci;
-                }
-                logger_base.warn("Failed to load cache item %s.", (const char*)it.c_str());
+                delete rci;
+                logger_base.warn("Failed to load cache item %s.", (const char*)key.c_str());
             }
-        }
+            return true;
+        });
 
-        logger_base.debug("Cache contained %d files.", (int)files.size());
+        logger_base.debug("Cache contained %d items.", items);
         TraceLog::ClearTraceMessages();
         return nullptr;
     }
@@ -84,7 +84,6 @@ private:
 RenderCache::RenderCache()
 {
     _enabled = true;
-	_cacheFolder = "";
 }
 
 RenderCache::~RenderCache()
@@ -102,6 +101,8 @@ void RenderCache::SetMaximumSizeMB(size_t mb)
 
 void RenderCache::EnforceMaximumSize()
 {
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
     // zero means no limit
     if (_maximumSizeMB == 0)
         return;
@@ -112,14 +113,9 @@ void RenderCache::EnforceMaximumSize()
     if (!wxDir::Exists(_baseCache))
         return;
 
-    wxDir dir(_baseCache);
-    wxULongLong total = dir.GetTotalSize(_baseCache);
-    if ((total / 1024 / 1024).ToULong() < _maximumSizeMB)
-        return;
-
-    // get the size and last written date of all render cache entries
+    // each sequence is one pack so this is a handful of files rather than one per effect
     typedef struct CACHE_ENTRY {
-        wxULongLong size = 0;
+        uint64_t size = 0;
         std::string name;
         wxDateTime modified;
 
@@ -131,40 +127,73 @@ void RenderCache::EnforceMaximumSize()
 
     std::list<CACHE_ENTRY> entries;
 
-    // wxArrayString dirs;
-    // GetAllFilesInDir(_baseCache, dirs, wxALL_FILES_PATTERN, wxDIR_DIRS);
+    std::shared_ptr<RenderCachePack> pack = GetPack();
+    uint64_t current = 0;
+    uint64_t total = 0;
 
-    // each sequence is in a directory
-    // for (const auto& d : dirs) {
     wxArrayString files;
-    GetAllFilesInDir(_baseCache, files, "*.cache", wxDIR_FILES | wxDIR_DIRS);
+    GetAllFilesInDir(_baseCache, files, "*." + RenderCachePack::GetExtension());
 
     for (const auto& f : files) {
         wxFileName fn(f);
+        if (pack != nullptr && fn.SameAs(wxFileName(pack->GetFile()))) {
+            // the open pack may have writes queued
+            current = pack->GetSize();
+            total += current;
+            continue;
+        }
         CACHE_ENTRY ce;
         ce.name = f;
-        ce.size = fn.GetSize();
+        ce.size = fn.GetSize().GetValue();
         ce.modified = fn.GetModificationTime();
-
-        if ((ce.size / 1024 / 1024).ToULong() > _maximumSizeMB / 2) {
-            // we always delete anything larger than half the maximum as these are essentially making the cache useless
-            wxRemoveFile(ce.name);
-            total -= ce.size;
-        } else {
-            entries.push_back(ce);
-        }
+        total += ce.size;
+        entries.push_back(ce);
     }
-    //}
 
-    entries.sort();
+    const uint64_t maximum = (uint64_t)_maximumSizeMB * 1024 * 1024;
+    if (total <= maximum)
+        return;
 
-    while ((total / 1024 / 1024).ToULong() > _maximumSizeMB && entries.size() > 0) {
-        if (wxFile::Exists(entries.front().name)) {
-            wxRemoveFile(entries.front().name);
+    // other sequences go first, least recently written first
+    entries.sort();
+    while (total > maximum && entries.size() > 0) {
+        if (wxRemoveFile(entries.front().name)) {
+            logger_base.debug("Render cache removed %s.", (const char*)entries.front().name.c_str());
             total -= entries.front().size;
         }
         entries.pop_front();
     }
+
+    // then the least recently used items of this one
+    if (total > maximum && pack != nullptr) {
+        // wait for the cache to finish loading, the pack cannot be rewritten while it is read
+        std::unique_lock<std::mutex> lock(_loadMutex);
+        pack->Trim(maximum - std::min(maximum, total - current), maximum / 2);
+    }
+}
+
+// before the packs each sequence had a folder holding a file per effect, these are never read now
+static void RemoveLegacyCaches(const std::string& folder)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    wxDir dir(folder);
+    if (!dir.IsOpened())
+        return;
+
+    std::list<wxString> legacy;
+    wxString name;
+    bool cont = dir.GetFirst(&name, "*_RENDER_CACHE", wxDIR_DIRS);
+    while (cont) {
+        legacy.push_back(folder + GetPathSeparator() + name);
+        cont = dir.GetNext(&name);
+    }
+    dir.Close();
+
+    for (const auto& it : legacy) {
+        logger_base.debug("Removing old style render cache folder %s.", (const char*)it.c_str());
+        wxDir::Remove(it, wxPATH_RMDIR_RECURSIVE);
+    }
 }
 
 void RenderCache::LoadCache()
@@ -196,53 +225,54 @@ void RenderCache::SetSequence(const std::string& path, const std::string& sequen
 
     if (path != "") {
         _baseCache = path + GetPathSeparator() + "RenderCache";
+        RemoveLegacyCaches(_baseCache);
         EnforceMaximumSize();
     }
 
+    if (sequenceFile == "")
+    {
+        return;
+    }
+
+    std::string cacheFile = path + GetPathSeparator() + "RenderCache" + GetPathSeparator() + sequenceFile + "." + RenderCachePack::GetExtension();
+
     if (!IsEnabled())
     {
-        if (sequenceFile != "")
+        if (FileExists(cacheFile))
         {
-            _cacheFolder = path + GetPathSeparator() + "RenderCache" + GetPathSeparator() + sequenceFile + "_RENDER_CACHE";
-            if (wxDir::Exists(_cacheFolder))
+            if (GetBitness() == "32bit")
             {
-                if (GetBitness() == "32bit")
-                {
-                    logger_base.debug("Render cache disabled but NOT removing folder %s as this is the 32 bt version.", (const char *)_cacheFolder.c_str());
-                }
-                else
-                {
-                    logger_base.debug("Render cache disabled so removing folder %s.", (const char *)_cacheFolder.c_str());
-                    wxDir::Remove(_cacheFolder, wxPATH_RMDIR_RECURSIVE);
-                }
+                logger_base.debug("Render cache disabled but NOT removing %s as this is the 32 bt version.", (const char *)cacheFile.c_str());
+            }
+            else
+            {
+                logger_base.debug("Render cache disabled so removing %s.", (const char *)cacheFile.c_str());
+                wxRemoveFile(cacheFile);
             }
         }
         return;
     }
 
-    if (sequenceFile != "")
+    wxString common = path + GetPathSeparator() + "RenderCache";
+    if (!wxDir::Exists(common))
     {
-        _cacheFolder = path + GetPathSeparator() + "RenderCache" + GetPathSeparator() + sequenceFile + "_RENDER_CACHE";
+        logger_base.debug("Creating render cache folder %s.", (const char *)common.c_str());
+        wxDir::Make(common);
+    }
 
-        if (!wxDir::Exists(_cacheFolder))
-        {
-            wxString common = path + GetPathSeparator() + "RenderCache";
-            if (!wxDir::Exists(common))
-            {
-                logger_base.debug("Creating render cache folder %s.", (const char *)common.c_str());
-                wxDir::Make(common);
-            }
+    logger_base.debug("Opening render cache %s.", (const char *)cacheFile.c_str());
+    {
+        std::unique_lock<std::recursive_mutex> lock(_cacheLock);
+        _pack = std::make_shared<RenderCachePack>(cacheFile, UseMMap());
+    }
 
-            logger_base.debug("Creating render cache folder %s.", (const char *)_cacheFolder.c_str());
-            wxDir::Make(_cacheFolder);
-        }
-        else
-        {
-            logger_base.debug("Opening render cache folder %s.", (const char *)_cacheFolder.c_str());
-        }
+    LoadCache();
+}
 
-        LoadCache();
-    }
+std::shared_ptr<RenderCachePack> RenderCache::GetPack()
+{
+    std::unique_lock<std::recursive_mutex> lock(_cacheLock);
+    return _pack;
 }
 
 void RenderCache::RemoveItem(RenderCacheItem *item) {
@@ -267,7 +297,7 @@ bool RenderCache::IsEffectOkForCaching(Effect* effect) const
 
     bool locked = false;
 
-    for (const auto& it : effect->GetSettings()) {
+    for (const auto& it : effect->GetSettingsView()) {
         // we cant cache effects with canvas turned on
         if (it.first == "T_CHECKBOX_Canvas" && it.second == "1") {
             return false;
@@ -313,7 +343,7 @@ RenderCacheItem* RenderCache::GetItem(Effect* effect, RenderBuffer* buffer)
 {
     static log4cpp::Category& logger_rcache = log4cpp::Category::getInstance(std::string("log_rendercache"));
     if (!IsEnabled()) return nullptr;
-    if (_cacheFolder == "") return nullptr;
+    if (GetPack() == nullptr) return nullptr;
 
     if (!IsEffectOkForCaching(effect)) return nullptr;
 
@@ -361,9 +391,10 @@ void RenderCache::Close()
 {
     static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
 
-    if (_cacheFolder == "") return;
+    std::shared_ptr<RenderCachePack> pack = GetPack();
+    if (pack == nullptr) return;
 
-    logger_base.debug("Closing render cache folder %s.", (const char *)_cacheFolder.c_str());
+    logger_base.debug("Closing render cache %s.", (const char *)pack->GetFile().c_str());
 
     {
         // wait for the cache to finish loading
@@ -373,9 +404,11 @@ void RenderCache::Close()
     logger_base.debug("    Got lock.");
 
     Purge(nullptr, false);
-    _cacheFolder = "";
+    // the sequence may be opened again straight away so everything must be in the file first
+    pack->Flush();
 
     std::unique_lock<std::recursive_mutex> lock(_cacheLock);
+    _pack = nullptr;
     for (auto &a : _cache) {
         delete a.second;
         a.second = nullptr;
@@ -490,9 +523,10 @@ void RenderCache::Purge(SequenceElements* sequenceElements, bool dodelete)
 {
     static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
 
-    if (dodelete && _cacheFolder != "")
+    std::shared_ptr<RenderCachePack> pack = GetPack();
+    if (dodelete && pack != nullptr)
     {
-        logger_base.debug("Purging render cache folder %s.", (const char *)_cacheFolder.c_str());
+        logger_base.debug("Purging render cache %s.", (const char *)pack->GetFile().c_str());
     }
 
     std::unique_lock<std::recursive_mutex> lock(_cacheLock);
@@ -534,6 +568,57 @@ bool RenderCache::UseMMap() const {
 #pragma endregion RenderCache
 
 #pragma region RenderCacheItem
+
+// An item in the pack is the properties and the frame layout, each string stored as its
+// length followed by its bytes, then each model's frames starting on a 16 byte boundary.
+namespace
+{
+    struct ItemHeader {
+        uint32_t properties;
+        uint32_t models;
+    };
+
+    size_t Align16(size_t v)
+    {
+        return (v + 15) & ~(size_t)15;
+    }
+
+    void WriteValue(std::vector<uint8_t>& data, const void* v, size_t size)
+    {
+        size_t at = data.size();
+        data.resize(at + size);
+        memcpy(&data[at], v, size);
+    }
+
+    void WriteString(std::vector<uint8_t>& data, const std::string& s)
+    {
+        uint32_t len = (uint32_t)s.size();
+        WriteValue(data, &len, sizeof(len));
+        WriteValue(data, s.data(), len);
+    }
+
+    bool ReadValue(const uint8_t* data, size_t size, size_t& pos, void* v, size_t vsize)
+    {
+        if (vsize > size - pos) {
+            return false;
+        }
+        memcpy(v, data + pos, vsize);
+        pos += vsize;
+        return true;
+    }
+
+    bool ReadString(const uint8_t* data, size_t size, size_t& pos, std::string& s)
+    {
+        uint32_t len;
+        if (!ReadValue(data, size, pos, &len, sizeof(len)) || len > size - pos) {
+            return false;
+        }
+        s.assign((const char*)data + pos, len);
+        pos += len;
+        return true;
+    }
+}
+
 RenderCacheItem::~RenderCacheItem()
 {
     PurgeFrames();
@@ -552,13 +637,8 @@ void RenderCacheItem::PurgeFrames()
             }
         }
     }
-#ifdef USE_MMAP_RENDERCACHE
-    if (_mmap) {
-        munmap(_mmap, _mmapSize);
-        _mmap = nullptr;
-        _mmapSize = 0;
-    }
-#endif
+    _mmap = nullptr;
+    _written = nullptr;
 }
 
 std::string RenderCacheItem::GetModelName(RenderBuffer* buffer)
@@ -577,10 +657,8 @@ std::string RenderCacheItem::GetModelName(RenderBuffer* buffer)
     }
 }
 
-RenderCacheItem::RenderCacheItem(RenderCache* renderCache, Effect* effect, RenderBuffer* buffer) : _renderCache(renderCache)
+RenderCacheItem::RenderCacheItem(RenderCache* renderCache, Effect* effect, RenderBuffer* buffer) : _renderCache(renderCache), _pack(renderCache->GetPack())
 {
-    _mmap = nullptr;
-    _mmapSize = 0;
     _purged = false;
     _dirty = true;
     std::string mname = GetModelName(buffer);
@@ -593,13 +671,12 @@ RenderCacheItem::RenderCacheItem(RenderCache* renderCache, Effect* effect, Rende
     elname.Replace("?", "_");
     elname.Replace("*", "_");
     elname.Replace("$", "_");
-    std::string file = wxString::Format("%s_%s_%d_%d.cache",
+    _key = wxString::Format("%s_%s_%d_%d",
             effect->GetEffectName(),
             elname,
             effect->GetParentEffectLayer()->GetLayerNumber(),
             effect->GetStartTimeMS()).ToStdString();
     _effectName = effect->GetEffectName();
-    _cacheFile = renderCache->GetCacheFolder() + GetPathSeparator() + file;
     _properties["Effect"] = effect->GetEffectName();
     _properties["Element"] = effect->GetParentEffectLayer()->GetParentElement()->GetFullName();
     _properties["EffectLayer"] = wxString::Format("%d", effect->GetParentEffectLayer()->GetLayerNumber());
@@ -607,11 +684,11 @@ RenderCacheItem::RenderCacheItem(RenderCache* renderCache, Effect* effect, Rende
     _properties["EndMS"] = wxString::Format("%d", effect->GetEndTimeMS());
     _properties["Frames"] = wxString::Format("%d", buffer->curEffEndPer - buffer->curEffStartPer + 1);
     _properties["Models"] = "-1";
-    for (const auto& it : effect->GetSettings())
+    for (const auto& it : effect->GetSettingsView())
     {
         _properties[it.first] = it.second;
     }
-    for (const auto& it : effect->GetPaletteMap())
+    for (const auto& it : effect->GetPaletteView())
     {
         _properties[it.first] = it.second;
     }
@@ -641,14 +718,17 @@ bool RenderCacheItem::IsMatch(Effect* effect, RenderBuffer* buffer)
 
     // We only log failures from here on because they should be relatively rare
 
+    SettingsView settings = effect->GetSettingsView();
+    SettingsView palette = effect->GetPaletteView();
+
     // 8 is the number of predefined tags
-    if (_properties.size() - 7 != effect->GetSettings().size() + effect->GetPaletteMap().size())
+    if (_properties.size() - 7 != settings.size() + palette.size())
     {
         logger_rcache.debug("RenderCache no mantch because number of proprerties different.");
         return false;
     }
 
-    for (const auto& it : effect->GetSettings())
+    for (const auto& it : settings)
     {
         if (_properties.find(it.first) == _properties.end()) {
             logger_rcache.debug("RenderCache no match because proprerty not present: " + it.first);
@@ -664,7 +744,7 @@ bool RenderCacheItem::IsMatch(Effect* effect, RenderBuffer* buffer)
         }
     }
 
-    for (const auto& it : effect->GetPaletteMap())
+    for (const auto& it : palette)
     {
         if (_properties.find(it.first) == _properties.end()) {
             logger_rcache.debug("RenderCache no match because pallette map not present: " + it.first);
@@ -686,14 +766,9 @@ bool RenderCacheItem::IsMatch(Effect* effect, RenderBuffer* buffer)
 void RenderCacheItem::Delete()
 {
     static log4cpp::Category& logger_rcache = log4cpp::Category::getInstance(std::string("log_rendercache"));
-    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
-    wxLogNull logNo; //kludge: avoid user error messahe
-    if (!_purged && FileExists(_cacheFile)) {
-        if (!wxRemoveFile(_cacheFile)) {
-            logger_base.warn("Unable to remove cache file " + _cacheFile);
-        } else {
-            logger_rcache.info("RenderCache removed file " + _cacheFile);
-        }
+    if (!_purged && _pack != nullptr) {
+        _pack->Remove(_key);
+        logger_rcache.info("RenderCache removed " + _key);
     }
     PurgeFrames();
     _renderCache->RemoveItem(this);
@@ -792,6 +867,9 @@ void RenderCacheItem::AddFrame(RenderBuffer* buffer)
 bool RenderCacheItem::GetFrame(RenderBuffer* buffer)
 {
     static log4cpp::Category& logger_rcache = log4cpp::Category::getInstance(std::string("log_rendercache"));
+    if (_written != nullptr) {
+        remmap();
+    }
     std::string mname = GetModelName(buffer);
     if (_frameSize.find(mname) == _frameSize.end()) {
         logger_rcache.info("RenderCache::GetFrame on model " + mname + " failed due to number of frames difference.");
@@ -818,23 +896,16 @@ bool RenderCacheItem::GetFrame(RenderBuffer* buffer)
 
 void RenderCacheItem::Touch() const
 {
-    wxFileName fn(_cacheFile);
-    fn.Touch();
+    if (_pack != nullptr) {
+        _pack->Touch(_key);
+    }
 }
 
 void RenderCacheItem::Save()
 {
     if (_purged) return;
     if (!_dirty) return;
-    
-    if (_mmap) {
-        return;
-    }
-
-    static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
-    //logger_base.debug("Saving render cache file %s.", (const char *)_cacheFile.c_str());
-
-    char zero = 0x00;
+    if (_pack == nullptr) return;
 
     // check all the data is there
     for (const auto& itm : _frames) {
@@ -845,46 +916,66 @@ void RenderCacheItem::Save()
         }
     }
 
-    wxFile file;
+    _properties["Models"] = wxString::Format("%d", (int)_frames.size());
 
-    if (file.Create(_cacheFile, true)) {
-        _properties["Models"] = wxString::Format("%d", (int)_frames.size());
-        // write the header fields
-        for (const auto& it : _properties) {
-            file.Write(it.first);
-            file.Write(&zero, 1);
-            file.Write(it.second);
-            file.Write(&zero, 1);
-        }
-
-        file.Write("RC_HEADEREND");
-        file.Write(&zero, 1);
+    std::vector<uint8_t> data;
+    ItemHeader header = { (uint32_t)_properties.size(), (uint32_t)_frames.size() };
+    WriteValue(data, &header, sizeof(header));
+    for (const auto& it : _properties) {
+        WriteString(data, it.first);
+        WriteString(data, it.second);
+    }
+    size_t size = 0;
+    for (const auto& it : _frames) {
+        uint32_t frames = (uint32_t)it.second.size();
+        uint32_t frameSize = (uint32_t)_frameSize.at(it.first);
+        WriteString(data, it.first);
+        WriteValue(data, &frames, sizeof(frames));
+        WriteValue(data, &frameSize, sizeof(frameSize));
+        size = Align16(size) + (size_t)frames * frameSize;
+    }
 
-        for (const auto& it : _frames) {
-            file.Write(it.first);
-            file.Write(&zero, 1);
-            file.Write(wxString::Format("%d", (int)it.second.size()));
-            file.Write(&zero, 1);
-            file.Write(wxString::Format("%ld", _frameSize.at(it.first)));
-            file.Write(&zero, 1);
+    size_t first = Align16(data.size());
+    size_t cur = first;
+    data.reserve(cur + size + 16);
+    for (const auto& itm : _frames) {
+        cur = Align16(cur);
+        data.resize(cur + itm.second.size() * _frameSize.at(itm.first));
+        for (const auto& it : itm.second) {
+            memcpy(&data[cur], it, _frameSize.at(itm.first));
+            cur += _frameSize.at(itm.first);
         }
-        _firstFrameOffset = file.Tell();
-        
-        // write the frames
-        for (const auto& itm : _frames) {
-            for (const auto& it : itm.second) {
-                wxASSERT(it != nullptr);
-                if (it != nullptr) {
-                    file.Write(it, _frameSize.at(itm.first));
-                }
+    }
+
+    // the frames are moved into the record the pack is given so only one copy is held while it is written
+    auto record = std::make_shared<const std::vector<uint8_t>>(std::move(data));
+    cur = first;
+    for (auto& itm : _frames) {
+        cur = Align16(cur);
+        for (auto& it : itm.second) {
+            if (!_mmap) {
+                free(it);
             }
+            it = (uint8_t*)record->data() + cur;
+            cur += _frameSize.at(itm.first);
         }
+    }
+    _mmap = record;
+    _dirty = false;
 
-        file.Close();
-        
-        remmap();
+    if (_renderCache->UseMMap()) {
+        // once written the frames can be used from the pack rather than held in memory
+        auto written = std::make_shared<Written>();
+        written->saved = record->data();
+        _written = written;
+        _pack->Write(_key, record, [written](const uint8_t* data, size_t size, const std::shared_ptr<const void>& keepAlive) {
+            std::unique_lock<std::mutex> lock(written->lock);
+            written->data = data;
+            written->keepAlive = keepAlive;
+        });
     } else {
-        logger_base.warn("    Failed to create file.");
+        _written = nullptr;
+        _pack->Write(_key, record);
     }
 }
 
@@ -896,104 +987,102 @@ bool RenderCacheItem::IsDone(RenderBuffer* buffer) const
     return modelFrames[frame];
 }
 
-RenderCacheItem::RenderCacheItem(RenderCache* renderCache, const std::string& filename) : _renderCache(renderCache)
+RenderCacheItem::RenderCacheItem(RenderCache* renderCache, const std::shared_ptr<RenderCachePack>& pack, const std::string& key, const uint8_t* data, size_t size, const std::shared_ptr<const void>& keepAlive) :
+    _renderCache(renderCache), _pack(pack), _key(key)
 {
     static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
 
-    _mmap = nullptr;
-    _mmapSize = 0;
-    _cacheFile = filename;
-    wxFileName fn(_cacheFile);
-    _effectName = fn.GetName();
-    int idx = _effectName.find('_');
-    _effectName = _effectName.substr(0, idx);
     _purged = false;
     _dirty = false;
 
-    wxFile file;
-
-    if (file.Open(_cacheFile)) {
-        char headerBuffer[8192];
-        memset(headerBuffer, 0x00, sizeof(headerBuffer));
-        file.Read(headerBuffer, sizeof(headerBuffer));
-
-        char* ps = headerBuffer;
-
-        while (strcmp(ps, "RC_HEADEREND") != 0) {
-            std::string key(ps);
-            ps += strlen(ps) + 1;
-            std::string value(ps);
-            ps += strlen(ps) + 1;
+    size_t pos = 0;
+    ItemHeader header;
+    if (!ReadValue(data, size, pos, &header, sizeof(header))) {
+        logger_base.debug("Cache item %s appears corrupt.", (const char*)key.c_str());
+        _purged = true;
+        return;
+    }
 
-            if (key == "") {
-                // file looks corrupt
-                logger_base.debug("Cache file %s appears corrupt.", (const char*)filename.c_str());
-                _purged = true;
-                return;
-            } else {
-                _properties[key] = value;
-            }
+    for (uint32_t i = 0; i < header.properties; i++) {
+        std::string k;
+        std::string v;
+        if (!ReadString(data, size, pos, k) || !ReadString(data, size, pos, v) || k == "") {
+            logger_base.debug("Cache item %s appears corrupt.", (const char*)key.c_str());
+            _purged = true;
+            return;
         }
-        ps += strlen(ps) + 1;
-
-        int models = wxAtoi(_properties["Models"]);
-
-        for (int i = 0; i < models; i++) {
-            std::string model(ps);
-            ps += strlen(ps) + 1;
-            std::string frames(ps);
-            ps += strlen(ps) + 1;
-            int fs = wxAtoi(frames);
-            std::string frameSize(ps);
-            ps += strlen(ps) + 1;
-            long fsz = wxAtol(frameSize);
-
-            std::vector<unsigned char *> n;
-            _frames[model] = n;
-            _frames.at(model).resize(fs);
-            _frameSize[model] = fsz;
+        _properties[k] = v;
+    }
+    _effectName = _properties["Effect"];
+
+    // the models in the order their frames follow
+    std::list<std::string> models;
+    for (uint32_t i = 0; i < header.models; i++) {
+        std::string model;
+        uint32_t frames;
+        uint32_t frameSize;
+        if (!ReadString(data, size, pos, model) || !ReadValue(data, size, pos, &frames, sizeof(frames)) || !ReadValue(data, size, pos, &frameSize, sizeof(frameSize)) ||
+            (uint64_t)frames * frameSize > size) {
+            logger_base.debug("Cache item %s appears corrupt.", (const char*)key.c_str());
+            _purged = true;
+            return;
         }
+        _frames[model].resize(frames);
+        _frameSize[model] = frameSize;
+        models.push_back(model);
+    }
 
-        _firstFrameOffset = ps - headerBuffer;
-#ifdef USE_MMAP_RENDERCACHE
-        if (renderCache->UseMMap()) {
-            file.Seek(0);
-            _mmapSize = file.Length();
-            _mmap = (uint8_t*)mmap(nullptr, _mmapSize, PROT_READ, MAP_PRIVATE, file.fd(), 0);
-            
-            size_t cur = _firstFrameOffset;
-            for (auto& itm : _frames) {
-                for (int i = 0; i < itm.second.size(); i++) {
-                    itm.second[i] = &_mmap[cur];
-                    cur += _frameSize.at(itm.first);
+    // set first so a failure part way through does not free frames in the mapping
+    _mmap = keepAlive;
+    size_t cur = Align16(pos);
+    for (const auto& model : models) {
+        cur = Align16(cur);
+        auto& frames = _frames.at(model);
+        size_t frameSize = _frameSize.at(model);
+        if (cur > size || frames.size() * frameSize > size - cur) {
+            logger_base.debug("Cache item %s appears corrupt.", (const char*)key.c_str());
+            PurgeFrames();
+            return;
+        }
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (keepAlive != nullptr) {
+                // mapped so use the frames where they are
+                frames[i] = (uint8_t*)data + cur;
+            } else {
+                uint8_t* frameBuffer = (uint8_t *)malloc(frameSize);
+                if (frameBuffer == nullptr) {
+                    PurgeFrames();
+                    logger_base.debug("Render Cache Item %s fails due to memory allocation issue.", (const char*)key.c_str());
+                    return;
                 }
+                memcpy(frameBuffer, data + cur, frameSize);
+                frames[i] = frameBuffer;
             }
-        } else
-#endif
-        {
-            file.Seek(_firstFrameOffset);
-            for (auto& itm : _frames) {
-                for (int i = 0; i < itm.second.size(); i++) {
-                    uint8_t* frameBuffer = (uint8_t *)malloc(_frameSize.at(itm.first));
-                    
-                    if (frameBuffer == nullptr) {
-                        file.Close();
-                        PurgeFrames();
-                        logger_base.debug("Render Cache Item file %s fails due to memory allocation issue.", (const char*)filename.c_str());
-                        return;
-                    }
-                    
-                    file.Read(frameBuffer, _frameSize.at(itm.first));
-                    itm.second[i] = frameBuffer;
-                }
+            cur += frameSize;
+        }
+    }
+}
+
+void RenderCacheItem::remmap() {
+    std::shared_ptr<Written> written = _written;
+    std::unique_lock<std::mutex> lock(written->lock);
+    if (written->keepAlive == nullptr) {
+        return;
+    }
+    for (auto& itm : _frames) {
+        for (auto& it : itm.second) {
+            if (it != nullptr) {
+                it = (uint8_t*)written->data + (it - written->saved);
             }
         }
-        file.Close();
     }
+    _mmap = written->keepAlive;
+    lock.unlock();
+    _written = nullptr;
 }
 
 void RenderCacheItem::unmmap() {
-#ifdef USE_MMAP_RENDERCACHE
+    _written = nullptr;
     if (_mmap) {
         for (auto& it : _frames) {
             for (int x = it.second.size() - 1; x >= 0; --x) {
@@ -1004,36 +1093,8 @@ void RenderCacheItem::unmmap() {
                 }
             }
         }
-        munmap(_mmap, _mmapSize);
         _mmap = nullptr;
-        _mmapSize = 0;
     }
-#endif
-}
-void RenderCacheItem::remmap() {
-#ifdef USE_MMAP_RENDERCACHE
-    if (_mmap) return;
-    if (!_renderCache->UseMMap()) return;
-
-    wxFile file;
-    if (file.Open(_cacheFile)) {
-        file.Seek(0);
-        _mmapSize = file.Length();
-        _mmap = (uint8_t*)mmap(nullptr, _mmapSize, PROT_READ, MAP_PRIVATE, file.fd(), 0);
-        
-        size_t cur = _firstFrameOffset;
-        for (auto& itm : _frames) {
-            for (int i = 0; i < itm.second.size(); i++) {
-                if (itm.second[i]) {
-                    free(itm.second[i]);
-                    itm.second[i] = nullptr;
-                }
-                itm.second[i] = &_mmap[cur];
-                cur += _frameSize.at(itm.first);
-            }
-        }
-    }
-#endif
 }
 
 
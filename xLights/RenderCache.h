@@ -13,6 +13,7 @@
 #include <string>
 #include <list>
 #include <map>
+#include <memory>
 #include <vector>
 #include <mutex>
 #include <shared_mutex>
@@ -23,11 +24,13 @@ class RenderCache;
 class SequenceElements;
 class RenderBuffer;
 class RenderCacheLoadThread;
+class RenderCachePack;
 
 class RenderCacheItem
 {
     RenderCache* _renderCache = nullptr;
-    std::string _cacheFile;
+    std::shared_ptr<RenderCachePack> _pack;
+    std::string _key;
     std::string _effectName;
     std::map<std::string, std::string> _properties;
     std::map<std::string, std::vector<uint8_t *>> _frames;
@@ -36,16 +39,24 @@ class RenderCacheItem
     bool _dirty = false;
     static std::string GetModelName(RenderBuffer* buffer);
 
-    
-    uint8_t *_mmap = nullptr;
-    size_t _mmapSize = 0;
-    size_t _firstFrameOffset = 0;
+    // set while the frames point into the memory mapped pack, or into the record last saved
+    // to the pack until it is written
+    std::shared_ptr<const void> _mmap;
+
+    // where a mapped pack put the record last saved, filled in by the pack's writer
+    struct Written {
+        std::mutex lock;
+        const uint8_t* saved = nullptr;
+        const uint8_t* data = nullptr;
+        std::shared_ptr<const void> keepAlive;
+    };
+    std::shared_ptr<Written> _written;
 
     void unmmap();
     void remmap();
 
 public:
-    RenderCacheItem(RenderCache* renderCache, const std::string& file);
+    RenderCacheItem(RenderCache* renderCache, const std::shared_ptr<RenderCachePack>& pack, const std::string& key, const uint8_t* data, size_t size, const std::shared_ptr<const void>& keepAlive);
     RenderCacheItem(RenderCache* renderCache, Effect* effect, RenderBuffer* buffer);
     virtual ~RenderCacheItem();
     bool GetFrame(RenderBuffer* buffer);
@@ -57,7 +68,7 @@ public:
     void Save();
     void Touch() const;
     bool IsDone(RenderBuffer* buffer) const;
-    const std::string& Description() const { return _cacheFile; }
+    const std::string& Description() const { return _key; }
     const std::string& EffectName() const { return _effectName; }
 };
 
@@ -72,7 +83,7 @@ class RenderCache
     };
     
     std::recursive_mutex  _cacheLock;
-	std::string _cacheFolder;
+    std::shared_ptr<RenderCachePack> _pack;
 	std::map<std::string, PerEffectCache*> _cache;
     std::string _enabled; // Disabled | Locked Only | Enabled
     std::mutex _loadMutex;
@@ -93,7 +104,7 @@ class RenderCache
         void SetSequence(const std::string& path, const std::string& sequenceFile);
 		RenderCacheItem* GetItem(Effect* effect, RenderBuffer* buffer);
         void RemoveItem(RenderCacheItem *item);
-        std::string GetCacheFolder() const { return _cacheFolder; }
+        std::shared_ptr<RenderCachePack> GetPack();
         void CleanupCache(SequenceElements* sequenceElements);
         void Purge(SequenceElements* sequenceElements, bool dodelete);
         void Enable(std::string enabled) { 
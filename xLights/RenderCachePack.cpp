@@ -0,0 +1,652 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <wx/file.h>
+#include <wx/filename.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "RenderCachePack.h"
+#include "ExternalHooks.h"
+
+#include <log4cpp/Category.hh>
+
+#ifndef __WXMSW__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifndef NO_ZSTD
+#include <zstd.h>
+#endif
+
+#define RENDER_CACHE_PACK_VERSION 1
+
+namespace
+{
+    struct PackHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t reserved;
+    };
+
+    struct RecordHeader {
+        char magic[4];
+        uint32_t type;
+        uint32_t keyLength;
+        uint32_t compression;
+        uint64_t storedSize; // bytes of data in the file
+        uint64_t size;       // bytes of data once decompressed
+    };
+
+    enum RecordType : uint32_t {
+        RECORD_ITEM = 1,
+        RECORD_REMOVED = 2
+    };
+
+    enum Compression : uint32_t {
+        COMPRESSION_NONE = 0,
+        COMPRESSION_ZSTD = 1
+    };
+
+    static const char PACK_MAGIC[4] = { 'X', 'L', 'R', 'C' };
+    static const char RECORD_MAGIC[4] = { 'R', 'C', 'R', 'D' };
+
+    // keys are built from effect and element names so anything longer is corruption
+    static const uint32_t MAX_KEY_LENGTH = 4096;
+    // not worth the time to compress anything smaller
+    static const size_t MIN_COMPRESS_SIZE = 4096;
+    // writes queued beyond this wait for the writer rather than holding ever more frames in memory
+    static const uint64_t MAX_PENDING_SIZE = 256 * 1024 * 1024;
+
+    uint64_t Align16(uint64_t v)
+    {
+        return (v + 15) & ~(uint64_t)15;
+    }
+
+    uint64_t DataOffset(uint32_t keyLength)
+    {
+        return Align16(sizeof(RecordHeader) + keyLength);
+    }
+
+    uint64_t RecordSize(uint32_t keyLength, uint64_t storedSize)
+    {
+        return Align16(DataOffset(keyLength) + storedSize);
+    }
+
+    bool WriteRecord(wxFile& f, uint32_t type, const std::string& key, const uint8_t* data, uint64_t storedSize, uint64_t size, uint32_t compression)
+    {
+        static const uint8_t zeros[16] = { 0 };
+
+        RecordHeader h;
+        memcpy(h.magic, RECORD_MAGIC, 4);
+        h.type = type;
+        h.keyLength = (uint32_t)key.size();
+        h.compression = compression;
+        h.storedSize = storedSize;
+        h.size = size;
+
+        uint64_t dataOffset = DataOffset(h.keyLength);
+        uint64_t recordSize = RecordSize(h.keyLength, storedSize);
+        return f.Write(&h, sizeof(h)) == sizeof(h) &&
+               f.Write(key.data(), key.size()) == key.size() &&
+               f.Write(zeros, dataOffset - sizeof(h) - key.size()) == dataOffset - sizeof(h) - key.size() &&
+               (storedSize == 0 || f.Write(data, storedSize) == storedSize) &&
+               f.Write(zeros, recordSize - dataOffset - storedSize) == recordSize - dataOffset - storedSize;
+    }
+
+    bool ReadHeader(wxFile& f, uint64_t offset, uint64_t length, RecordHeader& h, std::string& key)
+    {
+        if (offset + sizeof(RecordHeader) > length || f.Seek(offset) == wxInvalidOffset || f.Read(&h, sizeof(h)) != sizeof(h)) {
+            return false;
+        }
+        if (memcmp(h.magic, RECORD_MAGIC, 4) != 0 || (h.type != RECORD_ITEM && h.type != RECORD_REMOVED) ||
+            h.keyLength == 0 || h.keyLength > MAX_KEY_LENGTH || h.compression > COMPRESSION_ZSTD ||
+            h.storedSize > length || RecordSize(h.keyLength, h.storedSize) > length - offset) {
+            return false;
+        }
+        key.resize(h.keyLength);
+        return f.Read(&key[0], h.keyLength) == h.keyLength;
+    }
+}
+
+RenderCachePack::RenderCachePack(const std::string& file, bool useMMap) :
+    _file(file), _useMMap(useMMap)
+{
+    _fileSize = sizeof(PackHeader);
+    _thread = std::thread(&RenderCachePack::Run, this);
+}
+
+RenderCachePack::~RenderCachePack()
+{
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _stop = true;
+    }
+    _signal.notify_all();
+    _thread.join();
+}
+
+bool RenderCachePack::Reset()
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _index.clear();
+        _fileSize = sizeof(PackHeader);
+    }
+
+    PackHeader h;
+    memcpy(h.magic, PACK_MAGIC, 4);
+    h.version = RENDER_CACHE_PACK_VERSION;
+    h.reserved = 0;
+
+    wxFile f;
+    if (!f.Create(_file, true) || f.Write(&h, sizeof(h)) != sizeof(h)) {
+        logger_base.warn("Unable to create render cache %s.", (const char*)_file.c_str());
+        return false;
+    }
+    logger_base.debug("Created render cache %s.", (const char*)_file.c_str());
+    return true;
+}
+
+void RenderCachePack::Open()
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    wxFile f;
+    if (!FileExists(_file) || !f.Open(_file)) {
+        Reset();
+        return;
+    }
+
+    uint64_t length = f.Length();
+    PackHeader ph;
+    if (length < sizeof(ph) || f.Read(&ph, sizeof(ph)) != sizeof(ph) ||
+        memcmp(ph.magic, PACK_MAGIC, 4) != 0 || ph.version != RENDER_CACHE_PACK_VERSION) {
+        f.Close();
+        logger_base.debug("Render cache %s is not a usable pack, starting again.", (const char*)_file.c_str());
+        Reset();
+        return;
+    }
+
+    // walk the record headers to find the latest record of each item that is still there
+    std::map<std::string, Index> index;
+    uint64_t clock = 0;
+    uint64_t offset = sizeof(PackHeader);
+    RecordHeader h;
+    std::string key;
+    while (offset < length && ReadHeader(f, offset, length, h, key)) {
+        uint64_t size = RecordSize(h.keyLength, h.storedSize);
+        if (h.type == RECORD_ITEM) {
+            // the file is in the order things were saved which is as good a guess as any at the order they were used
+            index[key] = { offset, size, ++clock, true };
+        } else {
+            index.erase(key);
+        }
+        offset += size;
+    }
+    f.Close();
+    if (offset != length) {
+        // a write was cut short, drop it so appended records follow the last good one
+        logger_base.warn("Render cache %s is damaged after %llu bytes, the rest is discarded.", (const char*)_file.c_str(), (unsigned long long)offset);
+        std::error_code ec;
+        std::filesystem::resize_file(_file, offset, ec);
+        if (ec) {
+            Reset();
+            return;
+        }
+        length = offset;
+    }
+
+    std::unique_lock<std::mutex> lock(_lock);
+    _index = std::move(index);
+    _fileSize = length;
+    _clock = clock;
+}
+
+void RenderCachePack::Load(const LoadFunc& func)
+{
+    // only the items that were there when the pack was opened, anything written since the caller already has
+    std::vector<std::pair<uint64_t, std::string>> items;
+    uint64_t length;
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _signal.wait(lock, [this] { return _opened; });
+        length = _fileSize;
+        for (const auto& it : _index) {
+            if (it.second.existing) {
+                items.push_back({ it.second.offset, it.first });
+            }
+        }
+        if (items.empty()) {
+            return;
+        }
+        // the offsets must not move under us
+        _loading = true;
+    }
+    LoadItems(items, length, func);
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _loading = false;
+    }
+    _signal.notify_all();
+}
+
+void RenderCachePack::LoadItems(std::vector<std::pair<uint64_t, std::string>>& items, uint64_t length, const LoadFunc& func)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    wxFile f;
+    if (!f.Open(_file)) {
+        logger_base.warn("Unable to open render cache %s.", (const char*)_file.c_str());
+        return;
+    }
+
+    std::shared_ptr<const void> mapping;
+    const uint8_t* base = nullptr;
+#ifndef __WXMSW__
+    if (_useMMap && length > 0) {
+        void* m = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, f.fd(), 0);
+        if (m != MAP_FAILED) {
+            mapping = std::shared_ptr<const void>(m, [length](const void* p) { munmap((void*)p, length); });
+            base = (const uint8_t*)m;
+        }
+    }
+#endif
+
+    // hand the items over in file order so a pack that is not mapped is read front to back
+    std::sort(items.begin(), items.end());
+    RecordHeader h;
+    std::string key;
+    std::vector<uint8_t> stored;
+    std::vector<uint8_t> data;
+    for (const auto& it : items) {
+        if (!ReadHeader(f, it.first, length, h, key)) {
+            break;
+        }
+        uint64_t dataOffset = it.first + DataOffset(h.keyLength);
+        const uint8_t* in = nullptr;
+        if (base != nullptr) {
+            in = base + dataOffset;
+        } else {
+            stored.resize(h.storedSize);
+            if (f.Seek(dataOffset) == wxInvalidOffset || f.Read(stored.data(), h.storedSize) != (ssize_t)h.storedSize) {
+                logger_base.warn("Unable to read %s from render cache %s.", (const char*)key.c_str(), (const char*)_file.c_str());
+                continue;
+            }
+            in = stored.data();
+        }
+
+        bool more;
+        if (h.compression == COMPRESSION_NONE) {
+            more = func(key, in, h.storedSize, mapping);
+        } else {
+#ifndef NO_ZSTD
+            data.resize(h.size);
+            size_t res = ZSTD_decompress(data.data(), data.size(), in, h.storedSize);
+            if (ZSTD_isError(res) || res != h.size) {
+                logger_base.warn("Unable to decompress %s from render cache %s.", (const char*)key.c_str(), (const char*)_file.c_str());
+                continue;
+            }
+            more = func(key, data.data(), data.size(), nullptr);
+#else
+            continue;
+#endif
+        }
+        if (!more) {
+            break;
+        }
+    }
+}
+
+void RenderCachePack::Queue(Job&& job)
+{
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        if (job.type == Job::Type::WRITE) {
+            // a write that would go over the limit on its own still goes once the queue is empty
+            uint64_t size = RecordSize((uint32_t)job.key.size(), job.data->size());
+            _signal.wait(lock, [this, size] { return _stop || _pendingSize == 0 || _pendingSize + size <= MAX_PENDING_SIZE; });
+            if (!_stop) {
+                _pendingSize += size;
+            }
+        }
+        if (_stop) {
+            return;
+        }
+        _jobs.push_back(std::move(job));
+    }
+    _signal.notify_all();
+}
+
+void RenderCachePack::Write(const std::string& key, const std::shared_ptr<const std::vector<uint8_t>>& data, const WrittenFunc& written)
+{
+    Job job{ Job::Type::WRITE, key, data, written };
+    Queue(std::move(job));
+}
+
+void RenderCachePack::Remove(const std::string& key)
+{
+    Job job{ Job::Type::REMOVE, key };
+    Queue(std::move(job));
+}
+
+void RenderCachePack::Trim(uint64_t maxSize, uint64_t maxItem)
+{
+    Job job{ Job::Type::TRIM };
+    job.maxSize = maxSize;
+    job.maxItem = maxItem;
+    Queue(std::move(job));
+}
+
+void RenderCachePack::Touch(const std::string& key)
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        it->second.lastUsed = ++_clock;
+    }
+}
+
+void RenderCachePack::Flush()
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    _signal.wait(lock, [this] { return _jobs.empty() && !_busy; });
+}
+
+uint64_t RenderCachePack::GetSize() const
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    return _fileSize + _pendingSize;
+}
+
+void RenderCachePack::Run()
+{
+    // nothing queued is written until the offsets of what is already in the file are known
+    Open();
+    std::unique_lock<std::mutex> lock(_lock);
+    _opened = true;
+    _signal.notify_all();
+    for (;;) {
+        _signal.wait(lock, [this] { return _stop || !_jobs.empty(); });
+        if (_jobs.empty()) {
+            // only stop once everything queued has been written
+            break;
+        }
+        std::list<Job> jobs;
+        jobs.splice(jobs.end(), _jobs);
+        _busy = true;
+        lock.unlock();
+
+        // consecutive writes and removes are appended with the file opened once
+        std::list<Job> batch;
+        for (auto& job : jobs) {
+            if (job.type == Job::Type::TRIM) {
+                Append(batch);
+                batch.clear();
+                {
+                    // trimming rewrites the file so can't happen while it is being loaded
+                    std::unique_lock<std::mutex> tlock(_lock);
+                    _signal.wait(tlock, [this] { return !_loading; });
+                }
+                DoTrim(job.maxSize, job.maxItem);
+            } else {
+                batch.push_back(std::move(job));
+            }
+        }
+        Append(batch);
+
+        lock.lock();
+        _busy = false;
+        _signal.notify_all();
+    }
+}
+
+bool RenderCachePack::Append(const std::list<Job>& jobs)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    if (jobs.empty()) {
+        return true;
+    }
+
+    uint64_t pending = 0;
+    for (const auto& job : jobs) {
+        if (job.type == Job::Type::WRITE) {
+            pending += RecordSize((uint32_t)job.key.size(), job.data->size());
+        }
+    }
+
+    bool ok = true;
+    wxFile f;
+    if (!FileExists(_file) && !Reset()) {
+        ok = false;
+    } else if (!f.Open(_file, wxFile::write_append)) {
+        logger_base.warn("Unable to open render cache %s.", (const char*)_file.c_str());
+        ok = false;
+    }
+    // opened for reading the first time a written record is mapped
+    wxFile mapFile;
+
+    std::vector<uint8_t> compressed;
+    for (const auto& job : jobs) {
+        if (!ok) {
+            break;
+        }
+
+        uint64_t offset;
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            if (job.type == Job::Type::REMOVE && _index.find(job.key) == _index.end()) {
+                // never saved so there is nothing to remove
+                continue;
+            }
+            offset = _fileSize;
+        }
+
+        uint32_t type = job.type == Job::Type::WRITE ? RECORD_ITEM : RECORD_REMOVED;
+        const uint8_t* data = job.data != nullptr ? job.data->data() : nullptr;
+        uint64_t size = job.data != nullptr ? job.data->size() : 0;
+        uint64_t storedSize = size;
+        uint32_t compression = COMPRESSION_NONE;
+#ifndef NO_ZSTD
+        // a mapped pack is used in place so is only worth having uncompressed
+        if (!_useMMap && size >= MIN_COMPRESS_SIZE) {
+            compressed.resize(ZSTD_compressBound(size));
+            size_t res = ZSTD_compress(compressed.data(), compressed.size(), data, size, 1);
+            if (!ZSTD_isError(res) && res < size - size / 8) {
+                data = compressed.data();
+                storedSize = res;
+                compression = COMPRESSION_ZSTD;
+            }
+        }
+#endif
+
+        uint64_t recordSize = RecordSize((uint32_t)job.key.size(), storedSize);
+        if (!WriteRecord(f, type, job.key, data, storedSize, size, compression)) {
+            logger_base.warn("Unable to write %s to render cache %s.", (const char*)job.key.c_str(), (const char*)_file.c_str());
+            // take off the partial record so the pack still reads to the end
+            f.Close();
+            std::error_code ec;
+            std::filesystem::resize_file(_file, offset, ec);
+            ok = false;
+            break;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            if (type == RECORD_ITEM) {
+                _index[job.key] = { offset, recordSize, ++_clock };
+                uint64_t queued = RecordSize((uint32_t)job.key.size(), size);
+                _pendingSize -= std::min(queued, _pendingSize);
+                pending -= std::min(queued, pending);
+            } else {
+                _index.erase(job.key);
+            }
+            _fileSize = offset + recordSize;
+        }
+        // let anyone waiting for room in the queue go
+        _signal.notify_all();
+
+#ifndef __WXMSW__
+        if (job.written != nullptr && _useMMap && compression == COMPRESSION_NONE && storedSize != 0) {
+            if (!mapFile.IsOpened()) {
+                mapFile.Open(_file);
+            }
+            // the mapping has to start on a page so it takes in the end of whatever is before the record
+            uint64_t dataOffset = offset + DataOffset((uint32_t)job.key.size());
+            uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+            uint64_t mapOffset = dataOffset - dataOffset % pageSize;
+            size_t mapSize = (size_t)(dataOffset - mapOffset + storedSize);
+            void* m = mapFile.IsOpened() ? mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, mapFile.fd(), (off_t)mapOffset) : MAP_FAILED;
+            if (m != MAP_FAILED) {
+                std::shared_ptr<const void> mapping(m, [mapSize](const void* p) { munmap((void*)p, mapSize); });
+                job.written((const uint8_t*)m + (dataOffset - mapOffset), (size_t)storedSize, mapping);
+            }
+        }
+#endif
+    }
+
+    if (pending != 0) {
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            _pendingSize -= std::min(pending, _pendingSize);
+        }
+        _signal.notify_all();
+    }
+    return ok;
+}
+
+void RenderCachePack::DoTrim(uint64_t maxSize, uint64_t maxItem)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    std::vector<std::string> evicted;
+    uint64_t live = sizeof(PackHeader);
+    uint64_t fileSize;
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        std::vector<std::pair<uint64_t, std::string>> byAge;
+        byAge.reserve(_index.size());
+        for (const auto& it : _index) {
+            live += it.second.size;
+            byAge.push_back({ it.second.lastUsed, it.first });
+        }
+        std::sort(byAge.begin(), byAge.end());
+        for (const auto& it : byAge) {
+            uint64_t size = _index[it.second].size;
+            if (size > maxItem || live > maxSize) {
+                live -= size;
+                _index.erase(it.second);
+                evicted.push_back(it.second);
+            }
+        }
+        fileSize = _fileSize;
+    }
+
+    if (!evicted.empty()) {
+        logger_base.debug("Render cache %s evicting %d items.", (const char*)_file.c_str(), (int)evicted.size());
+    }
+
+    // rewrite the pack once a good part of it is replaced or removed items
+    if (evicted.empty() && fileSize - live < live / 4) {
+        return;
+    }
+    if (Compact()) {
+        return;
+    }
+
+    // could not rewrite the pack so record the evictions in it instead
+    wxFile f;
+    if (!f.Open(_file, wxFile::write_append)) {
+        return;
+    }
+    for (const auto& key : evicted) {
+        uint64_t offset;
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            offset = _fileSize;
+        }
+        if (!WriteRecord(f, RECORD_REMOVED, key, nullptr, 0, 0, COMPRESSION_NONE)) {
+            f.Close();
+            std::error_code ec;
+            std::filesystem::resize_file(_file, offset, ec);
+            return;
+        }
+        std::unique_lock<std::mutex> lock(_lock);
+        _fileSize = offset + RecordSize((uint32_t)key.size(), 0);
+    }
+}
+
+bool RenderCachePack::Compact()
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    // only this thread changes which items are in the index so the copy stays accurate
+    std::vector<std::pair<uint64_t, std::string>> items;
+    std::map<std::string, uint64_t> sizes;
+    uint64_t oldSize;
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        for (const auto& it : _index) {
+            items.push_back({ it.second.offset, it.first });
+            sizes[it.first] = it.second.size;
+        }
+        oldSize = _fileSize;
+    }
+    std::sort(items.begin(), items.end());
+
+    // written under another name first so the pack is never left half written
+    std::string temp = _file + ".tmp";
+    std::map<std::string, uint64_t> offsets;
+    uint64_t pos = sizeof(PackHeader);
+    bool ok;
+    {
+        wxFile in;
+        wxFile out;
+        ok = in.Open(_file) && out.Create(temp, true);
+        if (ok) {
+            PackHeader h;
+            memcpy(h.magic, PACK_MAGIC, 4);
+            h.version = RENDER_CACHE_PACK_VERSION;
+            h.reserved = 0;
+            ok = out.Write(&h, sizeof(h)) == sizeof(h);
+        }
+        // records are copied as they are, every offset is a multiple of 16 so they stay aligned
+        std::vector<uint8_t> buf;
+        for (size_t i = 0; ok && i < items.size(); i++) {
+            uint64_t size = sizes[items[i].second];
+            buf.resize(size);
+            ok = in.Seek(items[i].first) != wxInvalidOffset && in.Read(buf.data(), size) == (ssize_t)size &&
+                 out.Write(buf.data(), size) == size;
+            offsets[items[i].second] = pos;
+            pos += size;
+        }
+    }
+    if (!ok || !wxRenameFile(temp, _file, true)) {
+        logger_base.warn("Unable to compact render cache %s.", (const char*)_file.c_str());
+        wxRemoveFile(temp);
+        return false;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        for (const auto& it : offsets) {
+            _index[it.first].offset = it.second;
+        }
+        _fileSize = pos;
+    }
+    logger_base.debug("Render cache %s compacted from %llu to %llu bytes.", (const char*)_file.c_str(), (unsigned long long)oldSize, (unsigned long long)pos);
+    return true;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The render cache of one sequence held in a single append only file. Each item is a
+// record named by a key, a later record for the same key replaces the earlier one and
+// removing an item appends a record saying so. Record data starts on a 16 byte boundary
+// so a memory mapped pack can be used in place, and is zstd compressed when it is not
+// going to be mapped.
+//
+// All file writes are done in order on a background thread so saving an item only costs
+// the caller the time to queue it, unless so much is already queued that it has to wait
+// for the writer to catch up. Space left by replaced and removed items is reclaimed when
+// the pack is trimmed.
+class RenderCachePack
+{
+public:
+    // data is the record as it was written. When keepAlive is set data lives as long as it
+    // does, otherwise data is only valid for the duration of the call. Return false to stop.
+    typedef std::function<bool(const std::string& key, const uint8_t* data, size_t size, const std::shared_ptr<const void>& keepAlive)> LoadFunc;
+    // called on the writer thread once a record is in a mapped pack with its data where it
+    // now lives in the file, which keepAlive holds mapped
+    typedef std::function<void(const uint8_t* data, size_t size, const std::shared_ptr<const void>& keepAlive)> WrittenFunc;
+
+    RenderCachePack(const std::string& file, bool useMMap);
+    // waits for queued writes to complete
+    ~RenderCachePack();
+    RenderCachePack(const RenderCachePack&) = delete;
+    RenderCachePack& operator=(const RenderCachePack&) = delete;
+
+    static std::string GetExtension() { return "xlrc"; }
+    const std::string& GetFile() const { return _file; }
+
+    // reads the items that were in the pack when it was opened, waiting for that to finish first
+    void Load(const LoadFunc& func);
+
+    // data is only read so the caller can keep using it while the write is queued
+    void Write(const std::string& key, const std::shared_ptr<const std::vector<uint8_t>>& data, const WrittenFunc& written = nullptr);
+    void Remove(const std::string& key);
+    // marks the item as recently used
+    void Touch(const std::string& key);
+    // waits for queued writes to complete
+    void Flush();
+
+    // size of the file once queued writes complete
+    uint64_t GetSize() const;
+    // Drops items bigger than maxItem, as they are essentially making the cache useless, then
+    // the least recently used items until the pack fits in maxSize and rewrites it without them.
+    void Trim(uint64_t maxSize, uint64_t maxItem);
+
+private:
+    struct Index {
+        uint64_t offset = 0;
+        uint64_t size = 0; // the whole record
+        uint64_t lastUsed = 0;
+        bool existing = false; // was in the file when it was opened
+    };
+    struct Job {
+        enum class Type { WRITE, REMOVE, TRIM } type;
+        std::string key;
+        std::shared_ptr<const std::vector<uint8_t>> data;
+        WrittenFunc written;
+        uint64_t maxSize = 0;
+        uint64_t maxItem = 0;
+    };
+
+    void Queue(Job&& job);
+    void Run();
+    // reads the index of the file, done on the writer thread before any job
+    void Open();
+    void LoadItems(std::vector<std::pair<uint64_t, std::string>>& items, uint64_t length, const LoadFunc& func);
+    bool Append(const std::list<Job>& jobs);
+    void DoTrim(uint64_t maxSize, uint64_t maxItem);
+    bool Compact();
+    bool Reset();
+
+    const std::string _file;
+    const bool _useMMap;
+
+    mutable std::mutex _lock;
+    std::condition_variable _signal;
+    std::list<Job> _jobs;
+    bool _busy = false;
+    bool _stop = false;
+    bool _opened = false;
+    bool _loading = false;
+    std::map<std::string, Index> _index;
+    uint64_t _fileSize = 0;
+    uint64_t _pendingSize = 0;
+    uint64_t _clock = 0;
+    std::thread _thread;
+};
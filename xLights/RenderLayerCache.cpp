@@ -0,0 +1,256 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <wx/string.h>
+
+#include "RenderLayerCache.h"
+#include "RenderBuffer.h"
+#include "GPURenderUtils.h"
+
+struct RenderLayerCache::Frame {
+    int effectId = -1;
+    int width = 0;
+    int height = 0;
+    bool valid = false;
+    xlColorVector pixels;
+};
+
+namespace
+{
+    typedef RenderLayerCache::Frame Frame;
+
+    struct LayerFrames {
+        std::mutex lock;
+        uint64_t invalidated = 0; // generation of the last change to the layer
+        int frameTimeMS = 0;
+        // a frame is only changed in place while nothing has it pinned
+        std::map<int, std::shared_ptr<Frame>> frames;
+        // also read by Evict without the lock
+        std::atomic<uint64_t> lastUsed = 0;
+        std::atomic<size_t> bytes = 0;
+
+        // must hold lock
+        void Drop();
+    };
+
+    std::mutex __lock;
+    std::unordered_map<const EffectLayer*, std::shared_ptr<LayerFrames>> __layers;
+    std::atomic<uint64_t> __generation = 0;
+    std::atomic<uint64_t> __cleared = 0;
+    std::atomic<uint64_t> __tick = 0;
+    std::atomic<int64_t> __bytes = 0;
+
+    std::atomic<uint64_t> __reused = 0;
+    std::atomic<uint64_t> __stored = 0;
+    std::atomic<uint64_t> __dropped = 0;
+
+    void LayerFrames::Drop()
+    {
+        __bytes -= bytes;
+        __dropped += frames.size();
+        bytes = 0;
+        frames.clear();
+    }
+
+    std::shared_ptr<LayerFrames> Find(const EffectLayer* layer, bool create)
+    {
+        std::unique_lock<std::mutex> lock(__lock);
+        auto it = __layers.find(layer);
+        if (it != __layers.end()) {
+            return it->second;
+        }
+        if (!create) {
+            return nullptr;
+        }
+        auto res = std::make_shared<LayerFrames>();
+        __layers[layer] = res;
+        return res;
+    }
+
+    // drops the least recently used layers, other than keep, until we are back under budget
+    void Evict(const LayerFrames* keep)
+    {
+        while (__bytes > (int64_t)RenderLayerCache::MAX_BYTES) {
+            std::shared_ptr<LayerFrames> oldest;
+            {
+                std::unique_lock<std::mutex> lock(__lock);
+                for (const auto& it : __layers) {
+                    if (it.second.get() != keep && it.second->bytes > 0 && (oldest == nullptr || it.second->lastUsed < oldest->lastUsed)) {
+                        oldest = it.second;
+                    }
+                }
+            }
+            if (oldest == nullptr) {
+                return;
+            }
+            std::unique_lock<std::mutex> lock(oldest->lock);
+            oldest->Drop();
+        }
+    }
+}
+
+uint64_t RenderLayerCache::GetGeneration()
+{
+    return __generation;
+}
+
+RenderLayerCache::PinnedFrames RenderLayerCache::Pin(const EffectLayer* layer, int startFrame, int endFrame, int effectId, int frameTimeMS, const RenderBuffer& buffer)
+{
+    auto lf = Find(layer, false);
+    if (lf == nullptr) {
+        return nullptr;
+    }
+    auto res = std::make_shared<std::map<int, std::shared_ptr<const Frame>>>();
+    std::unique_lock<std::mutex> lock(lf->lock);
+    if (lf->frameTimeMS != frameTimeMS) {
+        return nullptr;
+    }
+    int expected = startFrame;
+    for (auto it = lf->frames.lower_bound(startFrame); it != lf->frames.end() && expected <= endFrame; ++it, ++expected) {
+        const Frame& f = *it->second;
+        if (it->first != expected || f.effectId != effectId || f.width != buffer.BufferWi || f.height != buffer.BufferHt ||
+            (f.valid && f.pixels.size() != buffer.GetPixelCount())) {
+            return nullptr;
+        }
+        res->emplace_hint(res->end(), it->first, it->second);
+    }
+    if (expected <= endFrame) {
+        return nullptr;
+    }
+    lf->lastUsed = ++__tick;
+    return res;
+}
+
+bool RenderLayerCache::Get(const PinnedFrames& pinned, int frame, RenderBuffer& buffer, bool& valid)
+{
+    auto it = pinned->find(frame);
+    if (it == pinned->end()) {
+        return false;
+    }
+    const Frame& f = *it->second;
+    valid = f.valid;
+    if (valid && !f.pixels.empty()) {
+        memcpy(buffer.GetPixels(), &f.pixels[0], f.pixels.size() * sizeof(xlColor));
+    }
+    ++__reused;
+    return true;
+}
+
+void RenderLayerCache::Put(const EffectLayer* layer, uint64_t generation, int frame, int frameTimeMS, int effectId, RenderBuffer& buffer, bool valid)
+{
+    if (generation < __cleared) {
+        return;
+    }
+    auto lf = Find(layer, true);
+    {
+        std::unique_lock<std::mutex> lock(lf->lock);
+        if (generation < lf->invalidated) {
+            // the layer changed while this frame was rendering
+            return;
+        }
+        if (lf->frameTimeMS != frameTimeMS) {
+            lf->Drop();
+            lf->frameTimeMS = frameTimeMS;
+        }
+
+        auto& fp = lf->frames[frame];
+        size_t oldBytes = fp != nullptr ? fp->pixels.capacity() * sizeof(xlColor) : 0;
+        if (fp == nullptr || fp.use_count() > 1) {
+            // pinned by a render still reading it, leave that copy alone
+            fp = std::make_shared<Frame>();
+        }
+        Frame& f = *fp;
+        f.effectId = effectId;
+        f.width = buffer.BufferWi;
+        f.height = buffer.BufferHt;
+        f.valid = valid;
+        if (valid) {
+            GPURenderUtils::waitForRenderCompletion(&buffer);
+            f.pixels.resize(buffer.GetPixelCount());
+            if (!f.pixels.empty()) {
+                memcpy(&f.pixels[0], buffer.GetPixels(), f.pixels.size() * sizeof(xlColor));
+            }
+        } else {
+            xlColorVector().swap(f.pixels);
+        }
+        size_t newBytes = f.pixels.capacity() * sizeof(xlColor);
+        lf->bytes += newBytes - oldBytes;
+        __bytes += (int64_t)newBytes - (int64_t)oldBytes;
+        lf->lastUsed = ++__tick;
+        ++__stored;
+    }
+    Evict(lf.get());
+}
+
+void RenderLayerCache::Invalidate(const EffectLayer* layer, int startMS, int endMS)
+{
+    auto lf = Find(layer, true);
+    std::unique_lock<std::mutex> lock(lf->lock);
+    lf->invalidated = ++__generation;
+    if (startMS < 0 || lf->frameTimeMS <= 0) {
+        lf->Drop();
+        return;
+    }
+    // a frame shows whatever covers its start time
+    int startFrame = (startMS + lf->frameTimeMS - 1) / lf->frameTimeMS;
+    int endFrame = endMS / lf->frameTimeMS;
+    for (auto it = lf->frames.lower_bound(startFrame); it != lf->frames.end() && it->first <= endFrame;) {
+        size_t bytes = it->second->pixels.capacity() * sizeof(xlColor);
+        lf->bytes -= bytes;
+        __bytes -= bytes;
+        ++__dropped;
+        it = lf->frames.erase(it);
+    }
+}
+
+void RenderLayerCache::Remove(const EffectLayer* layer)
+{
+    std::shared_ptr<LayerFrames> lf;
+    {
+        std::unique_lock<std::mutex> lock(__lock);
+        auto it = __layers.find(layer);
+        if (it == __layers.end()) {
+            return;
+        }
+        lf = it->second;
+        __layers.erase(it);
+    }
+    std::unique_lock<std::mutex> lock(lf->lock);
+    lf->invalidated = ++__generation;
+    lf->Drop();
+}
+
+void RenderLayerCache::Clear()
+{
+    __cleared = ++__generation;
+    std::unique_lock<std::mutex> lock(__lock);
+    for (auto& it : __layers) {
+        std::unique_lock<std::mutex> llock(it.second->lock);
+        it.second->invalidated = __cleared;
+        it.second->Drop();
+    }
+    __layers.clear();
+}
+
+std::string RenderLayerCache::GetStatsString()
+{
+    return wxString::Format("Render layer cache: %llu frames reused, %llu stored, %llu dropped, %.1fMB held.",
+                            (unsigned long long)__reused, (unsigned long long)__stored, (unsigned long long)__dropped,
+                            __bytes / (1024.0 * 1024.0))
+        .ToStdString();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+class EffectLayer;
+class RenderBuffer;
+
+// Holds what each effect layer rendered, after blur and rotozoom but before
+// transitions and blending, during interactive re-renders. When an edit only
+// touches one layer the other layers of that model, and every layer of the
+// models overlapping it, are put back from here rather than rendered again.
+//
+// Frames are dropped when the layer reports a change covering them, when a timing
+// track the layer depends on changes, when the render tree is rebuilt and when a
+// full render starts. Layers least recently stored to are dropped once MAX_BYTES
+// is exceeded.
+class RenderLayerCache
+{
+public:
+    // a token to pass to Put, taken before the effect's settings are read so any
+    // change made while it renders stops the stale frames being stored
+    static uint64_t GetGeneration();
+
+    struct Frame;
+    // frames held for the rest of an effect, kept even if the cache drops them meanwhile
+    typedef std::shared_ptr<const std::map<int, std::shared_ptr<const Frame>>> PinnedFrames;
+
+    // the frames startFrame to endFrame of this effect, nullptr unless they are all held and sized for buffer
+    static PinnedFrames Pin(const EffectLayer* layer, int startFrame, int endFrame, int effectId, int frameTimeMS, const RenderBuffer& buffer);
+    // copies a pinned frame back into buffer, false if the frame was not pinned
+    static bool Get(const PinnedFrames& pinned, int frame, RenderBuffer& buffer, bool& valid);
+    static void Put(const EffectLayer* layer, uint64_t generation, int frame, int frameTimeMS, int effectId, RenderBuffer& buffer, bool valid);
+
+    // startMS < 0 drops every frame
+    static void Invalidate(const EffectLayer* layer, int startMS = -1, int endMS = -1);
+    static void Remove(const EffectLayer* layer);
+    static void Clear();
+
+    static std::string GetStatsString();
+
+    static const size_t MAX_BYTES = 256 * 1024 * 1024;
+};
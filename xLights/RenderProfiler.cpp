@@ -0,0 +1,273 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <wx/file.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <set>
+
+#include "RenderProfiler.h"
+#include "UtilFunctions.h"
+
+#include <log4cpp/Category.hh>
+
+RenderProfiler RenderProfiler::INSTANCE;
+
+static thread_local int64_t mainThreadTimeUS = 0;
+
+void RenderProfiler::Start(const std::string& saveTo)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    std::unique_lock<std::mutex> lock(_ringsLock);
+    for (auto& r : _rings) {
+        std::unique_lock<std::mutex> rlock(r->lock);
+        r->next = 0;
+        r->dropped = 0;
+    }
+    _saveTo = saveTo;
+    _startUS.store(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    _enabled = true;
+    logger_base.info("Render profiling started.");
+}
+
+void RenderProfiler::Stop()
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+    if (_enabled) {
+        _enabled = false;
+        logger_base.info("Render profiling stopped. %d events recorded.", (int)GetEvents().size());
+        if (!_saveTo.empty()) {
+            WriteChromeTrace(_saveTo);
+            WriteSummary(_saveTo + ".txt");
+            logger_base.info(GetSummary());
+        }
+    }
+}
+
+int64_t RenderProfiler::NowUS() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - _startUS.load();
+}
+
+RenderProfiler::Ring* RenderProfiler::GetRing()
+{
+    static thread_local Ring* ring = nullptr;
+    if (ring == nullptr) {
+        std::unique_lock<std::mutex> lock(_ringsLock);
+        _rings.push_back(std::make_unique<Ring>());
+        ring = _rings.back().get();
+        ring->events.resize(RING_SIZE);
+        ring->thread = _rings.size();
+    }
+    return ring;
+}
+
+void RenderProfiler::Record(const Event& event)
+{
+    if (!_enabled) return;
+
+    Ring* ring = GetRing();
+    std::unique_lock<std::mutex> lock(ring->lock);
+    if (ring->next >= RING_SIZE) {
+        ++ring->dropped;
+    }
+    // assigning into the existing slot reuses the string buffers
+    Event& e = ring->events[ring->next % RING_SIZE];
+    e = event;
+    e.thread = ring->thread;
+    ++ring->next;
+}
+
+void RenderProfiler::AddMainThreadTime(int64_t us)
+{
+    mainThreadTimeUS += us;
+}
+
+int64_t RenderProfiler::TakeMainThreadTime()
+{
+    int64_t res = mainThreadTimeUS;
+    mainThreadTimeUS = 0;
+    return res;
+}
+
+std::vector<RenderProfiler::Event> RenderProfiler::GetEvents() const
+{
+    std::vector<Event> res;
+    std::unique_lock<std::mutex> lock(_ringsLock);
+    for (auto& r : _rings) {
+        std::unique_lock<std::mutex> rlock(r->lock);
+        size_t count = std::min(r->next, RING_SIZE);
+        size_t first = r->next - count;
+        for (size_t i = first; i < r->next; i++) {
+            res.push_back(r->events[i % RING_SIZE]);
+        }
+    }
+    std::sort(res.begin(), res.end(), [](const Event& a, const Event& b) { return a.startUS < b.startUS; });
+    return res;
+}
+
+size_t RenderProfiler::GetDroppedEvents() const
+{
+    size_t res = 0;
+    std::unique_lock<std::mutex> lock(_ringsLock);
+    for (auto& r : _rings) {
+        std::unique_lock<std::mutex> rlock(r->lock);
+        res += r->dropped;
+    }
+    return res;
+}
+
+bool RenderProfiler::WriteChromeTrace(const std::string& file) const
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    wxFile f;
+    if (!f.Create(file, true) || !f.IsOpened()) {
+        logger_base.error("Unable to create render profile file %s.", (const char*)file.c_str());
+        return false;
+    }
+
+    auto events = GetEvents();
+
+    // Each thread is a process in the trace. Model jobs go on track 0 and each
+    // model/layer the thread rendered gets its own track so runs never overlap.
+    std::map<std::pair<uint32_t, std::string>, int> tracks;
+    std::map<uint32_t, int> nextTrack;
+
+    f.Write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    auto write = [&f, &first](const std::string& s) {
+        if (!first) f.Write(",\n");
+        f.Write(s);
+        first = false;
+    };
+
+    std::set<uint32_t> threads;
+    for (const auto& e : events) {
+        if (threads.insert(e.thread).second) {
+            write("{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" + std::to_string(e.thread) + ",\"args\":{\"name\":\"Render thread " + std::to_string(e.thread) + "\"}}");
+            write("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + std::to_string(e.thread) + ",\"tid\":0,\"args\":{\"name\":\"Models\"}}");
+        }
+
+        int tid = 0;
+        std::string name = e.model;
+        if (!e.effect.empty()) {
+            std::string trackName = e.model + " / Layer " + std::to_string(e.layer + 1);
+            auto key = std::make_pair(e.thread, trackName);
+            auto it = tracks.find(key);
+            if (it == tracks.end()) {
+                tid = ++nextTrack[e.thread];
+                tracks[key] = tid;
+                write("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + std::to_string(e.thread) + ",\"tid\":" + std::to_string(tid) + ",\"args\":{\"name\":\"" + JSONSafe(trackName) + "\"}}");
+            } else {
+                tid = it->second;
+            }
+            name = e.effect;
+        }
+
+        write("{\"ph\":\"X\",\"cat\":\"" + std::string(e.effect.empty() ? "model" : "effect") +
+              "\",\"name\":\"" + JSONSafe(name) +
+              "\",\"pid\":" + std::to_string(e.thread) +
+              ",\"tid\":" + std::to_string(tid) +
+              ",\"ts\":" + std::to_string(e.startUS) +
+              ",\"dur\":" + std::to_string(std::max(e.endUS - e.startUS, (int64_t)1)) +
+              ",\"args\":{\"model\":\"" + JSONSafe(e.model) +
+              "\",\"layer\":" + std::to_string(e.layer + 1) +
+              ",\"startFrame\":" + std::to_string(e.startFrame) +
+              ",\"endFrame\":" + std::to_string(e.endFrame) +
+              ",\"renderMS\":" + std::to_string(e.renderUS / 1000.0) +
+              ",\"waitMS\":" + std::to_string(e.waitUS / 1000.0) +
+              ",\"mainThreadMS\":" + std::to_string(e.mainThreadUS / 1000.0) + "}}");
+    }
+    f.Write("\n]}\n");
+    f.Close();
+
+    logger_base.info("Render profile with %d events written to %s.", (int)events.size(), (const char*)file.c_str());
+    return true;
+}
+
+std::string RenderProfiler::GetSummary(int maxRows) const
+{
+    struct Totals {
+        int runs = 0;
+        int64_t frames = 0;
+        int64_t wallUS = 0;
+        int64_t renderUS = 0;
+        int64_t waitUS = 0;
+        int64_t mainThreadUS = 0;
+    };
+    std::map<std::string, Totals> byEffect;
+    std::map<std::string, Totals> byModel;
+
+    auto events = GetEvents();
+    for (const auto& e : events) {
+        if (e.effect.empty()) {
+            auto& t = byModel[e.model];
+            t.runs++;
+            t.frames += e.endFrame - e.startFrame + 1;
+            t.wallUS += e.endUS - e.startUS;
+            t.waitUS += e.waitUS;
+            t.mainThreadUS += e.mainThreadUS;
+        } else {
+            auto& t = byEffect[e.effect];
+            t.runs++;
+            t.frames += e.endFrame - e.startFrame + 1;
+            t.renderUS += e.renderUS;
+            t.mainThreadUS += e.mainThreadUS;
+            byModel[e.model].renderUS += e.renderUS;
+        }
+    }
+
+    auto sorted = [](const std::map<std::string, Totals>& m) {
+        std::vector<std::pair<std::string, Totals>> res(m.begin(), m.end());
+        std::sort(res.begin(), res.end(), [](const auto& a, const auto& b) {
+            return std::max(a.second.renderUS, a.second.wallUS) > std::max(b.second.renderUS, b.second.wallUS);
+        });
+        return res;
+    };
+
+    std::string res = "Render profile: " + std::to_string(events.size()) + " events";
+    size_t dropped = GetDroppedEvents();
+    if (dropped > 0) {
+        res += ", " + std::to_string(dropped) + " oldest events dropped";
+    }
+    res += "\n\nEffect                           Runs     Frames   Render ms  Main thread ms  us/frame\n";
+    int rows = 0;
+    for (const auto& it : sorted(byEffect)) {
+        if (rows++ >= maxRows) break;
+        const auto& t = it.second;
+        res += wxString::Format("%-30s %6d %10lld %11.1f %15.1f %9.1f\n", it.first.substr(0, 30), t.runs, (long long)t.frames,
+                                t.renderUS / 1000.0, t.mainThreadUS / 1000.0, t.frames > 0 ? (double)t.renderUS / t.frames : 0.0).ToStdString();
+    }
+
+    res += "\nModel                            Jobs    Wall ms   Render ms     Wait ms  Main thread ms\n";
+    rows = 0;
+    for (const auto& it : sorted(byModel)) {
+        if (rows++ >= maxRows) break;
+        const auto& t = it.second;
+        res += wxString::Format("%-30s %6d %10.1f %11.1f %11.1f %15.1f\n", it.first.substr(0, 30), t.runs,
+                                t.wallUS / 1000.0, t.renderUS / 1000.0, t.waitUS / 1000.0, t.mainThreadUS / 1000.0).ToStdString();
+    }
+    return res;
+}
+
+bool RenderProfiler::WriteSummary(const std::string& file) const
+{
+    wxFile f;
+    if (!f.Create(file, true) || !f.IsOpened()) {
+        return false;
+    }
+    f.Write(GetSummary(1000));
+    f.Close();
+    return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records where render time goes. Each rendering thread writes into its own
+// fixed size ring so recording never allocates or contends once warmed up, and
+// when profiling is off the cost is a single flag check per effect/frame.
+//
+// Events are either a whole model render job (effect empty, layer -1) or a run of
+// consecutive frames of one effect on one layer of a model/submodel/strand.
+class RenderProfiler
+{
+public:
+    struct Event {
+        std::string model;
+        std::string effect;
+        int layer = -1;
+        int startFrame = 0;
+        int endFrame = 0;
+        int64_t startUS = 0;       // wall clock start relative to when profiling started
+        int64_t endUS = 0;         // wall clock end
+        int64_t renderUS = 0;      // time actually spent rendering
+        int64_t waitUS = 0;        // time waiting on models this one renders on top of
+        int64_t mainThreadUS = 0;  // time waiting for effects which had to render on the main thread
+        uint32_t thread = 0;
+    };
+
+    static RenderProfiler INSTANCE;
+
+    // if saveTo is set the trace and summary are written there when profiling stops
+    void Start(const std::string& saveTo = "");
+    void Stop();
+    bool IsEnabled() const { return _enabled; }
+
+    int64_t NowUS() const;
+    void Record(const Event& event);
+
+    // per thread accumulator for time spent waiting on the main thread, taken by whoever records the next event
+    static void AddMainThreadTime(int64_t us);
+    static int64_t TakeMainThreadTime();
+
+    std::vector<Event> GetEvents() const;
+    size_t GetDroppedEvents() const;
+
+    // chrome://tracing or https://ui.perfetto.dev format
+    bool WriteChromeTrace(const std::string& file) const;
+    std::string GetSummary(int maxRows = 25) const;
+    bool WriteSummary(const std::string& file) const;
+
+private:
+    static const size_t RING_SIZE = 16384;
+
+    struct Ring {
+        std::mutex lock;
+        std::vector<Event> events;
+        size_t next = 0;
+        size_t dropped = 0;
+        uint32_t thread = 0;
+    };
+    Ring* GetRing();
+
+    std::atomic<bool> _enabled = false;
+    std::atomic<int64_t> _startUS = 0;
+    std::string _saveTo;
+    mutable std::mutex _ringsLock;
+    std::list<std::unique_ptr<Ring>> _rings;
+};
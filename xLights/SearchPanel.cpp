@@ -257,14 +257,14 @@ bool SearchPanel::ContainsSetting(Effect* eff, std::string const& search, bool r
         return ::Contains(::Lower(val), ::Lower(search));
     };
 
-    for (auto [key, setting] : eff->GetSettings()) {
+    for (auto [key, setting] : eff->GetSettingsView()) {
         std::string cmpvalue{ key + "=" + setting };
         if (compare(cmpvalue)) {
             value = cmpvalue;
             return true;
         }
     }
-    for (auto [key, setting] : eff->GetPaletteMap()) {
+    for (auto [key, setting] : eff->GetPaletteView()) {
         std::string cmpvalue{ key + "=" + setting };
         if (compare(cmpvalue)) {
             value = cmpvalue;
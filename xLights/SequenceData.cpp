@@ -9,7 +9,9 @@
  **************************************************************/
 
 #include <wx/wx.h>
+#include <wx/filename.h>
 
+#include <algorithm>
 
 #include <log4cpp/Category.hh>
 
@@ -18,8 +20,17 @@
 #include "SequenceData.h"
 #include "UtilFunctions.h"
 
+#ifdef USE_MMAP_BLOCKS
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <wx/msw/wrapwin.h>
+#endif
+
 const unsigned char SequenceData::FrameData::_constzero = 0;
 
+size_t SequenceData::_memoryBudget = (size_t)8 * 1024 * 1024 * 1024;
+
 
 // we'll keep the callocs below 1GB in size.  Should keep pressure off
 // the VM to find a huge block of space, but still not waste much
@@ -42,6 +53,89 @@ static size_t _hugePageAllocSize = DEFAULT_HUGE_ALLOC_SIZE;
 static bool _hugePagesFailed;
 #endif
 
+// file backed blocks have to start on a boundary the OS can map from, this suits all of them
+static const size_t SPILL_BLOCK_ALIGNMENT = 64 * 1024;
+
+static size_t AlignSpillBlock(size_t sz)
+{
+    return (sz + SPILL_BLOCK_ALIGNMENT - 1) / SPILL_BLOCK_ALIGNMENT * SPILL_BLOCK_ALIGNMENT;
+}
+
+// The temp file frame data is mapped from once it is over the memory budget. The
+// file is deleted as soon as nothing refers to it, the mapped blocks keep it alive
+// until they are unmapped so this only needs to live while they are being created.
+class SpillFile
+{
+public:
+    SpillFile(size_t size)
+    {
+        static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+        wxString name = wxFileName::CreateTempFileName("xlseq");
+        if (name.empty()) {
+            logger_base.warn("Unable to create a temp file for the sequence data.");
+            return;
+        }
+#ifdef USE_MMAP_BLOCKS
+        _file = open(name.c_str(), O_RDWR);
+        // nothing else needs the name
+        unlink(name.c_str());
+        if (_file >= 0 && ftruncate(_file, size) != 0) {
+            close(_file);
+            _file = -1;
+        }
+        _ok = _file >= 0;
+#else
+        _file = CreateFileW(name.wc_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        if (_file != INVALID_HANDLE_VALUE) {
+            _mapping = CreateFileMappingW(_file, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), nullptr);
+        }
+        _ok = _mapping != nullptr;
+#endif
+        if (!_ok) {
+            logger_base.warn("Unable to size the temp file %s for %zu bytes of sequence data.", (const char*)name.c_str(), size);
+        }
+    }
+
+    ~SpillFile()
+    {
+#ifdef USE_MMAP_BLOCKS
+        if (_file >= 0) {
+            close(_file);
+        }
+#else
+        if (_mapping != nullptr) {
+            CloseHandle(_mapping);
+        }
+        if (_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(_file);
+        }
+#endif
+    }
+
+    bool IsOk() const { return _ok; }
+
+    unsigned char* Map(size_t offset, size_t size)
+    {
+#ifdef USE_MMAP_BLOCKS
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _file, offset);
+        return data == MAP_FAILED ? nullptr : (unsigned char*)data;
+#else
+        return (unsigned char*)MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, (DWORD)(offset >> 32), (DWORD)(offset & 0xFFFFFFFF), size);
+#endif
+    }
+
+private:
+    bool _ok = false;
+#ifdef USE_MMAP_BLOCKS
+    int _file = -1;
+#else
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#endif
+};
+
 SequenceData::SequenceData() : _invalidFrame()
 {
 #ifdef USE_MMAP_BLOCKS
@@ -110,7 +204,11 @@ SequenceData::DataBlock::~DataBlock()
 #ifdef USE_MMAP_BLOCKS
         munmap(data, size);
 #else
-        free(data);
+        if (type == BlockType::FILE_BACKED) {
+            UnmapViewOfFile(data);
+        } else {
+            free(data);
+        }
 #endif
     }
 }
@@ -273,6 +371,51 @@ unsigned char *SequenceData::checkBlockPtr(unsigned char *block, size_t sizeRema
     return block;
 }
 
+bool SequenceData::InitFileBacked(size_t size)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    // whole frames in each block, each block starting on an aligned offset in the file
+    size_t framesPerBlock = std::max((size_t)1, MAX_BLOCK_SIZE / _bytesPerFrame);
+    size_t blockStride = AlignSpillBlock(framesPerBlock * _bytesPerFrame);
+    size_t fullBlocks = _numFrames / framesPerBlock;
+    size_t lastFrames = _numFrames % framesPerBlock;
+    size_t fileSize = fullBlocks * blockStride + AlignSpillBlock(lastFrames * _bytesPerFrame);
+
+    // running out of disk while the pages are being written back is fatal so make sure it is there now
+    wxDiskspaceSize_t freeSpace;
+    if (!wxGetDiskSpace(wxFileName::GetTempDir(), nullptr, &freeSpace) || freeSpace < wxDiskspaceSize_t((wxLongLong_t)(fileSize + fileSize / 10))) {
+        logger_base.warn("Not enough free space in %s to hold %zuMB of sequence data.", (const char*)wxFileName::GetTempDir().c_str(), fileSize / (1024 * 1024));
+        return false;
+    }
+
+    SpillFile file(fileSize);
+    if (!file.IsOk()) {
+        return false;
+    }
+    _frames.reserve(_numFrames);
+    size_t offset = 0;
+    for (unsigned int frame = 0; frame < _numFrames; frame += framesPerBlock) {
+        size_t frames = std::min(framesPerBlock, (size_t)(_numFrames - frame));
+        size_t blockSize = frames * _bytesPerFrame;
+        unsigned char* block = file.Map(offset, blockSize);
+        if (block == nullptr) {
+            logger_base.warn("Unable to map %zu bytes of sequence data at offset %zu, holding it all in memory instead.", blockSize, offset);
+            _frames.clear();
+            _dataBlocks.clear();
+            return false;
+        }
+        _dataBlocks.push_back(std::make_unique<DataBlock>(blockSize, block, BlockType::FILE_BACKED));
+        for (size_t f = 0; f < frames; ++f) {
+            _frames.push_back(FrameData(_numChannels, block + f * _bytesPerFrame));
+        }
+        offset += blockStride;
+    }
+    logger_base.info("Sequence data of %zuMB is over the %zuMB memory budget so is backed by a temp file. Frames=%d, Channels=%d.",
+                     size / (1024 * 1024), _memoryBudget / (1024 * 1024), _numFrames, _numChannels);
+    return true;
+}
+
 void SequenceData::init(unsigned int numChannels, unsigned int numFrames, unsigned int frameTime, bool roundto4)
 {
     static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
@@ -287,7 +430,10 @@ void SequenceData::init(unsigned int numChannels, unsigned int numFrames, unsign
     _frameTime = frameTime;
     _bytesPerFrame = roundTo4(numChannels);
 
-    if (numFrames > 0 && numChannels > 0) {
+    size_t totalSize = (size_t)_bytesPerFrame * (size_t)_numFrames;
+    bool fileBacked = _memoryBudget > 0 && totalSize > _memoryBudget && InitFileBacked(totalSize);
+
+    if (numFrames > 0 && numChannels > 0 && !fileBacked) {
         _frames.reserve(numFrames);
         size_t sizeRemaining = (size_t)_bytesPerFrame * (size_t)_numFrames;
         size_t blockSize = 0;
@@ -307,7 +453,7 @@ void SequenceData::init(unsigned int numChannels, unsigned int numFrames, unsign
             blockSize -= _bytesPerFrame;
         }
     }
-    else {
+    else if (!fileBacked) {
         logger_base.debug("Sequence memory released.");
     }
     _invalidFrame._data = (unsigned char*)calloc(1, _bytesPerFrame);
@@ -70,7 +70,8 @@ public:
 
     enum class BlockType {
         NORMAL,
-        HUGE_PAGE
+        HUGE_PAGE,
+        FILE_BACKED
     };
     class DataBlock {
         DataBlock(const DataBlock&d) = delete;
@@ -90,6 +91,12 @@ public:
     FrameData _invalidFrame;
     std::vector<FrameData> _frames;
     std::list<std::unique_ptr<DataBlock>> _dataBlocks;
+
+    // Sequences bigger than the memory budget are mapped from a temp file rather than
+    // allocated. Pages are only given space when first written and the OS writes cold
+    // ones back to the file and drops them from memory when it needs the room.
+    static size_t _memoryBudget;
+    bool InitFileBacked(size_t size);
     
     unsigned int _bytesPerFrame;
     unsigned int _numChannels;
@@ -107,6 +114,14 @@ public:
     virtual ~SequenceData();
     
     void init(unsigned int numChannels, unsigned int numFrames, unsigned int frameTime, bool roundto4 = true);
+
+    // bytes of frame data to hold in memory before falling back to a temp file, applies to the next init
+    static void SetMemoryBudget(size_t bytes) { _memoryBudget = bytes; }
+    static size_t GetMemoryBudget() { return _memoryBudget; }
+    [[nodiscard]] bool IsFileBacked() const
+    {
+        return !_dataBlocks.empty() && _dataBlocks.front()->type == BlockType::FILE_BACKED;
+    }
     unsigned int TotalTime() const { return _numFrames * _frameTime; }
     bool OK(unsigned int frame, unsigned int channel) const { return frame < _numFrames && channel < _numChannels; }
     
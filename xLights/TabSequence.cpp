@@ -39,6 +39,8 @@
 #include "ColoursPanel.h"
 #include "sequencer/MainSequencer.h"
 #include "HousePreviewPanel.h"
+#include "AudioAnalysisCache.h"
+#include "RenderProfiler.h"
 #include "ExternalHooks.h"
 
 #include "xLightsVersion.h"
@@ -343,6 +345,7 @@ wxString xLightsFrame::LoadEffectsFileNoCheck()
         UnsavedRgbEffectsChanges = true;
     }
     _renderCache.SetRenderCacheFolder(renderCacheDirectory);
+    AudioAnalysisCache::SetFolder(renderCacheDirectory + GetPathSeparator() + "AudioCache");
 
     mStoredLayoutGroup = GetXmlSetting("storedLayoutGroup", "Default");
 
@@ -1186,6 +1189,8 @@ void xLightsFrame::OpenRenderAndSaveSequences(const wxArrayString &origFilenames
         printf("Done All Files\n");
         wxBell();
         if (exitOnDone) {
+            // writes the profile out if one was requested on the command line
+            RenderProfiler::INSTANCE.Stop();
             Destroy();
         } else {
             CloseSequence();
@@ -316,41 +316,49 @@ wxString VAMPPluginDialog::ProcessPlugin(xLightsXmlFile* xml_file, xLightsFrame
             channels = 1;
         }
         p->initialise(channels, step, block);
-        pdata[0] =media->GetFilteredLeftDataPtr(0);
-        pdata[1] = media->GetFilteredRightDataPtr(0);
+        // the timings only depend on the audio, the plugin settings and the filter the audio has been through
+        std::string cacheDescription = xLightsVamp::DescribePlugin(p, output, step, block, channels,
+                                                                   wxString::Format("convert %d filter %s", (int)convert, media->GetFilterDescription()).ToStdString());
+        std::vector<float> values;
+        if (!xLightsVamp::LoadCachedTimings(media, cacheDescription, starts, ends, labels, values)) {
+            pdata[0] =media->GetFilteredLeftDataPtr(0);
+            pdata[1] = media->GetFilteredRightDataPtr(0);
         
-        wxProgressDialog progress("Processing Audio", "");
-        long totalLen = media->GetTrackSize();
-        long len = media->GetTrackSize();
-		int percent = 0;
-        long start = 0;
-        while (len) {
-            //int request = block;
-            //if (request > len) request = len;
-
-			pdata[0] = media->GetFilteredLeftDataPtr(start);
-			pdata[1] = media->GetFilteredRightDataPtr(start);
-
-            Vamp::RealTime timestamp = Vamp::RealTime::frame2RealTime(start, media->GetRate());
-            Vamp::Plugin::FeatureSet features = p->process(pdata, timestamp);
-            processFeatures(features[output], starts, ends, labels, convert);
-
-            if (len > (long)step) {
-                len -= step;
-            } else {
-                len = 0;
-            }
-            start += step;
+            wxProgressDialog progress("Processing Audio", "");
+            long totalLen = media->GetTrackSize();
+            long len = media->GetTrackSize();
+            int percent = 0;
+            long start = 0;
+            while (len) {
+                //int request = block;
+                //if (request > len) request = len;
+
+                pdata[0] = media->GetFilteredLeftDataPtr(start);
+                pdata[1] = media->GetFilteredRightDataPtr(start);
+
+                Vamp::RealTime timestamp = Vamp::RealTime::frame2RealTime(start, media->GetRate());
+                Vamp::Plugin::FeatureSet features = p->process(pdata, timestamp);
+                processFeatures(features[output], starts, ends, labels, convert);
+
+                if (len > (long)step) {
+                    len -= step;
+                } else {
+                    len = 0;
+                }
+                start += step;
             
-            int newp = (int)((start * 100) / totalLen);
-            if (newp != percent) {
-                percent = newp;
-                progress.Update(percent);
+                int newp = (int)((start * 100) / totalLen);
+                if (newp != percent) {
+                    percent = newp;
+                    progress.Update(percent);
+                }
             }
+            Vamp::Plugin::FeatureSet features = p->getRemainingFeatures();
+            processFeatures(features[output], starts, ends, labels, convert);
+            progress.Update(100);
+
+            xLightsVamp::SaveCachedTimings(media, cacheDescription, starts, ends, labels, values);
         }
-        Vamp::Plugin::FeatureSet features = p->getRemainingFeatures();
-        processFeatures(features[output], starts, ends, labels, convert);
-        progress.Update(100);
 
         xml_file->AddNewTimingSection(TimingName->GetValue().ToStdString(), xLightsParent, starts, ends, labels);
         return TimingName->GetValue();
@@ -29,6 +29,7 @@
 #include "../../xSchedule/wxHTTPServer/wxhttpserver.h"
 #include "../sequencer/MainSequencer.h"
 #include "../ModelPreview.h"
+#include "../RenderProfiler.h"
 #include <wx/uri.h>
 
 #include "LuaRunner.h"
@@ -253,6 +254,23 @@ bool xLightsFrame::ProcessAutomation(std::vector<std::string> &paths,
             _outputModelManager.AddImmediateWork(OutputModelManager::WORK_MODELS_CHANGE_REQUIRING_RERENDER, "Automation::renderAll");
         }
         return sendResponse("Rendered.", "msg", 200, false);
+    } else if (cmd == "startRenderProfile") {
+        RenderProfiler::INSTANCE.Start();
+        return sendResponse("Render profiling started.", "msg", 200, false);
+    } else if (cmd == "stopRenderProfile") {
+        RenderProfiler::INSTANCE.Stop();
+        auto file = params["file"];
+        if (!file.empty()) {
+            wxFileName summary(file);
+            summary.SetExt("txt");
+            if (!RenderProfiler::INSTANCE.WriteChromeTrace(file) || !RenderProfiler::INSTANCE.WriteSummary(summary.GetFullPath().ToStdString())) {
+                return sendResponse("Unable to save render profile.", "msg", 503, false);
+            }
+        }
+        wxString summary = JSONSafe(RenderProfiler::INSTANCE.GetSummary());
+        summary.Replace("\n", "\\n");
+        std::string response = wxString::Format("{\"msg\":\"Render profiling stopped.\",\"summary\":\"%s\"}", summary);
+        return sendResponse(response, "", 200, true);
     } else if (cmd == "batchRender") {
         wxArrayString files;
 
@@ -66,6 +66,7 @@
 #include "../Discovery.h"
 #include "../utils/CurlManager.h"
 #include "../utils/ip_utils.h"
+#include "FPPUploadManifest.h"
 
 #include "Falcon.h"
 #include "Minleon.h"
@@ -191,6 +192,7 @@ struct FPPWriteData {
             totalWritten += t;
 
             if (instance) {
+                instance->reportBytesSent(t);
                 size_t donePct = totalWritten;
                 donePct *= 1000;
                 donePct /= file->Length();
@@ -647,6 +649,12 @@ bool FPP::updateProgress(int val, bool yield) {
     return false;
 }
 
+void FPP::reportBytesSent(uint64_t bytes) {
+    if (progressDialog) {
+        progressDialog->addBytesSent(bytes);
+    }
+}
+
 
 bool FPP::uploadFile(const std::string &utfFilename, const std::string &file) {
     static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
@@ -797,7 +805,11 @@ public:
     FPP *instance;
     size_t length;
 
+    std::string manifestKey;
+    FPPUploadManifest manifest;
+
     size_t offset = 0;
+    size_t reported = 0; // furthest byte counted as sent, a retry from the start doesn't count again
     int lastPct = 0;
     int errorCount = 0;
     
@@ -813,6 +825,11 @@ int progress_callback(void *clientp,
                       curl_off_t ulnow) {
     V7ProgressStruct *p = (V7ProgressStruct*)clientp;
     if (p->instance) {
+        size_t sent = p->offset + ulnow;
+        if (sent > p->reported) {
+            p->instance->reportBytesSent(sent - p->reported);
+            p->reported = sent;
+        }
         size_t start = p->offset;
         start += ulnow;
         start *= 1000;
@@ -880,15 +897,18 @@ void prepareCurlForMulti(V7ProgressStruct *ps) {
         logger_curl.info("    FPPConnect CURL Callbak - URL: %s    Response: %d", ps->fullUrl.c_str(), response_code);
         bool cancelled = false;
         if (response_code != 200 && ps->errorCount < 3) {
-            // strange error on upload, let's restart and try again (up to three attempts)
+            // strange error on upload (or the player no longer has the start of a resumed upload),
+            // let's restart and try again (up to three attempts)
             ps->offset = 0;
             ps->in.Seek(0);
             ++ps->errorCount;
+            FPPUploadManifest::Record(ps->manifestKey, ps->manifest, 0);
         } else if (response_code != 200) {
             ps->instance->messages.push_back("ERROR Uploading file: " + ps->filename + ". Response code: " + std::to_string(response_code));
             cancelled = true;
         } else {
             ps->offset += remaining;
+            FPPUploadManifest::Record(ps->manifestKey, ps->manifest, ps->offset);
         }
         uint64_t pct = (ps->offset * 1000) / ps->length;
         cancelled |= ps->instance->updateProgress(pct, false);
@@ -904,6 +924,7 @@ void prepareCurlForMulti(V7ProgressStruct *ps) {
 bool FPP::uploadFileV7(const std::string &filename,
                        const std::string &file,
                        const std::string &dir) {
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
     bool cancelled = false;
 
     V7ProgressStruct *ps = new V7ProgressStruct();
@@ -925,6 +946,55 @@ bool FPP::uploadFileV7(const std::string &filename,
         if (progressDialog != nullptr) {
             cancelled |= updateProgress(0, true);
         }
+
+        ps->manifestKey = ipAddress + "/" + dir + "/" + filename;
+        ps->manifest = FPPUploadManifest::ForData(ps->length, [ps](uint8_t* buf, size_t size) {
+            ssize_t read = ps->in.Read(buf, size);
+            return read > 0 ? (size_t)read : 0;
+        });
+        ps->in.Seek(0);
+        FPPUploadManifest last;
+        bool haveLast = FPPUploadManifest::Find(ps->manifestKey, last);
+        if (haveLast && ps->manifest.IsUploaded(last)) {
+            // sent this exact file before, skip it if the player still has it
+            std::string url = ipAddress + "/api/files/" + dir;
+            if (!_fppProxy.empty()) {
+                url = "http://" + _fppProxy + "/proxy/" + url;
+            } else {
+                url = "http://" + url;
+            }
+            CurlManager::INSTANCE.addGet(url, [ps](int rc, const std::string& resp) {
+                bool present = false;
+                if (rc == 200) {
+                    wxJSONValue files;
+                    wxJSONReader reader;
+                    reader.Parse(resp, &files);
+                    for (int x = 0; x < files["files"].Size() && !present; x++) {
+                        wxJSONValue f = files["files"][x];
+                        present = ToUTF8(f["name"].AsString()) == ps->filename &&
+                                  f["sizeBytes"].AsInt64() == (wxInt64)ps->length;
+                    }
+                }
+                if (present) {
+                    logger_base.info("FPPConnect %s is unchanged since it was last uploaded, skipping.", ps->manifestKey.c_str());
+                    ps->instance->updateProgress(1000, false);
+                    delete ps;
+                } else {
+                    prepareCurlForMulti(ps);
+                }
+            });
+            return cancelled;
+        }
+        // FPP moves an upload into place once it has all of it, so only an interrupted upload can be
+        // carried on. A file that changed after it was fully sent has to be sent again from the start.
+        size_t resume = haveLast ? ps->manifest.ResumeOffset(last) : 0;
+        if (resume > 0) {
+            // an earlier upload of this file was interrupted, carry on from the last block it got that is unchanged
+            ps->offset = resume;
+            ps->reported = ps->offset;
+            ps->in.Seek(ps->offset);
+            logger_base.info("FPPConnect resuming upload of %s at %zu of %zu bytes.", ps->manifestKey.c_str(), ps->offset, ps->length);
+        }
         prepareCurlForMulti(ps);
     } else {
         delete ps;
@@ -1064,10 +1134,13 @@ bool FPP::PrepareUploadSequence(FSEQFile *file,
         delete outputFile;
     }
     outputFile = nullptr;
-    if (tempFileName != "") {
+    if (tempFileName != "" && sharedEncoder == nullptr) {
         ::wxRemoveFile(tempFileName);
-        tempFileName = "";
     }
+    tempFileName = "";
+    uploadKey = "";
+    sharedEncoder = nullptr;
+    sharedUsers = 0;
 
     updateProgress(0, true);
     wxFileName fn(FromUTF8(seq));
@@ -1222,26 +1295,59 @@ bool FPP::PrepareUploadSequence(FSEQFile *file,
             }
         }
     }
+    bool minorFeatures = fppType == FPP_TYPE::FPP && IsVersionAtLeast(7, 0);
     outputFile = FSEQFile::createFSEQFile(fileName, type == 0 ? 1 : 2, ctype, clevel);
     outputFileIsOriginal = false;
     outputFile->initializeFromFSEQ(*file);
-    if (fppType == FPP_TYPE::FPP && IsVersionAtLeast(7, 0)) {
+    if (minorFeatures) {
         outputFile->enableMinorVersionFeatures(2);
     }
+    uploadKey = baseName + "|" + std::to_string((int)fppType) + "|" + std::to_string(type == 0 ? 1 : 2)
+        + "|" + std::to_string((int)ctype) + "|" + std::to_string(clevel) + "|" + (minorFeatures ? "2" : "0");
     if (type >= 2 && !newRanges.empty()) {
         for (auto &a : newRanges) {
             ((V2FSEQFile*)outputFile)->m_sparseRanges.push_back(a);
+            uploadKey += "|" + std::to_string(a.first) + "-" + std::to_string(a.second);
         }
     }
     outputFile->writeHeader();
     return false;
 }
 
+int FPP::ShareUploadSequences(const std::list<FPP*>& instances) {
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    // the first instance in the list with a given key does the encode, FPPConnect
+    // finalizes in list order so the file is complete before any sharer uploads it
+    std::map<std::string, FPP*> encoders;
+    int shared = 0;
+    for (auto inst : instances) {
+        if (!inst->NeedCustomSequence() || inst->sharedEncoder != nullptr || inst->uploadKey.empty()) {
+            continue;
+        }
+        auto it = encoders.find(inst->uploadKey);
+        if (it == encoders.end()) {
+            encoders[inst->uploadKey] = inst;
+            continue;
+        }
+        FPP* encoder = it->second;
+        delete inst->outputFile;
+        inst->outputFile = nullptr;
+        ::wxRemoveFile(inst->tempFileName);
+        inst->tempFileName = encoder->tempFileName;
+        inst->sharedEncoder = encoder;
+        encoder->sharedUsers++;
+        shared++;
+        logger_base.debug("FPPConnect %s will upload the sequence encoded for %s.", inst->ipAddress.c_str(), encoder->ipAddress.c_str());
+    }
+    return shared;
+}
+
 bool FPP::WillUploadSequence() const {
-    return outputFile != nullptr;
+    return outputFile != nullptr || sharedEncoder != nullptr;
 }
 bool FPP::NeedCustomSequence() const {
-    return outputFile != nullptr && !outputFileIsOriginal;
+    return (outputFile != nullptr && !outputFileIsOriginal) || sharedEncoder != nullptr;
 }
 bool FPP::AddFrameToUpload(uint32_t frame, uint8_t *data) {
     if (outputFile && !outputFileIsOriginal) {
@@ -1252,8 +1358,8 @@ bool FPP::AddFrameToUpload(uint32_t frame, uint8_t *data) {
 
 bool FPP::FinalizeUploadSequence() {
     bool cancelled = false;
-    if (outputFile) {
-        if (!outputFileIsOriginal) {
+    if (outputFile || sharedEncoder) {
+        if (outputFile && !outputFileIsOriginal) {
             outputFile->finalize();
             delete outputFile;
         }
@@ -1264,18 +1370,40 @@ bool FPP::FinalizeUploadSequence() {
                 directory = "effects";
             }
             cancelled = uploadOrCopyFile(baseSeqName, tempFileName, directory);
-            if (!outputFileIsOriginal) {
-                ::wxRemoveFile(tempFileName);
-            }
-            tempFileName = "";
+            ReleaseTempSequence();
             outputFileIsOriginal = false;
         }
+        sharedEncoder = nullptr;
     } else {
         updateProgress(1000, false);
     }
     return cancelled;
 }
 
+void FPP::ReleaseTempSequence() {
+    if (tempFileName != "" && !outputFileIsOriginal) {
+        // a shared file is removed by whichever instance is done with it last
+        if (sharedEncoder != nullptr) {
+            if (--sharedEncoder->sharedUsers == 0 && sharedEncoder->tempFileName.empty()) {
+                ::wxRemoveFile(tempFileName);
+            }
+        } else if (sharedUsers == 0) {
+            ::wxRemoveFile(tempFileName);
+        }
+    }
+    tempFileName = "";
+    sharedEncoder = nullptr;
+}
+
+void FPP::AbandonUploadSequence() {
+    if (outputFile && !outputFileIsOriginal) {
+        delete outputFile;
+    }
+    outputFile = nullptr;
+    ReleaseTempSequence();
+    outputFileIsOriginal = false;
+}
+
 static bool PlaylistContainsEntry(wxJSONValue &pl, const std::string &media, const std::string &seq) {
     for (int x = 0; x < pl.Size(); x++) {
         wxJSONValue entry = pl[x];
@@ -64,6 +64,7 @@ class FPP : public BaseController
     wxWindow *parent = nullptr;
     void setProgress(FPPUploadProgressDialog*d, wxGauge *g) { progressDialog = d; progress = g; }
     bool updateProgress(int val, bool yield);
+    void reportBytesSent(uint64_t bytes);
 
     
     std::list<std::string> messages;
@@ -90,8 +91,15 @@ class FPP : public BaseController
     bool NeedCustomSequence() const;
     bool AddFrameToUpload(uint32_t frame, uint8_t *data);
     bool FinalizeUploadSequence();
+    // gives up on a prepared upload that will not be finalized, releasing any shared encode
+    void AbandonUploadSequence();
     std::string GetTempFile() const { return tempFileName; }
     void ClearTempFile() { tempFileName = ""; }
+
+    // After PrepareUploadSequence has been called on each instance, points instances
+    // that would produce byte identical FSEQ files at the first one so it is only
+    // encoded once. Returns the number of encodes saved.
+    static int ShareUploadSequences(const std::list<FPP*>& instances);
 #endif
     bool supportedForFPPConnect() const;
 
@@ -201,6 +209,10 @@ private:
     std::string baseSeqName;
     FSEQFile *outputFile = nullptr;
     bool outputFileIsOriginal = false;
+    std::string uploadKey;           // identifies the encoded file settings, instances with the same key share one encode
+    FPP *sharedEncoder = nullptr;    // instance encoding the file this one will upload
+    int sharedUsers = 0;             // number of instances uploading the file this one encodes
+    void ReleaseTempSequence();
 
     CURL *setupCurl(const std::string &url, bool isGet = true, int timeout = 30000);
     std::string curlInputBuffer;
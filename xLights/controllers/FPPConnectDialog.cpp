@@ -13,6 +13,7 @@
 #include "FPPConnectDialog.h"
 #include "xLightsMain.h"
 #include "FPP.h"
+#include "FPPUploadManifest.h"
 #include "xLightsXmlFile.h"
 #include "outputs/Output.h"
 #include "outputs/OutputManager.h"
@@ -911,6 +912,8 @@ void FPPConnectDialog::OnButton_UploadClick(wxCommandEvent& event)
 void FPPConnectDialog::doUpload(FPPUploadProgressDialog *prgs, std::vector<bool> doUpload) {
     static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
     xLightsFrame* frame = static_cast<xLightsFrame*>(GetParent());
+    // kept with the show so unchanged files are still skipped after a restart
+    FPPUploadManifest::SetFile(ToUTF8(xLightsFrame::CurrentDir + wxFileName::GetPathSeparator() + "xlights_fppuploads.dat"));
     std::map<int, int> udpRanges;
     wxJSONValue outputs = FPP::CreateUniverseFile(_outputManager->GetControllers(), false, &udpRanges);
     int pw, ph;
@@ -1038,6 +1041,20 @@ void FPPConnectDialog::doUpload(FPPUploadProgressDialog *prgs, std::vector<bool>
                 while (CurlManager::INSTANCE.processCurls()) {
                     wxYield();
                 }
+                // instances needing identical files only encode it once
+                int sharedCount = cancelled ? 0 : FPP::ShareUploadSequences(instances);
+                if (sharedCount) {
+                    logger_base.debug("FPPConnect %d FSEQ encodes shared for %s.", sharedCount, fseq.c_str());
+                }
+                // instances skipped by a cancel still have to let go of their temp file, shared or not
+                struct UploadReleaser {
+                    const std::list<FPP*>& instances;
+                    ~UploadReleaser() {
+                        for (const auto& inst : instances) {
+                            inst->AbandonUploadSequence();
+                        }
+                    }
+                } releaser{ instances };
                 row = 0;
                 for (const auto& inst : instances) {
                     if (!cancelled && doUpload[row]) {
@@ -1103,6 +1120,7 @@ void FPPConnectDialog::doUpload(FPPUploadProgressDialog *prgs, std::vector<bool>
                     }
                     row = 0;
                     prgs->setActionLabel("Uploading " + wxFileName(ToWXString(fseq)).GetFullName());
+                    prgs->resetThroughput();
                     for (const auto& inst : instances) {
                         inst->updateProgress(0, false);
                     }
@@ -0,0 +1,187 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include "FPPUploadManifest.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#define FPP_UPLOAD_MANIFEST_HEADER "xLights FPP upload manifests 1"
+
+namespace
+{
+    std::mutex manifestLock;
+    std::string manifestFile;
+    std::map<std::string, FPPUploadManifest> manifests;
+
+    std::filesystem::path ToPath(const std::string& utf8)
+    {
+        return std::filesystem::path(std::u8string(utf8.begin(), utf8.end()));
+    }
+
+    // FNV-1a a word at a time, it only has to notice a block changing
+    uint64_t HashBlock(const uint8_t* data, size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t w;
+            memcpy(&w, data + i, sizeof(w));
+            hash ^= w;
+            hash *= 0x100000001b3ULL;
+        }
+        for (; i < size; i++) {
+            hash ^= data[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    // must hold manifestLock
+    void Load()
+    {
+        manifests.clear();
+        std::ifstream in(ToPath(manifestFile));
+        std::string line;
+        if (!std::getline(in, line) || line != FPP_UPLOAD_MANIFEST_HEADER) {
+            return;
+        }
+        // each manifest is its key on one line then its length, uploaded, block count and blocks on the next
+        std::string key;
+        while (std::getline(in, key) && std::getline(in, line)) {
+            std::istringstream ss(line);
+            FPPUploadManifest m;
+            size_t count = 0;
+            if (!(ss >> m.length >> m.uploaded >> count) || count != (m.length + FPPUploadManifest::BLOCK_SIZE - 1) / FPPUploadManifest::BLOCK_SIZE) {
+                // damaged, better to send everything again than to skip something that changed
+                manifests.clear();
+                return;
+            }
+            m.blocks.resize(count);
+            for (auto& b : m.blocks) {
+                if (!(ss >> std::hex >> b)) {
+                    manifests.clear();
+                    return;
+                }
+            }
+            manifests[key] = std::move(m);
+        }
+    }
+
+    // must hold manifestLock
+    void Save()
+    {
+        if (manifestFile.empty()) {
+            return;
+        }
+        // written under another name first so a crash never leaves half a file
+        std::filesystem::path file = ToPath(manifestFile);
+        std::filesystem::path temp = ToPath(manifestFile + ".tmp");
+        {
+            std::ofstream out(temp, std::ios::trunc);
+            out << FPP_UPLOAD_MANIFEST_HEADER << "\n";
+            for (const auto& it : manifests) {
+                out << it.first << "\n" << it.second.length << " " << it.second.uploaded << " " << it.second.blocks.size() << std::hex;
+                for (auto b : it.second.blocks) {
+                    out << " " << b;
+                }
+                out << std::dec << "\n";
+            }
+            if (!out.good()) {
+                out.close();
+                std::error_code ec;
+                std::filesystem::remove(temp, ec);
+                return;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(temp, file, ec);
+    }
+}
+
+FPPUploadManifest FPPUploadManifest::ForData(uint64_t length, const std::function<size_t(uint8_t* buf, size_t size)>& read)
+{
+    FPPUploadManifest m;
+    m.length = length;
+    m.blocks.reserve((length + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    std::vector<uint8_t> buf(BLOCK_SIZE);
+    for (uint64_t pos = 0; pos < length; pos += BLOCK_SIZE) {
+        size_t want = (size_t)std::min((uint64_t)BLOCK_SIZE, length - pos);
+        size_t size = std::min(read(buf.data(), want), want);
+        m.blocks.push_back(HashBlock(buf.data(), size));
+    }
+    return m;
+}
+
+uint64_t FPPUploadManifest::MatchingPrefix(const FPPUploadManifest& other) const
+{
+    size_t b = 0;
+    while (b < blocks.size() && b < other.blocks.size() && blocks[b] == other.blocks[b]) {
+        ++b;
+    }
+    if (b == blocks.size() && length == other.length) {
+        return length;
+    }
+    return b * (uint64_t)BLOCK_SIZE;
+}
+
+bool FPPUploadManifest::IsUploaded(const FPPUploadManifest& last) const
+{
+    return last.uploaded >= last.length && MatchingPrefix(last) == length;
+}
+
+uint64_t FPPUploadManifest::ResumeOffset(const FPPUploadManifest& last) const
+{
+    // the player only has the start of an upload it has not finished
+    if (last.length != length || last.uploaded == 0 || last.uploaded >= last.length) {
+        return 0;
+    }
+    return std::min(MatchingPrefix(last), last.uploaded);
+}
+
+void FPPUploadManifest::SetFile(const std::string& file)
+{
+    std::unique_lock<std::mutex> lock(manifestLock);
+    if (file == manifestFile) {
+        return;
+    }
+    manifestFile = file;
+    Load();
+}
+
+bool FPPUploadManifest::Find(const std::string& key, FPPUploadManifest& manifest)
+{
+    std::unique_lock<std::mutex> lock(manifestLock);
+    auto it = manifests.find(key);
+    if (it == manifests.end()) {
+        return false;
+    }
+    manifest = it->second;
+    return true;
+}
+
+void FPPUploadManifest::Record(const std::string& key, const FPPUploadManifest& manifest, uint64_t uploaded)
+{
+    if (key.find('\n') != std::string::npos) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(manifestLock);
+    FPPUploadManifest& m = manifests[key];
+    if (m.blocks != manifest.blocks || m.length != manifest.length) {
+        m = manifest;
+    }
+    m.uploaded = uploaded;
+    Save();
+}
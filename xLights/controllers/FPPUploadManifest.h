@@ -0,0 +1,47 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Block hashes of what was last sent to a player, so a file that has not changed is not
+// sent again and an upload that was interrupted carries on from where it stopped.
+//
+// The manifests of every player are kept in one file, normally in the show folder, so
+// this still works after xLights is restarted. A player only keeps a partial upload until
+// it is finished, so a file that changed after it was fully sent is sent again from the start.
+class FPPUploadManifest
+{
+public:
+    static constexpr size_t BLOCK_SIZE = 1024 * 1024;
+
+    uint64_t length = 0;
+    uint64_t uploaded = 0; // bytes the player has acknowledged
+    std::vector<uint64_t> blocks;
+
+    // read fills buf with up to size bytes of the file and returns how many it got
+    static FPPUploadManifest ForData(uint64_t length, const std::function<size_t(uint8_t* buf, size_t size)>& read);
+
+    // number of bytes from the start that are the same in both
+    uint64_t MatchingPrefix(const FPPUploadManifest& other) const;
+    // last was this exact file and the player acknowledged all of it
+    bool IsUploaded(const FPPUploadManifest& last) const;
+    // where to carry on if last is an interrupted upload of this file, 0 to send it all
+    uint64_t ResumeOffset(const FPPUploadManifest& last) const;
+
+    // the file the manifests are kept in as UTF-8, empty keeps them in memory only
+    static void SetFile(const std::string& file);
+    static bool Find(const std::string& key, FPPUploadManifest& manifest);
+    static void Record(const std::string& key, const FPPUploadManifest& manifest, uint64_t uploaded);
+};
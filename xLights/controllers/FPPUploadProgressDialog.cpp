@@ -11,6 +11,7 @@
 const long FPPUploadProgressDialog::ID_STATICTEXT1 = wxNewId();
 const long FPPUploadProgressDialog::ID_SCROLLEDWINDOW1 = wxNewId();
 const long FPPUploadProgressDialog::ID_BUTTON1 = wxNewId();
+const long FPPUploadProgressDialog::ID_STATICTEXT2 = wxNewId();
 //*)
 
 BEGIN_EVENT_TABLE(FPPUploadProgressDialog,wxDialog)
@@ -40,6 +41,8 @@ FPPUploadProgressDialog::FPPUploadProgressDialog(wxWindow* parent,wxWindowID id)
     FlexGridSizer2 = new wxFlexGridSizer(0, 3, 0, 0);
     CancelButton = new wxButton(this, ID_BUTTON1, _("Cancel"), wxDefaultPosition, wxDefaultSize, 0, wxDefaultValidator, _T("ID_BUTTON1"));
     FlexGridSizer2->Add(CancelButton, 1, wxALL|wxALIGN_CENTER_HORIZONTAL|wxALIGN_CENTER_VERTICAL, 5);
+    ThroughputLabel = new wxStaticText(this, ID_STATICTEXT2, wxEmptyString, wxDefaultPosition, wxDefaultSize, 0, _T("ID_STATICTEXT2"));
+    FlexGridSizer2->Add(ThroughputLabel, 1, wxALL|wxALIGN_LEFT|wxALIGN_CENTER_VERTICAL, 5);
     FlexGridSizer1->Add(FlexGridSizer2, 1, wxALL|wxEXPAND, 5);
     SetSizer(FlexGridSizer1);
     Fit();
@@ -47,6 +50,7 @@ FPPUploadProgressDialog::FPPUploadProgressDialog(wxWindow* parent,wxWindowID id)
     Connect(ID_BUTTON1, wxEVT_COMMAND_BUTTON_CLICKED, (wxObjectEventFunction)&FPPUploadProgressDialog::OnCancelButtonClick);
     //*)
     SetEscapeId(ID_BUTTON1);
+    resetThroughput();
     
     FlexGridSizer1->SetSizeHints(this);
 }
@@ -80,3 +84,30 @@ wxGauge *FPPUploadProgressDialog::addGauge(const std::string &name) {
     g->SetRange(1000);
     return g;
 }
+
+void FPPUploadProgressDialog::resetThroughput() {
+    bytesSent = 0;
+    bytesAtLastUpdate = 0;
+    startTime = std::chrono::steady_clock::now();
+    lastUpdate = startTime;
+}
+
+void FPPUploadProgressDialog::addBytesSent(uint64_t bytes) {
+    bytesSent += bytes;
+
+    // only refresh a couple of times a second, this is called for every block curl sends
+    auto now = std::chrono::steady_clock::now();
+    auto sinceLast = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastUpdate).count();
+    if (sinceLast < 500) {
+        return;
+    }
+    auto total = std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count();
+    constexpr double MB = 1024.0 * 1024.0;
+    double current = (double)(bytesSent - bytesAtLastUpdate) * 1000.0 / sinceLast / MB;
+    double average = total > 0 ? (double)bytesSent * 1000.0 / total / MB : 0.0;
+    lastUpdate = now;
+    bytesAtLastUpdate = bytesSent;
+
+    ThroughputLabel->SetLabel(wxString::Format("Sent %.1f MB at %.2f MB/s (average %.2f MB/s)", bytesSent / MB, current, average));
+    Layout();
+}
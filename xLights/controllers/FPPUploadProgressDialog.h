@@ -9,6 +9,9 @@
 #include <wx/stattext.h>
 //*)
 
+#include <chrono>
+#include <cstdint>
+
 class wxGauge;
 
 class FPPUploadProgressDialog: public wxDialog
@@ -23,21 +26,31 @@ class FPPUploadProgressDialog: public wxDialog
         wxFlexGridSizer* scrolledWindowSizer;
         wxScrolledWindow* scrolledWindow;
         wxStaticText* ActionLabel;
+        wxStaticText* ThroughputLabel;
         //*)
 
         bool isCancelled() const {return cancelled;}
         void setActionLabel(const std::string &action);
         wxGauge *addGauge(const std::string &name);
+
+        // aggregate bytes sent across all the concurrent uploads
+        void addBytesSent(uint64_t bytes);
+        void resetThroughput();
     protected:
 
         //(*Identifiers(FPPUploadProgressDialog)
         static const long ID_STATICTEXT1;
         static const long ID_SCROLLEDWINDOW1;
         static const long ID_BUTTON1;
+        static const long ID_STATICTEXT2;
         //*)
 
     private:
     bool cancelled = false;
+    uint64_t bytesSent = 0;
+    uint64_t bytesAtLastUpdate = 0;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point lastUpdate;
     
         //(*Handlers(FPPUploadProgressDialog)
         void OnCancelButtonClick(wxCommandEvent& event);
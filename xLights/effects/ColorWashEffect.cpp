@@ -43,7 +43,7 @@ int ColorWashEffect::DrawEffectBackground(const Effect *e, int x1, int y1, int x
         e->GetBackgroundDisplayList().addToAccumulator(x1, y1, x2-x1, y2-y1, bg);
         return e->GetBackgroundDisplayList().iconSize;
     }
-    if (e->GetSettings().GetBool("E_CHECKBOX_ColorWash_CircularPalette")) {
+    if (e->GetSettingsView().GetBool("E_CHECKBOX_ColorWash_CircularPalette")) {
         xlColorVector map(e->GetPalette());
         map.push_back(map[0]);
         bg.AddHBlendedRectangleAsTriangles(x1, y1, x2, y2, colorMask, 0, map);
@@ -34,7 +34,6 @@ class GIFImage
     bool _ok = false;
 	
 	void ReadFrameProperties();
-    int CalcFrameForTime(int msec, bool loop);
     wxPoint LoadRawImageFrame(wxImage& image, int frame, wxAnimationDisposal& disposal);
     void CopyImageToImage(wxImage& to, wxImage& from, wxPoint offset, bool overlay, bool dontaddtransparency = false);
     void DoCreate(const std::string& filename);
@@ -45,6 +44,10 @@ class GIFImage
 		const wxImage &GetFrame(int frame);
 		const wxImage &GetFrameForTime(int msec, bool loop);
         int GetMSUntilNextFrame(int msec, bool loop);
+        // the frame showing at msec, -1 if that is past the end and not looping
+        int CalcFrameForTime(int msec, bool loop);
+        int GetFrameCount() const { return (int)_frameImages.size(); }
+        wxSize GetSize() const { return _gifSize; }
         std::string GetFilename() const { return _filename; }
         bool IsOk() const { return _ok; }
 
@@ -39,7 +39,7 @@ xlEffectPanel *GalaxyEffect::CreatePanel(wxWindow *parent) {
 
 int GalaxyEffect::DrawEffectBackground(const Effect *e, int x1, int y1, int x2, int y2,
                                        xlVertexColorAccumulator &backgrounds, xlColor* colorMask, bool ramps) {
-    int head_duration = e->GetSettings().GetInt("E_SLIDER_Galaxy_Duration", 20);
+    int head_duration = e->GetSettingsView().GetInt("E_SLIDER_Galaxy_Duration", 20);
     int num_colors = e->GetPaletteSize();
     xlColor head_color = e->GetPalette()[0];
     head_color.ApplyMask(colorMask);
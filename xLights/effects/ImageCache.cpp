@@ -0,0 +1,239 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <wx/filefn.h>
+#include <wx/log.h>
+#include <wx/string.h>
+
+#include "ImageCache.h"
+#include "GIFImage.h"
+
+#include <log4cpp/Category.hh>
+
+CachedImage::CachedImage(const wxImage& image)
+{
+    if (!image.IsOk()) {
+        return;
+    }
+    _width = image.GetWidth();
+    _height = image.GetHeight();
+    size_t pixels = (size_t)_width * _height;
+    _rgb.resize(pixels * 3);
+    memcpy(&_rgb[0], image.GetData(), _rgb.size());
+    if (image.HasAlpha()) {
+        _alpha.resize(pixels);
+        memcpy(&_alpha[0], image.GetAlpha(), _alpha.size());
+    }
+}
+
+wxImage CachedImage::GetImage() const
+{
+    if (_rgb.empty()) {
+        return wxImage();
+    }
+    // static data so wx neither copies nor frees it
+    return wxImage(_width, _height, const_cast<unsigned char*>(&_rgb[0]),
+                   _alpha.empty() ? nullptr : const_cast<unsigned char*>(&_alpha[0]), true);
+}
+
+namespace
+{
+    struct Entry {
+        std::mutex lock; // held while loading, and for gifs while composing frames
+        bool loaded = false;
+        std::shared_ptr<CachedImage> image;
+        std::unique_ptr<GIFImage> gif;
+        size_t size = 0;  // worked out by the loader
+        size_t bytes = 0; // what has been added to __bytes
+        std::list<std::string>::iterator lru;
+    };
+
+    std::mutex __lock;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> __entries;
+    std::list<std::string> __lru; // most recently used first
+    size_t __bytes = 0;
+
+    std::atomic<uint64_t> __hits = 0;
+    std::atomic<uint64_t> __misses = 0;
+    std::atomic<uint64_t> __evictions = 0;
+
+    std::string FileKey(const ImageCache::File& file)
+    {
+        return file.name + "|" + std::to_string((long long)file.modified) + "|" + (file.suppressBackground ? "1" : "0");
+    }
+
+    // must hold __lock
+    void Evict(const std::string& keep)
+    {
+        while (__bytes > ImageCache::MAX_BYTES && !__lru.empty() && __lru.back() != keep) {
+            auto it = __entries.find(__lru.back());
+            __bytes -= it->second->bytes;
+            __entries.erase(it);
+            __lru.pop_back();
+            ++__evictions;
+        }
+    }
+
+    std::shared_ptr<Entry> GetEntry(const std::string& key, const std::function<void(Entry&)>& load)
+    {
+        std::shared_ptr<Entry> e;
+        {
+            std::unique_lock<std::mutex> lock(__lock);
+            auto it = __entries.find(key);
+            if (it != __entries.end()) {
+                e = it->second;
+                __lru.splice(__lru.begin(), __lru, e->lru);
+                ++__hits;
+            } else {
+                e = std::make_shared<Entry>();
+                __lru.push_front(key);
+                e->lru = __lru.begin();
+                __entries[key] = e;
+                ++__misses;
+            }
+        }
+
+        std::unique_lock<std::mutex> elock(e->lock);
+        if (!e->loaded) {
+            load(*e);
+            e->loaded = true;
+            elock.unlock();
+
+            std::unique_lock<std::mutex> lock(__lock);
+            auto it = __entries.find(key);
+            if (it != __entries.end() && it->second == e) {
+                e->bytes = e->size;
+                __bytes += e->bytes;
+                Evict(key);
+            }
+        }
+        return e;
+    }
+
+    std::shared_ptr<Entry> GetGIF(const ImageCache::File& file)
+    {
+        return GetEntry(FileKey(file) + "|gif", [&file](Entry& e) {
+            e.gif = std::make_unique<GIFImage>(file.name, file.suppressBackground);
+            // the decoder keeps every frame it has composed
+            e.size = (size_t)e.gif->GetSize().GetWidth() * e.gif->GetSize().GetHeight() * 4 * e.gif->GetFrameCount();
+        });
+    }
+}
+
+ImageCache::File ImageCache::Open(const std::string& name, bool suppressBackground)
+{
+    File file;
+    file.name = name;
+    file.suppressBackground = suppressBackground;
+    file.modified = wxFileModificationTime(name);
+    file.frames = 1;
+
+    if (GIFImage::IsGIF(name)) {
+        auto e = GetGIF(file);
+        if (e->gif->IsOk() && e->gif->GetFrameCount() > 1) {
+            file.frames = e->gif->GetFrameCount();
+        }
+    }
+    return file;
+}
+
+std::shared_ptr<CachedImage> ImageCache::GetImage(const File& file, int frame, int width, int height, wxImageResizeQuality quality)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    if (file.frames <= 1) {
+        frame = 0;
+    } else if (frame >= file.frames) {
+        frame = file.frames - 1;
+    }
+    if (frame < 0) {
+        frame = 0;
+    }
+
+    std::string key = FileKey(file) + "|" + std::to_string(frame);
+    if (width > 0 && height > 0) {
+        key += "|" + std::to_string(width) + "x" + std::to_string(height) + "|" + std::to_string((int)quality);
+    }
+
+    auto e = GetEntry(key, [&](Entry& e) {
+        wxLogNull logNo; // suppress popups from png images. See http://trac.wxwidgets.org/ticket/15331
+        if (width > 0 && height > 0) {
+            auto raw = GetImage(file, frame);
+            if (raw != nullptr) {
+                if (raw->GetWidth() == width && raw->GetHeight() == height) {
+                    e.image = raw;
+                } else {
+                    e.image = std::make_shared<CachedImage>(raw->GetImage().Scale(width, height, quality));
+                }
+            }
+        } else if (file.frames > 1) {
+            auto g = GetGIF(file);
+            std::unique_lock<std::mutex> lock(g->lock);
+            e.image = std::make_shared<CachedImage>(g->gif->GetFrame(frame));
+        } else {
+            wxImage image;
+            if (image.LoadFile(file.name, wxBITMAP_TYPE_ANY, 0)) {
+                e.image = std::make_shared<CachedImage>(image);
+            } else {
+                logger_base.error("Error loading image file: %s.", (const char*)file.name.c_str());
+            }
+        }
+        if (e.image != nullptr && e.image->GetBytes() == 0) {
+            e.image = nullptr;
+        }
+        e.size = e.image != nullptr ? e.image->GetBytes() : 0;
+    });
+    return e->image;
+}
+
+int ImageCache::GetFrameForTime(const File& file, int msec, bool loop)
+{
+    if (file.frames <= 1) {
+        return 0;
+    }
+    // the frame timings are fixed once the gif is read so need no lock
+    return GetGIF(file)->gif->CalcFrameForTime(msec, loop);
+}
+
+ImageCache::Stats ImageCache::GetStats()
+{
+    Stats s;
+    s.hits = __hits;
+    s.misses = __misses;
+    s.evictions = __evictions;
+    std::unique_lock<std::mutex> lock(__lock);
+    s.entries = __entries.size();
+    s.bytes = __bytes;
+    return s;
+}
+
+std::string ImageCache::GetStatsString()
+{
+    Stats s = GetStats();
+    return wxString::Format("Image cache: %d images, %.1fMB, %llu hits, %llu misses, %llu evicted.",
+                            (int)s.entries, s.bytes / (1024.0 * 1024.0), (unsigned long long)s.hits,
+                            (unsigned long long)s.misses, (unsigned long long)s.evictions)
+        .ToStdString();
+}
+
+void ImageCache::Clear()
+{
+    std::unique_lock<std::mutex> lock(__lock);
+    __entries.clear();
+    __lru.clear();
+    __bytes = 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <wx/image.h>
+
+// Decoded pixels held by the ImageCache. Never modified once created so any number
+// of render threads can read one at the same time.
+class CachedImage
+{
+public:
+    CachedImage(const wxImage& image);
+
+    int GetWidth() const { return _width; }
+    int GetHeight() const { return _height; }
+    size_t GetBytes() const { return _rgb.size() + _alpha.size(); }
+
+    // A wxImage reading these pixels in place. It must be treated as read only and
+    // must not be used after the last shared_ptr to this CachedImage goes away.
+    wxImage GetImage() const;
+
+private:
+    int _width = 0;
+    int _height = 0;
+    std::vector<unsigned char> _rgb;
+    std::vector<unsigned char> _alpha;
+};
+
+// Process wide cache of decoded and scaled images so every effect, layer and render
+// thread showing the same file shares one copy of it rather than each decoding and
+// rescaling its own. Entries are keyed on the file's modified time so an edited file
+// is picked up on the next load. Different images load concurrently, threads asking
+// for one that is already loading wait for it. Least recently used entries are dropped
+// once MAX_BYTES is exceeded, anyone still holding one keeps it until they let go.
+class ImageCache
+{
+public:
+    // A version of a file, taken once when an effect (re)loads it so the
+    // per frame lookups don't have to go back to the disk.
+    struct File {
+        std::string name;
+        time_t modified = 0;
+        bool suppressBackground = true; // animated gifs only
+        int frames = 1;                 // more than 1 for animated gifs
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    static File Open(const std::string& name, bool suppressBackground = true);
+
+    // the image, or frame of an animated gif, scaled to width x height (0 for its own size)
+    // nullptr if it could not be loaded
+    static std::shared_ptr<CachedImage> GetImage(const File& file, int frame = 0, int width = 0, int height = 0,
+                                                 wxImageResizeQuality quality = wxIMAGE_QUALITY_NORMAL);
+    // the animated gif frame showing at msec, -1 if that is past the end and not looping
+    static int GetFrameForTime(const File& file, int msec, bool loop);
+
+    static Stats GetStats();
+    static std::string GetStatsString();
+    static void Clear();
+
+    static const size_t MAX_BYTES = 512 * 1024 * 1024;
+};
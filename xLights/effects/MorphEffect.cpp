@@ -148,8 +148,9 @@ void MorphEffect::SetDefaultParameters() {
 }
 
 void GetMorphEffectColors(const Effect *e, xlColor &start_h, xlColor &end_h, xlColor &start_t, xlColor &end_t) {
-    int useHeadStart = e->GetSettings().GetInt("E_CHECKBOX_MorphUseHeadStartColor", 0);
-    int useTailStart = e->GetSettings().GetInt("E_CHECKBOX_MorphUseHeadEndColor", 0);
+    SettingsView settings = e->GetSettingsView();
+    int useHeadStart = settings.GetInt("E_CHECKBOX_MorphUseHeadStartColor", 0);
+    int useTailStart = settings.GetInt("E_CHECKBOX_MorphUseHeadEndColor", 0);
 
     int hcols = 0, hcole = 1;
     int tcols = 2, tcole = 3;
@@ -184,7 +185,7 @@ void GetMorphEffectColors(const Effect *e, xlColor &start_h, xlColor &end_h, xlC
     end_t = e->GetPalette()[tcole];
 }
 int MorphEffect::DrawEffectBackground(const Effect *e, int x1, int y1, int x2, int y2, xlVertexColorAccumulator &backgrounds, xlColor* colorMask, bool ramps) {
-    int head_duration = e->GetSettings().GetInt("E_SLIDER_MorphDuration", 20);
+    int head_duration = e->GetSettingsView().GetInt("E_SLIDER_MorphDuration", 20);
     xlColor start_h;
     xlColor end_h;
     xlColor start_t;
@@ -84,8 +84,9 @@ wxString OnEffect::GetEffectString() {
 }
 
 void GetOnEffectColors(const Effect *e, xlColor &start, xlColor &end) {
-    int starti = e->GetSettings().GetInt("E_TEXTCTRL_Eff_On_Start", 100);
-    int endi = e->GetSettings().GetInt("E_TEXTCTRL_Eff_On_End", 100);
+    SettingsView settings = e->GetSettingsView();
+    int starti = settings.GetInt("E_TEXTCTRL_Eff_On_Start", 100);
+    int endi = settings.GetInt("E_TEXTCTRL_Eff_On_End", 100);
     xlColor newcolor = e->GetPalette()[0];
     if (starti == 100 && endi == 100) {
         start = end = newcolor;
@@ -104,9 +105,10 @@ int OnEffect::DrawEffectBackground(const Effect *e, int x1, int y1, int x2, int
 {
     if (ramp)
     {
-        bool shimmer = e->GetSettings().GetInt("E_CHECKBOX_On_Shimmer", 0) > 0;
-        int starti = e->GetSettings().GetInt("E_TEXTCTRL_Eff_On_Start", 100);
-        int endi = e->GetSettings().GetInt("E_TEXTCTRL_Eff_On_End", 100);
+        SettingsView settings = e->GetSettingsView();
+        bool shimmer = settings.GetInt("E_CHECKBOX_On_Shimmer", 0) > 0;
+        int starti = settings.GetInt("E_TEXTCTRL_Eff_On_Start", 100);
+        int endi = settings.GetInt("E_TEXTCTRL_Eff_On_End", 100);
         xlColor color = e->GetPalette()[0];
         color.ApplyMask(colorMask);
         int height = y2 - y1;
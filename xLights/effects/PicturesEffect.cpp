@@ -30,7 +30,7 @@
 #include "../models/Model.h"
 #include "../UtilFunctions.h"
 #include "../ExternalHooks.h"
-#include "GIFImage.h"
+#include "ImageCache.h"
 #include "../xLightsMain.h" 
 
 #include <log4cpp/Category.hh>
@@ -240,22 +240,20 @@ typedef std::vector< std::pair<wxPoint, xlColor> > PixelVector;
 
 class PicturesRenderCache : public EffectRenderCache {
 public:
-    PicturesRenderCache() : imageCount(0), frame(0),  gifImage(nullptr), maxmovieframes(0) {};
-    virtual ~PicturesRenderCache()
-    {
-        if (gifImage != nullptr) {
-            delete gifImage;
-            gifImage = nullptr;
-        }
-    };
+    PicturesRenderCache() : imageCount(0), frame(0), maxmovieframes(0), gifFrame(0) {};
+    virtual ~PicturesRenderCache() {};
 
+    // image and rawimage may read the pixels held by scaled and raw so must not outlive them
     wxImage image;
     wxImage rawimage;
     int imageCount;
     int frame;
     int maxmovieframes;
     wxString PictureName;
-    GIFImage* gifImage;
+    ImageCache::File file;
+    int gifFrame;
+    std::shared_ptr<CachedImage> raw;
+    std::shared_ptr<CachedImage> scaled;
     std::vector<PixelVector> PixelsByFrame;
 };
 
@@ -268,6 +266,27 @@ static PicturesRenderCache *GetCache(RenderBuffer &buf) {
     return cache;
 }
 
+// scaled copies come from the shared image cache so each size of each frame is only worked out once
+static wxImage GetScaledImage(PicturesRenderCache* cache, int width, int height)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (cache->raw == nullptr) {
+        wxImage image = cache->rawimage;
+        image.Rescale(width, height);
+        return image;
+    }
+    if (cache->raw->GetWidth() == width && cache->raw->GetHeight() == height) {
+        cache->scaled = nullptr;
+        return cache->rawimage;
+    }
+    cache->scaled = ImageCache::GetImage(cache->file, cache->gifFrame, width, height);
+    if (cache->scaled == nullptr) {
+        return cache->rawimage;
+    }
+    return cache->scaled->GetImage();
+}
+
 //Vixen channel remap from Vixen 2.x back to xLights:
 //for use when you have cell-by-cell Vixen 2.x sequencing that you want to preserve in an xLights sequence
 //how it works:
@@ -290,8 +309,11 @@ void PicturesEffect::LoadPixelsFromTextFile(RenderBuffer &buffer, wxFile& debug,
     wxImage &rawimage = cache->rawimage;
     std::vector<PixelVector> &PixelsByFrame = cache->PixelsByFrame;
 
-    if (image.GetWidth() && image.GetHeight()) image.Clear(); //CAUTION: image must be non-empty to clear it (memory error otherwise)
-    if (rawimage.GetWidth() && rawimage.GetHeight()) rawimage.Clear(); //CAUTION: image must be non-empty to clear it (memory error otherwise)
+    // these may point into the shared image cache so drop them rather than clearing them
+    image = wxImage();
+    rawimage = wxImage();
+    cache->raw = nullptr;
+    cache->scaled = nullptr;
 
     if (!cache->PictureName.CmpNoCase(filename)) { wrdebug("no change: " + filename); return; }
     if (!FileExists(filename)) { wrdebug("not found: " + filename); return; }
@@ -527,7 +549,6 @@ void PicturesEffect::Render(RenderBuffer& buffer,
         //      ffmpeg -i XXXX.mts -s 16x50 XXXX-%d.jpg
 
         wxFile f;
-        GIFImage*& gifImage = cache->gifImage;
         std::vector<PixelVector>& PixelsByFrame = cache->PixelsByFrame;
         int& frame = cache->frame;
 
@@ -595,54 +616,22 @@ void PicturesEffect::Render(RenderBuffer& buffer,
             if (!FileExists(NewPictureName)) {
                 noImageFile = true;
             } else {
-                wxLogNull logNo;  // suppress popups from png images. See http://trac.wxwidgets.org/ticket/15331
-
-                // There seems to be a bug on linux where this function crashes occasionally
-#ifdef LINUX
-                logger_base.debug("About to count images in bitmap %s.", (const char*)NewPictureName.c_str());
-#endif
-                cache->imageCount = wxImage::GetImageCount(NewPictureName);
-                if (cache->imageCount <= 0) {
-                    logger_base.error("Image %s reports %d frames which is invalid. Overriding it to be 1.", (const char*)NewPictureName.c_str(), cache->imageCount);
-
-                    // override it to 1
-                    cache->imageCount = 1;
-                }
-                
-                cache->PictureName = NewPictureName;
-
-                if (cache->imageCount > 1) {
 #ifdef DEBUG_GIF
-                    logger_base.debug("Preparing GIF file for reading: %s", (const char*)NewPictureName.c_str());
+                logger_base.debug("Preparing image file for reading: %s", (const char*)NewPictureName.c_str());
 #endif
-                    if (gifImage != nullptr && gifImage->GetFilename() != NewPictureName) {
-                        delete gifImage;
-                        gifImage = nullptr;
-                    }
-                    if (gifImage == nullptr) {
-                        gifImage = new GIFImage(NewPictureName.ToStdString(), suppressGIFBackground);
-                    }
-
-                    if (!gifImage->IsOk()) {
-                        delete gifImage;
-                        gifImage = nullptr;
-                        cache->imageCount = 1;
-                        if (!image.LoadFile(NewPictureName, wxBITMAP_TYPE_ANY, 0)) {
-                            logger_base.error("Error loading image file: %s.", (const char*)NewPictureName.c_str());
-                            image.Create(5, 5, true);
-                        }
-                        rawimage = image;
-                    } else {
-                        image = gifImage->GetFrame(0);
-                        rawimage = image;
-                    }
+                // decoded once and shared with every other effect showing this file
+                cache->file = ImageCache::Open(NewPictureName.ToStdString(), suppressGIFBackground);
+                cache->imageCount = cache->file.frames;
+                cache->PictureName = NewPictureName;
+                cache->gifFrame = 0;
+                cache->scaled = nullptr;
+                cache->raw = ImageCache::GetImage(cache->file, 0);
+                if (cache->raw == nullptr) {
+                    rawimage.Create(5, 5, true);
                 } else {
-                    if (!image.LoadFile(NewPictureName, wxBITMAP_TYPE_ANY, 0)) {
-                        logger_base.error("Error loading image file: %s.", (const char*)NewPictureName.c_str());
-                        image.Create(5, 5, true);
-                    }
-                    rawimage = image;
+                    rawimage = cache->raw->GetImage();
                 }
+                image = rawimage;
             }
         }
         if (!noImageFile && !image.IsOk()) {
@@ -654,14 +643,16 @@ void PicturesEffect::Render(RenderBuffer& buffer,
             scale_image = true;
 
             if (loopGIF) {
-                image = gifImage->GetFrameForTime((buffer.curPeriod - buffer.curEffStartPer) * buffer.frameTimeInMs * frameRateAdj, true);
+                cache->gifFrame = ImageCache::GetFrameForTime(cache->file, (buffer.curPeriod - buffer.curEffStartPer) * buffer.frameTimeInMs * frameRateAdj, true);
             }
             else {
-                int ii = cache->imageCount * buffer.GetEffectTimeIntervalPosition(frameRateAdj) * 0.99;
-                image = gifImage->GetFrame(ii);
+                cache->gifFrame = cache->imageCount * buffer.GetEffectTimeIntervalPosition(frameRateAdj) * 0.99;
             }
 
-            rawimage = image;
+            cache->scaled = nullptr;
+            cache->raw = ImageCache::GetImage(cache->file, cache->gifFrame);
+            rawimage = cache->raw != nullptr ? cache->raw->GetImage() : wxImage();
+            image = rawimage;
 
             if (!rawimage.IsOk()) {
                 noImageFile = true;
@@ -689,12 +680,11 @@ void PicturesEffect::Render(RenderBuffer& buffer,
     int xoffset = (imgwidth - BufferWi) / 2; //centered if sizes don't match
 
     if (scale_to_fit == "Scale To Fit" && (BufferWi != imgwidth || BufferHt != imght)) {
-        image = rawimage;
 // work around wxWidgets image rescaling bug on windows in VS release builds
 //#ifdef __WXMSW__
 //        image.Rescale(BufferWi, BufferHt, wxIMAGE_QUALITY_BILINEAR); // I tried bicubic but it creates visual artefacts
 //#else
-        image.Rescale(BufferWi, BufferHt);
+        image = GetScaledImage(cache, BufferWi, BufferHt);
 //#endif
         imgwidth = image.GetWidth();
         imght = image.GetHeight();
@@ -702,9 +692,8 @@ void PicturesEffect::Render(RenderBuffer& buffer,
         xoffset = (imgwidth - BufferWi) / 2; //centered if sizes don't match
     }
     else if (scale_to_fit == "Scale Keep Aspect Ratio" || scale_to_fit == "Scale Keep Aspect Ratio Crop") {
-        image = rawimage;
-        float xr = (float)BufferWi / (float)image.GetWidth();
-        float yr = (float)BufferHt / (float)image.GetHeight();
+        float xr = (float)BufferWi / (float)rawimage.GetWidth();
+        float yr = (float)BufferHt / (float)rawimage.GetHeight();
         float sc = std::min(xr, yr);
         if(scale_to_fit.find("Crop") != std::string::npos)
             sc = std::max(xr, yr);
@@ -712,7 +701,7 @@ void PicturesEffect::Render(RenderBuffer& buffer,
 //#ifdef __WXMSW__
 //        image.Rescale(image.GetWidth() * sc, image.GetHeight() * sc, wxIMAGE_QUALITY_BILINEAR); // I tried bicubic but it creates visual artefacts
 //#else
-        image.Rescale(image.GetWidth() * sc, image.GetHeight() * sc);
+        image = GetScaledImage(cache, rawimage.GetWidth() * sc, rawimage.GetHeight() * sc);
 //#endif
         imgwidth = image.GetWidth();
         imght = image.GetHeight();
@@ -730,7 +719,7 @@ void PicturesEffect::Render(RenderBuffer& buffer,
 //#ifdef __WXMSW__
 //            image.Rescale(imgwidth, imght, wxIMAGE_QUALITY_BILINEAR); // I tried bicubic but it creates visual artefacts
 //#else
-            image.Rescale(imgwidth, imght);
+            image = GetScaledImage(cache, imgwidth, imght);
 //#endif
             yoffset = (BufferHt + imght) / 2; //centered if sizes don't match
             xoffset = (imgwidth - BufferWi) / 2; //centered if sizes don't match
@@ -42,7 +42,7 @@ xlEffectPanel* ShockwaveEffect::CreatePanel(wxWindow* parent)
 int ShockwaveEffect::DrawEffectBackground(const Effect* e, int x1, int y1, int x2, int y2,
                                           xlVertexColorAccumulator& backgrounds, xlColor* colorMask, bool ramps)
 {
-    int cycles = e->GetSettings().GetInt("E_SLIDER_Shockwave_Cycles", 1);
+    int cycles = e->GetSettingsView().GetInt("E_SLIDER_Shockwave_Cycles", 1);
     int totalsize = x2 - x1;
     double x_size = totalsize / (double)cycles;
     x_size = std::max(x_size, 0.01);
@@ -134,9 +134,10 @@ int TwinkleEffect::DrawEffectBackground(const Effect *e, int x1, int y1, int x2,
     if (ramp) {
         float endi;
         float starti;
-        std::string vcs = e->GetPaletteMap().Get("C_VALUECURVE_Brightness", "");
+        SettingsView palette = e->GetPaletteView();
+        std::string vcs = palette.Get("C_VALUECURVE_Brightness", "");
         if (vcs == "") {
-            starti = e->GetPaletteMap().GetInt("C_SLIDER_Brightness", 100);
+            starti = palette.GetInt("C_SLIDER_Brightness", 100);
             if (starti > 100) starti = 100;
             endi = starti;
         } else {
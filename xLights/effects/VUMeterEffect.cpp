@@ -750,7 +750,7 @@ void VUMeterEffect::RenderSpectrogramFrame(RenderBuffer &buffer, int usebars, st
             }
             else
             {
-                std::vector<float>::const_iterator newdata = pdata->vu.cbegin();
+                auto newdata = pdata->vu.cbegin();
                 std::vector<float>::iterator olddata = lastpeaks.begin();
                 auto pause = pauseuntilpeakfall.begin();
 
@@ -786,7 +786,7 @@ void VUMeterEffect::RenderSpectrogramFrame(RenderBuffer &buffer, int usebars, st
 			if (lastvalues.size() == 0) {
 				lastvalues = pdata->vu;
             } else {
-				std::vector<float>::const_iterator newdata = pdata->vu.cbegin();
+				auto newdata = pdata->vu.cbegin();
 				std::vector<float>::iterator olddata = lastvalues.begin();
 
 				while (olddata != lastvalues.end())
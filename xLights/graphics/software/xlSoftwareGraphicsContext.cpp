@@ -0,0 +1,909 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <wx/bitmap.h>
+#include <wx/image.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "xlSoftwareGraphicsContext.h"
+#include "../xlMesh.h"
+#include "../../JobPool.h"
+#include "../../Parallel.h"
+
+// CPU side accumulators, they just hold the vertices until they are drawn
+
+class xlSoftwareVertexAccumulator : public xlVertexAccumulator {
+public:
+    virtual void Reset() override { vertices.clear(); }
+    virtual void PreAlloc(unsigned int i) override { vertices.reserve(vertices.size() + i * 3); }
+    virtual void AddVertex(float x, float y, float z) override {
+        vertices.push_back(x);
+        vertices.push_back(y);
+        vertices.push_back(z);
+    }
+    virtual uint32_t getCount() override { return vertices.size() / 3; }
+    virtual void SetVertex(uint32_t vertex, float x, float y, float z) override {
+        vertices[vertex * 3] = x;
+        vertices[vertex * 3 + 1] = y;
+        vertices[vertex * 3 + 2] = z;
+    }
+
+    std::vector<float> vertices;
+};
+
+class xlSoftwareVertexColorAccumulator : public xlVertexColorAccumulator {
+public:
+    virtual void Reset() override {
+        vertices.clear();
+        colors.clear();
+    }
+    virtual void PreAlloc(unsigned int i) override {
+        vertices.reserve(vertices.size() + i * 3);
+        colors.reserve(colors.size() + i);
+    }
+    virtual void AddVertex(float x, float y, float z, const xlColor& c) override {
+        vertices.push_back(x);
+        vertices.push_back(y);
+        vertices.push_back(z);
+        colors.push_back(c);
+    }
+    virtual uint32_t getCount() override { return colors.size(); }
+    virtual void SetVertex(uint32_t vertex, float x, float y, float z, const xlColor& c) override {
+        SetVertex(vertex, x, y, z);
+        colors[vertex] = c;
+    }
+    virtual void SetVertex(uint32_t vertex, float x, float y, float z) override {
+        vertices[vertex * 3] = x;
+        vertices[vertex * 3 + 1] = y;
+        vertices[vertex * 3 + 2] = z;
+    }
+    virtual void SetVertex(uint32_t vertex, const xlColor& c) override { colors[vertex] = c; }
+
+    std::vector<float> vertices;
+    std::vector<xlColor> colors;
+};
+
+class xlSoftwareVertexIndexedColorAccumulator : public xlVertexIndexedColorAccumulator {
+public:
+    virtual void Reset() override {
+        vertices.clear();
+        indexes.clear();
+    }
+    virtual void PreAlloc(unsigned int i) override {
+        vertices.reserve(vertices.size() + i * 3);
+        indexes.reserve(indexes.size() + i);
+    }
+    virtual void AddVertex(float x, float y, float z, uint32_t cIdx) override {
+        vertices.push_back(x);
+        vertices.push_back(y);
+        vertices.push_back(z);
+        indexes.push_back(cIdx);
+    }
+    virtual uint32_t getCount() override { return indexes.size(); }
+    virtual void SetColorCount(int c) override { colors.resize(c); }
+    virtual uint32_t GetColorCount() override { return colors.size(); }
+    virtual void SetColor(uint32_t idx, const xlColor& c) override { colors[idx] = c; }
+    virtual void SetVertex(uint32_t vertex, float x, float y, float z, uint32_t cIdx) override {
+        SetVertex(vertex, x, y, z);
+        indexes[vertex] = cIdx;
+    }
+    virtual void SetVertex(uint32_t vertex, float x, float y, float z) override {
+        vertices[vertex * 3] = x;
+        vertices[vertex * 3 + 1] = y;
+        vertices[vertex * 3 + 2] = z;
+    }
+    virtual void SetVertex(uint32_t vertex, uint32_t cIdx) override { indexes[vertex] = cIdx; }
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indexes;
+    std::vector<xlColor> colors;
+};
+
+class xlSoftwareVertexTextureAccumulator : public xlVertexTextureAccumulator {
+public:
+    virtual void Reset() override {
+        vertices.clear();
+        tvertices.clear();
+    }
+    virtual void PreAlloc(unsigned int i) override {
+        vertices.reserve(vertices.size() + i * 3);
+        tvertices.reserve(tvertices.size() + i * 2);
+    }
+    virtual void AddVertex(float x, float y, float z, float tx, float ty) override {
+        vertices.push_back(x);
+        vertices.push_back(y);
+        vertices.push_back(z);
+        tvertices.push_back(tx);
+        tvertices.push_back(ty);
+    }
+    virtual uint32_t getCount() override { return tvertices.size() / 2; }
+    virtual void SetVertex(uint32_t vertex, float x, float y, float z, float tx, float ty) override {
+        vertices[vertex * 3] = x;
+        vertices[vertex * 3 + 1] = y;
+        vertices[vertex * 3 + 2] = z;
+        tvertices[vertex * 2] = tx;
+        tvertices[vertex * 2 + 1] = ty;
+    }
+
+    std::vector<float> vertices;
+    std::vector<float> tvertices;
+};
+
+// Frames hold on to the pixels they were drawn with, so a texture that is changed
+// while earlier frames are still waiting to be rasterized gets a copy of its own.
+class xlSoftwareTexture : public xlTexture {
+public:
+    xlSoftwareTexture(int w, int h) {
+        data = std::make_shared<xlSoftwareFrame::TextureData>();
+        data->width = w;
+        data->height = h;
+        data->pixels.resize(w * h, xlCLEAR);
+    }
+    xlSoftwareTexture(const wxImage& image) {
+        data = std::make_shared<xlSoftwareFrame::TextureData>();
+        data->width = image.GetWidth();
+        data->height = image.GetHeight();
+        data->pixels.resize(data->width * data->height);
+        const uint8_t* rgb = image.GetData();
+        const uint8_t* alpha = image.HasAlpha() ? image.GetAlpha() : nullptr;
+        for (size_t i = 0; i < data->pixels.size(); ++i) {
+            data->pixels[i].Set(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], alpha ? alpha[i] : 255);
+        }
+        if (alpha == nullptr && image.HasMask()) {
+            xlColor mask(image.GetMaskRed(), image.GetMaskGreen(), image.GetMaskBlue());
+            for (auto& p : data->pixels) {
+                if (p == mask) {
+                    p.alpha = 0;
+                }
+            }
+        }
+    }
+
+    virtual void UpdatePixel(int x, int y, const xlColor& c, bool copyAlpha) override {
+        if (x < 0 || y < 0 || x >= data->width || y >= data->height) {
+            return;
+        }
+        xlColor& p = Writable()->pixels[y * data->width + x];
+        p.Set(c.red, c.green, c.blue, copyAlpha ? c.alpha : p.alpha);
+    }
+    virtual void UpdateData(uint8_t* d, bool bgr, bool alpha) override {
+        auto t = Writable();
+        int bpp = alpha ? 4 : 3;
+        for (size_t i = 0; i < t->pixels.size(); ++i, d += bpp) {
+            t->pixels[i].Set(bgr ? d[2] : d[0], d[1], bgr ? d[0] : d[2], alpha ? d[3] : 255);
+        }
+    }
+
+    std::shared_ptr<xlSoftwareFrame::TextureData> data;
+
+private:
+    xlSoftwareFrame::TextureData* Writable() {
+        if (data.use_count() > 1) {
+            data = std::make_shared<xlSoftwareFrame::TextureData>(*data);
+        }
+        return data.get();
+    }
+};
+
+class xlSoftwareRasterizeJob : public Job {
+public:
+    xlSoftwareRasterizeJob(const std::shared_ptr<xlSoftwareFrame>& f) : frame(f) {}
+    virtual void Process() override { frame->Rasterize(); }
+    virtual bool DeleteWhenComplete() override { return true; }
+    virtual const std::string GetName() const override { return "Preview Rasterize"; }
+
+    std::shared_ptr<xlSoftwareFrame> frame;
+};
+
+xlSoftwareFrame::xlSoftwareFrame(int width, int height, const xlColor& background) :
+    _width(std::max(width, 1)), _height(std::max(height, 1))
+{
+    _pixels.resize(_width * _height, background);
+}
+
+uint32_t xlSoftwareFrame::AddTexture(const std::shared_ptr<const TextureData>& t)
+{
+    auto it = _textureIndex.find(t.get());
+    if (it != _textureIndex.end()) {
+        return it->second;
+    }
+    uint32_t idx = _textures.size();
+    _textures.push_back(t);
+    _textureIndex[t.get()] = idx;
+    return idx;
+}
+
+void xlSoftwareFrame::RasterizeAsync()
+{
+    ParallelJobPool::POOL.PushJob(new xlSoftwareRasterizeJob(shared_from_this()));
+}
+
+void xlSoftwareFrame::WaitUntilRasterized()
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    _signal.wait(lock, [this] { return _rasterized; });
+}
+
+void xlSoftwareFrame::Rasterize()
+{
+    _depth.assign(_width * _height, 1.0f);
+    for (const auto& p : _primitives) {
+        switch (p.type) {
+        case PrimitiveType::POINT:
+            DrawPoint(p);
+            break;
+        case PrimitiveType::LINE:
+            DrawLine(p);
+            break;
+        case PrimitiveType::TRIANGLE:
+            DrawTriangle(p);
+            break;
+        }
+    }
+    // the display list is no longer needed, only the pixels
+    std::vector<Primitive>().swap(_primitives);
+    std::vector<float>().swap(_depth);
+    _textures.clear();
+    _textureIndex.clear();
+
+    std::unique_lock<std::mutex> lock(_lock);
+    _rasterized = true;
+    _signal.notify_all();
+}
+
+inline void xlSoftwareFrame::Plot(int x, int y, float z, const xlColor& c, const Primitive& p)
+{
+    if (x < 0 || y < 0 || x >= _width || y >= _height || z < 0.0f || z > 1.0f) {
+        return;
+    }
+    int idx = y * _width + x;
+    if (p.depthTest) {
+        if (z > _depth[idx]) {
+            return;
+        }
+        _depth[idx] = z;
+    }
+    xlColor& dst = _pixels[idx];
+    if (p.blend && c.alpha != 255) {
+        int a = c.alpha;
+        int ia = 255 - a;
+        dst.red = (c.red * a + dst.red * ia) / 255;
+        dst.green = (c.green * a + dst.green * ia) / 255;
+        dst.blue = (c.blue * a + dst.blue * ia) / 255;
+        dst.alpha = (a * a + dst.alpha * ia) / 255;
+    } else {
+        dst = c;
+    }
+}
+
+void xlSoftwareFrame::DrawPoint(const Primitive& p)
+{
+    const Vertex& v = p.v[0];
+    float half = p.pointSize / 2.0f;
+    int x1 = (int)std::floor(v.x - half + 0.5f);
+    int y1 = (int)std::floor(v.y - half + 0.5f);
+    int size = std::max(1, (int)std::lround(p.pointSize));
+    for (int y = y1; y < y1 + size; ++y) {
+        for (int x = x1; x < x1 + size; ++x) {
+            xlColor c = v.c;
+            if (p.smooth) {
+                // round point, fading out over the last pixel
+                float dx = x + 0.5f - v.x;
+                float dy = y + 0.5f - v.y;
+                float d = half - std::sqrt(dx * dx + dy * dy);
+                if (d <= 0.0f) {
+                    continue;
+                }
+                if (d < 1.0f) {
+                    c.alpha = (uint8_t)(c.alpha * d);
+                }
+            }
+            Plot(x, y, v.z, c, p);
+        }
+    }
+}
+
+void xlSoftwareFrame::DrawLine(const Primitive& p)
+{
+    const Vertex& a = p.v[0];
+    const Vertex& b = p.v[1];
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    int steps = (int)std::ceil(std::max(std::abs(dx), std::abs(dy)));
+    if (steps > 4 * (_width + _height)) {
+        // mostly off screen, only walk the part that can be visible
+        steps = 4 * (_width + _height);
+    }
+    for (int i = 0; i <= steps; ++i) {
+        float t = steps == 0 ? 0.0f : (float)i / (float)steps;
+        xlColor c = a.c;
+        if (a.c != b.c || a.c.alpha != b.c.alpha) {
+            c.Set(a.c.red + (b.c.red - a.c.red) * t, a.c.green + (b.c.green - a.c.green) * t,
+                  a.c.blue + (b.c.blue - a.c.blue) * t, a.c.alpha + (b.c.alpha - a.c.alpha) * t);
+        }
+        Plot((int)std::floor(a.x + dx * t), (int)std::floor(a.y + dy * t), a.z + (b.z - a.z) * t, c, p);
+    }
+}
+
+xlColor xlSoftwareFrame::Sample(const Primitive& p, float u, float v) const
+{
+    const TextureData& t = *_textures[p.texture];
+    float fx = std::clamp(u, 0.0f, 1.0f) * t.width - 0.5f;
+    float fy = std::clamp(v, 0.0f, 1.0f) * t.height - 0.5f;
+    int x0 = std::clamp((int)std::floor(fx), 0, t.width - 1);
+    int y0 = std::clamp((int)std::floor(fy), 0, t.height - 1);
+    int x1 = std::min(x0 + 1, t.width - 1);
+    int y1 = std::min(y0 + 1, t.height - 1);
+    float ax = std::clamp(fx - x0, 0.0f, 1.0f);
+    float ay = std::clamp(fy - y0, 0.0f, 1.0f);
+
+    const xlColor& c00 = t.pixels[y0 * t.width + x0];
+    const xlColor& c10 = t.pixels[y0 * t.width + x1];
+    const xlColor& c01 = t.pixels[y1 * t.width + x0];
+    const xlColor& c11 = t.pixels[y1 * t.width + x1];
+    auto mix = [ax, ay](uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        float top = a + (b - a) * ax;
+        float bottom = c + (d - c) * ax;
+        return top + (bottom - top) * ay;
+    };
+    float r = mix(c00.red, c10.red, c01.red, c11.red);
+    float g = mix(c00.green, c10.green, c01.green, c11.green);
+    float b = mix(c00.blue, c10.blue, c01.blue, c11.blue);
+    float a = mix(c00.alpha, c10.alpha, c01.alpha, c11.alpha);
+
+    auto clamp255 = [](float f) { return (uint8_t)std::clamp(f + 0.5f, 0.0f, 255.0f); };
+    if (p.textureMode == TextureMode::MASK) {
+        return xlColor(clamp255(p.tint[0] * 255.0f), clamp255(p.tint[1] * 255.0f), clamp255(p.tint[2] * 255.0f), clamp255(p.tint[3] * a));
+    }
+    return xlColor(clamp255(r * p.tint[0]), clamp255(g * p.tint[1]), clamp255(b * p.tint[2]), clamp255(a * p.tint[3]));
+}
+
+void xlSoftwareFrame::DrawTriangle(const Primitive& p)
+{
+    // edges are walked in fixed point so the two triangles either side of an edge agree
+    // exactly on which of them each pixel along it belongs to
+    static const int SUBPIXEL_BITS = 4;
+    static const float SUBPIXELS = 1 << SUBPIXEL_BITS;
+    const Vertex* v0 = &p.v[0];
+    const Vertex* v1 = &p.v[1];
+    const Vertex* v2 = &p.v[2];
+    for (const Vertex* v : { v0, v1, v2 }) {
+        // far enough off screen that the fixed point would overflow, better to drop it
+        if (!(std::abs(v->x) < 1000000.0f && std::abs(v->y) < 1000000.0f)) {
+            return;
+        }
+    }
+    int64_t x0 = std::lround(v0->x * SUBPIXELS);
+    int64_t y0 = std::lround(v0->y * SUBPIXELS);
+    int64_t x1 = std::lround(v1->x * SUBPIXELS);
+    int64_t y1 = std::lround(v1->y * SUBPIXELS);
+    int64_t x2 = std::lround(v2->x * SUBPIXELS);
+    int64_t y2 = std::lround(v2->y * SUBPIXELS);
+    int64_t area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+    if (area == 0) {
+        return;
+    }
+    if (area < 0) {
+        // nothing is culled, just wind them all the same way
+        std::swap(v1, v2);
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+        area = -area;
+    }
+
+    int minX = std::max(0, (int)(std::min({ x0, x1, x2 }) >> SUBPIXEL_BITS));
+    int maxX = std::min(_width - 1, (int)(std::max({ x0, x1, x2 }) >> SUBPIXEL_BITS));
+    int minY = std::max(0, (int)(std::min({ y0, y1, y2 }) >> SUBPIXEL_BITS));
+    int maxY = std::min(_height - 1, (int)(std::max({ y0, y1, y2 }) >> SUBPIXEL_BITS));
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+
+    // pixels exactly on an edge belong to the triangle that owns the edge, so shared edges are only drawn once
+    auto owns = [](int64_t ax, int64_t ay, int64_t bx, int64_t by) {
+        return (by == ay && bx < ax) || by > ay;
+    };
+    bool own0 = owns(x1, y1, x2, y2);
+    bool own1 = owns(x2, y2, x0, y0);
+    bool own2 = owns(x0, y0, x1, y1);
+
+    float iw0 = 1.0f / v0->w;
+    float iw1 = 1.0f / v1->w;
+    float iw2 = 1.0f / v2->w;
+    // blended circles only vary the alpha
+    bool smoothColor = v0->c != v1->c || v0->c != v2->c || v0->c.alpha != v1->c.alpha || v0->c.alpha != v2->c.alpha;
+    float farea = (float)area;
+
+    int64_t half = 1 << (SUBPIXEL_BITS - 1);
+    for (int y = minY; y <= maxY; ++y) {
+        int64_t py = ((int64_t)y << SUBPIXEL_BITS) + half;
+        for (int x = minX; x <= maxX; ++x) {
+            int64_t px = ((int64_t)x << SUBPIXEL_BITS) + half;
+            int64_t e0 = (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1);
+            int64_t e1 = (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2);
+            int64_t e2 = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0);
+            if (e0 < 0 || e1 < 0 || e2 < 0 ||
+                (e0 == 0 && !own0) || (e1 == 0 && !own1) || (e2 == 0 && !own2)) {
+                continue;
+            }
+            float w0 = e0 / farea;
+            float w1 = e1 / farea;
+            float w2 = e2 / farea;
+            float z = w0 * v0->z + w1 * v1->z + w2 * v2->z;
+
+            // perspective correct weights for the colours and texture coordinates
+            float pw0 = w0 * iw0;
+            float pw1 = w1 * iw1;
+            float pw2 = w2 * iw2;
+            float sum = pw0 + pw1 + pw2;
+            pw0 /= sum;
+            pw1 /= sum;
+            pw2 /= sum;
+
+            xlColor c;
+            if (p.textureMode != TextureMode::NONE) {
+                c = Sample(p, pw0 * v0->u + pw1 * v1->u + pw2 * v2->u, pw0 * v0->v + pw1 * v1->v + pw2 * v2->v);
+            } else if (smoothColor) {
+                c.Set(pw0 * v0->c.red + pw1 * v1->c.red + pw2 * v2->c.red + 0.5f,
+                      pw0 * v0->c.green + pw1 * v1->c.green + pw2 * v2->c.green + 0.5f,
+                      pw0 * v0->c.blue + pw1 * v1->c.blue + pw2 * v2->c.blue + 0.5f,
+                      pw0 * v0->c.alpha + pw1 * v1->c.alpha + pw2 * v2->c.alpha + 0.5f);
+            } else {
+                c = v0->c;
+            }
+            Plot(x, y, z, c, p);
+        }
+    }
+}
+
+bool xlSoftwareFrame::GetFrameForExport(uint8_t* buffer, int bufferSize)
+{
+    bool padWidth = (_width % 2);
+    bool padHeight = (_height % 2);
+    int widthWithPadding = padWidth ? (_width + 1) : _width;
+    int heightWithPadding = padHeight ? (_height + 1) : _height;
+    int reqSize = widthWithPadding * 3 * heightWithPadding;
+    if (bufferSize < reqSize) {
+        return false;
+    }
+    WaitUntilRasterized();
+
+    unsigned char* dst = buffer;
+    if (padHeight) {
+        memset(dst, 0, widthWithPadding * 3);
+        dst += widthWithPadding * 3;
+    }
+    const xlColor* src = &_pixels[0];
+    for (int y = 0; y < _height; ++y) {
+        for (int x = 0; x < _width; ++x, ++src, dst += 3) {
+            dst[0] = src->red;
+            dst[1] = src->green;
+            dst[2] = src->blue;
+        }
+        if (padWidth) {
+            dst[0] = dst[1] = dst[2] = 0x00;
+            dst += 3;
+        }
+    }
+    return true;
+}
+
+xlSoftwareGraphicsContext::xlSoftwareGraphicsContext(wxWindow* w, int width, int height, const xlColor& background) :
+    xlGraphicsContext(w), _width(width), _height(height), _background(background), _mvp(1.0f)
+{
+    _frame = std::make_shared<xlSoftwareFrame>(_width, _height, _background);
+}
+
+xlSoftwareGraphicsContext::~xlSoftwareGraphicsContext()
+{
+}
+
+std::shared_ptr<xlSoftwareFrame> xlSoftwareGraphicsContext::TakeFrame()
+{
+    auto f = _frame;
+    _frame = std::make_shared<xlSoftwareFrame>(_width, _height, _background);
+    return f;
+}
+
+xlGraphicsContext* xlSoftwareGraphicsContext::SetViewport(int x1, int y1, int x2, int y2, bool is3D)
+{
+    if (is3D) {
+        _mvp = glm::perspective(glm::radians(45.0f), (float)(x2 - x1) / (float)(y1 - y2), 1.0f, 200000.0f);
+    } else {
+        _mvp = glm::ortho((float)x1, (float)x2, (float)y2, (float)y1);
+    }
+    // the previews always draw with a depth buffer
+    _depthTest = true;
+    return this;
+}
+
+xlVertexAccumulator* xlSoftwareGraphicsContext::createVertexAccumulator()
+{
+    return new xlSoftwareVertexAccumulator();
+}
+xlVertexColorAccumulator* xlSoftwareGraphicsContext::createVertexColorAccumulator()
+{
+    return new xlSoftwareVertexColorAccumulator();
+}
+xlVertexTextureAccumulator* xlSoftwareGraphicsContext::createVertexTextureAccumulator()
+{
+    return new xlSoftwareVertexTextureAccumulator();
+}
+xlVertexIndexedColorAccumulator* xlSoftwareGraphicsContext::createVertexIndexedColorAccumulator()
+{
+    return new xlSoftwareVertexIndexedColorAccumulator();
+}
+xlTexture* xlSoftwareGraphicsContext::createTextureMipMaps(const std::vector<wxBitmap>& bitmaps)
+{
+    // only the full size image is used, there is no mip mapping
+    if (bitmaps.empty()) {
+        return new xlSoftwareTexture(1, 1);
+    }
+    return new xlSoftwareTexture(bitmaps[0].ConvertToImage());
+}
+xlTexture* xlSoftwareGraphicsContext::createTextureMipMaps(const std::vector<wxImage>& images)
+{
+    if (images.empty()) {
+        return new xlSoftwareTexture(1, 1);
+    }
+    return new xlSoftwareTexture(images[0]);
+}
+xlTexture* xlSoftwareGraphicsContext::createTexture(const wxImage& image)
+{
+    return new xlSoftwareTexture(image);
+}
+xlTexture* xlSoftwareGraphicsContext::createTexture(int w, int h, bool bgr, bool alpha)
+{
+    return new xlSoftwareTexture(w, h);
+}
+xlTexture* xlSoftwareGraphicsContext::createTextureForFont(const xlFontInfo& font)
+{
+    return createTexture(font.getImage());
+}
+xlGraphicsProgram* xlSoftwareGraphicsContext::createGraphicsProgram()
+{
+    return new xlGraphicsProgram(createVertexColorAccumulator());
+}
+xlMesh* xlSoftwareGraphicsContext::loadMeshFromObjFile(const std::string& file)
+{
+    return new xlMesh(this, file);
+}
+
+xlGraphicsContext* xlSoftwareGraphicsContext::PushMatrix()
+{
+    _matrixStack.push(_mvp);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::PopMatrix()
+{
+    if (!_matrixStack.empty()) {
+        _mvp = _matrixStack.top();
+        _matrixStack.pop();
+    }
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::Translate(float x, float y, float z)
+{
+    _mvp = glm::translate(_mvp, glm::vec3(x, y, z));
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::Rotate(float angle, float x, float y, float z)
+{
+    _mvp = glm::rotate(_mvp, glm::radians(angle), glm::vec3(x, y, z));
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::ApplyMatrix(const glm::mat4& m)
+{
+    _mvp = _mvp * m;
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::Scale(float w, float h, float z)
+{
+    _mvp = glm::scale(_mvp, glm::vec3(w, h, z));
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::SetCamera(const glm::mat4& m)
+{
+    _mvp = _mvp * m;
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::SetModelMatrix(const glm::mat4& m)
+{
+    _mvp = _mvp * m;
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::ScaleViewMatrix(float w, float h, float z)
+{
+    _mvp = glm::scale(_mvp, glm::vec3(w, h, z));
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::TranslateViewMatrix(float x, float y, float z)
+{
+    _mvp = glm::translate(_mvp, glm::vec3(x, y, z));
+    return this;
+}
+
+xlGraphicsContext* xlSoftwareGraphicsContext::enableBlending(bool e)
+{
+    _blending = e;
+    return this;
+}
+
+xlSoftwareFrame::Vertex xlSoftwareGraphicsContext::Project(const float* pos) const
+{
+    glm::vec4 clip = _mvp * glm::vec4(pos[0], pos[1], pos[2], 1.0f);
+    xlSoftwareFrame::Vertex v;
+    v.w = clip.w;
+    if (clip.w <= 0.0f) {
+        return v;
+    }
+    v.x = (clip.x / clip.w + 1.0f) * 0.5f * _width;
+    v.y = (1.0f - clip.y / clip.w) * 0.5f * _height;
+    v.z = (clip.z / clip.w + 1.0f) * 0.5f;
+    return v;
+}
+
+void xlSoftwareGraphicsContext::Draw(Mode mode, int start, int count, const float* pos, const float* tex,
+                                     const xlColor* colors, const uint32_t* colorIndex, bool perVertexColor,
+                                     float pointSize, bool smooth)
+{
+    if (count <= 0) {
+        return;
+    }
+    xlSoftwareFrame::Primitive p;
+    p.blend = _blending;
+    p.depthTest = _depthTest;
+    p.smooth = smooth;
+    p.pointSize = pointSize;
+    p.textureMode = _textureMode;
+    p.texture = _texture;
+    if (_tint != nullptr) {
+        std::copy(_tint, _tint + 4, p.tint);
+    }
+
+    auto vertex = [&](int i) {
+        xlSoftwareFrame::Vertex v = Project(&pos[i * 3]);
+        if (tex != nullptr) {
+            v.u = tex[i * 2];
+            v.v = tex[i * 2 + 1];
+        } else if (colorIndex != nullptr) {
+            v.c = colors[colorIndex[i]];
+        } else {
+            v.c = perVertexColor ? colors[i] : colors[0];
+        }
+        return v;
+    };
+    // primitives with a vertex behind the camera are dropped rather than clipped
+    auto add = [&](int n) {
+        for (int x = 0; x < n; ++x) {
+            if (p.v[x].w <= 0.0f) {
+                return;
+            }
+        }
+        _frame->Add(p);
+    };
+
+    int end = start + count;
+    switch (mode) {
+    case Mode::POINTS:
+        p.type = xlSoftwareFrame::PrimitiveType::POINT;
+        for (int i = start; i < end; ++i) {
+            p.v[0] = vertex(i);
+            add(1);
+        }
+        break;
+    case Mode::LINES:
+        p.type = xlSoftwareFrame::PrimitiveType::LINE;
+        for (int i = start; i + 1 < end; i += 2) {
+            p.v[0] = vertex(i);
+            p.v[1] = vertex(i + 1);
+            add(2);
+        }
+        break;
+    case Mode::LINE_STRIP:
+        p.type = xlSoftwareFrame::PrimitiveType::LINE;
+        if (count > 1) {
+            p.v[1] = vertex(start);
+            for (int i = start + 1; i < end; ++i) {
+                p.v[0] = p.v[1];
+                p.v[1] = vertex(i);
+                add(2);
+            }
+        }
+        break;
+    case Mode::TRIANGLES:
+        p.type = xlSoftwareFrame::PrimitiveType::TRIANGLE;
+        for (int i = start; i + 2 < end; i += 3) {
+            p.v[0] = vertex(i);
+            p.v[1] = vertex(i + 1);
+            p.v[2] = vertex(i + 2);
+            add(3);
+        }
+        break;
+    case Mode::TRIANGLE_STRIP:
+        p.type = xlSoftwareFrame::PrimitiveType::TRIANGLE;
+        if (count > 2) {
+            xlSoftwareFrame::Vertex a = vertex(start);
+            xlSoftwareFrame::Vertex b = vertex(start + 1);
+            for (int i = start + 2; i < end; ++i) {
+                p.v[0] = a;
+                p.v[1] = b;
+                p.v[2] = vertex(i);
+                add(3);
+                a = b;
+                b = p.v[2];
+            }
+        }
+        break;
+    }
+}
+
+static int CountFrom(int start, int count, uint32_t size)
+{
+    return count < 0 ? (int)size - start : std::min(count, (int)size - start);
+}
+
+xlGraphicsContext* xlSoftwareGraphicsContext::drawLines(xlVertexAccumulator* vac, const xlColor& c, int start, int count)
+{
+    auto va = (xlSoftwareVertexAccumulator*)vac;
+    Draw(Mode::LINES, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, &c, nullptr, false);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawLineStrip(xlVertexAccumulator* vac, const xlColor& c, int start, int count)
+{
+    auto va = (xlSoftwareVertexAccumulator*)vac;
+    Draw(Mode::LINE_STRIP, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, &c, nullptr, false);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawTriangles(xlVertexAccumulator* vac, const xlColor& c, int start, int count)
+{
+    auto va = (xlSoftwareVertexAccumulator*)vac;
+    Draw(Mode::TRIANGLES, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, &c, nullptr, false);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawTriangleStrip(xlVertexAccumulator* vac, const xlColor& c, int start, int count)
+{
+    auto va = (xlSoftwareVertexAccumulator*)vac;
+    Draw(Mode::TRIANGLE_STRIP, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, &c, nullptr, false);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawPoints(xlVertexAccumulator* vac, const xlColor& c, float pointSize, bool smoothPoints, int start, int count)
+{
+    auto va = (xlSoftwareVertexAccumulator*)vac;
+    Draw(Mode::POINTS, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, &c, nullptr, false, pointSize, smoothPoints);
+    return this;
+}
+
+xlGraphicsContext* xlSoftwareGraphicsContext::drawLines(xlVertexColorAccumulator* vac, int start, int count)
+{
+    auto va = (xlSoftwareVertexColorAccumulator*)vac;
+    Draw(Mode::LINES, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), nullptr, true);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawLineStrip(xlVertexColorAccumulator* vac, int start, int count)
+{
+    auto va = (xlSoftwareVertexColorAccumulator*)vac;
+    Draw(Mode::LINE_STRIP, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), nullptr, true);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawTriangles(xlVertexColorAccumulator* vac, int start, int count)
+{
+    auto va = (xlSoftwareVertexColorAccumulator*)vac;
+    Draw(Mode::TRIANGLES, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), nullptr, true);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawTriangleStrip(xlVertexColorAccumulator* vac, int start, int count)
+{
+    auto va = (xlSoftwareVertexColorAccumulator*)vac;
+    Draw(Mode::TRIANGLE_STRIP, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), nullptr, true);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawPoints(xlVertexColorAccumulator* vac, float pointSize, bool smoothPoints, int start, int count)
+{
+    auto va = (xlSoftwareVertexColorAccumulator*)vac;
+    Draw(Mode::POINTS, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), nullptr, true, pointSize, smoothPoints);
+    return this;
+}
+
+xlGraphicsContext* xlSoftwareGraphicsContext::drawLines(xlVertexIndexedColorAccumulator* vac, int start, int count)
+{
+    auto va = (xlSoftwareVertexIndexedColorAccumulator*)vac;
+    Draw(Mode::LINES, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), va->indexes.data(), true);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawLineStrip(xlVertexIndexedColorAccumulator* vac, int start, int count)
+{
+    auto va = (xlSoftwareVertexIndexedColorAccumulator*)vac;
+    Draw(Mode::LINE_STRIP, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), va->indexes.data(), true);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawTriangles(xlVertexIndexedColorAccumulator* vac, int start, int count)
+{
+    auto va = (xlSoftwareVertexIndexedColorAccumulator*)vac;
+    Draw(Mode::TRIANGLES, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), va->indexes.data(), true);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawTriangleStrip(xlVertexIndexedColorAccumulator* vac, int start, int count)
+{
+    auto va = (xlSoftwareVertexIndexedColorAccumulator*)vac;
+    Draw(Mode::TRIANGLE_STRIP, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), va->indexes.data(), true);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawPoints(xlVertexIndexedColorAccumulator* vac, float pointSize, bool smoothPoints, int start, int count)
+{
+    auto va = (xlSoftwareVertexIndexedColorAccumulator*)vac;
+    Draw(Mode::POINTS, start, CountFrom(start, count, va->getCount()), va->vertices.data(), nullptr, va->colors.data(), va->indexes.data(), true, pointSize, smoothPoints);
+    return this;
+}
+
+void xlSoftwareGraphicsContext::DrawTextured(xlVertexTextureAccumulator* vac, xlTexture* texture, xlSoftwareFrame::TextureMode mode,
+                                             const float* tint, int start, int count)
+{
+    auto va = (xlSoftwareVertexTextureAccumulator*)vac;
+    auto t = (xlSoftwareTexture*)texture;
+    if (t == nullptr || t->data->width == 0 || t->data->height == 0) {
+        return;
+    }
+    _textureMode = mode;
+    _texture = _frame->AddTexture(t->data);
+    _tint = tint;
+    Draw(Mode::TRIANGLES, start, CountFrom(start, count, va->getCount()), va->vertices.data(), va->tvertices.data(), nullptr, nullptr, false, 1, true);
+    _textureMode = xlSoftwareFrame::TextureMode::NONE;
+    _texture = 0;
+    _tint = nullptr;
+}
+
+xlGraphicsContext* xlSoftwareGraphicsContext::drawTexture(xlTexture* texture,
+                                                          float x, float y, float x2, float y2,
+                                                          float tx, float ty, float tx2, float ty2,
+                                                          bool smoothScale,
+                                                          int brightness, int alpha)
+{
+    xlSoftwareVertexTextureAccumulator va;
+    va.PreAlloc(6);
+    va.AddVertex(x, y, 0, tx, ty);
+    va.AddVertex(x, y2, 0, tx, ty2);
+    va.AddVertex(x2, y2, 0, tx2, ty2);
+    va.AddVertex(x, y, 0, tx, ty);
+    va.AddVertex(x2, y2, 0, tx2, ty2);
+    va.AddVertex(x2, y, 0, tx2, ty);
+    return drawTexture(&va, texture, brightness, alpha, 0, 6);
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawTexture(xlVertexTextureAccumulator* vac, xlTexture* texture, const xlColor& c, int start, int count)
+{
+    float tint[4] = { c.red / 255.0f, c.green / 255.0f, c.blue / 255.0f, c.alpha / 255.0f };
+    DrawTextured(vac, texture, xlSoftwareFrame::TextureMode::MASK, tint, start, count);
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawTexture(xlVertexTextureAccumulator* vac, xlTexture* texture, int brightness, uint8_t alpha, int start, int count)
+{
+    float b = brightness / 100.0f;
+    float tint[4] = { b, b, b, alpha / 255.0f };
+    DrawTextured(vac, texture, xlSoftwareFrame::TextureMode::MODULATE, tint, start, count);
+    return this;
+}
+
+xlGraphicsContext* xlSoftwareGraphicsContext::drawMeshSolids(xlMesh* mesh, int brightness, bool useViewMatrix)
+{
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawMeshTransparents(xlMesh* mesh, int brightness)
+{
+    return this;
+}
+xlGraphicsContext* xlSoftwareGraphicsContext::drawMeshWireframe(xlMesh* mesh, int brightness)
+{
+    return this;
+}
@@ -0,0 +1,209 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stack>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/glm.hpp>
+
+#include "../xlGraphicsContext.h"
+
+// Everything drawn into one frame of an xlSoftwareGraphicsContext, already transformed
+// to pixel coordinates and with the colours and texture pixels it needs captured, so
+// it can be rasterized on any thread after the accumulators it was drawn from have
+// moved on to the next frame.
+class xlSoftwareFrame : public std::enable_shared_from_this<xlSoftwareFrame>
+{
+public:
+    struct Vertex {
+        float x = 0, y = 0, z = 0; // pixels from the top left, depth 0 to 1
+        float w = 1;               // clip w, for perspective correct interpolation
+        float u = 0, v = 0;
+        xlColor c; // unused for textured triangles, they use the primitive's tint
+    };
+    struct TextureData {
+        int width = 0;
+        int height = 0;
+        std::vector<xlColor> pixels; // rgba, top row first
+    };
+    enum class PrimitiveType : uint8_t {
+        POINT,
+        LINE,
+        TRIANGLE
+    };
+    enum class TextureMode : uint8_t {
+        NONE,
+        MODULATE, // texture times the tint
+        MASK      // tint colour, tint alpha times the texture alpha
+    };
+    struct Primitive {
+        PrimitiveType type = PrimitiveType::TRIANGLE;
+        TextureMode textureMode = TextureMode::NONE;
+        bool blend = false;
+        bool depthTest = false;
+        bool smooth = false;  // round points, bilinear texture sampling
+        float pointSize = 1;
+        uint32_t texture = 0; // index into textures, for textured triangles
+        float tint[4] = { 1, 1, 1, 1 };
+        Vertex v[3];
+    };
+
+    xlSoftwareFrame(int width, int height, const xlColor& background);
+
+    int GetWidth() const { return _width; }
+    int GetHeight() const { return _height; }
+
+    void Add(const Primitive& p) { _primitives.push_back(p); }
+    uint32_t AddTexture(const std::shared_ptr<const TextureData>& t);
+    size_t GetPrimitiveCount() const { return _primitives.size(); }
+
+    // draws the primitives into the frame's pixels, can be called from any thread
+    void Rasterize();
+    // queues Rasterize on the parallel job pool
+    void RasterizeAsync();
+    void WaitUntilRasterized();
+
+    // rgba pixels, top row first, valid once rasterized
+    const std::vector<xlColor>& GetPixels() const { return _pixels; }
+    // copies the pixels in the RGB24 layout the video exporter takes, padded to an even size
+    bool GetFrameForExport(uint8_t* buffer, int bufferSize);
+
+private:
+    void DrawPoint(const Primitive& p);
+    void DrawLine(const Primitive& p);
+    void DrawTriangle(const Primitive& p);
+    void Plot(int x, int y, float z, const xlColor& c, const Primitive& p);
+    xlColor Sample(const Primitive& p, float u, float v) const;
+
+    int _width;
+    int _height;
+    std::vector<Primitive> _primitives;
+    std::vector<std::shared_ptr<const TextureData>> _textures;
+    std::map<const TextureData*, uint32_t> _textureIndex;
+    std::vector<xlColor> _pixels;
+    std::vector<float> _depth;
+
+    std::mutex _lock;
+    std::condition_variable _signal;
+    bool _rasterized = false;
+};
+
+// An xlGraphicsContext that draws with the CPU rather than the graphics card. It needs no
+// display or GPU context and any number of them can be in use at once, each frame it
+// records is rasterized separately so several can be in flight on worker threads. Used to
+// render the house preview offscreen for video export.
+//
+// Meshes are loaded but not drawn.
+class xlSoftwareGraphicsContext : public xlGraphicsContext {
+public:
+    // width and height are the size of the frames in pixels, the viewport passed to
+    // SetViewport is stretched to fill them
+    xlSoftwareGraphicsContext(wxWindow* w, int width, int height, const xlColor& background);
+    virtual ~xlSoftwareGraphicsContext();
+
+    // the frame drawn so far, the context draws into a new one afterwards
+    std::shared_ptr<xlSoftwareFrame> TakeFrame();
+
+    virtual xlGraphicsContext* SetViewport(int x1, int y1, int x2, int y2, bool is3D = false) override;
+
+    virtual xlVertexAccumulator* createVertexAccumulator() override;
+    virtual xlVertexColorAccumulator* createVertexColorAccumulator() override;
+    virtual xlVertexTextureAccumulator* createVertexTextureAccumulator() override;
+    virtual xlVertexIndexedColorAccumulator* createVertexIndexedColorAccumulator() override;
+    virtual xlTexture* createTextureMipMaps(const std::vector<wxBitmap>& bitmaps) override;
+    virtual xlTexture* createTextureMipMaps(const std::vector<wxImage>& images) override;
+    virtual xlTexture* createTexture(const wxImage& image) override;
+    virtual xlTexture* createTexture(int w, int h, bool bgr, bool alpha) override;
+    virtual xlTexture* createTextureForFont(const xlFontInfo& font) override;
+    virtual xlGraphicsProgram* createGraphicsProgram() override;
+    virtual xlMesh* loadMeshFromObjFile(const std::string& file) override;
+
+    virtual xlGraphicsContext* PushMatrix() override;
+    virtual xlGraphicsContext* PopMatrix() override;
+    virtual xlGraphicsContext* Translate(float x, float y, float z) override;
+    virtual xlGraphicsContext* Rotate(float angle, float x, float y, float z) override;
+    virtual xlGraphicsContext* ApplyMatrix(const glm::mat4& m) override;
+    virtual xlGraphicsContext* Scale(float w, float h, float z) override;
+    virtual xlGraphicsContext* SetCamera(const glm::mat4& m) override;
+    virtual xlGraphicsContext* SetModelMatrix(const glm::mat4& m) override;
+    virtual xlGraphicsContext* ScaleViewMatrix(float w, float h, float z) override;
+    virtual xlGraphicsContext* TranslateViewMatrix(float x, float y, float z) override;
+
+    virtual xlGraphicsContext* enableBlending(bool e = true) override;
+
+    virtual xlGraphicsContext* drawLines(xlVertexAccumulator* vac, const xlColor& c, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawLineStrip(xlVertexAccumulator* vac, const xlColor& c, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawTriangles(xlVertexAccumulator* vac, const xlColor& c, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawTriangleStrip(xlVertexAccumulator* vac, const xlColor& c, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawPoints(xlVertexAccumulator* vac, const xlColor& c, float pointSize, bool smoothPoints, int start = 0, int count = -1) override;
+
+    virtual xlGraphicsContext* drawLines(xlVertexColorAccumulator* vac, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawLineStrip(xlVertexColorAccumulator* vac, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawTriangles(xlVertexColorAccumulator* vac, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawTriangleStrip(xlVertexColorAccumulator* vac, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawPoints(xlVertexColorAccumulator* vac, float pointSize, bool smoothPoints, int start = 0, int count = -1) override;
+
+    virtual xlGraphicsContext* drawLines(xlVertexIndexedColorAccumulator* vac, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawLineStrip(xlVertexIndexedColorAccumulator* vac, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawTriangles(xlVertexIndexedColorAccumulator* vac, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawTriangleStrip(xlVertexIndexedColorAccumulator* vac, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawPoints(xlVertexIndexedColorAccumulator* vac, float pointSize, bool smoothPoints, int start = 0, int count = -1) override;
+
+    virtual xlGraphicsContext* drawTexture(xlTexture* texture,
+                                           float x, float y, float x2, float y2,
+                                           float tx = 0.0, float ty = 0.0, float tx2 = 1.0, float ty2 = 1.0,
+                                           bool smoothScale = true,
+                                           int brightness = 100, int alpha = 255) override;
+    virtual xlGraphicsContext* drawTexture(xlVertexTextureAccumulator* vac, xlTexture* texture, const xlColor& c, int start = 0, int count = -1) override;
+    virtual xlGraphicsContext* drawTexture(xlVertexTextureAccumulator* vac, xlTexture* texture, int brightness, uint8_t alpha, int start, int count) override;
+
+    virtual xlGraphicsContext* drawMeshSolids(xlMesh* mesh, int brightness, bool useViewMatrix) override;
+    virtual xlGraphicsContext* drawMeshTransparents(xlMesh* mesh, int brightness) override;
+    virtual xlGraphicsContext* drawMeshWireframe(xlMesh* mesh, int brightness) override;
+
+private:
+    enum class Mode {
+        POINTS,
+        LINES,
+        LINE_STRIP,
+        TRIANGLES,
+        TRIANGLE_STRIP
+    };
+    // Adds the primitives for count vertices from start. pos is 3 floats per vertex, tex 2. The colour of
+    // a vertex is colors[colorIndex[i]] if there is a colorIndex, else colors[i] or, if perVertexColor is
+    // false, colors[0].
+    void Draw(Mode mode, int start, int count, const float* pos, const float* tex,
+              const xlColor* colors, const uint32_t* colorIndex, bool perVertexColor,
+              float pointSize = 1, bool smooth = false);
+    void DrawTextured(xlVertexTextureAccumulator* vac, xlTexture* texture, xlSoftwareFrame::TextureMode mode,
+                      const float* tint, int start, int count);
+    xlSoftwareFrame::Vertex Project(const float* pos) const;
+
+    std::shared_ptr<xlSoftwareFrame> _frame;
+    int _width;
+    int _height;
+    xlColor _background;
+
+    glm::mat4 _mvp;
+    std::stack<glm::mat4> _matrixStack;
+    bool _blending = false;
+    bool _depthTest = false;
+
+    // set while DrawTextured is adding the triangles
+    xlSoftwareFrame::TextureMode _textureMode = xlSoftwareFrame::TextureMode::NONE;
+    uint32_t _texture = 0;
+    const float* _tint = nullptr;
+};
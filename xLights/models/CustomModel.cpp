@@ -13,6 +13,8 @@
 #include <wx/propgrid/propgrid.h>
 #include <wx/propgrid/advprops.h>
 
+#include <algorithm>
+#include <tuple>
 #include <vector>
 
 #include "CustomModel.h"
@@ -251,17 +253,67 @@ int CustomModel::OnPropertyGridChange(wxPropertyGridInterface* grid, wxPropertyG
     return Model::OnPropertyGridChange(grid, event);
 }
 
-std::tuple<int, int, int> FindNode(int node, const std::vector<std::vector<std::vector<int>>>& locations)
+void CustomModelNodes::Index()
 {
-    for (int l = 0; l < locations.size(); l++) {
-        for (int r = 0; r < locations[l].size(); r++) {
-            for (int c = 0; c < locations[l][r].size(); c++) {
-                if (locations[l][r][c] == node + 1) {
-                    return { l, r, c };
+    _firstCell.clear();
+    _firstCell.reserve(cells.size());
+    for (uint32_t i = 0; i < cells.size(); i++) {
+        _firstCell.emplace(cells[i].node, i); // does not replace so the first cell wins
+    }
+}
+
+const CustomModelNodes::Cell* CustomModelNodes::Find(int node) const
+{
+    auto it = _firstCell.find(node);
+    if (it == _firstCell.end()) {
+        return nullptr;
+    }
+    return &cells[it->second];
+}
+
+int CustomModelNodes::GetMaxNode() const
+{
+    int maxval = 0;
+    for (const auto& c : cells) {
+        maxval = std::max(maxval, c.node);
+    }
+    return maxval;
+}
+
+std::vector<std::vector<std::vector<int>>> CustomModelNodes::ToDense() const
+{
+    std::vector<std::vector<std::vector<int>>> locations(depth, std::vector<std::vector<int>>(height, std::vector<int>(width, -1)));
+    for (const auto& c : cells) {
+        locations[c.layer][c.row][c.col] = c.node;
+    }
+    return locations;
+}
+
+CustomModelNodes CustomModelNodes::FromDense(const std::vector<std::vector<std::vector<int>>>& model)
+{
+    CustomModelNodes res;
+    res.depth = std::max((int)model.size(), 1);
+    for (int l = 0; l < model.size(); l++) {
+        res.height = std::max((int)model[l].size(), res.height);
+        for (int r = 0; r < model[l].size(); r++) {
+            res.width = std::max((int)model[l][r].size(), res.width);
+            for (int c = 0; c < model[l][r].size(); c++) {
+                if (model[l][r][c] >= 0) {
+                    res.cells.push_back({ model[l][r][c], l, r, c });
                 }
             }
         }
     }
+    res.Index();
+    return res;
+}
+
+std::tuple<int, int, int> FindNode(int node, const CustomModelNodes& nodes)
+{
+    auto cell = nodes.Find(node + 1);
+    if (cell != nullptr) {
+        return { cell->layer, cell->row, cell->col };
+    }
     wxASSERT(false);
     return { -1,-1,-1 };
 }
@@ -591,14 +643,14 @@ void CustomModel::InitRenderBufferNodes(const std::string& tp, const std::string
     GetBufferSize(type, camera, transform, BufferWi, BufferHi, stagger);
     if (type == "Stacked X Horizontally") {
         for (auto n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = depth - std::get<0>(loc) - 1 + std::get<2>(loc) * depth;
             Nodes[n]->Coords[0].bufY = height - std::get<1>(loc) - 1;
         }
     }
     else if (type == "Stacked Y Horizontally") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = std::get<2>(loc) + std::get<1>(loc) * width;
             Nodes[n]->Coords[0].bufY = std::get<0>(loc);
         }
@@ -608,63 +660,63 @@ void CustomModel::InitRenderBufferNodes(const std::string& tp, const std::string
     }
     else if (type == "Stacked X Vertically") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = depth - std::get<0>(loc) - 1;
             Nodes[n]->Coords[0].bufY = std::get<1>(loc) + height * std::get<2>(loc);
         }
     }
     else if (type == "Stacked Y Vertically") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = std::get<2>(loc);
             Nodes[n]->Coords[0].bufY = std::get<0>(loc) + depth * std::get<1>(loc);
         }
     }
     else if (type == "Stacked Z Vertically") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = std::get<2>(loc);
             Nodes[n]->Coords[0].bufY = std::get<1>(loc) + depth * std::get<0>(loc);
         }
     }
     else if (type == "Overlaid X") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = depth - std::get<0>(loc) - 1;
             Nodes[n]->Coords[0].bufY = height - std::get<1>(loc) - 1;
         }
     }
     else if (type == "Overlaid Y") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = std::get<2>(loc);
             Nodes[n]->Coords[0].bufY = std::get<0>(loc);
         }
     }
     else if (type == "Overlaid Z") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = std::get<2>(loc);
             Nodes[n]->Coords[0].bufY = height - std::get<1>(loc) - 1;
         }
     }
     else if (type == "Unique X and Y X") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = depth - std::get<0>(loc) - 1 + std::get<2>(loc) * depth;
             Nodes[n]->Coords[0].bufY = std::get<1>(loc) + std::get<2>(loc) * height;
         }
     }
     else if (type == "Unique X and Y Y") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = std::get<2>(loc) + std::get<1>(loc) * width;
             Nodes[n]->Coords[0].bufY = std::get<0>(loc) + std::get<1>(loc) * depth;
         }
     }
     else if (type == "Unique X and Y Z") {
         for (size_t n = 0; n < Nodes.size(); n++) {
-            auto loc = FindNode(n, locations);
+            auto loc = FindNode(n, _nodes);
             Nodes[n]->Coords[0].bufX = std::get<2>(loc) + std::get<0>(loc) * width;
             Nodes[n]->Coords[0].bufY = std::get<1>(loc) + (height - std::get<1>(loc) - 1) * height;
         }
@@ -709,11 +761,13 @@ std::string CustomModel::CompressedToCustomModel(const std::string& compressed)
 
 std::vector<std::vector<std::vector<int>>> CustomModel::ParseCustomModel(const std::string& customModel)
 {
-    // layers - rows - cols
-    std::vector<std::vector<std::vector<int>>> locations;
+    return ParseCustomModelNodes(customModel).ToDense();
+}
 
-    uint32_t width = 1;
-    uint32_t height = 1;
+CustomModelNodes CustomModel::ParseCustomModelNodes(const std::string& customModel)
+{
+    CustomModelNodes res;
+    res.cells.reserve(4000);
 
     std::vector<std::string> layers;
     std::vector<std::string> rows;
@@ -726,30 +780,26 @@ std::vector<std::vector<std::vector<int>>> CustomModel::ParseCustomModel(const s
     int layer = 0;
 
     for (auto lv : layers) {
-        locations.emplace_back(std::vector<std::vector<int>>());
-
         rows.clear();
         Split(lv, ';', rows);
-        height = rows.size();
-        locations.back().resize(height);
+        // the last layer decides the height
+        res.height = std::max((int)rows.size(), 1);
 
         int row = 0;
         for (auto rv : rows) {
             cols.clear();
             Split(rv, ',', cols);
-            if (cols.size() > width)
-                width = cols.size();
+            res.width = std::max((int)cols.size(), res.width);
             int col = 0;
-            locations.back()[row].resize(width, -1);
             for (auto value : cols) {
                 while (value.length() > 0 && value[0] == ' ') {
                     value = value.substr(1);
                 }
                 if (!value.empty()) {
                     try {
-                        locations[layer][row][col] = std::stoi(value);
+                        res.cells.push_back({ std::stoi(value), layer, row, col });
                     } catch (...) {
-                        // not a number, treat as 0
+                        // not a number, treat as empty
                     }
                 }
                 col++;
@@ -758,15 +808,15 @@ std::vector<std::vector<std::vector<int>>> CustomModel::ParseCustomModel(const s
         }
         layer++;
     }
+    res.depth = std::max(layer, 1);
 
-    for (auto& lyr : locations) {
-        lyr.resize(height);
-        for (auto& rw : lyr) {
-            rw.resize(width, -1);
-        }
+    // rows past the height of the last layer are dropped
+    if (!res.cells.empty()) {
+        int height = res.height;
+        res.cells.erase(std::remove_if(res.cells.begin(), res.cells.end(), [height](const auto& c) { return c.row >= height || c.node < 0; }), res.cells.end());
     }
-
-    return locations;
+    res.Index();
+    return res;
 }
 
 std::vector<std::vector<std::vector<int>>> CustomModel::ParseCustomModelDataFromXml(const wxXmlNode* node)
@@ -778,99 +828,74 @@ std::vector<std::vector<std::vector<int>>> CustomModel::ParseCustomModelDataFrom
     }
 
 std::vector<std::vector<std::vector<int>>> CustomModel::ParseCompressed(const std::string& compressed) {
-    // node, row, col, [layer];
+    return ParseCompressedNodes(compressed).ToDense();
+}
 
-    // layers - rows - cols
-    std::vector<std::vector<std::vector<int>>> locations;
+CustomModelNodes CustomModel::ParseCompressedNodes(const std::string& compressed) {
+    // node, row, col, [layer];
+    CustomModelNodes res;
 
     // parse all the strings
-    std::vector<std::tuple<int,int,int,int>> nodes;
-    nodes.reserve(4000);
     std::vector<std::string> nodeStrings;
     nodeStrings.reserve(4000);
     Split(compressed, ';', nodeStrings);
+    res.cells.reserve(nodeStrings.size());
+    std::vector<std::string> nodeData;
     for (const auto& n : nodeStrings) {
-        std::vector<std::string> nodeData;
+        nodeData.clear();
         Split(n, ',', nodeData);
         if (nodeData.size() == 3) {
-            nodes.emplace_back(std::make_tuple(std::stoi(nodeData[0]), std::stoi(nodeData[1]), std::stoi(nodeData[2]), 0));
+            res.cells.push_back({ std::stoi(nodeData[0]), 0, std::stoi(nodeData[1]), std::stoi(nodeData[2]) });
         } else if (nodeData.size() == 4) {
-            nodes.emplace_back(std::make_tuple(std::stoi(nodeData[0]), std::stoi(nodeData[1]), std::stoi(nodeData[2]), std::stoi(nodeData[3])));
+            res.cells.push_back({ std::stoi(nodeData[0]), std::stoi(nodeData[3]), std::stoi(nodeData[1]), std::stoi(nodeData[2]) });
         }
     }
 
     // work out the required dimensions
-    int layers = 0;
-    int rows = 0;
-    int cols = 0;
-    for (const auto& n : nodes) {
-		layers = std::max(layers, std::get<3>(n));
-		rows = std::max(rows, std::get<1>(n));
-		cols = std::max(cols, std::get<2>(n));
-	}
-
-    // create enough space
-    locations.reserve(layers + 1);
-    for (int l = 0; l <= layers; l++) {
-		locations.emplace_back(std::vector<std::vector<int>>());
-		locations.back().reserve(rows + 1);
-		for (int r = 0; r <= rows; r++) {
-			locations.back().emplace_back(std::vector<int>());
-			locations.back().back().reserve(cols + 1);
-			for (int c = 0; c <= cols; c++) {
-				locations.back().back().emplace_back(-1);
-			}
-		}
-	}
-
-    // fill in data
-    for (const auto& n : nodes)
-    {
-        locations[std::get<3>(n)][std::get<1>(n)][std::get<2>(n)] = std::get<0>(n);
-    }
-
-    return locations;
+    for (const auto& c : res.cells) {
+        res.depth = std::max(res.depth, c.layer + 1);
+        res.height = std::max(res.height, c.row + 1);
+        res.width = std::max(res.width, c.col + 1);
+    }
+
+    // put the cells in grid order, if a cell is listed more than once the last one wins
+    std::stable_sort(res.cells.begin(), res.cells.end(), [](const auto& a, const auto& b) {
+        return std::tie(a.layer, a.row, a.col) < std::tie(b.layer, b.row, b.col);
+    });
+    auto last = std::unique(res.cells.rbegin(), res.cells.rend(), [](const auto& a, const auto& b) {
+        return a.layer == b.layer && a.row == b.row && a.col == b.col;
+    });
+    res.cells.erase(res.cells.begin(), last.base());
+    res.cells.erase(std::remove_if(res.cells.begin(), res.cells.end(), [](const auto& c) { return c.node < 0; }), res.cells.end());
+
+    res.Index();
+    return res;
 }
 
-std::string CustomModel::ToCompressed(const std::vector<std::vector<std::vector<int>>>& model) {
-
-    // we only compress if nodes to cells < 20%
-    int nodes = 0;
-    int cells = model.size() * model[0].size() * model[0][0].size();
-    for (const auto& l : model) {
-		for (const auto& r : l) {
-			for (const auto& c : r) {
-				if (c >= 0) {
-					nodes++;
-				}
-			}
-		}
-	}
+std::string CustomModel::ToCompressed(const CustomModelNodes& model) {
 
-    if (nodes > 0.80 * cells)
+    // we only compress if nodes to cells < 80%
+    if (model.cells.size() > 0.80 * model.width * model.height * model.depth)
         return "";
 
-    int layers = model.size();
     std::string compressed = "";
-    for (int l = 0; l < model.size(); l++) {
-		for (int r = 0; r < model[l].size(); r++) {
-			for (int c = 0; c < model[l][r].size(); c++) {
-				if (model[l][r][c] >= 0) {
-					if (!compressed.empty()) {
-						compressed += ";";
-					}
-					compressed += std::to_string(model[l][r][c]) + "," + std::to_string(r) + "," + std::to_string(c);
-					if (layers > 1) {
-						compressed += "," + std::to_string(l);
-					}
-				}
-			}
-		}
-	}
-
+    compressed.reserve(model.cells.size() * 12);
+    for (const auto& c : model.cells) {
+        if (!compressed.empty()) {
+            compressed += ";";
+        }
+        compressed += std::to_string(c.node) + "," + std::to_string(c.row) + "," + std::to_string(c.col);
+        if (model.depth > 1) {
+            compressed += "," + std::to_string(c.layer);
+        }
+    }
     return compressed;
 }
 
+std::string CustomModel::ToCompressed(const std::vector<std::vector<std::vector<int>>>& model) {
+    return ToCompressed(CustomModelNodes::FromDense(model));
+}
+
 std::string CustomModel::ToCustomModel(const std::vector<std::vector<std::vector<int>>>& model) {
     std::string customModel = "";
 	for (int l = 0; l < model.size(); l++) {
@@ -898,26 +923,17 @@ void CustomModel::InitCustomMatrix(const std::string& customModel, const std::st
 
     // we use compresssed if we can as it should be faster to parse
     if (compressed != "") {
-        locations = CustomModel::ParseCompressed(compressed);
+        _nodes = CustomModel::ParseCompressedNodes(compressed);
     } else {
-        locations = CustomModel::ParseCustomModel(customModel);
+        _nodes = CustomModel::ParseCustomModelNodes(customModel);
     }
 
-    uint32_t depth = locations.size();
-    uint32_t height = locations[0].size();
-    uint32_t width = locations[0][0].size();
+    uint32_t depth = _nodes.depth;
+    uint32_t height = _nodes.height;
+    uint32_t width = _nodes.width;
 
     // find the maximum node
-    int maxval = 0;
-    for (const auto& l : locations) {
-		for (const auto& r : l) {
-			for (const auto& c : r) {
-				if (c >= 0) {
-					maxval = std::max(maxval, c);
-				}
-			}
-		}
-	}
+    int maxval = _nodes.GetMaxNode();
 
     std::vector<int> nodemap;
     nodemap.resize(maxval + 1, -1);
@@ -929,50 +945,37 @@ void CustomModel::InitCustomMatrix(const std::string& customModel, const std::st
 
     int cpn = -1;
 
-    // now populate the nodes
-    size_t layer = 0;
-    for (const auto& l : locations) {
-        size_t row = 0;
-        for (const auto& r : l) {
-            size_t col = 0;
-            for (const auto& c : r) {
-                if (c > 0) {
-                    int idx = c - 1;//index is zero based
-                    // is node already defined in map?
-                    if (nodemap[idx] < 0) {
-                        // unmapped - so add a node
-                        nodemap[idx] = Nodes.size();
-                        SetNodeCount(1, 0, rgbOrder); // this creates a node of the correct class
-                        Nodes.back()->StringNum = idx;
-                        if (cpn == -1) {
-                            cpn = GetChanCountPerNode();
-                        }
-                        Nodes.back()->ActChan = firstStartChan + idx * cpn;
-                        if (idx < nodeNames.size() && !nodeNames[idx].empty()) {
-                            Nodes.back()->SetName(nodeNames[idx]);
-                        } else {
-                            Nodes.back()->SetName("Node " + std::to_string(idx + 1));
-                        }
-
-                        Nodes.back()->AddBufCoord(layer * ((float)width) + col, ((float)height) - row - 1);
-                        auto& cc = Nodes[nodemap[idx]]->Coords.back();
-                        cc.screenX = (float)col - ((float)width) / 2.0f;
-                        cc.screenY = ((float)height) - (float)row - 1.0f - ((float)height) / 2.0f;
-                        cc.screenZ = depth - (float)layer - 1.0f - depth / 2.0f;
-                    } else {
-                        // mapped - so add a coord to existing node
-                        Nodes[nodemap[idx]]->AddBufCoord(layer * ((float)width) + col, ((float)height) - row - 1);
-                        auto& c = Nodes[nodemap[idx]]->Coords.back();
-                        c.screenX = (float)col - ((float)width) / 2.0f;
-                        c.screenY = ((float)height) - (float)row - 1.0f - ((float)height) / 2.0f;
-                        c.screenZ = depth - (float)layer - 1.0f - depth / 2.0f;
-                    }
-                }
-                ++col;
+    // now populate the nodes, only cells holding a node are visited
+    for (const auto& cell : _nodes.cells) {
+        if (cell.node <= 0) {
+            continue;
+        }
+        float layer = cell.layer;
+        float row = cell.row;
+        float col = cell.col;
+        int idx = cell.node - 1;//index is zero based
+        // is node already defined in map?
+        if (nodemap[idx] < 0) {
+            // unmapped - so add a node
+            nodemap[idx] = Nodes.size();
+            SetNodeCount(1, 0, rgbOrder); // this creates a node of the correct class
+            Nodes.back()->StringNum = idx;
+            if (cpn == -1) {
+                cpn = GetChanCountPerNode();
+            }
+            Nodes.back()->ActChan = firstStartChan + idx * cpn;
+            if (idx < nodeNames.size() && !nodeNames[idx].empty()) {
+                Nodes.back()->SetName(nodeNames[idx]);
+            } else {
+                Nodes.back()->SetName("Node " + std::to_string(idx + 1));
             }
-            ++row;
         }
-        ++layer;
+        // add a coord to the node
+        Nodes[nodemap[idx]]->AddBufCoord(layer * ((float)width) + col, ((float)height) - row - 1);
+        auto& c = Nodes[nodemap[idx]]->Coords.back();
+        c.screenX = col - ((float)width) / 2.0f;
+        c.screenY = ((float)height) - row - 1.0f - ((float)height) / 2.0f;
+        c.screenZ = depth - layer - 1.0f - depth / 2.0f;
     }
 
     for (size_t x = 0; x < Nodes.size(); x++) {
@@ -10,8 +10,39 @@
  * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
  **************************************************************/
 
+#include <unordered_map>
+
 #include "Model.h"
 
+// Sparse form of the custom model data. Only cells holding a node are kept so
+// large mostly empty grids cost memory in proportion to their node count.
+class CustomModelNodes
+{
+    public:
+        struct Cell {
+            int node;  // as it appears in the model data so 1 based
+            int layer;
+            int row;
+            int col;
+        };
+
+        int width = 1;
+        int height = 1;
+        int depth = 1;
+
+        // sorted by layer, row then column. Call Index() after changing.
+        std::vector<Cell> cells;
+
+        void Index();
+        const Cell* Find(int node) const;
+        int GetMaxNode() const;
+        std::vector<std::vector<std::vector<int>>> ToDense() const;
+        static CustomModelNodes FromDense(const std::vector<std::vector<std::vector<int>>>& model);
+
+    private:
+        std::unordered_map<int, uint32_t> _firstCell; // node -> index in cells of the first cell holding it
+};
+
 class CustomModel : public ModelWithScreenLocation<BoxedScreenLocation>
 {
     public:
@@ -77,7 +108,11 @@ class CustomModel : public ModelWithScreenLocation<BoxedScreenLocation>
         static std::vector<std::vector<std::vector<int>>> ParseCustomModelDataFromXml(const wxXmlNode* node);
         static std::string ToCompressed(const std::vector<std::vector<std::vector<int>>>& model);
         static std::string ToCustomModel(const std::vector<std::vector<std::vector<int>>>& model);
-        std::vector<std::vector<std::vector<int>>> GetData() const { return locations; }
+        static CustomModelNodes ParseCustomModelNodes(const std::string& customModel);
+        static CustomModelNodes ParseCompressedNodes(const std::string& compressed);
+        static std::string ToCompressed(const CustomModelNodes& model);
+        std::vector<std::vector<std::vector<int>>> GetData() const { return _nodes.ToDense(); }
+        const CustomModelNodes& GetNodes() const { return _nodes; }
 
     protected:
         virtual void InitModel() override;
@@ -97,5 +132,5 @@ class CustomModel : public ModelWithScreenLocation<BoxedScreenLocation>
         std::string custom_background;
         int _strings;
         std::vector<int> stringStartNodes;
-        std::vector<std::vector<std::vector<int>>> locations;
+        CustomModelNodes _nodes;
 };
@@ -39,6 +39,7 @@ class ImageModel : public ModelWithScreenLocation<BoxedScreenLocation>
         virtual bool SupportsXlightsModel() override { return true; }
         virtual bool SupportsExportAsCustom() const override { return false; }
         virtual bool SupportsWiringView() const override { return false; }
+        virtual bool CanGatherPreviewColors() const override { return false; }
         virtual int GetNumPhysicalStrings() const override { return 1; }
         virtual std::list<std::string> GetFileReferences() override;
         virtual bool CleanupFileLocations(xLightsFrame* frame) override;
@@ -137,6 +137,8 @@ static void clearUnusedProtocolProperties(wxXmlNode* node)
 static const std::string EFFECT_PREVIEW_CACHE("ModelPreviewEffectCache");
 static const std::string MODEL_PREVIEW_CACHE_2D("ModelPreviewCache2D");
 static const std::string MODEL_PREVIEW_CACHE_3D("ModelPreviewCache3D");
+static const std::string OFFSCREEN_PREVIEW_CACHE_2D("OffscreenPreviewCache2D");
+static const std::string OFFSCREEN_PREVIEW_CACHE_3D("OffscreenPreviewCache3D");
 static const std::string LAYOUT_PREVIEW_CACHE_2D("LayoutPreviewCache2D");
 static const std::string LAYOUT_PREVIEW_CACHE_3D("LayoutPreviewCache3D");
 
@@ -2903,6 +2905,89 @@ bool Model::UpdateStartChannelFromChannelString(std::map<std::string, Model*>& m
     return valid;
 }
 
+// hashes the xml the model is built from, leaving out the start channels which only move the channels
+static size_t HashModelXml(const wxXmlNode* node, bool top)
+{
+    std::string key = node->GetName().ToStdString();
+    for (const wxXmlAttribute* a = node->GetAttributes(); a != nullptr; a = a->GetNext()) {
+        if (top && (a->GetName() == "StartChannel" || (a->GetName().StartsWith("String") && a->GetName().Mid(6).IsNumber()))) {
+            continue;
+        }
+        key += "|" + a->GetName().ToStdString() + "=" + a->GetValue().ToStdString();
+    }
+    size_t hash = std::hash<std::string>()(key);
+    for (const wxXmlNode* c = node->GetChildren(); c != nullptr; c = c->GetNext()) {
+        hash = hash * 31 + HashModelXml(c, false);
+    }
+    return hash;
+}
+
+std::list<std::string> Model::GetStartChannelDependencies() const
+{
+    std::list<std::string> res;
+    auto add = [&res](const std::string& sc) {
+        std::string s = Trim(sc);
+        if (!s.empty() && (s[0] == '>' || s[0] == '@') && s.find(':') != std::string::npos) {
+            std::string dep = Trim(s.substr(1, s.find(':') - 1));
+            if (std::find(res.begin(), res.end(), dep) == res.end()) {
+                res.push_back(dep);
+            }
+        }
+    };
+    add(ModelXml->GetAttribute("StartChannel", "1").ToStdString());
+    if (ModelXml->GetAttribute("Advanced", "0") == "1") {
+        for (size_t i = 0; i < stringStartChan.size(); ++i) {
+            add(ModelXml->GetAttribute(StartChanAttrName(i), "").ToStdString());
+        }
+    }
+    return res;
+}
+
+void Model::ApplyStartChannels()
+{
+    if (Nodes.empty() || _loadedXmlKey != HashModelXml(ModelXml, true) || DisplayAs == "WholeHouse") {
+        SetFromXml(ModelXml, zeroBased);
+        return;
+    }
+
+    std::vector<int32_t> oldStringStartChan = stringStartChan;
+    CouldComputeStartChannel = false;
+    std::string dependsonmodel;
+    int32_t StartChannel = GetNumberFromChannelString(ModelXml->GetAttribute("StartChannel", "1").ToStdString(), CouldComputeStartChannel, dependsonmodel);
+    ModelStartChannel = ModelXml->GetAttribute("StartChannel");
+    size_t NumberOfStrings = HasOneString(DisplayAs) ? 1 : parm1;
+    SetStringStartChannels(zeroBased, NumberOfStrings, StartChannel, CalcCannelsPerString());
+
+    if (oldStringStartChan == stringStartChan) {
+        return;
+    }
+    // the nodes (and the submodels' copies of them) move with the string they are on
+    auto canMove = [&oldStringStartChan](const std::vector<NodeBaseClassPtr>& nodes) {
+        for (const auto& n : nodes) {
+            if (n->StringNum >= oldStringStartChan.size()) {
+                return false;
+            }
+        }
+        return true;
+    };
+    bool ok = oldStringStartChan.size() == stringStartChan.size() && canMove(Nodes);
+    for (auto sm = subModels.begin(); ok && sm != subModels.end(); ++sm) {
+        ok = canMove((*sm)->Nodes);
+    }
+    if (!ok) {
+        SetFromXml(ModelXml, zeroBased);
+        return;
+    }
+    MoveNodesWithStrings(Nodes, oldStringStartChan, stringStartChan);
+    for (auto& sm : subModels) {
+        MoveNodesWithStrings(sm->Nodes, oldStringStartChan, stringStartChan);
+        // worked out the same way SubModel::Setup does, uploads and reports read it rather than the nodes
+        sm->ModelStartChannel = wxString::Format("%u", GetFirstNodeChannel(sm->Nodes) + 1);
+        sm->IncrementChangeCount();
+    }
+    IncrementChangeCount();
+}
+
 int Model::GetNumberFromChannelString(const std::string& sc) const
 {
     bool v = false;
@@ -3250,6 +3335,7 @@ void Model::SetFromXml(wxXmlNode* ModelNode, bool zb)
         ModelNode->RemoveChild(dimmingCurveNode);
     }
 
+    _loadedXmlKey = HashModelXml(ModelNode, true);
     IncrementChangeCount();
 }
 
@@ -5289,9 +5375,12 @@ void Model::DisplayModelOnWindow(ModelPreview* preview, xlGraphicsContext* ctx,
     ModelScreenLocation& screenLocation = GetModelScreenLocation();
     screenLocation.PrepareToDraw(is_3d, allowSelected);
 
+    // the offscreen renderer has its own accumulators, they cannot be shared with the window's
     const std::string& cacheKey = allowSelected
                                       ? (is_3d ? LAYOUT_PREVIEW_CACHE_3D : LAYOUT_PREVIEW_CACHE_2D)
-                                      : (is_3d ? MODEL_PREVIEW_CACHE_3D : MODEL_PREVIEW_CACHE_2D);
+                                      : preview->IsRenderingOffscreen()
+                                            ? (is_3d ? OFFSCREEN_PREVIEW_CACHE_3D : OFFSCREEN_PREVIEW_CACHE_2D)
+                                            : (is_3d ? MODEL_PREVIEW_CACHE_3D : MODEL_PREVIEW_CACHE_2D);
     if (uiObjectsInvalid) {
         deleteUIObjects();
     }
@@ -5432,9 +5521,13 @@ void Model::DisplayModelOnWindow(ModelPreview* preview, xlGraphicsContext* ctx,
                 color = saveColor;
             }
         } else if (c == nullptr) {
-            Nodes[n]->GetColor(color);
-            if (Nodes[n]->model->modelDimmingCurve != nullptr) {
-                Nodes[n]->model->modelDimmingCurve->reverse(color);
+            if (previewColors != nullptr) {
+                color = previewColors[n];
+            } else {
+                Nodes[n]->GetColor(color);
+                if (Nodes[n]->model->modelDimmingCurve != nullptr) {
+                    Nodes[n]->model->modelDimmingCurve->reverse(color);
+                }
             }
             if (Nodes[n]->model->StrobeRate) {
                 int r = rand() % 5;
@@ -7867,6 +7960,17 @@ Model::PreviewGraphicsCacheInfo::~PreviewGraphicsCacheInfo()
     if (va)
         delete va;
 };
+void Model::DeleteOffscreenUIObjects()
+{
+    for (const auto& key : { OFFSCREEN_PREVIEW_CACHE_2D, OFFSCREEN_PREVIEW_CACHE_3D }) {
+        auto it = uiCaches.find(key);
+        if (it != uiCaches.end()) {
+            delete it->second;
+            uiCaches.erase(it);
+        }
+    }
+}
+
 void Model::deleteUIObjects()
 {
     for (auto& a : uiCaches) {
@@ -235,6 +235,8 @@ public:
     int GetDefaultBufferWi() const { return BufferWi; }
     int GetDefaultBufferHt() const { return BufferHt; }
     virtual bool IsDMXModel() const { return false; }
+    // false for models that draw from the state of their nodes rather than just the node colours
+    virtual bool CanGatherPreviewColors() const { return !IsDMXModel(); }
 
     void SetProperty(wxString const& property, wxString const& value, bool apply = false);
     virtual void AddProperties(wxPropertyGridInterface* grid, OutputManager* outputManager) override;
@@ -320,6 +322,7 @@ protected:
     std::string _dir = "L";
 
     int StrobeRate = 0; // 0 = no strobing
+    const xlColor* previewColors = nullptr;
     bool zeroBased =  false;
 
     std::vector<std::string> strandNames;
@@ -454,6 +457,7 @@ public:
 
     std::string ModelStartChannel{ "" };
     bool CouldComputeStartChannel = false;
+    size_t _loadedXmlKey = 0; // everything in ModelXml bar the start channels, when SetFromXml last ran
     bool Overlapping = false;
     std::string _pixelCount{ "" };
     std::string _pixelType{ "" };
@@ -481,6 +485,11 @@ public:
     uint32_t GetNodeNumber(size_t nodenum) const;
     uint32_t GetNodeNumber(int bufY, int bufX) const;
     bool UpdateStartChannelFromChannelString(std::map<std::string, Model*>& models, std::list<std::string>& used);
+    // names of the models the start channels are relative to with > or @
+    std::list<std::string> GetStartChannelDependencies() const;
+    // Re-evaluates the start channels and moves the nodes to match. The model is only
+    // rebuilt if something other than its start channels has changed since it was loaded.
+    void ApplyStartChannels();
     int GetNumberFromChannelString(const std::string& sc) const;
     int GetNumberFromChannelString(const std::string& sc, bool& valid, std::string& dependsonmodel) const;
 
@@ -490,6 +499,10 @@ public:
                                       bool highlightFirst = false, int highlightpixel = 0,
                                       float *boundingBox = nullptr);
     virtual void DisplayEffectOnWindow(ModelPreview* preview, double pointSize);
+    // node colours for DisplayModelOnWindow to draw in place of reading each node, nullptr to read the nodes
+    void SetPreviewColors(const xlColor* colors) { previewColors = colors; }
+    // drops what DisplayModelOnWindow cached for a preview's offscreen rendering
+    void DeleteOffscreenUIObjects();
 
 
 
@@ -478,86 +478,64 @@ bool ModelManager::RecalcStartChannels() const
 
     wxStopWatch sw;
     bool changed = false;
-    std::set<std::string> modelsDone;
-    std::set<std::string> modelsOnNoController;
 
     for (const auto& it : models) {
         it.second->CouldComputeStartChannel = false;
     }
 
-    // first go through all models whose start channels are not dependent on other models
+    // work out which models each model's start channels hang off so every model is visited once,
+    // after everything it depends on
+    std::map<std::string, std::list<std::string>> dependents;
+    std::map<std::string, int> waitingOn;
+    std::list<std::string> ready;
     for (const auto& it : models) {
-        if (it.second->GetDisplayAs() != "ModelGroup") {
-            char first = '0';
-            if (!Trim(it.second->ModelStartChannel).empty())
-                first = Trim(it.second->ModelStartChannel)[0];
-            if (first != '>' && first != '@') {
-                modelsDone.emplace(it.first);
-                auto oldsc = it.second->GetFirstChannel();
-                it.second->SetFromXml(it.second->GetModelXml());
-                if (oldsc != it.second->GetFirstChannel()) {
-                    changed = true;
-                }
-            }
-            if (it.second->GetControllerName() == NO_CONTROLLER) {
-                modelsOnNoController.emplace(it.first);
+        if (it.second->GetDisplayAs() == "ModelGroup") {
+            continue;
+        }
+        int count = 0;
+        for (const auto& dep : it.second->GetStartChannelDependencies()) {
+            auto d = models.find(dep);
+            if (dep != it.first && d != models.end() && d->second->GetDisplayAs() != "ModelGroup") {
+                dependents[dep].push_back(it.first);
+                ++count;
             }
         }
+        waitingOn[it.first] = count;
+        if (count == 0) {
+            ready.push_back(it.first);
+        }
     }
 
-    // now go through all undone models that depend on something
-    bool workDone = false;
-    do {
-        workDone = false;
-
-        for (const auto& it : models) {
-            if (it.second->GetDisplayAs() != "ModelGroup") {
-                char first = '0';
-                if (!Trim(it.second->ModelStartChannel).empty())
-                    first = Trim(it.second->ModelStartChannel)[0];
-                if ((first == '>' || first == '@') && !it.second->CouldComputeStartChannel) {
-                    std::string dependsOn = Trim(Trim(it.second->ModelStartChannel).substr(1, Trim(it.second->ModelStartChannel).find(':') - 1));
-
-                    if (first == '>' && modelsOnNoController.find(dependsOn) != modelsOnNoController.end()) {
-                        modelsOnNoController.emplace(it.first);
-                    }
+    auto apply = [&changed](Model* m) {
+        auto oldsc = m->GetFirstChannel();
+        m->ApplyStartChannels();
+        if (oldsc != m->GetFirstChannel()) {
+            changed = true;
+        }
+    };
 
-                    if (modelsDone.find(dependsOn) != modelsDone.end() && modelsOnNoController.find(dependsOn) == modelsOnNoController.end()) {
-                        // the depends on model is done
-                        modelsDone.emplace(it.first);
-                        auto oldsc = it.second->GetFirstChannel();
-                        it.second->SetFromXml(it.second->GetModelXml());
-                        if (oldsc != it.second->GetFirstChannel()) {
-                            changed = true;
-                        }
-                        if (it.second->CouldComputeStartChannel) {
-                            workDone = true;
-                        }
-                    }
-                }
+    while (!ready.empty()) {
+        std::string name = ready.front();
+        ready.pop_front();
+        apply(models.at(name));
+        waitingOn.erase(name);
+        for (const auto& dep : dependents[name]) {
+            auto w = waitingOn.find(dep);
+            if (w != waitingOn.end() && --w->second == 0) {
+                ready.push_back(dep);
             }
         }
+    }
 
-    } while (workDone);
+    // anything left is part of a loop, it still needs its nodes but its start channel cannot be worked out
+    for (const auto& it : waitingOn) {
+        apply(models.at(it.first));
+    }
 
-    // now process anything unprocessed
     int countInvalid = 0;
     for (const auto& it : models) {
-        if (it.second->GetDisplayAs() != "ModelGroup") {
-            char first = '0';
-            if (!Trim(it.second->ModelStartChannel).empty())
-                first = Trim(it.second->ModelStartChannel)[0];
-            if ((first == '>' || first == '@') && !it.second->CouldComputeStartChannel) {
-                modelsDone.emplace(it.first);
-                auto oldsc = it.second->GetFirstChannel();
-                it.second->SetFromXml(it.second->GetModelXml());
-                if (oldsc != it.second->GetFirstChannel()) {
-                    changed = true;
-                }
-            }
-            if (!it.second->CouldComputeStartChannel) {
-                countInvalid++;
-            }
+        if (it.second->GetDisplayAs() != "ModelGroup" && !it.second->CouldComputeStartChannel) {
+            countInvalid++;
         }
     }
 
@@ -507,3 +507,19 @@ void NodeClassSuperString::GetForChannels(unsigned char* buf) const
         break;
     }
 }
+
+void MoveNodesWithStrings(std::vector<NodeBaseClassPtr>& nodes, const std::vector<int32_t>& oldStringStarts, const std::vector<int32_t>& stringStarts)
+{
+    for (auto& n : nodes) {
+        n->ActChan += stringStarts[n->StringNum] - oldStringStarts[n->StringNum];
+    }
+}
+
+uint32_t GetFirstNodeChannel(const std::vector<NodeBaseClassPtr>& nodes)
+{
+    uint32_t res = UINT32_MAX;
+    for (const auto& n : nodes) {
+        res = (std::min)(res, n->ActChan);
+    }
+    return res;
+}
@@ -268,6 +268,11 @@ public:
         return chanCnt;
     }
 
+    // offset from ActChan of the channel holding red (0), green (1) or blue (2), 255 if there is none
+    uint8_t GetChannelOffset(int component) const {
+        return offsets[component];
+    }
+
     bool IsVisible() const {
         return !Coords.empty();
     }
@@ -619,3 +624,8 @@ private:
 };
 
 typedef std::unique_ptr<NodeBaseClass> NodeBaseClassPtr;
+
+// moves every node as far as the start of its string moved, each node's string must be in both
+void MoveNodesWithStrings(std::vector<NodeBaseClassPtr>& nodes, const std::vector<int32_t>& oldStringStarts, const std::vector<int32_t>& stringStarts);
+// the lowest channel any of the nodes uses, UINT32_MAX if there are none
+uint32_t GetFirstNodeChannel(const std::vector<NodeBaseClassPtr>& nodes);
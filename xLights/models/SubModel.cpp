@@ -84,7 +84,6 @@ SubModel::SubModel(Model* p, wxXmlNode* n) :
         return std::make_pair(i, i);
     };
 
-    unsigned int startChannel = UINT32_MAX;
     if (isRanges) {
         if (_bufferStyle == KEEP_XY) {
             int line = 0;
@@ -143,7 +142,6 @@ SubModel::SubModel(Model* p, wxXmlNode* n) :
                 // ignore nodes indexes if they are out of range
                 if (idx < p->Nodes.size()) {
                     NodeBaseClass* node = p->Nodes[idx]->clone();
-                    startChannel = (std::min)(startChannel, node->ActChan);
                     Nodes.push_back(NodeBaseClassPtr(node));
                     for (auto& c : node->Coords) {
                         c.bufX -= minx;
@@ -195,7 +193,6 @@ SubModel::SubModel(Model* p, wxXmlNode* n) :
                                 NodeBaseClass* node;
                                 if (nodeIndexMap.find(nn) == nodeIndexMap.end()) {
                                     node = p->Nodes[nn]->clone();
-                                    startChannel = (std::min)(startChannel, node->ActChan);
                                     nodeIndexMap[nn] = Nodes.size();
                                     Nodes.push_back(NodeBaseClassPtr(node));
                                     if (node->Coords.size() > 1) {
@@ -310,7 +307,6 @@ SubModel::SubModel(Model* p, wxXmlNode* n) :
         for (int m = 0; m < nn; m++) {
             if (p->IsNodeInBufferRange(m, x1, y1, x2, y2)) {
                 NodeBaseClass* node = p->Nodes[m]->clone();
-                startChannel = (std::min)(startChannel, node->ActChan);
                 Nodes.push_back(NodeBaseClassPtr(node));
                 for (auto& c : node->Coords) {
                     c.bufX -= minx;
@@ -329,7 +325,7 @@ SubModel::SubModel(Model* p, wxXmlNode* n) :
         }
     }
     //ModelStartChannel is 1 based
-    this->ModelStartChannel = wxString::Format("%u", (startChannel + 1));
+    this->ModelStartChannel = wxString::Format("%u", (GetFirstNodeChannel(Nodes) + 1));
 
     // inherit pixel properties from parent model
     _pixelStyle = p->_pixelStyle;
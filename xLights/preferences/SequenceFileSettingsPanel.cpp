@@ -46,6 +46,7 @@ const long SequenceFileSettingsPanel::ID_BUTTON_ADDMEDIA = wxNewId();
 const long SequenceFileSettingsPanel::ID_BUTTON_REMOVE_MEDIA = wxNewId();
 const long SequenceFileSettingsPanel::ID_STATICTEXT2 = wxNewId();
 const long SequenceFileSettingsPanel::ID_CHOICE_VIEW_DEFAULT = wxNewId();
+const long SequenceFileSettingsPanel::ID_CHECKBOX_SIDECAR = wxNewId();
 //*)
 
 BEGIN_EVENT_TABLE(SequenceFileSettingsPanel,wxPanel)
@@ -165,6 +166,10 @@ SequenceFileSettingsPanel::SequenceFileSettingsPanel(wxWindow* parent,xLightsFra
 	ViewDefaultChoice->SetMinSize(wxSize(200,-1));
 	ViewDefaultChoice->SetToolTip(_("This option is used to select which models will populate the master view when a new sequence is created."));
 	GridBagSizer1->Add(ViewDefaultChoice, wxGBPosition(3, 1), wxDefaultSpan, wxALL|wxEXPAND, 5);
+	CheckBox_SequenceSidecar = new wxCheckBox(this, ID_CHECKBOX_SIDECAR, _("Binary Sequence Cache (.xsqb)"), wxDefaultPosition, wxDefaultSize, 0, wxDefaultValidator, _T("ID_CHECKBOX_SIDECAR"));
+	CheckBox_SequenceSidecar->SetValue(false);
+	CheckBox_SequenceSidecar->SetToolTip(_("Save a binary copy of the effects next to each sequence so unchanged sequences re-open much faster."));
+	GridBagSizer1->Add(CheckBox_SequenceSidecar, wxGBPosition(11, 0), wxGBSpan(1, 2), wxALL|wxALIGN_LEFT|wxALIGN_CENTER_VERTICAL, 5);
 	SetSizer(GridBagSizer1);
 	GridBagSizer1->Fit(this);
 	GridBagSizer1->SetSizeHints(this);
@@ -185,6 +190,7 @@ SequenceFileSettingsPanel::SequenceFileSettingsPanel(wxWindow* parent,xLightsFra
 	Connect(ID_BUTTON_ADDMEDIA,wxEVT_COMMAND_BUTTON_CLICKED,(wxObjectEventFunction)&SequenceFileSettingsPanel::OnAddMediaButtonClick);
 	Connect(ID_BUTTON_REMOVE_MEDIA,wxEVT_COMMAND_BUTTON_CLICKED,(wxObjectEventFunction)&SequenceFileSettingsPanel::OnRemoveMediaButtonClick);
 	Connect(ID_CHOICE_VIEW_DEFAULT,wxEVT_COMMAND_CHOICE_SELECTED,(wxObjectEventFunction)&SequenceFileSettingsPanel::OnViewDefaultChoiceSelect);
+	Connect(ID_CHECKBOX_SIDECAR,wxEVT_COMMAND_CHECKBOX_CLICKED,(wxObjectEventFunction)&SequenceFileSettingsPanel::OnCheckBox_SequenceSidecarClick);
 	//*)
 
 	GridBagSizer1->Fit(this);
@@ -205,6 +211,7 @@ bool SequenceFileSettingsPanel::TransferDataFromWindow() {
     frame->SetEnableRenderCache(RenderCacheChoice->GetStringSelection());
     frame->SetRenderOnSave(RenderOnSaveCheckBox->IsChecked());
     frame->SetSaveFseqOnSave(FSEQSaveCheckBox->IsChecked());
+    frame->SetSequenceSidecarEnabled(CheckBox_SequenceSidecar->IsChecked());
     frame->SetModelBlendDefaultOff(ModelBlendDefaultChoice->GetSelection());
     frame->SetLowDefinitionRender(CheckBox_LowDefinitionRender->IsChecked());
 
@@ -314,6 +321,7 @@ bool SequenceFileSettingsPanel::TransferDataToWindow() {
     }
     RenderCacheChoice->SetStringSelection(rc);
     FSEQSaveCheckBox->SetValue(frame->SaveFseqOnSave());
+    CheckBox_SequenceSidecar->SetValue(frame->SequenceSidecarEnabled());
     RenderOnSaveCheckBox->SetValue(frame->RenderOnSave());
     
     ModelBlendDefaultChoice->SetSelection(frame->ModelBlendDefaultOff());
@@ -388,6 +396,13 @@ void SequenceFileSettingsPanel::OnFSEQSaveCheckBoxClick(wxCommandEvent& event)
     }
 }
 
+void SequenceFileSettingsPanel::OnCheckBox_SequenceSidecarClick(wxCommandEvent& event)
+{
+    if (wxPreferencesEditor::ShouldApplyChangesImmediately()) {
+        TransferDataFromWindow();
+    }
+}
+
 void SequenceFileSettingsPanel::OnRenderCacheChoiceSelect(wxCommandEvent& event)
 {
     if (wxPreferencesEditor::ShouldApplyChangesImmediately()) {
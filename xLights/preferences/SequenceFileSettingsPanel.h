@@ -43,6 +43,7 @@ class SequenceFileSettingsPanel: public wxPanel
 		wxCheckBox* CheckBox_FSEQ;
 		wxCheckBox* CheckBox_LowDefinitionRender;
 		wxCheckBox* CheckBox_RenderCache;
+		wxCheckBox* CheckBox_SequenceSidecar;
 		wxCheckBox* FSEQSaveCheckBox;
 		wxCheckBox* RenderOnSaveCheckBox;
 		wxChoice* AutoSaveIntervalChoice;
@@ -84,6 +85,7 @@ class SequenceFileSettingsPanel: public wxPanel
 		static const long ID_BUTTON_REMOVE_MEDIA;
 		static const long ID_STATICTEXT2;
 		static const long ID_CHOICE_VIEW_DEFAULT;
+		static const long ID_CHECKBOX_SIDECAR;
 		//*)
 
 	private:
@@ -109,6 +111,7 @@ class SequenceFileSettingsPanel: public wxPanel
 		void OnViewDefaultChoiceSelect(wxCommandEvent& event);
 		void OnCheckBox_LowDefinitionRenderClick(wxCommandEvent& event);
 		void OnChoice_MaximumRenderCacheSelect(wxCommandEvent& event);
+		void OnCheckBox_SequenceSidecarClick(wxCommandEvent& event);
 		//*)
 
 		DECLARE_EVENT_TABLE()
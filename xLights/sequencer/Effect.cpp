@@ -147,7 +147,7 @@ static std::vector<std::string> BUTTON_IDS {
     "C_BUTTON_Palette7", "C_BUTTON_Palette8"
 };
 
-void Effect::ParseColorMap(const SettingsMap &mPaletteMap, xlColorVector &mColors, xlColorCurveVector& mCC) {
+void Effect::ParseColorMap(const SettingsView &mPaletteMap, xlColorVector &mColors, xlColorCurveVector& mCC) {
     mColors.clear();
     mCC.clear();
     if (!mPaletteMap.empty()) {
@@ -182,6 +182,7 @@ Effect::Effect(const Effect& ef)
     mEndTime = ef.mEndTime;
     mParentLayer = ef.mParentLayer;
     mColorMask = ef.mColorMask;
+    std::unique_lock<std::recursive_mutex> lock(ef.settingsLock);
     mSettings = ef.mSettings;
     mPaletteMap = ef.mPaletteMap;
     mColors = ef.mColors;
@@ -196,27 +197,29 @@ Effect::Effect(EffectManager* effectManager, EffectLayer* parent,int id, const s
 
     mColorMask = xlColor::NilColor();
     mEffectIndex = (parent->GetParentElement() == nullptr) ? -1 : parent->GetParentElement()->GetSequenceElements()->GetEffectManager().GetEffectIndex(name);
-    mSettings.Parse(effectManager, settings, name);
-
-    Element* parentElement = parent->GetParentElement();
-    if (!importing && parentElement != nullptr) {
-        Model* model = parentElement->GetSequenceElements()->GetXLightsFrame()->AllModels[parentElement->GetFullName()];
-        FixBuffer(model);
-    }
+    SettingsMap settingsMap;
+    settingsMap.Parse(effectManager, settings, name);
 
     // Fixes an erroneous blank settings created by using:
     //  settings["key"] == "test val"
     // code which as a side effect creates a blank value under the key
     // an example of this is fix to issue #622
-    if (mSettings.Get("T_CHOICE_Out_Transition_Type", "XXX") == "") {
-        mSettings.erase("T_CHOICE_Out_Transition_Type");
+    if (settingsMap.Get("T_CHOICE_Out_Transition_Type", "XXX") == "") {
+        settingsMap.erase("T_CHOICE_Out_Transition_Type");
+    }
+    if (settingsMap.Get("Converted", "XXX") == "") {
+        settingsMap.erase("Converted");
     }
-    if (mSettings.Get("Converted", "XXX") == "") {
-        mSettings.erase("Converted");
+    mSettings.Assign(settingsMap);
+
+    Element* parentElement = parent->GetParentElement();
+    if (!importing && parentElement != nullptr) {
+        Model* model = parentElement->GetSequenceElements()->GetXLightsFrame()->AllModels[parentElement->GetFullName()];
+        FixBuffer(model);
     }
 
     // check for any other odd looking blank settings
-    //for (const auto& it : mSettings)
+    //for (const auto& it : settingsMap)
     //{
     //    if (it.second == "")
     //    {
@@ -240,8 +243,10 @@ Effect::Effect(EffectManager* effectManager, EffectLayer* parent,int id, const s
         mName = new std::string(name);
     }
 
-    mPaletteMap.Parse(effectManager, palette, name);
-    ParseColorMap(mPaletteMap, mColors, mCC);
+    SettingsMap paletteMap;
+    paletteMap.Parse(effectManager, palette, name);
+    mPaletteMap.Assign(paletteMap);
+    ParseColorMap(mPaletteMap.View(), mColors, mCC);
 }
 
 Effect::~Effect()
@@ -331,17 +336,15 @@ void Effect::SetEffectName(const std::string & name)
 std::string Effect::GetSetting(const std::string& id) const
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
-    if (mSettings.Contains(id)) {
-        return mSettings[id];
-    }
-    return "";
+    return mSettings.View().Get(id, xlEMPTY_STRING);
 }
 
 bool Effect::SetSetting(const std::string& id, const std::string &v)
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
-    if (!mSettings.Contains(id) || mSettings[id] != v) {
-        mSettings[id] = v;
+    SettingsView settings = mSettings.View();
+    if (!settings.Contains(id) || settings[id] != v) {
+        (*mSettings.Edit())[id] = v;
         IncrementChangeCount();
         return true;
     }
@@ -357,6 +360,7 @@ void Effect::SetStartTimeMS(int startTimeMS)
 {
     wxASSERT(!IsLocked());
 
+    bool moved = startTimeMS != mStartTime;
     if (startTimeMS > mStartTime) {
         IncrementChangeCount();
         mStartTime = startTimeMS;
@@ -364,12 +368,16 @@ void Effect::SetStartTimeMS(int startTimeMS)
         mStartTime = startTimeMS;
         IncrementChangeCount();
     }
+    if (moved) {
+        mParentLayer->InvalidateTimeIndex();
+    }
 }
 
 void Effect::SetEndTimeMS(int endTimeMS)
 {
     wxASSERT(!IsLocked());
 
+    bool moved = endTimeMS != mEndTime;
     if (endTimeMS < mEndTime) {
         IncrementChangeCount();
         mEndTime = endTimeMS;
@@ -377,6 +385,9 @@ void Effect::SetEndTimeMS(int endTimeMS)
         mEndTime = endTimeMS;
         IncrementChangeCount();
     }
+    if (moved) {
+        mParentLayer->InvalidateTimeIndex();
+    }
 }
 
 bool Effect::OverlapsWith(int startTimeMS, int EndTimeMS) const
@@ -417,14 +428,14 @@ void Effect::ConvertTo(int effectIndex)
 {
     if (effectIndex != mEffectIndex) {
         SetEffectIndex(effectIndex);
+        std::unique_lock<std::recursive_mutex> lock(settingsLock);
         SettingsMap newSettings;
         // remove any E_ settings as the effect type has changed
-        for (const auto& it : mSettings) {
+        for (const auto& it : mSettings.View()) {
             if (!StartsWith(it.first, "E_")) {
                 newSettings[it.first] = it.second;
             }
         }
-        mSettings = newSettings;
 
         std::string palette;
         std::string effectText = xLightsApp::GetFrame()->GetEffectTextFromWindows(palette);
@@ -434,10 +445,11 @@ void Effect::ConvertTo(int effectIndex)
             if (StartsWith(it, "E_")) {
                 auto sv = wxSplit(it, '=');
                 if (sv.size()==2) {
-                    mSettings[sv[0]] = sv[1];
+                    newSettings[sv[0]] = sv[1];
                 }
             }
         }
+        mSettings.Assign(newSettings);
     }
 }
 
@@ -453,7 +465,7 @@ bool Effect::IsModelRenderDisabled() const
 bool Effect::IsEffectRenderDisabled() const
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
-    return mSettings.Contains("X_Effect_RenderDisabled");
+    return mSettings.View().Contains("X_Effect_RenderDisabled");
 }
 
 bool Effect::IsRenderDisabled() const
@@ -467,17 +479,17 @@ void Effect::SetEffectRenderDisabled(bool disabled)
 {
     std::unique_lock<std::recursive_mutex> getlock(settingsLock);
     if (disabled) {
-        mSettings["X_Effect_RenderDisabled"] = "True";
+        (*mSettings.Edit())["X_Effect_RenderDisabled"] = "True";
     }
-    else {
-        mSettings.erase("X_Effect_RenderDisabled");
+    else if (mSettings.View().Contains("X_Effect_RenderDisabled")) {
+        mSettings.Edit()->erase("X_Effect_RenderDisabled");
     }
 }
 
 bool Effect::IsLocked() const
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
-    return mSettings.Contains("X_Effect_Locked");
+    return mSettings.View().Contains("X_Effect_Locked");
 }
 
 void Effect::SetLocked(bool lock)
@@ -485,11 +497,11 @@ void Effect::SetLocked(bool lock)
     std::unique_lock<std::recursive_mutex> getlock(settingsLock);
     if (lock)
     {
-        mSettings["X_Effect_Locked"] = "True";
+        (*mSettings.Edit())["X_Effect_Locked"] = "True";
     }
-    else
+    else if (mSettings.View().Contains("X_Effect_Locked"))
     {
-        mSettings.erase("X_Effect_Locked");
+        mSettings.Edit()->erase("X_Effect_Locked");
     }
 }
 
@@ -506,13 +518,13 @@ void Effect::IncrementChangeCount()
 std::string Effect::GetSettingsAsString() const
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
-    return mSettings.AsString();
+    return mSettings.View().AsString();
 }
 
 std::string Effect::GetSettingsAsJSON() const
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
-    return mSettings.AsJSON();
+    return mSettings.View().AsJSON();
 }
 
 void Effect::SetSettings(const std::string& settings, bool keepxsettings, bool json) {
@@ -522,18 +534,20 @@ void Effect::SetSettings(const std::string& settings, bool keepxsettings, bool j
 
     SettingsMap x;
     if (keepxsettings) {
-        for (const auto& it : mSettings) {
+        for (const auto& it : mSettings.View()) {
             if (it.first.size() > 2 && it.first[0] == 'X' && it.first[1] == '_') {
                 x[it.first] = it.second;
             }
         }
     }
-    json ? mSettings.ParseJson(nullptr, settings, "") : mSettings.Parse(nullptr, settings, "");
+    SettingsMap newSettings;
+    json ? newSettings.ParseJson(nullptr, settings, "") : newSettings.Parse(nullptr, settings, "");
     if (keepxsettings) {
         for (const auto& it : x) {
-            mSettings[it.first] = it.second;
+            newSettings[it.first] = it.second;
         }
     }
+    mSettings.Assign(newSettings);
 
     if (old != GetSettingsAsString()) {
         IncrementChangeCount();
@@ -546,10 +560,12 @@ bool Effect::SettingsChanged(const std::string& settings)
     SettingsMap x;
     x.Parse(nullptr, settings, "");
 
-    if (mSettings.size() != x.size())
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    SettingsView current = mSettings.View();
+    if (current.size() != x.size())
         return true;
 
-    for (const auto& it: mSettings) {
+    for (const auto& it: current) {
         if (it.second != x[it.first])
             return true;
     }
@@ -562,7 +578,10 @@ void Effect::PressButton(RenderableEffect* re, const std::string& id)
     bool changed = false;
     if (StartsWith(id, "E_"))
     {
-        changed = re->PressButton(id, mPaletteMap, mSettings);
+        std::unique_lock<std::recursive_mutex> lock(settingsLock);
+        auto palette = mPaletteMap.Edit();
+        auto settings = mSettings.Edit();
+        changed = re->PressButton(id, *palette, *settings);
     }
     else
     {
@@ -575,52 +594,55 @@ void Effect::PressButton(RenderableEffect* re, const std::string& id)
 void Effect::ApplySetting(const std::string& id, const std::string& value, ValueCurve* vc, const std::string& vcid)
 {
     static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
     wxString idd(id);
     if (idd.StartsWith("C_"))
     {
+        auto palette = mPaletteMap.Edit();
         if (vc != nullptr && vc->IsActive())
         {
-            mPaletteMap[vcid] = vc->Serialise();
+            (*palette)[vcid] = vc->Serialise();
         }
         else
         {
-            mPaletteMap.erase(vcid);
-            mPaletteMap[id] = value;
+            palette->erase(vcid);
+            (*palette)[id] = value;
         }
     }
     else
     {
+        auto settings = mSettings.Edit();
         if (vc != nullptr && vc->IsActive())
         {
-            mSettings[vcid] = vc->Serialise();
+            (*settings)[vcid] = vc->Serialise();
         }
         else
         {
-            mSettings.erase(vcid);
+            settings->erase(vcid);
 
             wxString wid = id;
 
             if (wid.Contains("FILEPICKER")) {
                 wxString realid = wid.substr(0, wid.Length() - 3);
                 if (wid.EndsWith("_FN")) {
-                    mSettings[realid] = value;
+                    (*settings)[realid] = value;
                 } else if (wid.EndsWith("_PN")) {
-                    if (mSettings.Contains(realid) && mSettings.Get(realid, "") != "") {
-                        wxString origName = mSettings[realid];
+                    if (settings->Contains(realid) && settings->Get(realid, "") != "") {
+                        wxString origName = (*settings)[realid];
                         wxFileName fn(origName, origName[1] == ':' ? wxPATH_WIN : wxPATH_UNIX);
                         fn.SetPath(value);
                         wxString newName = fn.GetFullPath();
-                        mSettings[realid] = newName;
+                        (*settings)[realid] = newName;
                     }
                 }
                 else if (wid.EndsWith("_SF")) {
-                    if (mSettings.Contains(realid) && mSettings.Get(realid, "") != "") {
+                    if (settings->Contains(realid) && settings->Get(realid, "") != "") {
 
                         // This moves through all possible options to locate the file relative to the provided show folder.
                         // This will be the deepest path possible ... so if the file exists in multiple locations it will find the 
                         // deepest valid path
                         // This only updates the path if we find the file ... if not found there will be no errors but it will log the issue
-                        wxString origName = mSettings[realid];
+                        wxString origName = (*settings)[realid];
 
                         wxFileName fn(origName, origName[1] == ':' ? wxPATH_WIN : wxPATH_UNIX);
 
@@ -635,17 +657,17 @@ void Effect::ApplySetting(const std::string& id, const std::string& value, Value
                             pth += file;
                             if (FileExists(pth)) {
                                 // found it
-                                mSettings[realid] = pth;
+                                (*settings)[realid] = pth;
                                 break;
                             }
                         }
-                        if (origName == mSettings[realid] && !FileExists(origName)) {
+                        if (origName == (*settings)[realid] && !FileExists(origName)) {
                             logger_base.warn("Unable to correct show folder '%s' : '%s' to '%s'", (const char*)realid.c_str(), (const char*)origName.c_str(), (const char*)value.c_str());
                         }
                     }
                 }
             } else {
-                mSettings[id] = value;
+                (*settings)[id] = value;
             }
         }
     }
@@ -654,11 +676,13 @@ void Effect::ApplySetting(const std::string& id, const std::string& value, Value
 
 bool Effect::UsesColour(const std::string& from)
 {
-    for (auto it : mPaletteMap) {
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    SettingsView palette = mPaletteMap.View();
+    for (const auto& it : palette) {
         if (StartsWith(it.first, "C_BUTTON")) { // only check the colours
             if (Lower(it.second) == Lower(from)) { // check the colours match
                 std::string setting = "C_CHECKBOX" + it.first.substr(8);
-                if (mPaletteMap.Get(setting, "0") == "1") { // check the colours checkbox is checked
+                if (palette.Get(setting, "0") == "1") { // check the colours checkbox is checked
                     return true;
                 }
             }
@@ -669,21 +693,30 @@ bool Effect::UsesColour(const std::string& from)
 
 int Effect::ReplaceColours(xLightsFrame* frame, const std::string& from, const std::string& to)
 {
-    int res = 0;
-    for (auto it : mPaletteMap) {
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    std::vector<std::string> replace;
+    SettingsView palette = mPaletteMap.View();
+    for (const auto& it : palette) {
         if (StartsWith(it.first, "C_BUTTON")) {
             if (Lower(it.second) == Lower(from)) {
                 std::string setting = "C_CHECKBOX" + it.first.substr(8);
-                if (mPaletteMap.Get(setting, "0") == "1") {
-                    mPaletteMap[it.first] = to;
-                    res++;
+                if (palette.Get(setting, "0") == "1") {
+                    replace.push_back(it.first);
                 }
             }
         }
     }
+    int res = replace.size();
 
     if (res > 0) {
-        ParseColorMap(mPaletteMap, mColors, mCC);
+        {
+            auto edit = mPaletteMap.Edit();
+            for (const auto& it : replace) {
+                (*edit)[it] = to;
+            }
+        }
+        ParseColorMap(mPaletteMap.View(), mColors, mCC);
+        lock.unlock();
 
         // we changed so this effect needs to re-render
         frame->RenderEffectForModel(GetParentEffectLayer()->GetParentElement()->GetModelName(),
@@ -694,26 +727,57 @@ int Effect::ReplaceColours(xLightsFrame* frame, const std::string& from, const s
     return res;
 }
 
+SettingsView Effect::GetSettingsView() const
+{
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    return mSettings.Snapshot();
+}
+
+SettingsView Effect::GetPaletteView() const
+{
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    return mPaletteMap.Snapshot();
+}
+
+bool Effect::HasPaletteSettings() const
+{
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    return !mPaletteMap.View().empty();
+}
+
+SettingsMap& Effect::GetSettings()
+{
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    return mSettings.Map();
+}
+
+SettingsMap& Effect::GetPaletteMap()
+{
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    return mPaletteMap.Map();
+}
+
 void Effect::CopySettingsMap(SettingsMap &target, bool stripPfx) const
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
 
-    for (std::map<std::string,std::string>::const_iterator it=mSettings.begin(); it!=mSettings.end(); ++it)
+    for (const auto& it : mSettings.View())
     {
-        std::string name = it->first;
-        if (stripPfx && name[1] == '_')
+        if (stripPfx && it.first[1] == '_')
         {
-            name = name.substr(2);
+            target[it.first.substr(2)] = it.second;
+        }
+        else
+        {
+            target[it.first] = it.second;
         }
-        target[name] = it->second;
     }
-    for (std::map<std::string,std::string>::const_iterator it=mPaletteMap.begin(); it!=mPaletteMap.end(); ++it)
+    for (const auto& it : mPaletteMap.View())
     {
-        std::string name = it->first;
+        const std::string& name = it.first;
         if (stripPfx && name[1] == '_'  && (name[2] == 'S' || name[2] == 'C' || name[2] == 'V')) //only need the slider, checkbox and value curve entries
         {
-            name = name.substr(2);
-            target[name] = it->second;
+            target[name.substr(2)] = it.second;
         }
     }
 }
@@ -722,28 +786,30 @@ void Effect::CopySettingsMap(SettingsMap &target, bool stripPfx) const
 void Effect::FixBuffer(const Model* m)
 {
     if (m == nullptr) return;
-    auto style = mSettings.Get("B_CHOICE_BufferStyle", "Default");
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    auto style = mSettings.View().Get("B_CHOICE_BufferStyle", "Default");
     std::string newStyle = m->AdjustBufferStyle(style);
     if (newStyle != style) {
-        mSettings["B_CHOICE_BufferStyle"] = newStyle;
+        (*mSettings.Edit())["B_CHOICE_BufferStyle"] = newStyle;
     }
 }
 
 bool Effect::IsPersistent() const
 {
-    return mSettings.GetBool("B_CHECKBOX_OverlayBkg", false);
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    return mSettings.View().GetBool("B_CHECKBOX_OverlayBkg", false);
 }
 
 std::string Effect::GetPaletteAsString() const
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
-    return mPaletteMap.AsString();
+    return mPaletteMap.View().AsString();
 }
 
 std::string Effect::GetPaletteAsJSON() const
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
-    return mPaletteMap.AsJSON();
+    return mPaletteMap.View().AsJSON();
 }
 
 void Effect::SetPalette(const std::string& i)
@@ -752,11 +818,13 @@ void Effect::SetPalette(const std::string& i)
 
     auto old = GetPaletteAsString();
 
-    mPaletteMap.Parse(nullptr, i, "");
+    SettingsMap paletteMap;
+    paletteMap.Parse(nullptr, i, "");
+    mPaletteMap.Assign(paletteMap);
     mColors.clear();
     mCC.clear();
-    if (!mPaletteMap.empty()) {
-        ParseColorMap(mPaletteMap, mColors, mCC);
+    if (!paletteMap.empty()) {
+        ParseColorMap(mPaletteMap.View(), mColors, mCC);
     }
     if (old != GetPaletteAsString()) {
         IncrementChangeCount();
@@ -768,30 +836,29 @@ void Effect::SetColourOnlyPalette(const std::string& i, bool json)
 {
     std::unique_lock<std::recursive_mutex> lock(settingsLock);
 
-    // save the old palette
-    auto oldPalette = mPaletteMap;
-
     // parse in the new one
-    json ? mPaletteMap.ParseJson(nullptr, i, "") : mPaletteMap.Parse(nullptr, i, "");
+    SettingsMap paletteMap;
+    json ? paletteMap.ParseJson(nullptr, i, "") : paletteMap.Parse(nullptr, i, "");
 
-    // copy over all the non colour entries
-    for (auto it = oldPalette.begin(); it != oldPalette.end(); ++it)
+    // copy over all the non colour entries from the old palette
+    for (const auto& it : mPaletteMap.View())
     {
-        wxString key(it->first);
+        wxString key(it.first);
         if (!key.StartsWith("C_BUTTON_Palette") && !key.StartsWith("C_CHECKBOX_Palette"))
         {
-            mPaletteMap[it->first] = it->second;
+            paletteMap[it.first] = it.second;
         }
     }
+    mPaletteMap.Assign(paletteMap);
 
     mColors.clear();
     mCC.clear();
     IncrementChangeCount();
-    if (mPaletteMap.empty())
+    if (paletteMap.empty())
     {
         return;
     }
-    ParseColorMap(mPaletteMap, mColors, mCC);
+    ParseColorMap(mPaletteMap.View(), mColors, mCC);
 }
 
 void Effect::CopyPalette(xlColorVector &target, xlColorCurveVector& newcc) const
@@ -803,12 +870,14 @@ void Effect::CopyPalette(xlColorVector &target, xlColorCurveVector& newcc) const
 
 void Effect::EraseSettingsStartingWith(const std::string& s)
 {
-    auto it = GetSettings().begin();
-    while (it != GetSettings().end()) {
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    auto settings = mSettings.Edit();
+    auto it = settings->begin();
+    while (it != settings->end()) {
         if (StartsWith(it->first, "B_")) {
             auto next = it;
             ++next;
-            GetSettings().erase(it->first);
+            settings->erase(it->first);
             it = next;
         } else {
             ++it;
@@ -818,12 +887,14 @@ void Effect::EraseSettingsStartingWith(const std::string& s)
 
 void Effect::ErasePalette()
 {
-    auto it = GetPaletteMap().begin();
-    while (it != GetPaletteMap().end()) {
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    auto palette = mPaletteMap.Edit();
+    auto it = palette->begin();
+    while (it != palette->end()) {
         if (StartsWith(it->first, "C_BUTTON_Palette") || StartsWith(it->first, "C_CHECKBOX_Palette")) {
             auto next = it;
             ++next;
-            GetPaletteMap().erase(it->first);
+            palette->erase(it->first);
             it = next;
         } else {
             ++it;
@@ -833,12 +904,14 @@ void Effect::ErasePalette()
 
 void Effect::EraseColourSettings()
 {
-    auto it = GetPaletteMap().begin();
-    while (it != GetPaletteMap().end()) {
+    std::unique_lock<std::recursive_mutex> lock(settingsLock);
+    auto palette = mPaletteMap.Edit();
+    auto it = palette->begin();
+    while (it != palette->end()) {
         if (!StartsWith(it->first, "C_BUTTON_Palette") && !StartsWith(it->first, "C_CHECKBOX_Palette")) {
             auto next = it;
             ++next;
-            GetPaletteMap().erase(it->first);
+            palette->erase(it->first);
             it = next;
         } else {
             ++it;
@@ -851,11 +924,12 @@ void Effect::PaletteMapUpdated() {
     mColors.clear();
     mCC.clear();
     IncrementChangeCount();
-    if (mPaletteMap.empty())
+    SettingsView palette = mPaletteMap.View();
+    if (palette.empty())
     {
         return;
     }
-    ParseColorMap(mPaletteMap, mColors, mCC);
+    ParseColorMap(palette, mColors, mCC);
 }
 
 bool operator<(const Effect &e1, const Effect &e2)
@@ -18,6 +18,7 @@
 
 #include "../ColorCurve.h" // This needs to be here
 #include "../UtilClasses.h"
+#include "EffectSettings.h"
 #include "../graphics/xlGraphicsAccumulators.h"
 #include "../Color.h"
 
@@ -52,8 +53,8 @@ class Effect
     EffectLayer* mParentLayer = nullptr;
     xlColor mColorMask = xlBLACK;
     mutable std::recursive_mutex settingsLock;
-    SettingsMap mSettings;
-    SettingsMap mPaletteMap;
+    EffectSettings mSettings;
+    EffectSettings mPaletteMap;
     xlColorVector mColors;
     xlColorCurveVector mCC;
     xlDisplayList background;
@@ -61,7 +62,7 @@ class Effect
     wxLongLong _timeToDelete = 0;
 
     Effect() {}  //don't allow default or copy constructor
-    static void ParseColorMap(const SettingsMap &mPaletteMap, xlColorVector &mColors, xlColorCurveVector& mCC);
+    static void ParseColorMap(const SettingsView &mPaletteMap, xlColorVector &mColors, xlColorCurveVector& mCC);
 
 public:
     Effect(EffectManager* effectManager, EffectLayer* parent, int id, const std::string & name, const std::string &settings, const std::string &palette,
@@ -126,14 +127,19 @@ public:
     bool UsesColour(const std::string& from);
     int ReplaceColours(xLightsFrame* frame, const std::string& from, const std::string& to);
     void PressButton(RenderableEffect* re, const std::string& id);
-    const SettingsMap &GetSettings() const { return mSettings; }
+    // Read only views of the settings and palette, they do not cost the effect a SettingsMap and
+    // stay as they were when taken whatever happens to the effect after. Asking for a SettingsMap
+    // moves the effect's settings out of the shared pool into one, from then on views share a
+    // copy of it that is only made again once the map has changed.
+    SettingsView GetSettingsView() const;
+    SettingsView GetPaletteView() const;
+    bool HasPaletteSettings() const;
     void CopySettingsMap(SettingsMap &target, bool stripPfx = false) const;
     void FixBuffer(const Model* m);
     bool IsPersistent() const;
 
     const xlColorVector &GetPalette() const { return mColors; }
     int GetPaletteSize() const { return mColors.size(); }
-    const SettingsMap &GetPaletteMap() const { return mPaletteMap; }
     std::string GetPaletteAsString() const;
     std::string GetPaletteAsJSON() const;
     void SetPalette(const std::string& i);
@@ -144,9 +150,9 @@ public:
     void EraseColourSettings();
 
     /* Do NOT call these on any thread other than the main thread */
-    SettingsMap &GetSettings() { return mSettings; }
+    SettingsMap &GetSettings();
     xlColorVector &GetPalette() { return mColors; }
-    SettingsMap &GetPaletteMap() { return mPaletteMap; }
+    SettingsMap &GetPaletteMap();
     void PaletteMapUpdated();
 
     xlDisplayList &GetBackgroundDisplayList() { return background; }
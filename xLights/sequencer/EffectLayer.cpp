@@ -9,6 +9,8 @@
  **************************************************************/
 
 #include <algorithm>
+#include <limits>
+#include <unordered_set>
 #include <vector>
 
 #include "EffectLayer.h"
@@ -21,6 +23,7 @@
 #include "Element.h"
 #include "../xLightsMain.h"
 #include "../xLightsApp.h"
+#include "../RenderLayerCache.h"
 
 #include <log4cpp/Category.hh>
 #include "effects/DMXEffect.h"
@@ -48,6 +51,7 @@ EffectLayer::~EffectLayer()
     if (name != nullptr) {
         delete name;
     }
+    RenderLayerCache::Remove(this);
 }
 
 // Some actions can be done while rendering so we don't want to abort the render,
@@ -104,7 +108,7 @@ Effect* EffectLayer::GetEffect(int index) const
 
 Effect* EffectLayer::GetEffectByTime(int timeMS) {
     std::unique_lock<std::recursive_mutex> locker(acquireLockWaitForRender());
-    for(const auto& it : mEffects) {
+    for (const auto& it : GetEffectsInTimeRange(timeMS, timeMS)) {
         if (timeMS >= it->GetStartTimeMS() &&
             timeMS <= it->GetEndTimeMS()) {
             return it;
@@ -153,6 +157,7 @@ void EffectLayer::RemoveEffect(int index)
         Effect *e = mEffects[index];
         if (!e->IsLocked()) {
             mEffects.erase(mEffects.begin() + index);
+            InvalidateTimeIndex();
             IncrementChangeCount(e->GetStartTimeMS(), e->GetEndTimeMS());
             e->SetTimeToDelete();
             std::unique_lock<std::mutex> e2dLocker(effectsToDeleteLock);
@@ -172,6 +177,7 @@ void EffectLayer::DeleteEffect(int id)
             std::unique_lock<std::mutex> e2dLocker(effectsToDeleteLock);
             mEffectsToDelete.push_back(mEffects[i]);
             mEffects.erase(mEffects.begin() + i);
+            InvalidateTimeIndex();
             NumberEffects();
             return;
         }
@@ -179,6 +185,27 @@ void EffectLayer::DeleteEffect(int id)
     wxASSERT(false);
 }
 
+void EffectLayer::DeleteEffects(const std::vector<Effect*>& effects)
+{
+    std::unique_lock<std::recursive_mutex> locker(acquireLockWaitForRender());
+    std::unordered_set<Effect*> toDelete(effects.begin(), effects.end());
+    std::vector<Effect*> newEffects;
+    newEffects.reserve(mEffects.size());
+    for (const auto& e : mEffects) {
+        if (toDelete.find(e) != toDelete.end()) {
+            IncrementChangeCount(e->GetStartTimeMS(), e->GetEndTimeMS());
+            e->SetTimeToDelete();
+            std::unique_lock<std::mutex> e2dLocker(effectsToDeleteLock);
+            mEffectsToDelete.push_back(e);
+        } else {
+            newEffects.push_back(e);
+        }
+    }
+    mEffects.swap(newEffects);
+    InvalidateTimeIndex();
+    NumberEffects();
+}
+
 void EffectLayer::RemoveAllEffects(UndoManager *undo_mgr)
 {
     std::unique_lock<std::recursive_mutex> locker(acquireLockWaitForRender());
@@ -201,6 +228,7 @@ void EffectLayer::RemoveAllEffects(UndoManager *undo_mgr)
     }
 
     mEffects = newEffects;
+    InvalidateTimeIndex();
 
     // renumber the remaining effects
     NumberEffects();
@@ -248,6 +276,7 @@ Effect* EffectLayer::AddEffect(int id, const std::string &n, const std::string &
     Effect* e = new Effect(em, this, id, name, settings, palette, startTimeMS, endTimeMS, Selected, Protected, importing);
     wxASSERT(e != nullptr);
     mEffects.push_back(e);
+    InvalidateTimeIndex();
     if (!suppress_sort) {
         SortEffects();
     }
@@ -265,9 +294,69 @@ void EffectLayer::NumberEffects()
 void EffectLayer::SortEffects()
 {
     std::sort(mEffects.begin(), mEffects.end(), SortEffectByStartTime);
+    InvalidateTimeIndex();
     NumberEffects();
 }
 
+// mEffects sorted by start time and the latest end time of the effects up to each one in it
+struct EffectLayer::TimeIndex {
+    std::vector<Effect*> effects;
+    std::vector<int> maxEnd;
+};
+
+void EffectLayer::InvalidateTimeIndex()
+{
+    std::unique_lock<std::mutex> locker(mTimeIndexLock);
+    ++mTimeIndexGeneration;
+    mTimeIndex = nullptr;
+}
+
+std::shared_ptr<const EffectLayer::TimeIndex> EffectLayer::GetTimeIndex() const
+{
+    {
+        std::unique_lock<std::mutex> locker(mTimeIndexLock);
+        if (mTimeIndex != nullptr) {
+            return mTimeIndex;
+        }
+    }
+
+    // mEffects only changes under the layer lock, an effect being retimed meanwhile bumps the generation
+    std::unique_lock<std::recursive_mutex> locker(const_cast<EffectLayer*>(this)->acquireLockWaitForRender());
+    uint64_t generation = mTimeIndexGeneration;
+    auto index = std::make_shared<TimeIndex>();
+    // stable so effects starting together stay in layer order, which is the order the scans used to find them in
+    index->effects = mEffects;
+    std::stable_sort(index->effects.begin(), index->effects.end(), SortEffectByStartTime);
+    index->maxEnd.resize(index->effects.size());
+    int maxEnd = std::numeric_limits<int>::min();
+    for (size_t i = 0; i < index->effects.size(); ++i) {
+        maxEnd = std::max(maxEnd, index->effects[i]->GetEndTimeMS());
+        index->maxEnd[i] = maxEnd;
+    }
+
+    std::unique_lock<std::mutex> indexLocker(mTimeIndexLock);
+    if (generation == mTimeIndexGeneration) {
+        mTimeIndex = index;
+    }
+    return index;
+}
+
+EffectLayer::TimeRange EffectLayer::GetEffectsInTimeRange(int startTimeMS, int endTimeMS) const
+{
+    TimeRange res;
+    res._index = GetTimeIndex();
+    const auto& effects = res._index->effects;
+    const auto& maxEnds = res._index->maxEnd;
+    // nothing before the first effect that reaches the start time can overlap, nor anything starting after the end
+    size_t first = std::lower_bound(maxEnds.begin(), maxEnds.end(), startTimeMS) - maxEnds.begin();
+    size_t last = std::upper_bound(effects.begin(), effects.end(), endTimeMS, [](int ms, const Effect* e) { return ms < e->GetStartTimeMS(); }) - effects.begin();
+    if (last > first) {
+        res._begin = effects.data() + first;
+        res._end = effects.data() + last;
+    }
+    return res;
+}
+
 bool EffectLayer::IsStartTimeLinked(int index) const
 {
     if (index < mEffects.size() && index > 0) {
@@ -342,10 +431,10 @@ bool EffectLayer::HitTestEffectByTime(int timeMS, int& index) const
 }
 
 bool EffectLayer::HitTestEffectBetweenTime(int t1MS, int t2MS) const {
-    for (int i = 0; i < mEffects.size(); i++) {
-        if ((mEffects[i]->GetStartTimeMS() > t1MS && mEffects[i]->GetStartTimeMS() < t2MS) ||
-            (mEffects[i]->GetEndTimeMS() > t1MS && mEffects[i]->GetEndTimeMS() < t2MS) ||
-            (mEffects[i]->GetStartTimeMS() == t1MS && mEffects[i]->GetEndTimeMS() == t2MS)) {
+    for (const auto& it : GetEffectsInTimeRange(t1MS, t2MS)) {
+        if ((it->GetStartTimeMS() > t1MS && it->GetStartTimeMS() < t2MS) ||
+            (it->GetEndTimeMS() > t1MS && it->GetEndTimeMS() < t2MS) ||
+            (it->GetStartTimeMS() == t1MS && it->GetEndTimeMS() == t2MS)) {
             return true;
         }
     }
@@ -386,19 +475,19 @@ Effect* EffectLayer::GetEffectAfterTime(int ms, const std::string& filterText, b
 }
 
 Effect* EffectLayer::GetEffectAtTime(int timeMS, const std::string& filterText, bool isFilterTextRegex) const {
-    for (int i = 0; i < mEffects.size(); ++i) {
-        if (timeMS >= mEffects[i]->GetStartTimeMS() &&
-            timeMS <= mEffects[i]->GetEndTimeMS() && mEffects[i]->FilteredIn(filterText, isFilterTextRegex)) {
-            return mEffects[i];
+    for (const auto& it : GetEffectsInTimeRange(timeMS, timeMS)) {
+        if (timeMS >= it->GetStartTimeMS() &&
+            timeMS <= it->GetEndTimeMS() && it->FilteredIn(filterText, isFilterTextRegex)) {
+            return it;
         }
     }
     return nullptr;
 }
 
 Effect* EffectLayer::GetEffectStartingAtTime(int timeMS, const std::string& filterText, bool isFilterTextRegex) const {
-    for (int i = 0; i < mEffects.size(); ++i) {
-        if (timeMS == mEffects[i]->GetStartTimeMS() && mEffects[i]->FilteredIn(filterText, isFilterTextRegex)) {
-            return mEffects[i];
+    for (const auto& it : GetEffectsInTimeRange(timeMS, timeMS)) {
+        if (timeMS == it->GetStartTimeMS() && it->FilteredIn(filterText, isFilterTextRegex)) {
+            return it;
         }
     }
     return nullptr;
@@ -446,27 +535,27 @@ std::list<Effect*> EffectLayer::GetAllEffects() const
 
 bool EffectLayer::GetRangeIsClearMS(int startTimeMS, int endTimeMS, bool ignore_selected)
 {
-    for (int i = 0; i < mEffects.size(); i++)
+    for (const auto& it : GetEffectsInTimeRange(startTimeMS, endTimeMS))
     {
         if (ignore_selected)
         {
-            if (mEffects[i]->GetSelected())
+            if (it->GetSelected())
             {
                 continue;
             }
         }
         // check if start is between effect range
-        if ((startTimeMS > mEffects[i]->GetStartTimeMS()) && (startTimeMS < mEffects[i]->GetEndTimeMS()))
+        if ((startTimeMS > it->GetStartTimeMS()) && (startTimeMS < it->GetEndTimeMS()))
         {
             return false;
         }
         // check if end is between effect range
-        if ((endTimeMS > mEffects[i]->GetStartTimeMS()) && (endTimeMS < mEffects[i]->GetEndTimeMS()))
+        if ((endTimeMS > it->GetStartTimeMS()) && (endTimeMS < it->GetEndTimeMS()))
         {
             return false;
         }
         // check effect is between start and end
-        if ((mEffects[i]->GetStartTimeMS() >= startTimeMS) && (mEffects[i]->GetEndTimeMS() <= endTimeMS))
+        if ((it->GetStartTimeMS() >= startTimeMS) && (it->GetEndTimeMS() <= endTimeMS))
         {
             return false;
         }
@@ -475,9 +564,9 @@ bool EffectLayer::GetRangeIsClearMS(int startTimeMS, int endTimeMS, bool ignore_
 }
 
 bool EffectLayer::HasEffectsInTimeRange(int startTimeMS, int endTimeMS) {
-    for (int i = 0; i < mEffects.size(); i++)
+    for (const auto& it : GetEffectsInTimeRange(startTimeMS, endTimeMS))
     {
-        if (mEffects[i]->OverlapsWith(startTimeMS, endTimeMS)) return true;
+        if (it->OverlapsWith(startTimeMS, endTimeMS)) return true;
     }
     return false;
 }
@@ -502,36 +591,36 @@ bool EffectLayer::HasEffectsByType(const std::string& type) const
 int EffectLayer::SelectEffectsInTimeRange(int startTimeMS, int endTimeMS)
 {
     int num_selected = 0;
-    for (int i = 0; i < mEffects.size(); i++)
+    for (const auto& it : GetEffectsInTimeRange(startTimeMS, endTimeMS))
     {
-        int midpoint = mEffects[i]->GetStartTimeMS() + ((mEffects[i]->GetEndTimeMS() - mEffects[i]->GetStartTimeMS()) / 2);
-        if (mEffects[i]->GetStartTimeMS() >= startTimeMS && mEffects[i]->GetStartTimeMS() < endTimeMS)
+        int midpoint = it->GetStartTimeMS() + ((it->GetEndTimeMS() - it->GetStartTimeMS()) / 2);
+        if (it->GetStartTimeMS() >= startTimeMS && it->GetStartTimeMS() < endTimeMS)
         {
             if (endTimeMS < midpoint)
             {
-                mEffects[i]->SetSelected(EFFECT_LT_SELECTED);
+                it->SetSelected(EFFECT_LT_SELECTED);
             }
             else
             {
-                mEffects[i]->SetSelected(EFFECT_SELECTED);
+                it->SetSelected(EFFECT_SELECTED);
             }
             num_selected++;
         }
-        else if (mEffects[i]->GetEndTimeMS() <= endTimeMS && mEffects[i]->GetEndTimeMS() > startTimeMS)
+        else if (it->GetEndTimeMS() <= endTimeMS && it->GetEndTimeMS() > startTimeMS)
         {
             if (startTimeMS > midpoint)
             {
-                mEffects[i]->SetSelected(EFFECT_RT_SELECTED);
+                it->SetSelected(EFFECT_RT_SELECTED);
             }
             else
             {
-                mEffects[i]->SetSelected(EFFECT_SELECTED);
+                it->SetSelected(EFFECT_SELECTED);
             }
             num_selected++;
         }
-        else if (mEffects[i]->GetEndTimeMS() > endTimeMS &&  mEffects[i]->GetStartTimeMS() < startTimeMS)
+        else if (it->GetEndTimeMS() > endTimeMS &&  it->GetStartTimeMS() < startTimeMS)
         {
-            mEffects[i]->SetSelected(EFFECT_SELECTED);
+            it->SetSelected(EFFECT_SELECTED);
             num_selected++;
         }
     }
@@ -541,21 +630,21 @@ int EffectLayer::SelectEffectsInTimeRange(int startTimeMS, int endTimeMS)
 std::vector<Effect*> EffectLayer::GetEffectsByTypeAndTime(const std::string &type, int startTimeMS, int endTimeMS)
 {
     std::vector<Effect*> effs = std::vector<Effect*>();
-    for (int i = 0; i < mEffects.size(); i++)
+    for (const auto& it : GetEffectsInTimeRange(startTimeMS, endTimeMS))
     {
-        if (mEffects[i]->GetEffectName() == type)
+        if (it->GetEffectName() == type)
         {
-            if (mEffects[i]->GetStartTimeMS() >= startTimeMS && mEffects[i]->GetStartTimeMS() < endTimeMS)
+            if (it->GetStartTimeMS() >= startTimeMS && it->GetStartTimeMS() < endTimeMS)
             {
-                effs.push_back(mEffects[i]);
+                effs.push_back(it);
             }
-            else if (mEffects[i]->GetEndTimeMS() <= endTimeMS && mEffects[i]->GetEndTimeMS() > startTimeMS)
+            else if (it->GetEndTimeMS() <= endTimeMS && it->GetEndTimeMS() > startTimeMS)
             {
-                effs.push_back(mEffects[i]);
+                effs.push_back(it);
             }
-            else if (mEffects[i]->GetEndTimeMS() > endTimeMS &&  mEffects[i]->GetStartTimeMS() < startTimeMS)
+            else if (it->GetEndTimeMS() > endTimeMS &&  it->GetStartTimeMS() < startTimeMS)
             {
-                effs.push_back(mEffects[i]);
+                effs.push_back(it);
             }
         }
     }
@@ -565,19 +654,19 @@ std::vector<Effect*> EffectLayer::GetEffectsByTypeAndTime(const std::string &typ
 std::vector<Effect*> EffectLayer::GetAllEffectsByTime(int startTimeMS, int endTimeMS)
 {
     std::vector<Effect*> effs = std::vector<Effect*>();
-    for (int i = 0; i < mEffects.size(); i++)
+    for (const auto& it : GetEffectsInTimeRange(startTimeMS, endTimeMS))
     {
-        if (mEffects[i]->GetStartTimeMS() >= startTimeMS && mEffects[i]->GetStartTimeMS() < endTimeMS)
+        if (it->GetStartTimeMS() >= startTimeMS && it->GetStartTimeMS() < endTimeMS)
         {
-            effs.push_back(mEffects[i]);
+            effs.push_back(it);
         }
-        else if (mEffects[i]->GetEndTimeMS() <= endTimeMS && mEffects[i]->GetEndTimeMS() > startTimeMS)
+        else if (it->GetEndTimeMS() <= endTimeMS && it->GetEndTimeMS() > startTimeMS)
         {
-            effs.push_back(mEffects[i]);
+            effs.push_back(it);
         }
-        else if (mEffects[i]->GetEndTimeMS() > endTimeMS &&  mEffects[i]->GetStartTimeMS() < startTimeMS)
+        else if (it->GetEndTimeMS() > endTimeMS &&  it->GetStartTimeMS() < startTimeMS)
         {
-            effs.push_back(mEffects[i]);
+            effs.push_back(it);
         }
     }
     return effs;
@@ -625,13 +714,13 @@ bool EffectLayer::IsEffectValid(Effect* e) const
 
 Effect* EffectLayer::SelectEffectUsingTime(int time)
 {
-    for (int i = 0; i < mEffects.size(); i++)
+    for (const auto& it : GetEffectsInTimeRange(time, time))
     {
-        if (time >= mEffects[i]->GetStartTimeMS() && time < mEffects[i]->GetEndTimeMS())
+        if (time >= it->GetStartTimeMS() && time < it->GetEndTimeMS())
         {
-            mEffects[i]->SetSelected(EFFECT_SELECTED);
-            PlayEffect(mEffects[i]);
-            return mEffects[i];
+            it->SetSelected(EFFECT_SELECTED);
+            PlayEffect(it);
+            return it;
         }
     }
 
@@ -661,14 +750,14 @@ void EffectLayer::SelectAllEffects()
 void EffectLayer::ConvertEffectsToPerModel(UndoManager& undo_manager)
 {
     for (auto& it : mEffects) {
-        auto buffer = it->GetSettings()["B_CHOICE_BufferStyle"];
+        auto buffer = it->GetSetting("B_CHOICE_BufferStyle");
         if (buffer == "Per Preview" || buffer == "Default" || buffer == "Single Line") {
             undo_manager.CaptureModifiedEffect(GetParentElement()->GetName(), GetIndex(), it->GetID(), it->GetSettingsAsString(), it->GetPaletteAsString());
-            it->GetSettings()["B_CHOICE_BufferStyle"] = "Per Model " + buffer;
+            it->SetSetting("B_CHOICE_BufferStyle", "Per Model " + buffer);
         }
         else if (buffer == "") {
             undo_manager.CaptureModifiedEffect(GetParentElement()->GetName(), GetIndex(), it->GetID(), it->GetSettingsAsString(), it->GetPaletteAsString());
-            it->GetSettings()["B_CHOICE_BufferStyle"] = "Per Model Default";
+            it->SetSetting("B_CHOICE_BufferStyle", "Per Model Default");
         }
     }
 }
@@ -1312,6 +1401,7 @@ void EffectLayer::DeleteSelectedEffects(UndoManager& undo_mgr)
         }
     }
     mEffects.erase(std::remove_if(mEffects.begin(), mEffects.end(), ShouldDeleteSelected),mEffects.end());
+    InvalidateTimeIndex();
 }
 
 void EffectLayer::DeleteAllEffects()
@@ -1327,6 +1417,7 @@ void EffectLayer::DeleteAllEffects()
         }
     }
     mEffects.erase(std::remove_if(mEffects.begin(), mEffects.end(), ShouldDeleteNotLocked), mEffects.end());
+    InvalidateTimeIndex();
 }
 
 void EffectLayer::DeleteEffectByIndex(int idx) {
@@ -1338,6 +1429,7 @@ void EffectLayer::DeleteEffectByIndex(int idx) {
         std::unique_lock<std::mutex> e2dLocker(effectsToDeleteLock);
         mEffectsToDelete.push_back(mEffects[idx]);
         mEffects.erase(mEffects.begin() + idx);
+        InvalidateTimeIndex();
     }
 }
 
@@ -1358,6 +1450,7 @@ bool EffectLayer::SortEffectByStartTime(Effect *e1,Effect *e2)
 
 void EffectLayer::IncrementChangeCount(int startMS, int endMS)
 {
+    RenderLayerCache::Invalidate(this, startMS, endMS);
     if (mParentElement) {
         mParentElement->IncrementChangeCount(startMS, endMS);
     }
@@ -1374,7 +1467,7 @@ std::list<std::string> EffectLayer::GetFileReferences(Model* model, EffectManage
         if (ef->GetEffectIndex() >= 0)
         {
             RenderableEffect *eff = em[ef->GetEffectIndex()];
-            res.splice(end(res), eff->GetFileReferences(model, ef->GetSettings()));
+            res.splice(end(res), eff->GetFileReferences(model, ef->GetSettingsView().ToMap()));
         }
     }
 
@@ -1392,7 +1485,7 @@ std::list<std::string> EffectLayer::GetFacesUsed(EffectManager& em) const
         if (ef->GetEffectIndex() >= 0)
         {
             RenderableEffect *eff = em[ef->GetEffectIndex()];
-            res.splice(end(res), eff->GetFacesUsed(ef->GetSettings()));
+            res.splice(end(res), eff->GetFacesUsed(ef->GetSettingsView().ToMap()));
         }
     }
 
@@ -16,6 +16,7 @@
 #include "wx/wx.h"
 #include <atomic>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -50,6 +51,28 @@ public:
     std::list<std::string> GetFacesUsed(EffectManager& em) const;
     bool CleanupFileLocations(xLightsFrame* frame, EffectManager& em);
 
+    struct TimeIndex;
+    // Part of the time index. It keeps the index it came from alive so it can still be walked after the
+    // layer's effects change, the Effect* in it need the layer lock as they always have.
+    class TimeRange {
+    public:
+        Effect* const* begin() const { return _begin; }
+        Effect* const* end() const { return _end; }
+        bool empty() const { return _begin == _end; }
+
+    private:
+        friend class EffectLayer;
+        std::shared_ptr<const TimeIndex> _index;
+        Effect* const* _begin = nullptr;
+        Effect* const* _end = nullptr;
+    };
+
+    // The effects that may overlap startTimeMS to endTimeMS inclusive, in start time order, found in
+    // O(log n) from an index kept sorted by start time. As effects on a layer do not overlap these are
+    // normally exactly the overlapping effects but callers still test each one.
+    TimeRange GetEffectsInTimeRange(int startTimeMS, int endTimeMS) const;
+    void InvalidateTimeIndex();
+
     std::vector<Effect*> GetEffectsByTypeAndTime(const std::string& type, int startTimeMS, int endTimeMS);
     std::vector<Effect*> GetAllEffectsByTime(int startTimeMS, int endTimeMS);
     Effect* SelectEffectUsingDescription(std::string description);
@@ -111,6 +134,8 @@ public:
     void DeleteSelectedEffects(UndoManager& undo_mgr);
     void DeleteAllEffects();
     void DeleteEffect(int id);
+    // deletes all of them and renumbers what is left once
+    void DeleteEffects(const std::vector<Effect*>& effects);
     void DeleteEffectByIndex(int idx);
     static bool ShouldDeleteSelected(Effect* eff);
     static bool ShouldDeleteNotLocked(Effect* eff);
@@ -151,6 +176,7 @@ private:
 
     void SortEffects();
     void PlayEffect(Effect* effect);
+    std::shared_ptr<const TimeIndex> GetTimeIndex() const;
 
     static std::atomic_int exclusive_index;
 
@@ -161,6 +187,11 @@ private:
     void GetMaximumRangeWithRightMovement(int index, int& toLeft, int& toRight);
     std::vector<Effect*> mEffects;
     std::list<Effect*> mEffectsToDelete;
+
+    // never changed once built, a change to the effects drops it and the first lookup after builds another
+    mutable std::shared_ptr<const TimeIndex> mTimeIndex;
+    mutable std::atomic_uint64_t mTimeIndexGeneration = 0;
+    mutable std::mutex mTimeIndexLock;
     int mIndex = 0;
     Element* mParentElement = nullptr;
     std::recursive_mutex lock;
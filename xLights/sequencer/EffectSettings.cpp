@@ -0,0 +1,271 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+
+#include "EffectSettings.h"
+
+// strings in an unordered_set never move so the pointers handed out stay valid
+static std::shared_mutex __settingsPoolLock;
+static std::unordered_set<std::string> __settingsPool;
+
+static const std::shared_ptr<const InternedSettings::Entries> __noSettings = std::make_shared<const InternedSettings::Entries>();
+
+static void ReplaceAll(std::string& str, const std::string& from, const std::string& to)
+{
+    size_t start_pos = 0;
+    while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
+        str.replace(start_pos, from.length(), to);
+        start_pos += to.length();
+    }
+}
+
+const std::string* InternedSettings::Intern(const std::string& s)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(__settingsPoolLock);
+        auto it = __settingsPool.find(s);
+        if (it != __settingsPool.end()) {
+            return &*it;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(__settingsPoolLock);
+    return &*__settingsPool.insert(s).first;
+}
+
+std::shared_ptr<const InternedSettings::Entries> InternedSettings::Build(const SettingsMap& map)
+{
+    if (map.empty()) {
+        return __noSettings;
+    }
+    // the map is already in key order
+    auto entries = std::make_shared<Entries>();
+    entries->reserve(map.size());
+    for (const auto& it : map) {
+        entries->push_back({ Intern(it.first), Intern(it.second) });
+    }
+    return entries;
+}
+
+const InternedSettings::Entry* InternedSettings::Find(const Entries& entries, const std::string& key)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), key, [](const Entry& e, const std::string& k) { return *e.key < k; });
+    if (it == entries.end() || *it->key != key) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+SettingsView::const_iterator SettingsView::begin() const
+{
+    const_iterator res;
+    if (_map != nullptr) {
+        res._it = _map->begin();
+    } else if (_entries != nullptr && !_entries->empty()) {
+        res._entry = _entries->data();
+    }
+    return res;
+}
+
+SettingsView::const_iterator SettingsView::end() const
+{
+    const_iterator res;
+    if (_map != nullptr) {
+        res._it = _map->end();
+    } else if (_entries != nullptr && !_entries->empty()) {
+        res._entry = _entries->data() + _entries->size();
+    }
+    return res;
+}
+
+size_t SettingsView::size() const
+{
+    if (_map != nullptr) {
+        return _map->size();
+    }
+    return _entries == nullptr ? 0 : _entries->size();
+}
+
+const std::string* SettingsView::Find(const std::string& key) const
+{
+    if (_map != nullptr) {
+        auto it = _map->find(key);
+        return it == _map->end() ? nullptr : &it->second;
+    }
+    if (_entries == nullptr) {
+        return nullptr;
+    }
+    const InternedSettings::Entry* e = InternedSettings::Find(*_entries, key);
+    return e == nullptr ? nullptr : e->value;
+}
+
+int SettingsView::GetInt(const std::string& key, const int def) const
+{
+    const std::string* v = Find(key);
+    if (v == nullptr || v->length() == 0 || v->at(0) == ' ') {
+        return def;
+    }
+    try {
+        return stoi(*v);
+    } catch (...) {
+        return def;
+    }
+}
+
+float SettingsView::GetFloat(const std::string& key, const float def) const
+{
+    const std::string* v = Find(key);
+    if (v == nullptr || v->length() == 0 || v->at(0) == ' ') {
+        return def;
+    }
+    try {
+        return stof(*v);
+    } catch (...) {
+        return def;
+    }
+}
+
+double SettingsView::GetDouble(const std::string& key, const double def) const
+{
+    const std::string* v = Find(key);
+    if (v == nullptr || v->length() == 0 || v->at(0) == ' ') {
+        return def;
+    }
+    try {
+        return stod(*v);
+    } catch (...) {
+        return def;
+    }
+}
+
+std::string SettingsView::AsString() const
+{
+    if (_map != nullptr) {
+        return _map->AsString();
+    }
+    std::string ret;
+    for (const auto& it : *this) {
+        if (ret.length() != 0) {
+            ret += ",";
+        }
+        std::string value = it.second;
+        ReplaceAll(value, "&", "&amp;");   // need to escape the amps
+        ReplaceAll(value, ",", "&comma;"); // need to escape the commas
+        ret += it.first + "=" + value;
+    }
+    return ret;
+}
+
+std::string SettingsView::AsJSON() const
+{
+    if (_map != nullptr) {
+        return _map->AsJSON();
+    }
+    std::string ret;
+    for (const auto& it : *this) {
+        if (ret.length() != 0) {
+            ret += ",";
+        }
+        std::string value = it.second;
+        ReplaceAll(value, "&", "&amp;");   // need to escape the amps
+        ReplaceAll(value, ",", "&comma;"); // need to escape the commas
+        ret += "\"" + it.first + "\":\"" + value + "\"";
+    }
+    ret.insert(0, "{");
+    ret.append("}");
+    return ret;
+}
+
+SettingsMap SettingsView::ToMap() const
+{
+    if (_map != nullptr) {
+        return *_map;
+    }
+    SettingsMap res;
+    for (const auto& it : *this) {
+        res.emplace_hint(res.end(), it.first, it.second);
+    }
+    return res;
+}
+
+EffectSettings::Editor::Editor(EffectSettings& settings) :
+    _settings(settings)
+{
+    if (settings._map != nullptr) {
+        _map = settings._map.get();
+    } else {
+        _temp = settings.View().ToMap();
+        _map = &_temp;
+    }
+}
+
+EffectSettings::Editor::~Editor()
+{
+    if (_map == &_temp) {
+        _settings._interned = InternedSettings::Build(_temp);
+    }
+}
+
+EffectSettings& EffectSettings::operator=(const EffectSettings& s)
+{
+    if (this == &s) {
+        return *this;
+    }
+    if (_map != nullptr) {
+        *_map = s.View().ToMap();
+    } else if (s._map != nullptr) {
+        _interned = InternedSettings::Build(*s._map);
+    } else {
+        _interned = s._interned;
+    }
+    return *this;
+}
+
+SettingsView EffectSettings::View() const
+{
+    if (_map != nullptr) {
+        return SettingsView(_map.get());
+    }
+    return SettingsView(_interned);
+}
+
+SettingsView EffectSettings::Snapshot() const
+{
+    if (_map != nullptr) {
+        // the map can be changed through references Map() has handed out, so rather than track
+        // that it is compared, which costs far less than copying it
+        if (_snapshot == nullptr || *_snapshot != *_map) {
+            _snapshot = std::make_shared<const SettingsMap>(*_map);
+        }
+        return SettingsView(_snapshot);
+    }
+    return SettingsView(_interned);
+}
+
+void EffectSettings::Assign(const SettingsMap& map)
+{
+    if (_map != nullptr) {
+        *_map = map;
+    } else {
+        _interned = InternedSettings::Build(map);
+    }
+}
+
+SettingsMap& EffectSettings::Map()
+{
+    if (_map == nullptr) {
+        _map = std::make_unique<SettingsMap>(View().ToMap());
+        _interned = nullptr;
+    }
+    return *_map;
+}
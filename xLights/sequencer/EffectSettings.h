@@ -0,0 +1,178 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../UtilClasses.h"
+
+// Settings held as an array of key/value pairs sorted by key. The strings are interned
+// in a pool shared by every effect so the keys, and the values most effects have in
+// common, are only stored once and each setting costs an effect two pointers. Pooled
+// strings are never freed.
+//
+// An array is never changed once it is built, an edit builds a new one, so anything
+// holding on to an array can keep reading it while the effect changes.
+class InternedSettings
+{
+public:
+    struct Entry {
+        const std::string* key;
+        const std::string* value;
+    };
+    typedef std::vector<Entry> Entries;
+
+    // the pooled copy of s
+    static const std::string* Intern(const std::string& s);
+    static std::shared_ptr<const Entries> Build(const SettingsMap& map);
+    // nullptr if the key is not there
+    static const Entry* Find(const Entries& entries, const std::string& key);
+};
+
+// Read only access to settings held either interned or in a SettingsMap, with the same
+// accessors as SettingsMap. A view holds on to what it reads, the interned array or its
+// own copy of the map, so it never changes and can be used from any thread. Only
+// EffectSettings makes views straight onto a map, for use under the effect's lock.
+class SettingsView
+{
+public:
+    class const_iterator
+    {
+    public:
+        typedef std::pair<const std::string&, const std::string&> value_type;
+
+        value_type operator*() const
+        {
+            if (_entry != nullptr) {
+                return value_type(*_entry->key, *_entry->value);
+            }
+            return value_type(_it->first, _it->second);
+        }
+        const_iterator& operator++()
+        {
+            if (_entry != nullptr) {
+                ++_entry;
+            } else {
+                ++_it;
+            }
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const { return _entry == other._entry && _it == other._it; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class SettingsView;
+        const InternedSettings::Entry* _entry = nullptr;
+        std::map<std::string, std::string>::const_iterator _it{};
+    };
+
+    SettingsView() {}
+    explicit SettingsView(const std::shared_ptr<const InternedSettings::Entries>& entries) : _entries(entries) {}
+    explicit SettingsView(const std::shared_ptr<const SettingsMap>& map) : _ownedMap(map), _map(map.get()) {}
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+    bool Contains(const std::string& key) const { return Find(key) != nullptr; }
+    const std::string& Get(const std::string& key, const std::string& def) const
+    {
+        const std::string* v = Find(key);
+        return v == nullptr ? def : *v;
+    }
+    std::string Get(const std::string& key, const char* def) const
+    {
+        const std::string* v = Find(key);
+        return v == nullptr ? def : *v;
+    }
+    const std::string& operator[](const std::string& key) const
+    {
+        return Get(key, xlEMPTY_STRING);
+    }
+    int GetInt(const std::string& key, const int def = 0) const;
+    float GetFloat(const std::string& key, const float def = 0.0) const;
+    double GetDouble(const std::string& key, const double def = 0.0) const;
+    bool GetBool(const std::string& key, const bool def = false) const
+    {
+        const std::string* v = Find(key);
+        if (v == nullptr) {
+            return def;
+        }
+        return v->length() >= 1 && v->at(0) == '1';
+    }
+
+    std::string AsString() const;
+    std::string AsJSON() const;
+    SettingsMap ToMap() const;
+
+private:
+    friend class EffectSettings;
+    explicit SettingsView(const SettingsMap* map) : _map(map) {}
+
+    // nullptr if the key is not there
+    const std::string* Find(const std::string& key) const;
+
+    std::shared_ptr<const InternedSettings::Entries> _entries;
+    std::shared_ptr<const SettingsMap> _ownedMap;
+    const SettingsMap* _map = nullptr;
+};
+
+// The settings or the palette of an effect. They are held interned until something asks
+// for them as a SettingsMap, from then on the map is kept and is what they are read from
+// so references to it stay valid. The effect's lock must be held around all of these.
+class EffectSettings
+{
+public:
+    // Changes the settings through a SettingsMap, interning the result when the editor
+    // goes out of scope if the settings are not already held in a map
+    class Editor
+    {
+    public:
+        explicit Editor(EffectSettings& settings);
+        ~Editor();
+        Editor(const Editor&) = delete;
+        Editor& operator=(const Editor&) = delete;
+
+        SettingsMap& operator*() { return *_map; }
+        SettingsMap* operator->() { return _map; }
+
+    private:
+        EffectSettings& _settings;
+        SettingsMap _temp;
+        SettingsMap* _map;
+    };
+
+    EffectSettings() {}
+    EffectSettings(const EffectSettings& s) { *this = s; }
+    EffectSettings& operator=(const EffectSettings& s);
+
+    // only valid while the lock is held and nothing changes the settings
+    SettingsView View() const;
+    // keeps what it reads so it can be used once the lock is released, a map is copied
+    // unless it is still the same as it was for the last snapshot
+    SettingsView Snapshot() const;
+    Editor Edit() { return Editor(*this); }
+    void Assign(const SettingsMap& map);
+
+    SettingsMap& Map();
+    bool IsMapped() const { return _map != nullptr; }
+
+private:
+    // the interned array is dropped for the map when the settings are first asked for as a SettingsMap
+    std::shared_ptr<const InternedSettings::Entries> _interned;
+    std::unique_ptr<SettingsMap> _map;
+    // the last copy of the map handed to a snapshot
+    mutable std::shared_ptr<const SettingsMap> _snapshot;
+};
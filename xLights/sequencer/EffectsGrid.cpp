@@ -1086,7 +1086,7 @@ Effect* EffectsGrid::FillRandomEffects() {
                     mSequenceElements->get_undo_mgr().CaptureAddedEffect(el->GetParentElement()->GetModelName(), el->GetIndex(), ef->GetID());
                     RaiseSelectedEffectChanged(ef, true);
                     mSelectedEffect = ef;
-                    if (!ef->GetPaletteMap().empty() && !ef->IsRenderDisabled()) {
+                    if (ef->HasPaletteSettings() && !ef->IsRenderDisabled()) {
                         sendRenderEvent(el->GetParentElement()->GetModelName(),
                                         mDropStartTimeMS,
                                         mDropEndTimeMS, true);
@@ -1939,7 +1939,7 @@ Effect* EffectsGrid::ACDraw(ACTYPE type, ACSTYLE style, ACMODE mode, int intensi
                         // can ignore these
                     } else if (eff->GetStartTimeMS() < startMS && eff->GetEndTimeMS() > endMS) {
                         if (!eff->IsLocked()) {
-                            SettingsMap settings = eff->GetSettings();
+                            SettingsMap settings = eff->GetSettingsView().ToMap();
 
                             int start = eff->GetStartTimeMS();
                             int end = eff->GetEndTimeMS();
@@ -2428,23 +2428,23 @@ void EffectsGrid::TruncateEffect(EffectLayer* el, Effect* eff, int startMS, int
 
         // now fix the brightness ... the hard part
         if (name == "On") {
-            int startBrightness = GetEffectBrightnessAt(eff->GetEffectName(), eff->GetSettings(), 0.0, startMS, endMS);
-            int endBrightness = GetEffectBrightnessAt(eff->GetEffectName(), eff->GetSettings(), 1.0, startMS, endMS);
+            int startBrightness = GetEffectBrightnessAt(eff->GetEffectName(), eff->GetSettingsView().ToMap(), 0.0, startMS, endMS);
+            int endBrightness = GetEffectBrightnessAt(eff->GetEffectName(), eff->GetSettingsView().ToMap(), 1.0, startMS, endMS);
 
             if (startBrightness != endBrightness) {
                 int newEndBrightness = (endBrightness - startBrightness) * endPos + startBrightness;
-                eff->GetSettings()["E_TEXTCTRL_Eff_On_End"] = std::to_string(newEndBrightness);
+                eff->SetSetting("E_TEXTCTRL_Eff_On_End", std::to_string(newEndBrightness));
                 eff->IncrementChangeCount();
                 RaiseSelectedEffectChanged(eff, false, true);
             }
         } else if (name == "Twinkle") {
-            if (wxString(eff->GetSettings().Get("C_VALUECURVE_Brightness", "")).Contains("Active=TRUE")) {
-                ValueCurve vc(eff->GetSettings().Get("C_VALUECURVE_Brightness", ""));
+            if (wxString(eff->GetSetting("C_VALUECURVE_Brightness")).Contains("Active=TRUE")) {
+                ValueCurve vc(eff->GetSetting("C_VALUECURVE_Brightness"));
                 vc.SetLimits(0, 400);
 
                 TruncateBrightnessValueCurve(vc, startPos, endPos, startMS, endMS, originalLength);
 
-                eff->GetSettings()["C_VALUECURVE_Brightness"] = vc.Serialise();
+                eff->SetSetting("C_VALUECURVE_Brightness", vc.Serialise());
                 eff->IncrementChangeCount();
                 RaiseSelectedEffectChanged(eff, false, true);
             }
@@ -2457,23 +2457,23 @@ void EffectsGrid::TruncateEffect(EffectLayer* el, Effect* eff, int startMS, int
 
         // now fix the brightness ... the hard part
         if (name == "On") {
-            int startBrightness = GetEffectBrightnessAt(eff->GetEffectName(), eff->GetSettings(), 0.0, startMS, endMS);
-            int endBrightness = GetEffectBrightnessAt(eff->GetEffectName(), eff->GetSettings(), 1.0, startMS, endMS);
+            int startBrightness = GetEffectBrightnessAt(eff->GetEffectName(), eff->GetSettingsView().ToMap(), 0.0, startMS, endMS);
+            int endBrightness = GetEffectBrightnessAt(eff->GetEffectName(), eff->GetSettingsView().ToMap(), 1.0, startMS, endMS);
 
             if (startBrightness != endBrightness) {
                 int newStartBrightness = (endBrightness - startBrightness) * startPos + startBrightness;
-                eff->GetSettings()["E_TEXTCTRL_Eff_On_Start"] = std::to_string(newStartBrightness);
+                eff->SetSetting("E_TEXTCTRL_Eff_On_Start", std::to_string(newStartBrightness));
                 eff->IncrementChangeCount();
                 RaiseSelectedEffectChanged(eff, false, true);
             }
         } else if (name == "Twinkle") {
-            if (wxString(eff->GetSettings().Get("C_VALUECURVE_Brightness", "")).Contains("Active=TRUE")) {
-                ValueCurve vc(eff->GetSettings().Get("C_VALUECURVE_Brightness", ""));
+            if (wxString(eff->GetSetting("C_VALUECURVE_Brightness")).Contains("Active=TRUE")) {
+                ValueCurve vc(eff->GetSetting("C_VALUECURVE_Brightness"));
                 vc.SetLimits(0, 400);
 
                 TruncateBrightnessValueCurve(vc, startPos, endPos, startMS, endMS, originalLength);
 
-                eff->GetSettings()["C_VALUECURVE_Brightness"] = vc.Serialise();
+                eff->SetSetting("C_VALUECURVE_Brightness", vc.Serialise());
                 eff->IncrementChangeCount();
                 RaiseSelectedEffectChanged(eff, false, true);
             }
@@ -4625,7 +4625,7 @@ Effect* EffectsGrid::OldPaste(const wxString& data, const wxString& pasteDataVer
                                     xlights->GetEffectManager().GetEffect(efdata[0].ToStdString())->adjustSettings(pasteDataVersion.ToStdString(), ef, false);
                                 }
                                 mSequenceElements->get_undo_mgr().CaptureAddedEffect(el->GetParentElement()->GetModelName(), el->GetIndex(), ef->GetID());
-                                if (!ef->GetPaletteMap().empty() && !ef->IsRenderDisabled()) {
+                                if (ef->HasPaletteSettings() && !ef->IsRenderDisabled()) {
                                     sendRenderEvent(el->GetParentElement()->GetModelName(),
                                                     new_start_time,
                                                     new_end_time, true);
@@ -4683,7 +4683,7 @@ Effect* EffectsGrid::OldPaste(const wxString& data, const wxString& pasteDataVer
                             }
                             mSequenceElements->get_undo_mgr().CreateUndoStep();
                             mSequenceElements->get_undo_mgr().CaptureAddedEffect(el->GetParentElement()->GetModelName(), el->GetIndex(), ef->GetID());
-                            if (!ef->GetPaletteMap().empty() && !ef->IsRenderDisabled()) {
+                            if (ef->HasPaletteSettings() && !ef->IsRenderDisabled()) {
                                 sendRenderEvent(el->GetParentElement()->GetModelName(),
                                                 mDropStartTimeMS,
                                                 mDropEndTimeMS, true);
@@ -4786,7 +4786,7 @@ Effect* EffectsGrid::OldPaste(const wxString& data, const wxString& pasteDataVer
                                         xlights->GetEffectManager().GetEffect(efdata[0].ToStdString())->adjustSettings(pasteDataVersion.ToStdString(), ef, false);
                                     }
                                     mSequenceElements->get_undo_mgr().CaptureAddedEffect(el->GetParentElement()->GetModelName(), el->GetIndex(), ef->GetID());
-                                    if (!ef->GetPaletteMap().empty() && !ef->IsRenderDisabled()) {
+                                    if (ef->HasPaletteSettings() && !ef->IsRenderDisabled()) {
                                         sendRenderEvent(el->GetParentElement()->GetModelName(),
                                                         start_time,
                                                         end_time, true);
@@ -6207,7 +6207,7 @@ void EffectsGrid::DrawEffects(xlGraphicsContext* ctx) {
 void EffectsGrid::DrawFadeHints(Effect* e, int x1, int y1, int x2, int y2, xlVertexColorAccumulator* backgrounds) const {
     if (xlights->IsSuppressFadeHints())
         return;
-    const SettingsMap& sm(e->GetSettings());
+    SettingsView sm(e->GetSettingsView());
     int inTransitionEnd = 0, outTransitionStart = 0;
     double fadeInTime = sm.GetDouble("T_TEXTCTRL_Fadein");
     if (fadeInTime != 0.) {
@@ -16,6 +16,7 @@
 #include <algorithm>
 
 #include "SequenceElements.h"
+#include "SequenceSidecar.h"
 #include "TimeLine.h"
 #include "../xLightsMain.h"
 #include "../LyricsDialog.h"
@@ -27,6 +28,7 @@
 #include "../SequenceViewManager.h"
 #include "../JukeboxPanel.h"
 #include "../TraceLog.h"
+#include "../RenderLayerCache.h"
 #include "../UtilFunctions.h"
 
 #include <log4cpp/Category.hh>
@@ -741,7 +743,7 @@ bool SequenceElements::LoadSequencerFile(xLightsXmlFile& xml_file, const wxStrin
     renderDependency.clear();
 
     mFilename = xml_file;
-    wxXmlDocument& seqDocument = xml_file.GetXmlDocument();
+    wxXmlDocument& seqDocument = xml_file.GetLoadedXmlDocument();
 
     wxXmlNode* root = seqDocument.GetRoot();
     std::vector<std::string> effectStrings;
@@ -928,6 +930,10 @@ bool SequenceElements::LoadSequencerFile(xLightsXmlFile& xml_file, const wxStrin
         }
         TraceLog::PopTraceContext();
     }
+    if (xml_file.GetSidecar() != nullptr) {
+        TraceLog::AddTraceMessage("Loading sidecar");
+        LoadSidecar(*xml_file.GetSidecar(), xml_file, ShowDir, importing);
+    }
     for (size_t x = 0; x < GetElementCount(); x++) {
         Element* el = GetElement(x);
         if (el->GetEffectLayerCount() == 0) {
@@ -940,6 +946,131 @@ bool SequenceElements::LoadSequencerFile(xLightsXmlFile& xml_file, const wxStrin
     return true;
 }
 
+// Equivalent of the DisplayElements/ElementEffects processing above but reading the
+// pre-interned records from the binary sidecar rather than walking the xml
+void SequenceElements::LoadSidecar(const SequenceSidecar& sidecar, xLightsXmlFile& xml_file, const wxString& ShowDir, bool importing)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    // settings strings are shared by many effects so only fix up file parameters once per string
+    std::map<uint32_t, std::string> fixedSettings;
+    auto getSettings = [&](uint32_t idx) -> const std::string& {
+        auto it = fixedSettings.find(idx);
+        if (it != fixedSettings.end()) {
+            return it->second;
+        }
+        std::string settings = sidecar.GetStdString(idx);
+        if (settings.find("E_FILEPICKER_Pictures_Filename") != std::string::npos) {
+            settings = FixEffectFileParameter("E_FILEPICKER_Pictures_Filename", settings, ShowDir);
+        } else if (settings.find("E_TEXTCTRL_Glediator_Filename") != std::string::npos) {
+            settings = FixEffectFileParameter("E_TEXTCTRL_Glediator_Filename", settings, ShowDir);
+        } else if (settings.find("E_FILEPICKER_Glediator_Filename") != std::string::npos) {
+            settings = FixEffectFileParameter("E_FILEPICKER_Glediator_Filename", settings, "");
+        }
+        return fixedSettings.emplace(idx, settings).first->second;
+    };
+
+    int loaded = 0;
+    for (uint32_t i = 0; i < sidecar.GetElementCount(); i++) {
+        const auto& er = sidecar.GetElement(i);
+        std::string name = sidecar.GetStdString(er.name);
+        std::string type = er.timing ? STR_TIMING : "model";
+        if (ElementExists(name)) {
+            DisplayError("Duplicate " + type + ": '" + name + "'. Second instance ignored.");
+            continue;
+        }
+        Element* element = AddElement(name, type, er.visible != 0, er.collapsed != 0, er.timing && er.active, false, er.renderDisabled != 0);
+        if (element == nullptr) {
+            continue;
+        }
+        if (er.timing) {
+            TimingElement* te = dynamic_cast<TimingElement*>(element);
+            te->SetViews(sidecar.GetStdString(er.views));
+            te->SetSubType(sidecar.GetStdString(er.subType));
+            if (er.fixedTiming > 0) {
+                int interval = TimeLine::RoundToMultipleOfPeriod(er.fixedTiming, mFrequency);
+                if (interval == 0)
+                    interval = 1000 / mFrequency;
+                te->SetFixedTiming(interval);
+                EffectLayer* effectLayer = element->AddEffectLayer();
+                int end_time = TimeLine::RoundToMultipleOfPeriod(xml_file.GetSequenceDurationMS(), mFrequency);
+                for (int time = 0; time < end_time; time += interval) {
+                    effectLayer->AddEffect(0, "", "", "", time, time + interval, EFFECT_NOT_SELECTED, false, true);
+                }
+                effectLayer->NumberEffects();
+                continue;
+            }
+        }
+
+        for (uint32_t l = er.firstLayer; l < er.firstLayer + er.layerCount; l++) {
+            const auto& lr = sidecar.GetLayer(l);
+            EffectLayer* effectLayer = nullptr;
+            ModelElement* me = dynamic_cast<ModelElement*>(element);
+            switch (lr.kind) {
+            case SequenceSidecar::LayerKind::EFFECT_LAYER:
+                effectLayer = element->AddEffectLayer();
+                break;
+            case SequenceSidecar::LayerKind::SUBMODEL_LAYER:
+                if (me != nullptr) {
+                    SubModelElement* se = me->GetSubModel(sidecar.GetStdString(lr.ownerName), true);
+                    while (lr.layer >= (int)se->GetEffectLayerCount()) {
+                        se->AddEffectLayer();
+                    }
+                    effectLayer = se->GetEffectLayer(lr.layer);
+                }
+                break;
+            case SequenceSidecar::LayerKind::STRAND_LAYER:
+            case SequenceSidecar::LayerKind::NODE_LAYER:
+                if (me != nullptr) {
+                    StrandElement* se = me->GetStrand(lr.strand, true);
+                    if (lr.ownerName != SequenceSidecar::NO_STRING) {
+                        se->SetName(sidecar.GetStdString(lr.ownerName));
+                    }
+                    if (lr.kind == SequenceSidecar::LayerKind::NODE_LAYER) {
+                        NodeLayer* nl = se->GetNodeLayer(lr.node, true);
+                        if (lr.nodeName != SequenceSidecar::NO_STRING) {
+                            nl->SetNodeName(sidecar.GetStdString(lr.nodeName));
+                        }
+                        effectLayer = nl;
+                    } else {
+                        while (lr.layer >= (int)se->GetEffectLayerCount()) {
+                            se->AddEffectLayer();
+                        }
+                        effectLayer = se->GetEffectLayer(lr.layer);
+                    }
+                }
+                break;
+            }
+            if (effectLayer == nullptr) {
+                logger_base.error("Element %s was not a model element. This typically happens when a timing track is created with the same name as a model.", (const char*)element->GetName().c_str());
+                continue;
+            }
+            if (lr.layerName != SequenceSidecar::NO_STRING) {
+                effectLayer->SetLayerName(sidecar.GetStdString(lr.layerName));
+            }
+
+            for (uint32_t e = lr.firstEffect; e < lr.firstEffect + lr.effectCount; e++) {
+                const auto& rec = sidecar.GetEffect(e);
+                int startTime = TimeLine::RoundToMultipleOfPeriod(rec.startTimeMS, mFrequency);
+                int endTime = TimeLine::RoundToMultipleOfPeriod(rec.endTimeMS, mFrequency);
+                if (startTime >= endTime) {
+                    continue;
+                }
+                std::string effectName = sidecar.GetStdString(rec.name);
+                if (er.timing) {
+                    effectLayer->AddEffect(0, effectName, sidecar.GetStdString(rec.settings), STR_EMPTY,
+                                           startTime, endTime, EFFECT_NOT_SELECTED, (rec.flags & SequenceSidecar::EFFECT_FLAG_PROTECTED) != 0, false, importing);
+                } else if (effectName != "Random") {
+                    effectLayer->AddEffect(rec.id, effectName, getSettings(rec.settings), sidecar.GetStdString(rec.palette),
+                                           startTime, endTime, EFFECT_NOT_SELECTED, (rec.flags & SequenceSidecar::EFFECT_FLAG_PROTECTED) != 0, false, importing);
+                }
+                loaded++;
+            }
+        }
+    }
+    logger_base.debug("Loaded %d effects from sequence sidecar.", loaded);
+}
+
 void SequenceElements::PrepareViews(xLightsXmlFile& xml_file)
 {
     static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
@@ -2339,6 +2470,20 @@ void SequenceElements::BreakdownWord(EffectLayer* phoneme_layer, int start_time,
     }
 }
 
+// the layers render from the timing track so anything they kept over the range is stale
+static void InvalidateRenderedLayers(Element* el, int startMS, int endMS)
+{
+    for (size_t i = 0; i < el->GetEffectLayerCount(); ++i) {
+        RenderLayerCache::Invalidate(el->GetEffectLayer(i), startMS, endMS);
+    }
+    ModelElement* me = dynamic_cast<ModelElement*>(el);
+    if (me != nullptr) {
+        for (int i = 0; i < me->GetSubModelAndStrandCount(); ++i) {
+            InvalidateRenderedLayers(me->GetSubModel(i), startMS, endMS);
+        }
+    }
+}
+
 void SequenceElements::IncrementChangeCount(Element *el) {
     mChangeCount++;
     if (el != nullptr && el->GetType() == ElementType::ELEMENT_TYPE_TIMING) {
@@ -2351,6 +2496,7 @@ void SequenceElements::IncrementChangeCount(Element *el) {
             for (std::set<std::string>::iterator sit = it->second.begin(); sit != it->second.end(); ++sit) {
                 Element *el2 = this->GetElement(*sit);
                 if (el2 != nullptr) {
+                    InvalidateRenderedLayers(el2, ss, es);
                     el2->IncrementChangeCount(ss, es);
                     modelsToRender.insert(*sit);
                     xframe->StartOutputTimer(); // start the timer so the render will trigger
@@ -24,6 +24,7 @@
 class xLightsXmlFile;  // forward declaration needed due to circular dependency
 class SequenceViewManager;
 class TimeLine;
+class SequenceSidecar;
 
 #define CURRENT_VIEW -1
 #define MASTER_VIEW 0
@@ -217,6 +218,7 @@ private:
         const std::vector<std::string> & effectStrings,
         const std::vector<std::string> & colorPalettes,
         bool importing = false);
+    void LoadSidecar(const SequenceSidecar& sidecar, xLightsXmlFile& xml_file, const wxString& ShowDir, bool importing);
     static bool SortElementsByIndex(const Element *element1, const Element *element2)
     {
         return (element1->GetIndex() < element2->GetIndex());
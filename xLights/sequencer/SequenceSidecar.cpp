@@ -0,0 +1,588 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/mstream.h>
+#include <wx/xml/xml.h>
+
+#include <cstring>
+#include <unordered_map>
+
+#include "SequenceSidecar.h"
+#include "SequenceElements.h"
+#include "Element.h"
+#include "EffectLayer.h"
+#include "Effect.h"
+#include "../ExternalHooks.h"
+
+#include <log4cpp/Category.hh>
+
+#ifndef __WXMSW__
+#include <sys/mman.h>
+#define USE_MMAP_SIDECAR
+#endif
+
+#define SIDECAR_VERSION 2
+
+namespace
+{
+    struct SidecarHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint64_t sourceHash;
+        uint32_t stringCount;
+        uint32_t elementCount;
+        uint32_t layerCount;
+        uint32_t effectCount;
+        uint32_t skeleton;
+        uint32_t sections;
+        uint32_t modelCount;
+        uint32_t timingCount;
+        uint64_t stringTableOffset;
+        uint64_t stringDataOffset;
+        uint64_t elementOffset;
+        uint64_t layerOffset;
+        uint64_t effectOffset;
+        uint64_t nameOffset; // model then timing name string indexes
+    };
+
+    struct StringEntry {
+        uint64_t offset;
+        uint32_t length;
+        uint32_t pad;
+    };
+
+    static const char SIDECAR_MAGIC[4] = { 'X', 'S', 'Q', 'B' };
+
+    // the skeleton keeps everything except these sections which live in the record tables
+    bool IsSidecarSection(const wxString& name)
+    {
+        return name == "DisplayElements" || name == "ElementEffects" || name == "EffectDB" || name == "ColorPalettes" || name == "CompressedData";
+    }
+
+    // FNV-1a a word at a time, it only has to notice the sequence changing
+    bool HashFile(const std::string& file, uint64_t& size, uint64_t& hash)
+    {
+        wxFile f;
+        if (!f.Open(file)) {
+            return false;
+        }
+        hash = 0xcbf29ce484222325ULL;
+        size = 0;
+        std::vector<uint8_t> buf(1024 * 1024);
+        for (;;) {
+            ssize_t read = f.Read(buf.data(), buf.size());
+            if (read <= 0) {
+                break;
+            }
+            ssize_t i = 0;
+            for (; i + (ssize_t)sizeof(uint64_t) <= read; i += sizeof(uint64_t)) {
+                uint64_t w;
+                memcpy(&w, &buf[i], sizeof(w));
+                hash ^= w;
+                hash *= 0x100000001b3ULL;
+            }
+            for (; i < read; i++) {
+                hash ^= buf[i];
+                hash *= 0x100000001b3ULL;
+            }
+            size += read;
+        }
+        return true;
+    }
+
+    bool GetFileStats(const std::string& file, uint64_t& size, int64_t& modified)
+    {
+        wxFileName fn(file);
+        if (!fn.FileExists()) {
+            return false;
+        }
+        size = fn.GetSize().GetValue();
+        modified = (int64_t)fn.GetModificationTime().GetTicks();
+        return true;
+    }
+
+    class StringPool
+    {
+    public:
+        uint32_t Add(const std::string& s)
+        {
+            auto it = _index.find(s);
+            if (it != _index.end()) {
+                return it->second;
+            }
+            uint32_t idx = (uint32_t)_strings.size();
+            auto res = _index.emplace(s, idx);
+            _strings.push_back(&res.first->first);
+            return idx;
+        }
+        uint32_t AddOptional(const std::string& s)
+        {
+            return s.empty() ? SequenceSidecar::NO_STRING : Add(s);
+        }
+        const std::vector<const std::string*>& Strings() const { return _strings; }
+
+    private:
+        std::unordered_map<std::string, uint32_t> _index;
+        std::vector<const std::string*> _strings;
+    };
+
+    size_t Align8(size_t v)
+    {
+        return (v + 7) & ~(size_t)7;
+    }
+
+    template<class T>
+    void Append(std::vector<uint8_t>& out, const std::vector<T>& v)
+    {
+        if (!v.empty()) {
+            size_t at = out.size();
+            out.resize(at + v.size() * sizeof(T));
+            memcpy(&out[at], v.data(), v.size() * sizeof(T));
+        }
+    }
+}
+
+static bool sidecarEnabled = false;
+
+bool SequenceSidecar::IsEnabled()
+{
+    return sidecarEnabled;
+}
+
+void SequenceSidecar::SetEnabled(bool enabled)
+{
+    sidecarEnabled = enabled;
+}
+
+std::string SequenceSidecar::GetSidecarFile(const std::string& sequenceFile)
+{
+    wxFileName fn(sequenceFile);
+    fn.SetExt("xsqb");
+    return fn.GetFullPath().ToStdString();
+}
+
+void SequenceSidecar::Remove(const std::string& sequenceFile)
+{
+    std::string sc = GetSidecarFile(sequenceFile);
+    if (FileExists(sc)) {
+        wxRemoveFile(sc);
+    }
+}
+
+SequenceSidecar::~SequenceSidecar()
+{
+#ifdef USE_MMAP_SIDECAR
+    if (_mapped && _data != nullptr) {
+        munmap((void*)_data, _size);
+    }
+#endif
+    _data = nullptr;
+}
+
+bool SequenceSidecar::Map(const std::string& file)
+{
+    wxFile f;
+    if (!f.Open(file)) {
+        return false;
+    }
+    _size = f.Length();
+    if (_size < sizeof(SidecarHeader)) {
+        return false;
+    }
+#ifdef USE_MMAP_SIDECAR
+    void* m = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, f.fd(), 0);
+    if (m != MAP_FAILED) {
+        _data = (const uint8_t*)m;
+        _mapped = true;
+        return true;
+    }
+#endif
+    _buffer.resize(_size);
+    if (f.Read(_buffer.data(), _size) != (ssize_t)_size) {
+        _buffer.clear();
+        return false;
+    }
+    _data = _buffer.data();
+    return true;
+}
+
+bool SequenceSidecar::Validate(const std::string& sequenceFile) const
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    const SidecarHeader* h = (const SidecarHeader*)_data;
+    if (memcmp(h->magic, SIDECAR_MAGIC, 4) != 0 || h->version != SIDECAR_VERSION) {
+        logger_base.debug("Sequence sidecar has an unknown format.");
+        return false;
+    }
+    if (h->stringTableOffset + (uint64_t)h->stringCount * sizeof(StringEntry) > _size ||
+        h->elementOffset + (uint64_t)h->elementCount * sizeof(ElementRecord) > _size ||
+        h->layerOffset + (uint64_t)h->layerCount * sizeof(LayerRecord) > _size ||
+        h->effectOffset + (uint64_t)h->effectCount * sizeof(EffectRecord) > _size ||
+        h->nameOffset + ((uint64_t)h->modelCount + h->timingCount) * sizeof(uint32_t) > _size ||
+        h->stringDataOffset > _size || h->skeleton >= h->stringCount || h->sections >= h->stringCount) {
+        logger_base.warn("Sequence sidecar is truncated.");
+        return false;
+    }
+    uint64_t size = 0;
+    int64_t modified = 0;
+    if (!GetFileStats(sequenceFile, size, modified) || size != h->sourceSize) {
+        logger_base.debug("Sequence sidecar is stale ... sequence size has changed.");
+        return false;
+    }
+    if (modified == h->sourceModified) {
+        return true;
+    }
+    // copied or touched but maybe not changed, only the content can tell
+    uint64_t hash = 0;
+    if (!HashFile(sequenceFile, size, hash) || size != h->sourceSize || hash != h->sourceHash) {
+        logger_base.debug("Sequence sidecar is stale ... sequence content has changed.");
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<SequenceSidecar> SequenceSidecar::Open(const std::string& sequenceFile)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    std::string sc = GetSidecarFile(sequenceFile);
+    if (!FileExists(sc)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<SequenceSidecar> res(new SequenceSidecar());
+    if (!res->Map(sc) || !res->Validate(sequenceFile)) {
+        return nullptr;
+    }
+    logger_base.debug("Using sequence sidecar %s: %u elements, %u layers, %u effects.", (const char*)sc.c_str(),
+                      res->GetElementCount(),
+                      ((const SidecarHeader*)res->_data)->layerCount,
+                      ((const SidecarHeader*)res->_data)->effectCount);
+    return res;
+}
+
+std::string_view SequenceSidecar::GetString(uint32_t idx) const
+{
+    const SidecarHeader* h = (const SidecarHeader*)_data;
+    if (idx >= h->stringCount) {
+        return std::string_view();
+    }
+    const StringEntry& e = ((const StringEntry*)(_data + h->stringTableOffset))[idx];
+    if (h->stringDataOffset + e.offset + e.length > _size) {
+        return std::string_view();
+    }
+    return std::string_view((const char*)(_data + h->stringDataOffset + e.offset), e.length);
+}
+
+uint32_t SequenceSidecar::GetElementCount() const
+{
+    return ((const SidecarHeader*)_data)->elementCount;
+}
+
+const SequenceSidecar::ElementRecord& SequenceSidecar::GetElement(uint32_t idx) const
+{
+    return ((const ElementRecord*)(_data + ((const SidecarHeader*)_data)->elementOffset))[idx];
+}
+
+const SequenceSidecar::LayerRecord& SequenceSidecar::GetLayer(uint32_t idx) const
+{
+    return ((const LayerRecord*)(_data + ((const SidecarHeader*)_data)->layerOffset))[idx];
+}
+
+const SequenceSidecar::EffectRecord& SequenceSidecar::GetEffect(uint32_t idx) const
+{
+    return ((const EffectRecord*)(_data + ((const SidecarHeader*)_data)->effectOffset))[idx];
+}
+
+bool SequenceSidecar::LoadSkeleton(wxXmlDocument& doc) const
+{
+    std::string_view sk = GetString(((const SidecarHeader*)_data)->skeleton);
+    wxMemoryInputStream in(sk.data(), sk.size());
+    return doc.Load(in);
+}
+
+bool SequenceSidecar::LoadSections(wxXmlDocument& doc) const
+{
+    std::string_view sections = GetString(((const SidecarHeader*)_data)->sections);
+    wxMemoryInputStream in(sections.data(), sections.size());
+    return doc.Load(in);
+}
+
+std::vector<std::string> SequenceSidecar::GetModelNames() const
+{
+    const SidecarHeader* h = (const SidecarHeader*)_data;
+    const uint32_t* names = (const uint32_t*)(_data + h->nameOffset);
+    std::vector<std::string> res;
+    res.reserve(h->modelCount);
+    for (uint32_t i = 0; i < h->modelCount; i++) {
+        res.push_back(GetStdString(names[i]));
+    }
+    return res;
+}
+
+std::vector<std::string> SequenceSidecar::GetTimingNames() const
+{
+    const SidecarHeader* h = (const SidecarHeader*)_data;
+    const uint32_t* names = (const uint32_t*)(_data + h->nameOffset) + h->modelCount;
+    std::vector<std::string> res;
+    res.reserve(h->timingCount);
+    for (uint32_t i = 0; i < h->timingCount; i++) {
+        res.push_back(GetStdString(names[i]));
+    }
+    return res;
+}
+
+static void AddEffects(EffectLayer* layer, bool timing, StringPool& pool, std::vector<SequenceSidecar::EffectRecord>& effects, SequenceSidecar::LayerRecord& lr)
+{
+    lr.firstEffect = (uint32_t)effects.size();
+    for (const auto& e : layer->GetEffects()) {
+        SequenceSidecar::EffectRecord er;
+        memset(&er, 0, sizeof(er));
+        er.id = timing ? 0 : e->GetID();
+        er.name = pool.Add(e->GetEffectName());
+        er.settings = pool.Add(e->GetSettingsAsString());
+        er.palette = timing ? SequenceSidecar::NO_STRING : pool.AddOptional(e->GetPaletteAsString());
+        er.startTimeMS = e->GetStartTimeMS();
+        er.endTimeMS = e->GetEndTimeMS();
+        er.flags = e->GetProtected() ? SequenceSidecar::EFFECT_FLAG_PROTECTED : 0;
+        effects.push_back(er);
+    }
+    lr.effectCount = (uint32_t)effects.size() - lr.firstEffect;
+}
+
+static SequenceSidecar::LayerRecord NewLayer(SequenceSidecar::LayerKind kind)
+{
+    SequenceSidecar::LayerRecord lr;
+    memset(&lr, 0, sizeof(lr));
+    lr.kind = kind;
+    lr.layerName = SequenceSidecar::NO_STRING;
+    lr.ownerName = SequenceSidecar::NO_STRING;
+    lr.nodeName = SequenceSidecar::NO_STRING;
+    return lr;
+}
+
+bool SequenceSidecar::Write(const std::string& sequenceFile, const wxXmlDocument& doc, SequenceElements& elements,
+                            const std::vector<std::string>& models, const std::vector<std::string>& timings)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    if (!doc.IsOk() || doc.GetRoot() == nullptr) {
+        return false;
+    }
+
+    SidecarHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SIDECAR_MAGIC, 4);
+    header.version = SIDECAR_VERSION;
+    if (!HashFile(sequenceFile, header.sourceSize, header.sourceHash)) {
+        return false;
+    }
+    uint64_t size = 0;
+    if (!GetFileStats(sequenceFile, size, header.sourceModified) || size != header.sourceSize) {
+        return false;
+    }
+
+    StringPool pool;
+    std::vector<ElementRecord> elementRecs;
+    std::vector<LayerRecord> layerRecs;
+    std::vector<EffectRecord> effectRecs;
+
+    // skeleton document without the sections we store as records, and those sections on their own
+    {
+        wxXmlDocument skeleton;
+        wxXmlDocument sections;
+        wxXmlNode* root = doc.GetRoot();
+        wxXmlNode* sroot = new wxXmlNode(wxXML_ELEMENT_NODE, root->GetName());
+        wxXmlNode* sectionsRoot = new wxXmlNode(wxXML_ELEMENT_NODE, "sections");
+        for (wxXmlAttribute* a = root->GetAttributes(); a != nullptr; a = a->GetNext()) {
+            sroot->AddAttribute(a->GetName(), a->GetValue());
+        }
+        for (wxXmlNode* e = root->GetChildren(); e != nullptr; e = e->GetNext()) {
+            if (!IsSidecarSection(e->GetName())) {
+                sroot->AddChild(new wxXmlNode(*e));
+            } else {
+                sectionsRoot->AddChild(new wxXmlNode(*e));
+            }
+        }
+        sroot->AddChild(new wxXmlNode(wxXML_ELEMENT_NODE, "ColorPalettes"));
+        sroot->AddChild(new wxXmlNode(wxXML_ELEMENT_NODE, "EffectDB"));
+        sroot->AddChild(new wxXmlNode(wxXML_ELEMENT_NODE, "DisplayElements"));
+        sroot->AddChild(new wxXmlNode(wxXML_ELEMENT_NODE, "ElementEffects"));
+        skeleton.SetRoot(sroot);
+
+        wxMemoryOutputStream out;
+        skeleton.Save(out, wxXML_NO_INDENTATION);
+        size_t len = out.GetOutputStreamBuffer()->Tell();
+        header.skeleton = pool.Add(std::string((const char*)out.GetOutputStreamBuffer()->GetBufferStart(), len));
+
+        sections.SetRoot(sectionsRoot);
+        wxMemoryOutputStream sout;
+        sections.Save(sout, wxXML_NO_INDENTATION);
+        len = sout.GetOutputStreamBuffer()->Tell();
+        header.sections = pool.Add(std::string((const char*)sout.GetOutputStreamBuffer()->GetBufferStart(), len));
+    }
+
+    std::vector<uint32_t> nameRecs;
+    nameRecs.reserve(models.size() + timings.size());
+    for (const auto& it : models) {
+        nameRecs.push_back(pool.Add(it));
+    }
+    for (const auto& it : timings) {
+        nameRecs.push_back(pool.Add(it));
+    }
+    header.modelCount = (uint32_t)models.size();
+    header.timingCount = (uint32_t)timings.size();
+
+    for (size_t i = 0; i < elements.GetElementCount(); i++) {
+        Element* element = elements.GetElement(i);
+        ElementRecord er;
+        memset(&er, 0, sizeof(er));
+        er.name = pool.Add(element->GetName());
+        er.views = NO_STRING;
+        er.subType = NO_STRING;
+        er.collapsed = element->GetCollapsed();
+        er.renderDisabled = element->IsRenderDisabled();
+        er.firstLayer = (uint32_t)layerRecs.size();
+
+        if (element->GetType() == ElementType::ELEMENT_TYPE_TIMING) {
+            TimingElement* te = dynamic_cast<TimingElement*>(element);
+            er.timing = 1;
+            er.visible = te->GetMasterVisible();
+            er.active = te->GetActive();
+            er.views = pool.AddOptional(te->GetViews());
+            er.subType = pool.AddOptional(te->GetSubType());
+            er.fixedTiming = te->GetFixedTiming();
+            if (!te->IsFixedTiming()) {
+                for (size_t j = 0; j < te->GetEffectLayerCount(); j++) {
+                    LayerRecord lr = NewLayer(LayerKind::EFFECT_LAYER);
+                    lr.layer = (int32_t)j;
+                    AddEffects(te->GetEffectLayer(j), true, pool, effectRecs, lr);
+                    layerRecs.push_back(lr);
+                }
+            }
+        } else if (element->GetType() == ElementType::ELEMENT_TYPE_MODEL) {
+            ModelElement* me = dynamic_cast<ModelElement*>(element);
+            er.visible = element->GetVisible();
+            for (size_t j = 0; j < me->GetEffectLayerCount(); j++) {
+                EffectLayer* layer = me->GetEffectLayer(j);
+                LayerRecord lr = NewLayer(LayerKind::EFFECT_LAYER);
+                lr.layer = (int32_t)j;
+                lr.layerName = pool.AddOptional(layer->GetLayerName());
+                AddEffects(layer, false, pool, effectRecs, lr);
+                layerRecs.push_back(lr);
+            }
+            for (int s = 0; s < me->GetSubModelAndStrandCount(); s++) {
+                SubModelElement* se = me->GetSubModel(s);
+                StrandElement* strEl = dynamic_cast<StrandElement*>(se);
+                for (size_t j = 0; j < se->GetEffectLayerCount(); j++) {
+                    EffectLayer* layer = se->GetEffectLayer(j);
+                    if (layer->GetEffectCount() == 0 && layer->GetLayerName().empty()) {
+                        continue;
+                    }
+                    LayerRecord lr = NewLayer(strEl == nullptr ? LayerKind::SUBMODEL_LAYER : LayerKind::STRAND_LAYER);
+                    lr.layer = (int32_t)j;
+                    lr.strand = strEl == nullptr ? 0 : strEl->GetStrand();
+                    lr.ownerName = pool.AddOptional(se->GetName());
+                    lr.layerName = pool.AddOptional(layer->GetLayerName());
+                    AddEffects(layer, false, pool, effectRecs, lr);
+                    layerRecs.push_back(lr);
+                }
+                if (strEl != nullptr) {
+                    for (int n = 0; n < strEl->GetNodeLayerCount(); n++) {
+                        NodeLayer* nlayer = strEl->GetNodeLayer(n);
+                        if (nlayer->GetEffectCount() == 0) {
+                            continue;
+                        }
+                        LayerRecord lr = NewLayer(LayerKind::NODE_LAYER);
+                        lr.strand = strEl->GetStrand();
+                        lr.node = n;
+                        lr.ownerName = pool.AddOptional(se->GetName());
+                        lr.nodeName = pool.AddOptional(nlayer->GetNodeName());
+                        AddEffects(nlayer, false, pool, effectRecs, lr);
+                        layerRecs.push_back(lr);
+                    }
+                }
+            }
+        }
+        er.layerCount = (uint32_t)layerRecs.size() - er.firstLayer;
+        elementRecs.push_back(er);
+    }
+
+    header.stringCount = (uint32_t)pool.Strings().size();
+    header.elementCount = (uint32_t)elementRecs.size();
+    header.layerCount = (uint32_t)layerRecs.size();
+    header.effectCount = (uint32_t)effectRecs.size();
+
+    std::vector<StringEntry> stringTable;
+    stringTable.reserve(pool.Strings().size());
+    uint64_t stringDataSize = 0;
+    for (const auto& s : pool.Strings()) {
+        stringTable.push_back({ stringDataSize, (uint32_t)s->size(), 0 });
+        stringDataSize += s->size();
+    }
+
+    size_t offset = Align8(sizeof(SidecarHeader));
+    header.stringTableOffset = offset;
+    offset = Align8(offset + stringTable.size() * sizeof(StringEntry));
+    header.elementOffset = offset;
+    offset = Align8(offset + elementRecs.size() * sizeof(ElementRecord));
+    header.layerOffset = offset;
+    offset = Align8(offset + layerRecs.size() * sizeof(LayerRecord));
+    header.effectOffset = offset;
+    offset = Align8(offset + effectRecs.size() * sizeof(EffectRecord));
+    header.nameOffset = offset;
+    offset = Align8(offset + nameRecs.size() * sizeof(uint32_t));
+    header.stringDataOffset = offset;
+
+    std::vector<uint8_t> out;
+    out.reserve(offset + stringDataSize);
+    out.resize(header.stringTableOffset);
+    memcpy(out.data(), &header, sizeof(header));
+    Append(out, stringTable);
+    out.resize(header.elementOffset);
+    Append(out, elementRecs);
+    out.resize(header.layerOffset);
+    Append(out, layerRecs);
+    out.resize(header.effectOffset);
+    Append(out, effectRecs);
+    out.resize(header.nameOffset);
+    Append(out, nameRecs);
+    out.resize(header.stringDataOffset + stringDataSize);
+    for (size_t i = 0; i < stringTable.size(); i++) {
+        if (stringTable[i].length != 0) {
+            memcpy(&out[header.stringDataOffset + stringTable[i].offset], pool.Strings()[i]->data(), stringTable[i].length);
+        }
+    }
+
+    // write to a temp file and move it into place so a reader never sees a partial sidecar
+    std::string sc = GetSidecarFile(sequenceFile);
+    std::string tmp = sc + ".tmp";
+    {
+        wxFile f;
+        if (!f.Create(tmp, true) || f.Write(out.data(), out.size()) != out.size()) {
+            logger_base.warn("Unable to write sequence sidecar %s.", (const char*)sc.c_str());
+            f.Close();
+            wxRemoveFile(tmp);
+            return false;
+        }
+    }
+    if (!wxRenameFile(tmp, sc, true)) {
+        wxRemoveFile(tmp);
+        return false;
+    }
+    logger_base.debug("Sequence sidecar written %s: %u elements, %u layers, %u effects, %u strings.", (const char*)sc.c_str(),
+                      header.elementCount, header.layerCount, header.effectCount, header.stringCount);
+    return true;
+}
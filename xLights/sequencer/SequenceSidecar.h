@@ -0,0 +1,123 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class wxXmlDocument;
+class SequenceElements;
+
+// Binary sidecar (.xsqb) written next to a sequence file.
+//
+// It holds everything SequenceElements builds from the large sections of the
+// .xsq (DisplayElements, ElementEffects, EffectDB and ColorPalettes) as flat
+// record arrays plus an interned string table, and the rest of the xml
+// document as a small "skeleton". The xml of those sections is kept as well
+// so the full document can be put back together if anything asks for it, and
+// the model and timing names the .xsq lists so they need neither. All
+// references are indexes so the file can be memory mapped and used in place.
+// The sidecar is only used if the size and modification time of the .xsq
+// still match, or if the size does and the content hash shows a file that was
+// only touched is unchanged.
+class SequenceSidecar
+{
+public:
+    static constexpr uint32_t NO_STRING = 0xFFFFFFFF;
+
+    enum class LayerKind : uint8_t {
+        EFFECT_LAYER,
+        SUBMODEL_LAYER,
+        STRAND_LAYER,
+        NODE_LAYER
+    };
+
+    struct ElementRecord {
+        uint32_t name;
+        uint32_t views;
+        uint32_t subType;
+        uint8_t timing;
+        uint8_t visible;
+        uint8_t collapsed;
+        uint8_t active;
+        uint8_t renderDisabled;
+        uint8_t pad[3];
+        int32_t fixedTiming;
+        uint32_t firstLayer;
+        uint32_t layerCount;
+    };
+
+    struct LayerRecord {
+        LayerKind kind;
+        uint8_t pad[3];
+        uint32_t layerName;
+        uint32_t ownerName; // submodel or strand name
+        uint32_t nodeName;
+        int32_t strand;
+        int32_t layer;
+        int32_t node;
+        uint32_t firstEffect;
+        uint32_t effectCount;
+    };
+
+    struct EffectRecord {
+        int32_t id;
+        uint32_t name;
+        uint32_t settings;
+        uint32_t palette;
+        int32_t startTimeMS;
+        int32_t endTimeMS;
+        uint32_t flags;
+    };
+
+    static const uint32_t EFFECT_FLAG_PROTECTED = 0x01;
+
+    static bool IsEnabled();
+    static void SetEnabled(bool enabled);
+    static std::string GetSidecarFile(const std::string& sequenceFile);
+
+    // returns nullptr if there is no sidecar or it does not match the sequence file
+    static std::unique_ptr<SequenceSidecar> Open(const std::string& sequenceFile);
+    static bool Write(const std::string& sequenceFile, const wxXmlDocument& doc, SequenceElements& elements,
+                      const std::vector<std::string>& models, const std::vector<std::string>& timings);
+    static void Remove(const std::string& sequenceFile);
+
+    ~SequenceSidecar();
+    SequenceSidecar(const SequenceSidecar&) = delete;
+    SequenceSidecar& operator=(const SequenceSidecar&) = delete;
+
+    bool LoadSkeleton(wxXmlDocument& doc) const;
+    // the sections missing from the skeleton as children of one root node
+    bool LoadSections(wxXmlDocument& doc) const;
+    std::vector<std::string> GetModelNames() const;
+    std::vector<std::string> GetTimingNames() const;
+
+    std::string_view GetString(uint32_t idx) const;
+    std::string GetStdString(uint32_t idx) const { return std::string(GetString(idx)); }
+
+    uint32_t GetElementCount() const;
+    const ElementRecord& GetElement(uint32_t idx) const;
+    const LayerRecord& GetLayer(uint32_t idx) const;
+    const EffectRecord& GetEffect(uint32_t idx) const;
+
+private:
+    SequenceSidecar() {}
+    bool Map(const std::string& file);
+    bool Validate(const std::string& sequenceFile) const;
+
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    bool _mapped = false;
+    std::vector<uint8_t> _buffer;
+};
@@ -8,95 +8,203 @@
  * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
  **************************************************************/
 
+#include <algorithm>
+
 #include "UndoManager.h"
 #include "Element.h"
 #include "SequenceElements.h"
 #include <log4cpp/Category.hh>
 
-DeletedEffectInfo::DeletedEffectInfo( const std::string &element_name_, int layer_index_, const std::string &name_, const std::string &settings_,
-                                      const std::string &palette_, int startTimeMS_, int endTimeMS_, int Selected_, bool Protected_ )
-: element_name(element_name_), layer_index(layer_index_), name(name_), settings(settings_),
-  palette(palette_), startTimeMS(startTimeMS_), endTimeMS(endTimeMS_), Selected(Selected_), Protected(Protected_)
+// the journal's default memory limit
+#define UNDO_MEMORY_LIMIT_MB 256
+
+namespace
 {
+    // Effects of a layer waiting to be deleted in one go. Until then the rest are found by
+    // the ids they would have if every delete had renumbered the layer straight away.
+    class HeldDeletes
+    {
+        EffectLayer* _layer;
+        std::vector<int> _tree; // Fenwick tree of the effects still there, by position
+        int _remaining;
+        std::vector<Effect*> _effects;
+
+    public:
+        explicit HeldDeletes(EffectLayer* el) :
+            _layer(el), _tree(el->GetEffectCount() + 1, 0), _remaining(el->GetEffectCount())
+        {
+            for (size_t i = 1; i < _tree.size(); i++) {
+                _tree[i] += 1;
+                size_t parent = i + (i & (~i + 1));
+                if (parent < _tree.size()) {
+                    _tree[parent] += _tree[i];
+                }
+            }
+        }
+
+        // the position in the layer of the effect with this id, -1 if there isn't one
+        int Find(int id) const
+        {
+            if (id < 0 || id >= _remaining) {
+                return -1;
+            }
+            size_t step = 1;
+            while (step * 2 < _tree.size()) {
+                step *= 2;
+            }
+            size_t pos = 0;
+            int want = id + 1;
+            for (; step > 0; step /= 2) {
+                if (pos + step < _tree.size() && _tree[pos + step] < want) {
+                    pos += step;
+                    want -= _tree[pos];
+                }
+            }
+            return (int)pos;
+        }
+
+        void Delete(int index)
+        {
+            _effects.push_back(_layer->GetEffect(index));
+            --_remaining;
+            for (size_t i = index + 1; i < _tree.size(); i += (i & (~i + 1))) {
+                _tree[i] -= 1;
+            }
+        }
+
+        void Apply()
+        {
+            _layer->DeleteEffects(_effects);
+        }
+    };
 }
 
-AddedEffectInfo::AddedEffectInfo( const std::string &element_name_, int layer_index_, int id_ )
-: element_name(element_name_), layer_index(layer_index_), id(id_)
+uint32_t UndoStringPool::Add(const std::string& s)
 {
+    auto it = mIndex.find(std::string_view(s));
+    if (it != mIndex.end()) {
+        mEntries[it->second].refs++;
+        return it->second;
+    }
+
+    uint32_t id;
+    if (!mFree.empty()) {
+        id = mFree.back();
+        mFree.pop_back();
+    } else {
+        id = (uint32_t)mEntries.size();
+        mEntries.emplace_back();
+    }
+    Entry& e = mEntries[id];
+    e.value = s;
+    e.refs = 1;
+    mIndex[std::string_view(e.value)] = id;
+    mBytes += sizeof(Entry) + e.value.capacity();
+    return id;
 }
 
-MovedEffectInfo::MovedEffectInfo( const std::string &element_name_, int layer_index_, int id_, int startTimeMS_, int endTimeMS_ )
-: element_name(element_name_), layer_index(layer_index_), id(id_), startTimeMS(startTimeMS_), endTimeMS(endTimeMS_)
+void UndoStringPool::Release(uint32_t id)
 {
+    if (id == NO_STRING) {
+        return;
+    }
+    Entry& e = mEntries[id];
+    if (--e.refs == 0) {
+        mIndex.erase(std::string_view(e.value));
+        mBytes -= sizeof(Entry) + e.value.capacity();
+        std::string().swap(e.value);
+        mFree.push_back(id);
+    }
 }
 
-ModifiedEffectInfo::ModifiedEffectInfo( const std::string &element_name_, int layer_index_, int id_, const std::string &settings_, const std::string &palette_ )
-: element_name(element_name_), layer_index(layer_index_), id(id_), settings(settings_), palette(palette_), effectName(""), effectType(-1)
+void UndoStringPool::Clear()
 {
+    mIndex.clear();
+    mEntries.clear();
+    mFree.clear();
+    mBytes = 0;
 }
 
-
-ModifiedEffectInfo::ModifiedEffectInfo( const std::string &element_name_, int layer_index_, Effect *ef)
-: element_name(element_name_), layer_index(layer_index_), id(ef->GetID()),
-    settings(ef->GetSettingsAsString()), palette(ef->GetPaletteAsString()), effectName(ef->GetEffectName()), effectType(ef->GetEffectIndex())
+UndoManager::UndoManager(SequenceElements* parent)
+: mMemoryLimit((size_t)UNDO_MEMORY_LIMIT_MB * 1024 * 1024), mParentSequence(parent), mCaptureUndo(false)
 {
 }
 
-UndoStep::UndoStep( UNDO_ACTIONS action )
-: undo_action(action)
+UndoManager::~UndoManager()
 {
 }
 
-UndoStep::UndoStep( UNDO_ACTIONS action, DeletedEffectInfo* effect_info )
-: undo_action(action)
+void UndoManager::SetCaptureUndo( bool value )
 {
-    deleted_effect_info.push_back(effect_info);
+    mCaptureUndo = value;
 }
 
-UndoStep::UndoStep( UNDO_ACTIONS action, AddedEffectInfo* effect_info )
-: undo_action(action)
+void UndoManager::SetMemoryLimit( size_t bytes )
 {
-    added_effect_info.push_back(effect_info);
+    mMemoryLimit = bytes;
+    TrimToMemoryLimit();
 }
 
-UndoStep::UndoStep( UNDO_ACTIONS action, MovedEffectInfo* effect_info )
-: undo_action(action)
+size_t UndoManager::GetMemoryUsed() const
 {
-    moved_effect_info.push_back(effect_info);
+    return mStrings.GetMemoryUsed() + (mUndoSteps.size() + mRedoSteps.size()) * sizeof(UndoRecord);
 }
 
-UndoStep::UndoStep( UNDO_ACTIONS action, ModifiedEffectInfo* effect_info )
-: undo_action(action)
+UndoRecord& UndoManager::AddRecord( std::deque<UndoRecord> &list, UNDO_ACTIONS action, const std::string &element_name, int layer_index )
 {
-    modified_effect_info.push_back(effect_info);
+    UndoRecord& record = list.emplace_back();
+    record.action = action;
+    record.element_name = mStrings.Add(element_name);
+    record.layer_index = layer_index;
+    return record;
 }
 
-UndoManager::UndoManager(SequenceElements* parent)
-: mParentSequence(parent), mCaptureUndo(false)
+void UndoManager::ReleaseRecord( UndoRecord &record )
 {
+    mStrings.Release(record.element_name);
+    mStrings.Release(record.name);
+    mStrings.Release(record.settings);
+    mStrings.Release(record.palette);
 }
 
-UndoManager::~UndoManager()
+void UndoManager::ClearList( std::deque<UndoRecord> &list )
 {
-    for( size_t i = 0; i < mUndoSteps.size(); i++ )
-    {
-        delete mUndoSteps[i];
+    for (auto& it : list) {
+        ReleaseRecord(it);
     }
+    list.clear();
 }
 
-void UndoManager::SetCaptureUndo( bool value )
+void UndoManager::TrimToMemoryLimit()
 {
-    mCaptureUndo = value;
+    static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    int dropped = 0;
+    while (GetMemoryUsed() > mMemoryLimit && !mUndoSteps.empty()) {
+        // the oldest step runs up to the next marker, if there is none it is the last step and is kept
+        auto next = std::find_if(mUndoSteps.begin() + 1, mUndoSteps.end(), [](const UndoRecord& r) { return r.action == UNDO_MARKER; });
+        if (next == mUndoSteps.end()) {
+            break;
+        }
+        for (auto it = mUndoSteps.begin(); it != next; ++it) {
+            ReleaseRecord(*it);
+        }
+        mUndoSteps.erase(mUndoSteps.begin(), next);
+        dropped++;
+    }
+    if (dropped > 0) {
+        logger_base.debug("Undo history over its memory limit, dropped the oldest %d step(s).", dropped);
+    }
 }
 
 void UndoManager::RemoveUnusedMarkers()
 {
     if( mUndoSteps.size() > 0 )
     {
-        UndoStep* last_action = mUndoSteps.back();
         // delete any marker stragglers
-        if( last_action->undo_action == UNDO_MARKER )
+        if( mUndoSteps.back().action == UNDO_MARKER )
         {
+            ReleaseRecord(mUndoSteps.back());
             mUndoSteps.pop_back();
         }
     }
@@ -106,8 +214,7 @@ bool UndoManager::ChangeCaptured()
 {
     if( mUndoSteps.size() > 0 )
     {
-        UndoStep* last_action = mUndoSteps.back();
-        if( last_action->undo_action != UNDO_MARKER )
+        if( mUndoSteps.back().action != UNDO_MARKER )
         {
             return true;
         }
@@ -116,21 +223,13 @@ bool UndoManager::ChangeCaptured()
 }
 
 void UndoManager::Clear() {
-    RemoveUnusedMarkers();
-    for (size_t i = 0; i < mUndoSteps.size(); i++)
-    {
-        delete mUndoSteps[i];
-    }
-    mUndoSteps.clear();
-    ClearRedo();
+    ClearList(mUndoSteps);
+    ClearList(mRedoSteps);
+    mStrings.Clear();
 }
 
 void UndoManager::ClearRedo() {
-    for (size_t i = 0; i < mRedoSteps.size(); i++)
-    {
-        delete mRedoSteps[i];
-    }
-    mRedoSteps.clear();
+    ClearList(mRedoSteps);
 }
 
 bool UndoManager::CanUndo()
@@ -148,198 +247,248 @@ void UndoManager::CreateUndoStep()
 {
     ClearRedo();
     RemoveUnusedMarkers();
-    UndoStep* action = new UndoStep(UNDO_MARKER);
-    mUndoSteps.push_back(action);
+    TrimToMemoryLimit();
+    mUndoSteps.emplace_back().action = UNDO_MARKER;
 }
 
 void UndoManager::CaptureEffectToBeDeleted( const std::string &element_name, int layer_index, const std::string &name, const std::string &settings,
                                             const std::string &palette, int startTimeMS, int endTimeMS, int Selected, bool Protected )
 {
-    DeletedEffectInfo* effect_undo_action = new DeletedEffectInfo( element_name, layer_index, name, settings, palette, startTimeMS, endTimeMS, Selected, Protected );
-    UndoStep* action = new UndoStep(UNDO_EFFECT_DELETED, effect_undo_action);
-    mUndoSteps.push_back(action);
+    UndoRecord& record = AddRecord(mUndoSteps, UNDO_EFFECT_DELETED, element_name, layer_index);
+    record.name = mStrings.Add(name);
+    record.settings = mStrings.Add(settings);
+    record.palette = mStrings.Add(palette);
+    record.startTimeMS = startTimeMS;
+    record.endTimeMS = endTimeMS;
+    record.Selected = Selected;
+    record.Protected = Protected;
 }
 
 void UndoManager::CaptureAddedEffect( const std::string &element_name, int layer_index, int id )
 {
-    AddedEffectInfo* effect_undo_action = new AddedEffectInfo( element_name, layer_index, id );
-    UndoStep* action = new UndoStep(UNDO_EFFECT_ADDED, effect_undo_action);
-    mUndoSteps.push_back(action);
+    AddRecord(mUndoSteps, UNDO_EFFECT_ADDED, element_name, layer_index).id = id;
 }
 
 void UndoManager::CaptureEffectToBeMoved( const std::string &element_name, int layer_index, int id, int startTimeMS, int endTimeMS )
 {
-    MovedEffectInfo* effect_undo_action = new MovedEffectInfo( element_name, layer_index, id, startTimeMS, endTimeMS );
-    UndoStep* action = new UndoStep(UNDO_EFFECT_MOVED, effect_undo_action);
-    mUndoSteps.push_back(action);
+    UndoRecord& record = AddRecord(mUndoSteps, UNDO_EFFECT_MOVED, element_name, layer_index);
+    record.id = id;
+    record.startTimeMS = startTimeMS;
+    record.endTimeMS = endTimeMS;
 }
 
 void UndoManager::CaptureModifiedEffect( const std::string &element_name, int layer_index, int id, const std::string &settings, const std::string &palette )
 {
-    ModifiedEffectInfo* effect_undo_action = new ModifiedEffectInfo( element_name, layer_index, id, settings, palette );
-    UndoStep* action = new UndoStep(UNDO_EFFECT_MODIFIED, effect_undo_action);
-    mUndoSteps.push_back(action);
+    UndoRecord& record = AddRecord(mUndoSteps, UNDO_EFFECT_MODIFIED, element_name, layer_index);
+    record.id = id;
+    record.settings = mStrings.Add(settings);
+    record.palette = mStrings.Add(palette);
 }
 
 void UndoManager::CaptureModifiedEffect( const std::string &element_name, int layer_index, Effect *ef )
 {
-    ModifiedEffectInfo* effect_undo_action = new ModifiedEffectInfo( element_name, layer_index, ef );
-    UndoStep* action = new UndoStep(UNDO_EFFECT_MODIFIED, effect_undo_action);
-    mUndoSteps.push_back(action);
+    UndoRecord& record = AddRecord(mUndoSteps, UNDO_EFFECT_MODIFIED, element_name, layer_index);
+    record.id = ef->GetID();
+    record.name = mStrings.Add(ef->GetEffectName());
+    record.settings = mStrings.Add(ef->GetSettingsAsString());
+    record.palette = mStrings.Add(ef->GetPaletteAsString());
+    record.effectType = ef->GetEffectIndex();
 }
+
 void UndoManager::CancelLastStep() {
     if (!mUndoSteps.empty()) {
-        delete mUndoSteps.back();
+        ReleaseRecord(mUndoSteps.back());
         mUndoSteps.pop_back();
     }
 }
 
 void UndoManager::UndoLastStep()
 {
-    UndoStep* action = new UndoStep(UNDO_MARKER);
-    mRedoSteps.push_back(action);
+    mRedoSteps.emplace_back().action = UNDO_MARKER;
     ProcessUndoStep(mUndoSteps, mRedoSteps);
 }
 
 void UndoManager::RedoLastStep()
 {
-    UndoStep* action = new UndoStep(UNDO_MARKER);
-    mUndoSteps.push_back(action);
+    mUndoSteps.emplace_back().action = UNDO_MARKER;
     ProcessUndoStep(mRedoSteps, mUndoSteps);
 }
 
-void UndoManager::ProcessUndoStep(std::vector<UndoStep*> &fromList, std::vector<UndoStep*> &toList)
+void UndoManager::ProcessUndoStep(std::deque<UndoRecord> &fromList, std::deque<UndoRecord> &toList)
 {
     static log4cpp::Category &logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    // A bulk edit is thousands of records against a few layers so the layers are looked up
+    // once for the whole step. Deleting an effect renumbers its layer, so the deletes are held
+    // back and done together, and the ids are found through what is held back meanwhile.
+    std::unordered_map<uint64_t, EffectLayer*> layers;
+    std::unordered_map<EffectLayer*, HeldDeletes> deletes;
+    auto getLayer = [this, &layers](const UndoRecord& record) -> EffectLayer* {
+        uint64_t key = ((uint64_t)record.element_name << 32) | (uint32_t)record.layer_index;
+        auto it = layers.find(key);
+        if (it != layers.end()) {
+            return it->second;
+        }
+        EffectLayer* el = nullptr;
+        Element* element = mParentSequence->GetElement(mStrings.Get(record.element_name));
+        if (element != nullptr) {
+            el = element->GetEffectLayerFromExclusiveIndex(record.layer_index);
+        }
+        layers[key] = el;
+        return el;
+    };
+    auto findEffect = [&deletes](EffectLayer* el, int id) -> int {
+        auto it = deletes.find(el);
+        if (it != deletes.end()) {
+            return it->second.Find(id);
+        }
+        // an effect's id is its position unless the layer has not been renumbered since it changed
+        if (id >= 0 && id < el->GetEffectCount() && el->GetEffect(id)->GetID() == id) {
+            return id;
+        }
+        for (int i = 0; i < el->GetEffectCount(); i++) {
+            if (el->GetEffect(i)->GetID() == id) {
+                return i;
+            }
+        }
+        return -1;
+    };
+    auto getEffect = [&findEffect](EffectLayer* el, int id) -> Effect* {
+        int index = findEffect(el, id);
+        return index < 0 ? nullptr : el->GetEffect(index);
+    };
+    auto applyDeletes = [&deletes](EffectLayer* el) {
+        auto it = deletes.find(el);
+        if (it != deletes.end()) {
+            it->second.Apply();
+            deletes.erase(it);
+        }
+    };
+
     bool done = false;
     while (fromList.size() > 0 && !done)
     {
-        UndoStep* next_action = fromList.back();
-        switch (next_action->undo_action)
+        UndoRecord& next_action = fromList.back();
+        switch (next_action.action)
         {
         case UNDO_MARKER:
             done = true;
             break;
         case UNDO_EFFECT_DELETED:
         {
-            if (next_action->deleted_effect_info.size() == 0) {
-                logger_base.crit("UndoManager::ProcessUndoStep about to access past end of array. This wont end well. XXX");
-            }
-            Element* element = mParentSequence->GetElement(next_action->deleted_effect_info[0]->element_name);
-            if (element != nullptr)
+            EffectLayer* el = getLayer(next_action);
+            if (el != nullptr)
             {
-                EffectLayer* el = element->GetEffectLayerFromExclusiveIndex(next_action->deleted_effect_info[0]->layer_index);
-                if (el != nullptr)
+                applyDeletes(el);
+                Effect* eff = el->AddEffect(0,
+                    mStrings.Get(next_action.name),
+                    mStrings.Get(next_action.settings),
+                    mStrings.Get(next_action.palette),
+                    next_action.startTimeMS,
+                    next_action.endTimeMS,
+                    next_action.Selected,
+                    next_action.Protected);
+
+                // Move effect to other list
+                if (eff != nullptr)
                 {
-                    Effect* eff = el->AddEffect(0,
-                        next_action->deleted_effect_info[0]->name,
-                        next_action->deleted_effect_info[0]->settings,
-                        next_action->deleted_effect_info[0]->palette,
-                        next_action->deleted_effect_info[0]->startTimeMS,
-                        next_action->deleted_effect_info[0]->endTimeMS,
-                        next_action->deleted_effect_info[0]->Selected,
-                        next_action->deleted_effect_info[0]->Protected);
-
-                    // Move effect to other list
-                    AddedEffectInfo* effect_undo_action = new AddedEffectInfo(el->GetParentElement()->GetModelName(), el->GetIndex(), eff->GetID());
-                    UndoStep* action = new UndoStep(UNDO_EFFECT_ADDED, effect_undo_action);
-                    toList.push_back(action);
+                    AddRecord(toList, UNDO_EFFECT_ADDED, el->GetParentElement()->GetModelName(), el->GetIndex()).id = eff->GetID();
                 }
             }
         }
         break;
         case UNDO_EFFECT_ADDED:
         {
-            if (next_action->added_effect_info.size() == 0) {
-                logger_base.crit("UndoManager::ProcessUndoStep about to access past end of array. This wont end well. AAA");
-            }
-            Element* element = mParentSequence->GetElement(next_action->added_effect_info[0]->element_name);
-            if (element != nullptr)
+            EffectLayer* el = getLayer(next_action);
+            if (el != nullptr)
             {
-                EffectLayer* el = element->GetEffectLayerFromExclusiveIndex(next_action->added_effect_info[0]->layer_index);
-                if (el != nullptr)
+                // Move effect to other list
+                int index = findEffect(el, next_action.id);
+                Effect* eff = index < 0 ? nullptr : el->GetEffect(index);
+                if (eff == nullptr)
                 {
-                    // Move effect to other list
-                    Effect* eff = el->GetEffectFromID(next_action->added_effect_info[0]->id);
-                    DeletedEffectInfo* effect_undo_action = new DeletedEffectInfo(el->GetParentElement()->GetModelName(), el->GetIndex(), eff->GetEffectName(), eff->GetSettingsAsString(), eff->GetPaletteAsString(), eff->GetStartTimeMS(), eff->GetEndTimeMS(), EFFECT_NOT_SELECTED, false);
-                    UndoStep* action = new UndoStep(UNDO_EFFECT_DELETED, effect_undo_action);
-                    toList.push_back(action);
-
-                    // Delete the effect
-                    el->DeleteEffect(next_action->added_effect_info[0]->id);
+                    logger_base.warn("UndoLastStep:UNDO_EFFECT_ADDED Effect not found %d.", next_action.id);
+                }
+                else
+                {
+                    UndoRecord& record = AddRecord(toList, UNDO_EFFECT_DELETED, el->GetParentElement()->GetModelName(), el->GetIndex());
+                    record.name = mStrings.Add(eff->GetEffectName());
+                    record.settings = mStrings.Add(eff->GetSettingsAsString());
+                    record.palette = mStrings.Add(eff->GetPaletteAsString());
+                    record.startTimeMS = eff->GetStartTimeMS();
+                    record.endTimeMS = eff->GetEndTimeMS();
+                    record.Selected = EFFECT_NOT_SELECTED;
+                    record.Protected = false;
+
+                    // Delete the effect, with the others from this layer
+                    deletes.try_emplace(el, el).first->second.Delete(index);
                 }
             }
         }
         break;
         case UNDO_EFFECT_MOVED:
         {
-            if (next_action->moved_effect_info.size() == 0) {
-                logger_base.crit("UndoManager::ProcessUndoStep about to access past end of array. This wont end well. BBB");
+            EffectLayer* el = getLayer(next_action);
+            if (el == nullptr)
+            {
+                logger_base.warn("UndoLastStep:UNDO_EFFECT_MOVED Element not found %d.", next_action.layer_index);
             }
-            Element* element = mParentSequence->GetElement(next_action->moved_effect_info[0]->element_name);
-            if (element != nullptr)
+            else
             {
-                EffectLayer* el = element->GetEffectLayerFromExclusiveIndex(next_action->moved_effect_info[0]->layer_index);
-                if (el == nullptr)
+                Effect* eff = getEffect(el, next_action.id);
+                if (eff != nullptr)
                 {
-                    logger_base.warn("UndoLastStep:UNDO_EFFECT_MOVED Element not found %d.", next_action->moved_effect_info[0]->layer_index);
-                }
-                else
-                {
-                    Effect* eff = el->GetEffectFromID(next_action->moved_effect_info[0]->id);
-                    if (eff != nullptr)
-                    {
-                        // Capture for other list
-                        MovedEffectInfo* effect_undo_action = new MovedEffectInfo(el->GetParentElement()->GetModelName(), el->GetIndex(), eff->GetID(), eff->GetStartTimeMS(), eff->GetEndTimeMS());
-                        UndoStep* action = new UndoStep(UNDO_EFFECT_MOVED, effect_undo_action);
-                        toList.push_back(action);
-
-                        // Move the effect
-                        eff->SetStartTimeMS(next_action->moved_effect_info[0]->startTimeMS);
-                        eff->SetEndTimeMS(next_action->moved_effect_info[0]->endTimeMS);
-                    }
+                    // Capture for other list
+                    UndoRecord& record = AddRecord(toList, UNDO_EFFECT_MOVED, el->GetParentElement()->GetModelName(), el->GetIndex());
+                    record.id = next_action.id;
+                    record.startTimeMS = eff->GetStartTimeMS();
+                    record.endTimeMS = eff->GetEndTimeMS();
+
+                    // Move the effect
+                    eff->SetStartTimeMS(next_action.startTimeMS);
+                    eff->SetEndTimeMS(next_action.endTimeMS);
                 }
             }
         }
         break;
         case UNDO_EFFECT_MODIFIED:
         {
-            if (next_action->modified_effect_info.size() == 0) {
-                logger_base.crit("UndoManager::ProcessUndoStep about to access past end of array. This wont end well. CCC");
+            EffectLayer* el = getLayer(next_action);
+            if (el == nullptr)
+            {
+                logger_base.warn("UndoLastStep:UNDO_EFFECT_MODIFIED Element not found %d.", next_action.layer_index);
             }
-            Element* element = mParentSequence->GetElement(next_action->modified_effect_info[0]->element_name);
-            if (element != nullptr)
+            else
             {
-                EffectLayer* el = element->GetEffectLayerFromExclusiveIndex(next_action->modified_effect_info[0]->layer_index);
-                if (el == nullptr)
+                Effect* eff = getEffect(el, next_action.id);
+                if (eff != nullptr)
                 {
-                    logger_base.warn("UndoLastStep:UNDO_EFFECT_MODIFIED Element not found %d.", next_action->modified_effect_info[0]->layer_index);
-                }
-                else
-                {
-                    Effect* eff = el->GetEffectFromID(next_action->modified_effect_info[0]->id);
-                    if (eff != nullptr)
-                    {
-                        // Capture for other list
-                        ModifiedEffectInfo* effect_undo_action = new ModifiedEffectInfo(el->GetParentElement()->GetModelName(), el->GetIndex(), eff);
-                        UndoStep* action = new UndoStep(UNDO_EFFECT_MODIFIED, effect_undo_action);
-                        toList.push_back(action);
-
-                        // Modify the effect
-                        if (next_action->modified_effect_info[0]->effectType >= 0) {
-                            eff->SetEffectName(next_action->modified_effect_info[0]->effectName);
-                            eff->SetEffectIndex(next_action->modified_effect_info[0]->effectType);
-                        }
-                        eff->SetSettings(next_action->modified_effect_info[0]->settings, false);
-                        eff->SetPalette(next_action->modified_effect_info[0]->palette);
+                    // Capture for other list
+                    UndoRecord& record = AddRecord(toList, UNDO_EFFECT_MODIFIED, el->GetParentElement()->GetModelName(), el->GetIndex());
+                    record.id = next_action.id;
+                    record.name = mStrings.Add(eff->GetEffectName());
+                    record.settings = mStrings.Add(eff->GetSettingsAsString());
+                    record.palette = mStrings.Add(eff->GetPaletteAsString());
+                    record.effectType = eff->GetEffectIndex();
+
+                    // Modify the effect
+                    if (next_action.effectType >= 0) {
+                        eff->SetEffectName(mStrings.Get(next_action.name));
+                        eff->SetEffectIndex(next_action.effectType);
                     }
+                    eff->SetSettings(mStrings.Get(next_action.settings), false);
+                    eff->SetPalette(mStrings.Get(next_action.palette));
                 }
             }
         }
         break;
         }
+        ReleaseRecord(fromList.back());
         fromList.pop_back();
     }
+    for (auto& it : deletes) {
+        it.second.Apply();
+    }
 }
 
 std::string UndoManager::GetUndoString()
@@ -348,8 +497,7 @@ std::string UndoManager::GetUndoString()
 
     if (mUndoSteps.size() > 0)
     {
-        UndoStep* next_action = mUndoSteps.back();
-        switch (next_action->undo_action)
+        switch (mUndoSteps.back().action)
         {
         case UNDO_EFFECT_DELETED:
             undo_string = "Undo: Effect(s) Deleted";
@@ -376,8 +524,7 @@ std::string UndoManager::GetRedoString()
 
     if (mRedoSteps.size() > 0)
     {
-        UndoStep* next_action = mRedoSteps.back();
-        switch (next_action->undo_action)
+        switch (mRedoSteps.back().action)
         {
         case UNDO_EFFECT_DELETED:
             redo_string = "Redo: Effect(s) Deleted";
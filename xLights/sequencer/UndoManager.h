@@ -11,10 +11,15 @@
  **************************************************************/
 
 #include "wx/wx.h"
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 class SequenceElements;
 class Effect;
+class EffectLayer;
 
 enum UNDO_ACTIONS
 {
@@ -25,71 +30,48 @@ enum UNDO_ACTIONS
     UNDO_EFFECT_MOVED
 };
 
-class DeletedEffectInfo
+// The strings held by the undo journal. Each one is kept once, however many records use it.
+// Bulk edits leave many effects with the same palette and settings, and undo and redo
+// capture the same strings back and forth, so sharing them keeps the journal small.
+class UndoStringPool
 {
 public:
-    std::string element_name;
-    int layer_index;
-    std::string name;
-    std::string settings;
-    std::string palette;
-    int startTimeMS;
-    int endTimeMS;
-    int Selected;
-    bool Protected;
-    DeletedEffectInfo( const std::string &element_name_, int layer_index_, const std::string &name_, const std::string &settings_,
-                       const std::string &palette_, int startTimeMS_, int endTimeMS_, int Selected_, bool Protected_ );
+    static const uint32_t NO_STRING = 0xFFFFFFFF;
+
+    uint32_t Add(const std::string& s);
+    void Release(uint32_t id);
+    const std::string& Get(uint32_t id) const { return mEntries[id].value; }
+    size_t GetMemoryUsed() const { return mBytes; }
+    void Clear();
+
+private:
+    struct Entry
+    {
+        std::string value;
+        uint32_t refs = 0;
+    };
+    std::deque<Entry> mEntries; // a deque so the values mIndex views never move
+    std::vector<uint32_t> mFree;
+    std::unordered_map<std::string_view, uint32_t> mIndex;
+    size_t mBytes = 0;
 };
 
-class AddedEffectInfo
+// One entry in the undo journal. Which fields are used depends on the action. Strings are
+// ids in the journal's UndoStringPool.
+struct UndoRecord
 {
-public:
-    std::string element_name;
-    int layer_index;
-    int id;
-    AddedEffectInfo( const std::string &element_name_, int layer_index_, int id_ );
-};
-
-class MovedEffectInfo
-{
-public:
-    std::string element_name;
-    int layer_index;
-    int id;
-    int startTimeMS;
-    int endTimeMS;
-    MovedEffectInfo( const std::string &element_name_, int layer_index_, int id_, int startTimeMS_, int endTimeMS_ );
-};
-
-class ModifiedEffectInfo
-{
-public:
-    std::string element_name;
-    int layer_index;
-    int id;
-    std::string settings;
-    std::string palette;
-    std::string effectName;
-    int effectType;
-    
-    ModifiedEffectInfo( const std::string &element_name_, int layer_index_, int id_, const std::string &settings_, const std::string &palette_ );
-    ModifiedEffectInfo( const std::string &element_name_, int layer_index_, Effect *ef);
-};
-
-class UndoStep
-{
-public:
-    explicit UndoStep( UNDO_ACTIONS action );
-    UndoStep( UNDO_ACTIONS action, DeletedEffectInfo* effect_info );
-    UndoStep( UNDO_ACTIONS action, AddedEffectInfo* effect_info );
-    UndoStep( UNDO_ACTIONS action, MovedEffectInfo* effect_info );
-    UndoStep( UNDO_ACTIONS action, ModifiedEffectInfo* effect_info );
-
-    UNDO_ACTIONS undo_action;
-    std::vector<DeletedEffectInfo*> deleted_effect_info;
-    std::vector<AddedEffectInfo*> added_effect_info;
-    std::vector<MovedEffectInfo*> moved_effect_info;
-    std::vector<ModifiedEffectInfo*> modified_effect_info;
+    UNDO_ACTIONS action = UNDO_MARKER;
+    uint32_t element_name = UndoStringPool::NO_STRING;
+    int layer_index = 0;
+    int id = 0;                                   // added, moved and modified effects
+    uint32_t name = UndoStringPool::NO_STRING;    // deleted and modified effects
+    uint32_t settings = UndoStringPool::NO_STRING;
+    uint32_t palette = UndoStringPool::NO_STRING;
+    int startTimeMS = 0;                          // deleted and moved effects
+    int endTimeMS = 0;
+    int Selected = 0;
+    bool Protected = false;
+    int effectType = -1;                          // modified effects, -1 leaves the effect type alone
 };
 
 class UndoManager
@@ -121,12 +103,23 @@ class UndoManager
         void CaptureEffectToBeMoved( const std::string &element_name, int layer_index, int id, int startTimeMS, int endTimeMS );
         void CaptureModifiedEffect( const std::string &element_name, int layer_index, int id, const std::string &settings, const std::string &palette );
         void CaptureModifiedEffect( const std::string &element_name, int layer_index, Effect *ef);
+
+        // once the journal uses more than this the oldest steps are dropped, the last step is always kept
+        void SetMemoryLimit( size_t bytes );
+        size_t GetMemoryUsed() const;
     protected:
-        void ProcessUndoStep(std::vector<UndoStep*> &fromList, std::vector<UndoStep*> &toList);
+        void ProcessUndoStep(std::deque<UndoRecord> &fromList, std::deque<UndoRecord> &toList);
 
     private:
-        std::vector<UndoStep*> mUndoSteps;
-        std::vector<UndoStep*> mRedoSteps;
+        UndoRecord& AddRecord( std::deque<UndoRecord> &list, UNDO_ACTIONS action, const std::string &element_name, int layer_index );
+        void ReleaseRecord( UndoRecord &record );
+        void ClearList( std::deque<UndoRecord> &list );
+        void TrimToMemoryLimit();
+
+        std::deque<UndoRecord> mUndoSteps;
+        std::deque<UndoRecord> mRedoSteps;
+        UndoStringPool mStrings;
+        size_t mMemoryLimit;
         SequenceElements* mParentSequence;
         bool mCaptureUndo;
 
@@ -699,30 +699,17 @@ void Waveform::WaveView::SetMinMaxSampleSet(float SamplesPerPixel, AudioManager*
 	MinMaxs.clear();
 
 	if (media != nullptr) {
-		float minimum=1;
-		float maximum=-1;
-		long trackSize = media->GetTrackSize();
-		int totalMinMaxs = (int)((float)trackSize/SamplesPerPixel)+1;
-
-		for (int i = 0; i < totalMinMaxs; i++) {
-			// Use float calculation to minimize compounded rounding of position
-			long start = (long)((float)i*SamplesPerPixel);
-			if (start >= trackSize) {
-				return;
-			}
-			long end = start + SamplesPerPixel;
-			if (end >= trackSize) {
-				end = trackSize;
-			}
-			minimum = 1;
-			maximum = -1;
-            media->GetLeftDataMinMax(start, end, minimum, maximum, type, lowNote, highNote);
+		std::vector<float> minimums;
+		std::vector<float> maximums;
+		media->GetLeftDataMinMaxSet(SamplesPerPixel, minimums, maximums, type, lowNote, highNote);
+		MinMaxs.reserve(minimums.size());
+		for (size_t i = 0; i < minimums.size(); i++) {
 			MINMAX mm;
-			mm.min = minimum;
-			mm.max = maximum;
+			mm.min = minimums[i];
+			mm.max = maximums[i];
 			MinMaxs.push_back(mm);
 		}
-    }
+	}
 }
 
 void Waveform::mouseLeftWindow(wxMouseEvent& event)
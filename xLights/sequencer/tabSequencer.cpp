@@ -861,6 +861,12 @@ void xLightsFrame::LoadSequencer(xLightsXmlFile& xml_file)
     AddTraceMessage("loading");
     _sequenceElements.LoadSequencerFile(xml_file, GetShowDirectory());
 
+    // capture the freshly parsed sequence before any version upgrades are applied so the
+    // sidecar reloads exactly what the xml would have
+    if (xml_file.ShouldWriteSidecar()) {
+        xml_file.WriteSidecar(_sequenceElements);
+    }
+
     logger_base.debug("Upgrading sequence");
     xml_file.AdjustEffectSettingsForVersion(_sequenceElements, this);
 
@@ -1109,7 +1115,7 @@ void xLightsFrame::EffectChanged(wxCommandEvent& event)
 {
     Effect* effect = (Effect*)event.GetClientData();
     SetEffectControls(effect->GetParentEffectLayer()->GetParentElement()->GetFullName(),
-                      effect->GetEffectName(), effect->GetSettings(), effect->GetPaletteMap(),
+                      effect->GetEffectName(), effect->GetSettingsView().ToMap(), effect->GetPaletteView().ToMap(),
                       effect->GetStartTimeMS(), effect->GetEndTimeMS(), true);
     selectedEffectString = "";  // force update to effect rendering
 }
@@ -1223,12 +1229,12 @@ void xLightsFrame::SelectedEffectChanged(SelectedEffectChangedEvent& event)
                     resetStrings = true;
                 }
                 SetEffectControls(effect->GetParentEffectLayer()->GetParentElement()->GetFullName(),
-                    effect->GetEffectName(), effect->GetSettings(), effect->GetPaletteMap(),
+                    effect->GetEffectName(), effect->GetSettingsView().ToMap(), effect->GetPaletteView().ToMap(),
                     effect->GetStartTimeMS(), effect->GetEndTimeMS(), !event.isNew);
                 selectedEffectString = GetEffectTextFromWindows(selectedEffectPalette);
                 selectedEffect = effect;
 
-                if (effect->GetPaletteMap().empty() || resetStrings || effect->SettingsChanged(selectedEffectString)) { // the settings changed is necessary because there are some situations where a new effect wont render because somehow the selectedEffectString changes without triggering a render. I think it relates to effects that auto-set certain values based on the model such as faces and states
+                if (!effect->HasPaletteSettings() || resetStrings || effect->SettingsChanged(selectedEffectString)) { // the settings changed is necessary because there are some situations where a new effect wont render because somehow the selectedEffectString changes without triggering a render. I think it relates to effects that auto-set certain values based on the model such as faces and states
                     effect->SetPalette(selectedEffectPalette);
                     effect->SetSettings(selectedEffectString, true);
                     if (!_suspendRender) {
@@ -2138,7 +2144,7 @@ void xLightsFrame::RandomizeEffect(wxCommandEvent& event)
                 std::string effectName = el->GetEffect(j)->GetEffectName();
                 int effectIndex = el->GetEffect(j)->GetEffectIndex();
 
-                auto oldSettings = el->GetEffect(j)->GetSettings();
+                auto oldSettings = el->GetEffect(j)->GetSettingsView().ToMap();
 
                 std::string settings = EffectsPanel1->GetRandomEffectString(effectIndex).ToStdString();
                 std::string palette = colorPanel->GetRandomColorString().ToStdString();
@@ -2168,8 +2174,8 @@ void xLightsFrame::RandomizeEffect(wxCommandEvent& event)
 
                 SetEffectControls(el->GetEffect(j)->GetParentEffectLayer()->GetParentElement()->GetFullName(),
                                   el->GetEffect(j)->GetEffectName(),
-                                  el->GetEffect(j)->GetSettings(),
-                                  el->GetEffect(j)->GetPaletteMap(),
+                                  el->GetEffect(j)->GetSettingsView().ToMap(),
+                                  el->GetEffect(j)->GetPaletteView().ToMap(),
                                   el->GetEffect(j)->GetStartTimeMS(),
                                   el->GetEffect(j)->GetEndTimeMS(),
                                   true);
@@ -0,0 +1,573 @@
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include "ProbeEngine.h"
+
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define CLOSESOCKET closesocket
+#define SOCKERR WSAGetLastError()
+#define IN_PROGRESS(e) ((e) == WSAEWOULDBLOCK || (e) == WSAEINPROGRESS)
+#define WOULD_BLOCK(e) ((e) == WSAEWOULDBLOCK)
+#define REFUSED(e) ((e) == WSAECONNREFUSED)
+#define poll WSAPoll
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET -1
+#define CLOSESOCKET close
+#define SOCKERR errno
+#define IN_PROGRESS(e) ((e) == EINPROGRESS || (e) == EWOULDBLOCK)
+#define WOULD_BLOCK(e) ((e) == EAGAIN || (e) == EWOULDBLOCK)
+#define REFUSED(e) ((e) == ECONNREFUSED)
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#define USE_EPOLL
+#endif
+
+#define MAX_RESPONSE_SIZE (64 * 1024)
+#define IDLE_WAIT_MS 20
+
+enum class ProbeState {
+    CONNECTING,
+    SENDING,
+    READING
+};
+
+struct ProbeEngine::Probe {
+    ProbeRequest req;
+    ProbeState state = ProbeState::CONNECTING;
+    uint32_t host = 0;
+    std::string send;
+    size_t sent = 0;
+    std::string recv;
+    clock::time_point start;
+    clock::time_point deadline;
+    bool wantRead = false;
+    bool wantWrite = false;
+};
+
+static bool SetNonBlocking(socket_t s)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags != -1 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static uint16_t ICMPChecksum(const uint8_t* data, size_t len)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += (data[i] << 8) | data[i + 1];
+    }
+    if (len & 1) {
+        sum += data[len - 1] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+static std::string BuildEchoRequest(uint16_t seq)
+{
+    uint8_t pkt[16] = { 0 };
+    pkt[0] = 8; // echo request
+    pkt[6] = seq >> 8;
+    pkt[7] = seq & 0xFF;
+    memcpy(&pkt[8], "xLights", 7);
+    uint16_t cs = ICMPChecksum(pkt, sizeof(pkt));
+    pkt[2] = cs >> 8;
+    pkt[3] = cs & 0xFF;
+    return std::string((const char*)pkt, sizeof(pkt));
+}
+
+ProbeEngine::ProbeEngine(size_t maxInFlight, size_t maxPerHost, int hostIntervalMS) :
+    _maxInFlight(maxInFlight), _maxPerHost(maxPerHost), _hostIntervalMS(hostIntervalMS)
+{
+}
+
+ProbeEngine::~ProbeEngine()
+{
+    Stop();
+}
+
+bool ProbeEngine::SupportsICMP()
+{
+#ifdef _WIN32
+    // windows only offers icmp to non admin users through the blocking IcmpSendEcho api
+    return false;
+#else
+    static int supported = -1;
+    if (supported == -1) {
+        socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+        supported = s == INVALID_SOCKET ? 0 : 1;
+        if (s != INVALID_SOCKET) {
+            CLOSESOCKET(s);
+        }
+    }
+    return supported == 1;
+#endif
+}
+
+void ProbeEngine::Start()
+{
+    if (_running) {
+        return;
+    }
+#ifdef USE_EPOLL
+    _pollFd = epoll_create1(EPOLL_CLOEXEC);
+#endif
+    _cancel = false;
+    _running = true;
+    _thread = new std::thread(&ProbeEngine::Run, this);
+}
+
+void ProbeEngine::Stop()
+{
+    if (_thread == nullptr) {
+        return;
+    }
+    _running = false;
+    _thread->join();
+    delete _thread;
+    _thread = nullptr;
+#ifdef USE_EPOLL
+    if (_pollFd != -1) {
+        close(_pollFd);
+        _pollFd = -1;
+    }
+#endif
+}
+
+void ProbeEngine::Submit(ProbeRequest&& req)
+{
+    std::unique_lock<std::mutex> lock(_pendingLock);
+    _pending.push_back(std::move(req));
+}
+
+void ProbeEngine::Cancel()
+{
+    {
+        std::unique_lock<std::mutex> lock(_pendingLock);
+        _pending.clear();
+    }
+    _cancel = true;
+}
+
+size_t ProbeEngine::GetPendingCount() const
+{
+    std::unique_lock<std::mutex> lock(_pendingLock);
+    return _pending.size();
+}
+
+bool ProbeEngine::IsIdle() const
+{
+    return GetPendingCount() == 0 && _inFlightCount == 0;
+}
+
+std::string ProbeEngine::GetStats() const
+{
+    return "Probes pending " + std::to_string(GetPendingCount()) +
+           " : in flight " + std::to_string((size_t)_inFlightCount) +
+           " : done " + std::to_string((uint64_t)_completed) +
+           " : timed out " + std::to_string((uint64_t)_timeouts);
+}
+
+void ProbeEngine::Watch(intptr_t fd, bool read, bool write, bool add)
+{
+    auto& p = _inFlight[fd];
+    p->wantRead = read;
+    p->wantWrite = write;
+#ifdef USE_EPOLL
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = (read ? (uint32_t)EPOLLIN : (uint32_t)0) | (write ? (uint32_t)EPOLLOUT : (uint32_t)0);
+    ev.data.fd = (int)fd;
+    epoll_ctl(_pollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, (int)fd, &ev);
+#endif
+}
+
+void ProbeEngine::Unwatch(intptr_t fd)
+{
+#ifdef USE_EPOLL
+    epoll_ctl(_pollFd, EPOLL_CTL_DEL, (int)fd, nullptr);
+#endif
+}
+
+bool ProbeEngine::StartProbe(ProbeRequest& req)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(req.port);
+    if (inet_pton(AF_INET, req.ip.c_str(), &addr.sin_addr) != 1) {
+        ProbeResult res;
+        res.type = req.type;
+        res.ip = req.ip;
+        res.port = req.port;
+        res.error = "Invalid IP address";
+        if (req.callback) req.callback(res);
+        return false;
+    }
+
+    socket_t s = INVALID_SOCKET;
+    switch (req.type) {
+    case ProbeType::ICMP:
+        s = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+        addr.sin_port = 0;
+        break;
+    case ProbeType::UDP:
+        s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        break;
+    case ProbeType::TCP_CONNECT:
+    case ProbeType::HTTP:
+        s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        break;
+    }
+    if (s == INVALID_SOCKET || !SetNonBlocking(s)) {
+        if (s != INVALID_SOCKET) {
+            CLOSESOCKET(s);
+        }
+        ProbeResult res;
+        res.type = req.type;
+        res.ip = req.ip;
+        res.port = req.port;
+        res.error = "Unable to create socket";
+        if (req.callback) req.callback(res);
+        return false;
+    }
+
+    auto p = std::make_unique<Probe>();
+    p->host = ntohl(addr.sin_addr.s_addr);
+    p->start = clock::now();
+    p->deadline = p->start + std::chrono::milliseconds(req.timeoutMS);
+
+    bool wantRead = false;
+    bool wantWrite = true;
+    int rc = connect(s, (sockaddr*)&addr, sizeof(addr));
+    int err = rc == 0 ? 0 : SOCKERR;
+    if (rc != 0 && !IN_PROGRESS(err)) {
+        // an immediate refusal still means the host is there
+        CLOSESOCKET(s);
+        ProbeResult res;
+        res.type = req.type;
+        res.ip = req.ip;
+        res.port = req.port;
+        res.error = REFUSED(err) ? "Connection refused" : "Connect failed";
+        if (req.callback) req.callback(res);
+        return false;
+    }
+
+    switch (req.type) {
+    case ProbeType::ICMP:
+        p->send = BuildEchoRequest((uint16_t)(_completed + _inFlight.size()));
+        p->state = ProbeState::SENDING;
+        break;
+    case ProbeType::UDP:
+        p->send = req.payload;
+        p->state = ProbeState::SENDING;
+        break;
+    case ProbeType::TCP_CONNECT:
+        p->state = ProbeState::CONNECTING;
+        break;
+    case ProbeType::HTTP:
+        p->send = "GET " + (req.payload.empty() ? std::string("/") : req.payload) + " HTTP/1.0\r\nHost: " + req.ip + "\r\nUser-Agent: xLights\r\nConnection: close\r\n\r\n";
+        p->state = ProbeState::CONNECTING;
+        break;
+    }
+
+    HostState& hs = _hosts[p->host];
+    hs.inFlight++;
+    hs.lastStart = p->start;
+
+    p->req = std::move(req);
+    intptr_t fd = (intptr_t)s;
+    _inFlight[fd] = std::move(p);
+    _inFlightCount = _inFlight.size();
+    Watch(fd, wantRead, wantWrite, true);
+    return true;
+}
+
+void ProbeEngine::Finish(intptr_t fd, bool ok, const std::string& error, bool timedOut)
+{
+    auto it = _inFlight.find(fd);
+    if (it == _inFlight.end()) {
+        return;
+    }
+    std::unique_ptr<Probe> p = std::move(it->second);
+    _inFlight.erase(it);
+    _inFlightCount = _inFlight.size();
+    Unwatch(fd);
+    CLOSESOCKET((socket_t)fd);
+
+    auto hs = _hosts.find(p->host);
+    if (hs != _hosts.end() && hs->second.inFlight > 0) {
+        hs->second.inFlight--;
+    }
+
+    _completed++;
+    if (timedOut) {
+        _timeouts++;
+    }
+
+    if (p->req.callback && !_cancel) {
+        ProbeResult res;
+        res.type = p->req.type;
+        res.ip = p->req.ip;
+        res.port = p->req.port;
+        res.ok = ok;
+        res.timedOut = timedOut;
+        res.error = error;
+        res.rttMS = (int)std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - p->start).count();
+        res.response = std::move(p->recv);
+        p->req.callback(res);
+    }
+}
+
+void ProbeEngine::HandleEvent(intptr_t fd, bool readable, bool writable, bool error)
+{
+    auto it = _inFlight.find(fd);
+    if (it == _inFlight.end()) {
+        return;
+    }
+    Probe* p = it->second.get();
+    socket_t s = (socket_t)fd;
+
+    if (p->state == ProbeState::CONNECTING && (writable || error)) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&err, &len);
+        if (err != 0) {
+            Finish(fd, false, REFUSED(err) ? "Connection refused" : "Connect failed");
+            return;
+        }
+        if (p->req.type == ProbeType::TCP_CONNECT) {
+            Finish(fd, true, "");
+            return;
+        }
+        p->state = ProbeState::SENDING;
+    }
+
+    if (p->state == ProbeState::SENDING && (writable || p->req.type != ProbeType::HTTP)) {
+        while (p->sent < p->send.size()) {
+            int n = send(s, p->send.data() + p->sent, (int)(p->send.size() - p->sent), 0);
+            if (n < 0) {
+                if (WOULD_BLOCK(SOCKERR)) {
+                    Watch(fd, false, true, false);
+                    return;
+                }
+                Finish(fd, false, "Send failed");
+                return;
+            }
+            p->sent += n;
+        }
+        p->state = ProbeState::READING;
+        Watch(fd, true, false, false);
+        return;
+    }
+
+    if (p->state == ProbeState::READING && (readable || error)) {
+        char buf[4096];
+        for (;;) {
+            int n = recv(s, buf, sizeof(buf), 0);
+            if (n > 0) {
+                p->recv.append(buf, n);
+                if (p->req.type == ProbeType::ICMP || p->req.type == ProbeType::UDP) {
+                    break;
+                }
+                if (p->recv.size() >= MAX_RESPONSE_SIZE) {
+                    break;
+                }
+            } else if (n == 0) {
+                break;
+            } else {
+                int e = SOCKERR;
+                if (WOULD_BLOCK(e)) {
+                    return;
+                }
+                // udp to a closed port reports refused which tells us the host is alive
+                Finish(fd, false, REFUSED(e) ? "Connection refused" : "Receive failed");
+                return;
+            }
+        }
+
+        switch (p->req.type) {
+        case ProbeType::ICMP: {
+            // macOS includes the ip header in the reply, linux does not
+            size_t off = 0;
+            if (p->recv.size() >= 20 && ((uint8_t)p->recv[0] >> 4) == 4) {
+                off = ((uint8_t)p->recv[0] & 0x0F) * 4;
+            }
+            bool reply = p->recv.size() > off && (uint8_t)p->recv[off] == 0;
+            Finish(fd, reply, reply ? "" : "Unexpected ICMP reply");
+        } break;
+        case ProbeType::UDP:
+            Finish(fd, true, "");
+            break;
+        default:
+            Finish(fd, p->recv.compare(0, 5, "HTTP/") == 0, p->recv.empty() ? "Empty response" : "");
+            break;
+        }
+    }
+}
+
+void ProbeEngine::ExpireProbes()
+{
+    auto now = clock::now();
+    std::vector<intptr_t> expired;
+    for (const auto& it : _inFlight) {
+        if (it.second->deadline <= now) {
+            expired.push_back(it.first);
+        }
+    }
+    for (const auto& fd : expired) {
+        auto it = _inFlight.find(fd);
+        // an http probe that got a partial response before the deadline is still useful
+        bool partial = it != _inFlight.end() && it->second->req.type == ProbeType::HTTP && it->second->recv.compare(0, 5, "HTTP/") == 0;
+        Finish(fd, partial, partial ? "" : "Timed out", !partial);
+    }
+}
+
+void ProbeEngine::StartPending()
+{
+    if (_inFlight.size() >= _maxInFlight) {
+        return;
+    }
+
+    // pull out the requests that are allowed to start now leaving the rest queued
+    std::vector<ProbeRequest> toStart;
+    {
+        std::unique_lock<std::mutex> lock(_pendingLock);
+        auto now = clock::now();
+        std::map<uint32_t, size_t> starting;
+        for (auto it = _pending.begin(); it != _pending.end() && _inFlight.size() + toStart.size() < _maxInFlight;) {
+            in_addr a;
+            uint32_t host = 0;
+            if (inet_pton(AF_INET, it->ip.c_str(), &a) == 1) {
+                host = ntohl(a.s_addr);
+            }
+            auto hs = _hosts.find(host);
+            size_t inFlight = starting[host] + (hs == _hosts.end() ? 0 : hs->second.inFlight);
+            // only one probe to a host per interval, anything already started this pass was started now
+            bool tooSoon = _hostIntervalMS > 0 &&
+                           (starting[host] > 0 || (hs != _hosts.end() && std::chrono::duration_cast<std::chrono::milliseconds>(now - hs->second.lastStart).count() < _hostIntervalMS));
+            if (inFlight < _maxPerHost && !tooSoon) {
+                starting[host]++;
+                toStart.push_back(std::move(*it));
+                it = _pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& it : toStart) {
+        StartProbe(it);
+    }
+}
+
+int ProbeEngine::Wait(int timeoutMS)
+{
+    int handled = 0;
+#ifdef USE_EPOLL
+    epoll_event events[256];
+    int n = epoll_wait(_pollFd, events, 256, timeoutMS);
+    for (int i = 0; i < n; i++) {
+        HandleEvent(events[i].data.fd,
+                    (events[i].events & EPOLLIN) != 0,
+                    (events[i].events & EPOLLOUT) != 0,
+                    (events[i].events & (EPOLLERR | EPOLLHUP)) != 0);
+        handled++;
+    }
+#else
+    std::vector<pollfd> fds;
+    fds.reserve(_inFlight.size());
+    for (const auto& it : _inFlight) {
+        pollfd pfd;
+        pfd.fd = (socket_t)it.first;
+        pfd.events = (it.second->wantRead ? POLLIN : 0) | (it.second->wantWrite ? POLLOUT : 0);
+        pfd.revents = 0;
+        fds.push_back(pfd);
+    }
+    if (fds.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMS));
+        return 0;
+    }
+    int n = poll(fds.data(), (unsigned long)fds.size(), timeoutMS);
+    for (int i = 0; n > 0 && i < (int)fds.size(); i++) {
+        if (fds[i].revents != 0) {
+            HandleEvent((intptr_t)fds[i].fd,
+                        (fds[i].revents & POLLIN) != 0,
+                        (fds[i].revents & POLLOUT) != 0,
+                        (fds[i].revents & (POLLERR | POLLHUP)) != 0);
+            handled++;
+        }
+    }
+#endif
+    return handled;
+}
+
+void ProbeEngine::Run()
+{
+    while (_running) {
+        if (_cancel) {
+            std::vector<intptr_t> all;
+            for (const auto& it : _inFlight) {
+                all.push_back(it.first);
+            }
+            for (const auto& fd : all) {
+                Finish(fd, false, "Cancelled");
+            }
+            _hosts.clear();
+            _cancel = false;
+        }
+
+        StartPending();
+
+        int timeout = IDLE_WAIT_MS;
+        auto now = clock::now();
+        for (const auto& it : _inFlight) {
+            int ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(it.second->deadline - now).count();
+            if (ms < timeout) {
+                timeout = std::max(ms, 0);
+            }
+        }
+        Wait(timeout);
+        ExpireProbes();
+    }
+
+    // close anything still open
+    std::vector<intptr_t> all;
+    for (const auto& it : _inFlight) {
+        all.push_back(it.first);
+    }
+    _cancel = true;
+    for (const auto& fd : all) {
+        Finish(fd, false, "Stopped");
+    }
+}
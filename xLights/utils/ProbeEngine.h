@@ -0,0 +1,116 @@
+#pragma once
+
+/***************************************************************
+ * This source files comes from the xLights project
+ * https://www.xlights.org
+ * https://github.com/xLightsSequencer/xLights
+ * See the github commit history for a record of contributing
+ * developers.
+ * Copyright claimed based on commit dates recorded in Github
+ * License: https://github.com/xLightsSequencer/xLights/blob/master/License.txt
+ **************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Single threaded, readiness driven network prober.
+//
+// All sockets are non blocking and multiplexed on one thread (epoll on linux,
+// poll/WSAPoll elsewhere) so thousands of ICMP/UDP/TCP/HTTP probes can be in
+// flight at once. Results are delivered through each probe's callback on the
+// engine thread as soon as the probe completes or times out.
+enum class ProbeType {
+    ICMP,
+    UDP,
+    TCP_CONNECT,
+    HTTP
+};
+
+struct ProbeResult {
+    ProbeType type = ProbeType::TCP_CONNECT;
+    std::string ip;
+    uint16_t port = 0;
+    bool ok = false;
+    bool timedOut = false;
+    int rttMS = 0;
+    std::string response; // http response or udp/icmp reply
+    std::string error;
+};
+
+struct ProbeRequest {
+    ProbeType type = ProbeType::TCP_CONNECT;
+    std::string ip;
+    uint16_t port = 0;
+    std::string payload; // udp payload or http path
+    int timeoutMS = 2000;
+    std::function<void(const ProbeResult&)> callback;
+};
+
+class ProbeEngine
+{
+public:
+    ProbeEngine(size_t maxInFlight = 2048, size_t maxPerHost = 2, int hostIntervalMS = 5);
+    virtual ~ProbeEngine();
+
+    void Start();
+    void Stop();
+    void Submit(ProbeRequest&& req);
+    // drop everything pending and in flight without calling the callbacks
+    void Cancel();
+    bool IsIdle() const;
+
+    size_t GetPendingCount() const;
+    size_t GetInFlightCount() const { return _inFlightCount; }
+    uint64_t GetCompletedCount() const { return _completed; }
+    uint64_t GetTimeoutCount() const { return _timeouts; }
+    std::string GetStats() const;
+
+    static bool SupportsICMP();
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    struct Probe;
+    struct HostState {
+        size_t inFlight = 0;
+        clock::time_point lastStart;
+    };
+
+    void Run();
+    bool StartProbe(ProbeRequest& req);
+    void HandleEvent(intptr_t fd, bool readable, bool writable, bool error);
+    void Finish(intptr_t fd, bool ok, const std::string& error, bool timedOut = false);
+    void ExpireProbes();
+    void StartPending();
+    int Wait(int timeoutMS);
+    void Watch(intptr_t fd, bool read, bool write, bool add);
+    void Unwatch(intptr_t fd);
+
+    size_t _maxInFlight;
+    size_t _maxPerHost;
+    int _hostIntervalMS;
+
+    mutable std::mutex _pendingLock;
+    std::deque<ProbeRequest> _pending;
+    std::atomic<bool> _cancel = false;
+
+    // only touched on the engine thread
+    std::unordered_map<intptr_t, std::unique_ptr<Probe>> _inFlight;
+    std::map<uint32_t, HostState> _hosts;
+    std::atomic<size_t> _inFlightCount = 0;
+    std::atomic<uint64_t> _completed = 0;
+    std::atomic<uint64_t> _timeouts = 0;
+
+    std::atomic<bool> _running = false;
+    std::thread* _thread = nullptr;
+    int _pollFd = -1;
+};
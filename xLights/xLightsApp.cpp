@@ -39,6 +39,8 @@
 #include "BitmapCache.h"
 #include "utils/CurlManager.h"
 #include "SequencePackage.h"
+#include "RenderBenchmark.h"
+#include "RenderProfiler.h"
 
 #ifndef __WXMSW__
 #include "automation/automation.h"
@@ -528,7 +530,9 @@ bool xLightsApp::OnInit()
     {
         { wxCMD_LINE_SWITCH, "h", "help", "displays help on the command line parameters", wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP },
         { wxCMD_LINE_SWITCH, "r", "render", "render files and exit"},
+        { wxCMD_LINE_OPTION, "p", "profile", "with -r save a render profile (Chrome trace) to this file" },
         { wxCMD_LINE_SWITCH, "cs", "checksequence", "run check sequence and exit" },
+        { wxCMD_LINE_OPTION, "bm", "benchmark", "run the effect render benchmark, save the results (JSON) to this file and exit" },
         { wxCMD_LINE_OPTION, "m", "media", "specify media directory"},
         { wxCMD_LINE_OPTION, "s", "show", "specify show directory" },
         { wxCMD_LINE_SWITCH, "w", "wipe", "wipe settings clean" },
@@ -668,7 +672,7 @@ bool xLightsApp::OnInit()
             sequenceFiles.Clear();
         }
 
-        if (!parser.Found("cs") && !parser.Found("r") && !parser.Found("o") && !info.empty() && readOnlyZipFile == "")
+        if (!parser.Found("cs") && !parser.Found("r") && !parser.Found("o") && !parser.Found("bm") && !info.empty() && readOnlyZipFile == "")
         {
             DisplayInfo(info); //give positive feedback*/
         }
@@ -682,6 +686,12 @@ bool xLightsApp::OnInit()
     if (readOnlyZipFile == "" &&  parser.Found("r")) {
         logger_base.info("-r: Render mode is ON");
         renderOnlyMode = true;
+
+        wxString profileFile;
+        if (parser.Found("p", &profileFile)) {
+            logger_base.info("-p: Render profile will be saved to %s.", (const char*)profileFile.c_str());
+            RenderProfiler::INSTANCE.Start(profileFile.ToStdString());
+        }
     }
 
     wxFileName xsqFile;
@@ -750,6 +760,19 @@ bool xLightsApp::OnInit()
         topFrame->CallAfter(&xLightsFrame::OpenAndCheckSequence, sequenceFiles, true);
     }
 
+    wxString benchmarkFile;
+    if (parser.Found("bm", &benchmarkFile)) {
+        logger_base.info("-bm: Render benchmark results will be saved to %s.", (const char*)benchmarkFile.c_str());
+        topFrame->CallAfter([this, topFrame, benchmarkFile]() {
+            RenderBenchmark benchmark(topFrame);
+            if (!benchmark.Run(benchmarkFile.ToStdString())) {
+                logger_base.error("-bm: Render benchmark failed, exiting with an error.");
+                _exitCode = 1;
+            }
+            topFrame->Destroy();
+        });
+    }
+
     if (parser.Found("o")) {
         logger_base.info("-o: Turning on output to lights");
         // Turn on output to lights - ignore if another xLights/xSchedule is already outputting
@@ -774,6 +797,11 @@ void xLightsApp::WipeSettings()
     config->DeleteAll();
 }
 
+int xLightsApp::OnRun() {
+    int rc = xLightsAppBaseClass::OnRun();
+    return rc != 0 ? rc : _exitCode;
+}
+
 bool xLightsApp::ProcessIdle() {
     uint64_t now = wxGetLocalTimeMillis().GetValue();
     bool b = CurlManager::INSTANCE.processCurls();
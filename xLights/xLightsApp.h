@@ -42,5 +42,8 @@ public:
     virtual void MacOpenFiles(wxArrayString const& fileNames) override;
     #endif
     virtual bool ProcessIdle() override;
+    // returns the main loop's exit code or, if that succeeded, the one a batch mode set
+    virtual int OnRun() override;
     uint64_t _nextIdleTime = 0;
+    int _exitCode = 0;
 };
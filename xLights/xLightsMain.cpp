@@ -40,9 +40,11 @@
 
 #include <cctype>
 #include <cstring>
+#include <deque>
 #include <thread>
 
 #include "AboutDialog.h"
+#include "AudioAnalysisCache.h"
 #include "BatchRenderDialog.h"
 #include "CachedFileDownloader.h"
 #include "CheckboxSelectDialog.h"
@@ -73,6 +75,7 @@
 #include "PathGenerationDialog.h"
 #include "PixelTestDialog.h"
 #include "RenderCommandEvent.h"
+#include "RenderProfiler.h"
 #include "RestoreBackupDialog.h"
 #include "SeqSettingsDialog.h"
 #include "ShaderDownloadDialog.h"
@@ -102,6 +105,7 @@
 #include "effects/ShaderEffect.h"
 #include "effects/StateEffect.h"
 #include "graphics/opengl/xlGLCanvas.h"
+#include "graphics/software/xlSoftwareGraphicsContext.h"
 #include "models/ModelGroup.h"
 #include "models/RulerObject.h"
 #include "models/SubModel.h"
@@ -112,6 +116,7 @@
 #include "outputs/IPOutput.h"
 #include "outputs/ZCPPOutput.h"
 #include "sequencer/MainSequencer.h"
+#include "sequencer/SequenceSidecar.h"
 #include "utils/ip_utils.h"
 #include "TempFileManager.h"
 #include "xlColourData.h"
@@ -266,6 +271,7 @@ const wxWindowID xLightsFrame::iD_MNU_VENDORCACHEPURGE = wxNewId();
 const wxWindowID xLightsFrame::ID_MNU_PURGERENDERCACHE = wxNewId();
 const wxWindowID xLightsFrame::ID_MNU_CRASH = wxNewId();
 const wxWindowID xLightsFrame::ID_MNU_DUMPRENDERSTATE = wxNewId();
+const wxWindowID xLightsFrame::ID_MNU_RENDERPROFILE = wxNewId();
 const wxWindowID xLightsFrame::ID_MENU_GENERATE2DPATH = wxNewId();
 const wxWindowID xLightsFrame::ID_MENUITEM_GenerateCustomModel = wxNewId();
 const wxWindowID xLightsFrame::ID_MNU_REMAPCUSTOM = wxNewId();
@@ -1005,6 +1011,8 @@ xLightsFrame::xLightsFrame(wxWindow* parent, int ab, wxWindowID id, bool renderO
     Menu1->Append(MenuItem_CrashXLights);
     MenuItem_LogRenderState = new wxMenuItem(Menu1, ID_MNU_DUMPRENDERSTATE, _("Log Render State"), wxEmptyString, wxITEM_NORMAL);
     Menu1->Append(MenuItem_LogRenderState);
+    MenuItem_RenderProfile = new wxMenuItem(Menu1, ID_MNU_RENDERPROFILE, _("Start Render Profiling"), _("Record how long each model and effect takes to render"), wxITEM_NORMAL);
+    Menu1->Append(MenuItem_RenderProfile);
     Menu1->AppendSeparator();
     MenuItem_Generate2DPath = new wxMenuItem(Menu1, ID_MENU_GENERATE2DPATH, _("Generate 2D Path"), wxEmptyString, wxITEM_NORMAL);
     Menu1->Append(MenuItem_Generate2DPath);
@@ -1278,6 +1286,7 @@ xLightsFrame::xLightsFrame(wxWindow* parent, int ab, wxWindowID id, bool renderO
     Connect(ID_MNU_PURGERENDERCACHE, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&xLightsFrame::OnMenuItem_PurgeRenderCacheSelected);
     Connect(ID_MNU_CRASH, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&xLightsFrame::OnMenuItem_CrashXLightsSelected);
     Connect(ID_MNU_DUMPRENDERSTATE, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&xLightsFrame::OnMenuItem_LogRenderStateSelected);
+    Connect(ID_MNU_RENDERPROFILE, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&xLightsFrame::OnMenuItem_RenderProfileSelected);
     Connect(ID_MENU_GENERATE2DPATH, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&xLightsFrame::OnMenuItem_Generate2DPathSelected);
     Connect(ID_MENUITEM_GenerateCustomModel, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&xLightsFrame::OnMenu_GenerateCustomModelSelected);
     Connect(ID_MNU_REMAPCUSTOM, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&xLightsFrame::OnMenuItem_RemapCustomSelected);
@@ -1555,6 +1564,11 @@ xLightsFrame::xLightsFrame(wxWindow* parent, int ab, wxWindowID id, bool renderO
 
     config->Read("xLightsFSEQVersion", &_fseqVersion, 2);
 
+    int sequenceMemoryMB = 8192;
+    config->Read("xLightsSequenceMemoryMB", &sequenceMemoryMB, 8192);
+    SequenceData::SetMemoryBudget((size_t)sequenceMemoryMB * 1024 * 1024);
+    logger_base.debug("Sequence Memory Budget: %dMB.", sequenceMemoryMB);
+
     config->Read("xLightsTimelineZooming", &_timelineZooming, 0);
     config->Read("xLightsPlayVolume", &playVolume, 100);
     MenuItem_LoudVol->Check(playVolume == 100);
@@ -1735,6 +1749,10 @@ xLightsFrame::xLightsFrame(wxWindow* parent, int ab, wxWindowID id, bool renderO
         mRenderOnSave = false;
     }
 
+    config->Read("xLightsSequenceSidecar", &mSequenceSidecar, false);
+    logger_base.debug("Sequence sidecar: %s.", toStr(mSequenceSidecar));
+    SequenceSidecar::SetEnabled(mSequenceSidecar);
+
     config->Read("xLightsModelHandleSize", &_modelHandleSize, 1);
     logger_base.debug("Model Handle Size: %d.", _modelHandleSize);
 
@@ -2121,6 +2139,7 @@ xLightsFrame::~xLightsFrame()
     config->Write("xLightsGridNodeValues", mGridNodeValues);
     config->Write("xLightsRenderOnSave", mRenderOnSave);
     config->Write("xLightsSaveFseqOnSave", mSaveFseqOnSave);
+    config->Write("xLightsSequenceSidecar", mSequenceSidecar);
     config->Write("xLightsBackupSubdirectories", _backupSubfolders);
     config->Write("xLightsExcludePresetsPkgSeq", _excludePresetsFromPackagedSequences);
     config->Write("xLightsPromptBatchRenderIssues", _promptBatchRenderIssues);
@@ -3389,6 +3408,18 @@ bool xLightsFrame::ExportVideoPreview(wxString const& path)
     int audioFrameIndex = 0;
     bool exportStatus = false;
     std::string emsg;
+
+    // When the software renderer can draw everything in the preview, frames are drawn on this
+    // thread ahead of the encoder and rasterized on the job pool, so several are in flight at
+    // once and no GL context is needed. Otherwise each frame goes through the window.
+    bool offscreen = housePreview->CanRenderOffscreen();
+    std::deque<std::shared_ptr<xlSoftwareFrame>> pendingFrames;
+    unsigned nextFrame = 0;
+    size_t maxPendingFrames = std::max(2u, std::thread::hardware_concurrency());
+    if (offscreen) {
+        logger_base.debug("    Rendering offscreen, up to %d frames in flight.", (int)maxPendingFrames);
+        housePreview->StartOffscreenRendering(width * contentScaleFactor, height * contentScaleFactor);
+    }
     try {
         VideoExporter videoExporter(this, width, height, contentScaleFactor, _seqData.FrameTime(), _seqData.NumFrames(),
                                     audioChannelCount, audioSampleRate, path, _videoExportCodec, _videoExportBitrate);
@@ -3412,6 +3443,25 @@ bool xLightsFrame::ExportVideoPreview(wxString const& path)
         if (audioMgr != nullptr) {
             videoExporter.setGetAudioCallback(audioLambda);
         }
+        auto offscreenLambda = [&, this](AVFrame* f, uint8_t* buf, int bufSize, unsigned frameIndex) {
+            if (frameIndex + pendingFrames.size() != nextFrame) {
+                // not the frame we drew next, start again from this one
+                pendingFrames.clear();
+                nextFrame = frameIndex;
+            }
+            while (nextFrame < (unsigned)frameCount && pendingFrames.size() < maxPendingFrames) {
+                auto frame = housePreview->RenderOffscreen(nextFrame * this->_seqData.FrameTime(), this->_seqData[nextFrame][0]);
+                frame->RasterizeAsync();
+                pendingFrames.push_back(frame);
+                ++nextFrame;
+            }
+            if (pendingFrames.empty()) {
+                return false;
+            }
+            auto frame = pendingFrames.front();
+            pendingFrames.pop_front();
+            return frame->GetFrameForExport(buf, bufSize);
+        };
         auto videoLambda = [=, this](AVFrame* f, uint8_t* buf, int bufSize, unsigned frameIndex) {
             const SequenceData::FrameData& frameData(this->_seqData[frameIndex]);
             const uint8_t* data = frameData[0];
@@ -3419,7 +3469,11 @@ bool xLightsFrame::ExportVideoPreview(wxString const& path)
             housePreview->Render(frameIndex * this->_seqData.FrameTime(), data, false);
             return housePreview->getFrameForExport(width * contentScaleFactor, height * contentScaleFactor, f, buf, bufSize);
         };
-        videoExporter.setGetVideoCallback(videoLambda);
+        if (offscreen) {
+            videoExporter.setGetVideoCallback(offscreenLambda);
+        } else {
+            videoExporter.setGetVideoCallback(videoLambda);
+        }
 
         exportStatus = videoExporter.Export(_appProgress.get());
     } catch (const std::runtime_error& re) {
@@ -3427,6 +3481,11 @@ bool xLightsFrame::ExportVideoPreview(wxString const& path)
         logger_base.error("Error exporting video : %s", (const char*)re.what());
         exportStatus = false;
     }
+    if (offscreen) {
+        // anything still queued holds its own copy of what it draws
+        pendingFrames.clear();
+        housePreview->EndOffscreenRendering();
+    }
 
     SetPlayStatus(playStatus);
 
@@ -3592,6 +3651,12 @@ void xLightsFrame::SetRenderOnSave(bool b)
     mRenderOnSave = b;
 }
 
+void xLightsFrame::SetSequenceSidecarEnabled(bool b)
+{
+    mSequenceSidecar = b;
+    SequenceSidecar::SetEnabled(b);
+}
+
 void xLightsFrame::SetSaveFseqOnSave(bool b)
 {
     mSaveFseqOnSave = b;
@@ -4409,6 +4474,7 @@ void xLightsFrame::SetRenderCacheFolder(bool useShow, const std::string& folder)
     UpdateControllerSave();
 
     logger_base.debug("Render Cache directory set to : %s.", (const char*)renderCacheDirectory.c_str());
+    AudioAnalysisCache::SetFolder(renderCacheDirectory + GetPathSeparator() + "AudioCache");
 }
 
 void xLightsFrame::GetBackupFolder(bool& useShow, std::string& folder)
@@ -6370,7 +6436,7 @@ std::string xLightsFrame::CheckSequence(bool displayInEditor, bool writeToFile)
                                 Effect* ef = nl->GetEffect(l);
                                 CheckEffect(ef, f, errcount, warncount, wxString::Format("%s Strand %lu/Node %lu", se->GetFullName(), j + 1, l + 1).ToStdString(), e->GetName(), true, videoCacheWarning, disabledEffects, faces, states, viewPoints);
                                 RenderableEffect* eff = effectManager[ef->GetEffectIndex()];
-                                allfiles.splice(end(allfiles), eff->GetFileReferences(model, ef->GetSettings()));
+                                allfiles.splice(end(allfiles), eff->GetFileReferences(model, ef->GetSettingsView().ToMap()));
                             }
                         }
                     }
@@ -6571,7 +6637,8 @@ void xLightsFrame::ValidateEffectAssets()
 void xLightsFrame::CheckEffect(Effect* ef, wxFile& f, size_t& errcount, size_t& warncount, const std::string& name, const std::string& modelName, bool node, bool& videoCacheWarning, bool& disabledEffects, std::list<std::pair<std::string, std::string>>& faces, std::list<std::pair<std::string, std::string>>& states, std::list<std::string>& viewPoints)
 {
     EffectManager& em = _sequenceElements.GetEffectManager();
-    SettingsMap& sm = ef->GetSettings();
+    // a copy so checking does not leave the effect holding its settings as a map
+    const SettingsMap sm = ef->GetSettingsView().ToMap();
 
     if (ef->GetEffectName() == "Video") {
         if (_enableRenderCache == "Disabled") {
@@ -6740,7 +6807,7 @@ void xLightsFrame::CheckElement(Element* e, wxFile& f, size_t& errcount, size_t&
                 errcount++;
             } else {
                 RenderableEffect* eff = effectManager[ef->GetEffectIndex()];
-                allfiles.splice(end(allfiles), eff->GetFileReferences(m, ef->GetSettings()));
+                allfiles.splice(end(allfiles), eff->GetFileReferences(m, ef->GetSettingsView().ToMap()));
 
                 // Check there are nodes to actually render on
                 if (m != nullptr) {
@@ -6868,7 +6935,7 @@ int xLightsFrame::ExportNodes(wxFile& f, StrandElement* e, NodeLayer* nl, int n,
         std::string fs = "";
         if (ef->GetEffectIndex() >= 0) {
             RenderableEffect* eff = effectManager[ef->GetEffectIndex()];
-            auto files = eff->GetFileReferences(m, ef->GetSettings());
+            auto files = eff->GetFileReferences(m, ef->GetSettingsView().ToMap());
 
             for (auto it = files.begin(); it != files.end(); ++it) {
                 if (fs != "") {
@@ -6889,7 +6956,7 @@ int xLightsFrame::ExportNodes(wxFile& f, StrandElement* e, NodeLayer* nl, int n,
             effectTotalTime[ef->GetEffectName()] = duration;
         }
 
-        SettingsMap& sm = ef->GetSettings();
+        SettingsView sm = ef->GetSettingsView();
         f.Write(wxString::Format("\"%s\",%02d:%02d.%03d,%02d:%02d.%03d,%02d:%02d.%03d,\"%s\",\"%s\",%s,%s\n",
                                  ef->GetEffectName(),
                                  ef->GetStartTimeMS() / 60000,
@@ -6946,7 +7013,7 @@ int xLightsFrame::ExportElement(wxFile& f, Element* e, std::map<std::string, int
                 std::string fs = "";
                 if (ef->GetEffectIndex() >= 0) {
                     RenderableEffect* eff = effectManager[ef->GetEffectIndex()];
-                    auto files = eff->GetFileReferences(m, ef->GetSettings());
+                    auto files = eff->GetFileReferences(m, ef->GetSettingsView().ToMap());
 
                     for (auto it = files.begin(); it != files.end(); ++it) {
                         if (fs != "") {
@@ -6967,7 +7034,7 @@ int xLightsFrame::ExportElement(wxFile& f, Element* e, std::map<std::string, int
                     effectTotalTime[ef->GetEffectName()] = duration;
                 }
 
-                SettingsMap& sm = ef->GetSettings();
+                SettingsView sm = ef->GetSettingsView();
                 f.Write(wxString::Format("\"%s\",%02d:%02d.%03d,%02d:%02d.%03d,%02d:%02d.%03d,\"%s\",\"%s\",%s,%s\n",
                                          ef->GetEffectName(),
                                          ef->GetStartTimeMS() / 60000,
@@ -8902,6 +8969,34 @@ void xLightsFrame::OnMenuItem_LogRenderStateSelected(wxCommandEvent& event)
     LogRenderStatus();
 }
 
+void xLightsFrame::OnMenuItem_RenderProfileSelected(wxCommandEvent& event)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    if (!RenderProfiler::INSTANCE.IsEnabled()) {
+        RenderProfiler::INSTANCE.Start();
+        MenuItem_RenderProfile->SetItemLabel(_("Stop Render Profiling"));
+        SetStatusText(_("Render profiling started. Render and then stop profiling to save the results."));
+        return;
+    }
+
+    RenderProfiler::INSTANCE.Stop();
+    MenuItem_RenderProfile->SetItemLabel(_("Start Render Profiling"));
+    logger_base.info(RenderProfiler::INSTANCE.GetSummary());
+
+    wxFileDialog fd(this, "Save render profile", CurrentDir, "RenderProfile.json", "Chrome Trace Files (*.json)|*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (fd.ShowModal() != wxID_OK) {
+        return;
+    }
+    wxFileName summary(fd.GetPath());
+    summary.SetExt("txt");
+    if (RenderProfiler::INSTANCE.WriteChromeTrace(fd.GetPath().ToStdString()) && RenderProfiler::INSTANCE.WriteSummary(summary.GetFullPath().ToStdString())) {
+        SetStatusText(wxString::Format("Render profile saved to %s. Open it in chrome://tracing or ui.perfetto.dev.", fd.GetPath()));
+    } else {
+        DisplayError("Unable to save the render profile to " + fd.GetPath(), this);
+    }
+}
+
 void xLightsFrame::SaveCurrentTab()
 {
     switch (Notebook1->GetSelection()) {
@@ -575,6 +575,7 @@ public:
     void OnMenuItemBatchRenderSelected(wxCommandEvent& event);
     void OnMenuItem_UpdateSelected(wxCommandEvent& event);
     void OnMenuItem_LogRenderStateSelected(wxCommandEvent& event);
+    void OnMenuItem_RenderProfileSelected(wxCommandEvent& event);
     void OnMenuItem_File_Save_Selected(wxCommandEvent& event);
     void OnMenuItem_PurgeVendorCacheSelected(wxCommandEvent& event);
     void OnMenuItem_LoudVolSelected(wxCommandEvent& event);
@@ -778,6 +779,7 @@ public:
     static const wxWindowID ID_MNU_PURGERENDERCACHE;
     static const wxWindowID ID_MNU_CRASH;
     static const wxWindowID ID_MNU_DUMPRENDERSTATE;
+    static const wxWindowID ID_MNU_RENDERPROFILE;
     static const wxWindowID ID_MENU_GENERATE2DPATH;
     static const wxWindowID ID_MENUITEM_GenerateCustomModel;
     static const wxWindowID ID_MNU_REMAPCUSTOM;
@@ -983,6 +985,7 @@ public:
     wxMenuItem* MenuItem_ImportEffects;
     wxMenuItem* MenuItem_KeyBindings;
     wxMenuItem* MenuItem_LogRenderState;
+    wxMenuItem* MenuItem_RenderProfile;
     wxMenuItem* MenuItem_LoudVol;
     wxMenuItem* MenuItem_MedVol;
     wxMenuItem* MenuItem_PackageSequence;
@@ -1277,6 +1280,9 @@ public:
     bool SaveFseqOnSave() const { return mSaveFseqOnSave; }
     void SetSaveFseqOnSave(bool b);
 
+    bool SequenceSidecarEnabled() const { return mSequenceSidecar; }
+    void SetSequenceSidecarEnabled(bool b);
+
     int AutoSaveInterval() const { return mAutoSaveInterval; }
     void SetAutoSaveInterval(int i);
 
@@ -1620,6 +1626,7 @@ private:
 	bool mRendering;
     int abortedRenderJobs = 0;
     bool mSaveFseqOnSave;
+    bool mSequenceSidecar = false;
     int _modelHandleSize = 1;
 
     class RenderTree {
@@ -139,6 +139,7 @@ int xLightsXmlFile::GetLastView() const
 
 wxXmlNode* xLightsXmlFile::GetPalettesNode() const
 {
+    FillDocument();
     wxXmlNode* root = seqDocument.GetRoot();
 
     for (wxXmlNode* e = root->GetChildren(); e != nullptr; e = e->GetNext()) {
@@ -317,6 +318,7 @@ wxString xLightsXmlFile::GetRenderMode()
 
 void xLightsXmlFile::AddDisplayElement(const wxString& name, const wxString& type, const wxString& visible, const wxString& collapsed, const wxString& active, const wxString& renderDisabled)
 {
+    FillDocument();
     wxXmlNode* root = seqDocument.GetRoot();
 
     for (wxXmlNode* e = root->GetChildren(); e != nullptr; e = e->GetNext()) {
@@ -337,6 +339,7 @@ void xLightsXmlFile::AddDisplayElement(const wxString& name, const wxString& typ
 
 void xLightsXmlFile::AddTimingDisplayElement(const wxString& name, const wxString& visible, const wxString& active, const wxString &subType)
 {
+    FillDocument();
     wxXmlNode* root = seqDocument.GetRoot();
 
     for (wxXmlNode* e = root->GetChildren(); e != nullptr; e = e->GetNext()) {
@@ -378,6 +381,7 @@ void xLightsXmlFile::AddTimingDisplayElement(const wxString& name, const wxStrin
 
 int xLightsXmlFile::AddColorPalette(StringIntMap& paletteCache, const wxString& palette)
 {
+    FillDocument();
     int cnt = 0;
     wxXmlNode* root = seqDocument.GetRoot();
 
@@ -403,6 +407,7 @@ int xLightsXmlFile::AddColorPalette(StringIntMap& paletteCache, const wxString&
 
 wxXmlNode* xLightsXmlFile::AddElement(const wxString& name, const wxString& type)
 {
+    FillDocument();
     wxXmlNode* root = seqDocument.GetRoot();
     wxXmlNode* child = nullptr;
 
@@ -420,6 +425,7 @@ wxXmlNode* xLightsXmlFile::AddElement(const wxString& name, const wxString& type
 
 wxXmlNode* xLightsXmlFile::AddFixedTiming(const wxString& name, const wxString& timing)
 {
+    FillDocument();
     wxXmlNode* root = seqDocument.GetRoot();
     wxXmlNode* child = nullptr;
 
@@ -700,6 +706,7 @@ void xLightsXmlFile::SetHeaderInfo(HEADER_INFO_TYPES name_name, const wxString&
 
 void xLightsXmlFile::SetTimingSectionName(const std::string& section, const std::string& name)
 {
+    FillDocument();
     bool found = false;
     wxXmlNode* root = seqDocument.GetRoot();
 
@@ -750,6 +757,7 @@ void xLightsXmlFile::SetTimingSectionName(const std::string& section, const std:
 
 void xLightsXmlFile::DeleteTimingSection(const std::string& section)
 {
+    FillDocument();
     bool found = false;
     wxXmlNode* root = seqDocument.GetRoot();
 
@@ -797,6 +805,8 @@ void xLightsXmlFile::DeleteTimingSection(const std::string& section)
 
 void xLightsXmlFile::CreateNew()
 {
+    _sidecar.reset();
+
     // construct the new XML file
     wxXmlNode* root = new wxXmlNode(wxXML_ELEMENT_NODE, "xsequence");
     root->AddAttribute("BaseChannel", "0");
@@ -1039,6 +1049,7 @@ void ConvertAllChildrenToFixedPointTiming(wxXmlNode* node)
 
 void xLightsXmlFile::ConvertToFixedPointTiming()
 {
+    FillDocument();
     wxXmlNode* root = seqDocument.GetRoot();
 
     for (wxXmlNode* e = root->GetChildren(); e != nullptr; e = e->GetNext()) {
@@ -1048,22 +1059,8 @@ void xLightsXmlFile::ConvertToFixedPointTiming()
     }
 }
 
-bool xLightsXmlFile::LoadSequence(const wxString& ShowDir, bool ignore_audio, const wxFileName &realFilename)
+static void ExpandCompressedData(wxXmlNode* root)
 {
-    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
-    if (realFilename.GetFullPath() != GetFullPath()) {
-        logger_base.info("LoadSequence: Loading sequence " + GetFullPath() + " from " + realFilename.GetFullPath());
-    } else {
-        logger_base.info("LoadSequence: Loading sequence " + GetFullPath());
-    }
-
-    if (!seqDocument.Load(realFilename.GetFullPath())) {
-        logger_base.error("LoadSequence: XML file load failed.");
-        return false;
-    }
-    is_open = true;
-
-    wxXmlNode* root = seqDocument.GetRoot();
     for (wxXmlNode* e = root->GetChildren(); e != nullptr; e = e->GetNext()) {
         if (e->GetName() == "CompressedData") {
             int size = wxAtoi(e->GetAttribute("size"));
@@ -1082,6 +1079,72 @@ bool xLightsXmlFile::LoadSequence(const wxString& ShowDir, bool ignore_audio, co
             delete[] bytes;
         }
     }
+}
+
+// A sequence opened from its sidecar only has empty DisplayElements, ElementEffects, EffectDB
+// and ColorPalettes sections, they are read from the sidecar the first time anything needs them
+void xLightsXmlFile::FillDocument() const
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+    if (_sidecar == nullptr) {
+        return;
+    }
+
+    wxXmlDocument sections;
+    if (!_sidecar->LoadSections(sections) || sections.GetRoot() == nullptr) {
+        logger_base.error("FillDocument: Sequence sidecar sections could not be loaded.");
+        _sidecar.reset();
+        return;
+    }
+    wxXmlNode* sroot = sections.GetRoot();
+    ExpandCompressedData(sroot);
+
+    wxXmlNode* root = seqDocument.GetRoot();
+    while (sroot->GetChildren() != nullptr) {
+        wxXmlNode* section = sroot->GetChildren();
+        sroot->RemoveChild(section);
+        for (wxXmlNode* e = root->GetChildren(); e != nullptr; e = e->GetNext()) {
+            if (e->GetName() == section->GetName()) {
+                root->RemoveChild(e);
+                delete e;
+                break;
+            }
+        }
+        root->AddChild(section);
+    }
+    _sidecar.reset();
+    logger_base.debug("FillDocument: Sequence sections loaded from the sidecar.");
+}
+
+bool xLightsXmlFile::LoadSequence(const wxString& ShowDir, bool ignore_audio, const wxFileName &realFilename)
+{
+    static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+    if (realFilename.GetFullPath() != GetFullPath()) {
+        logger_base.info("LoadSequence: Loading sequence " + GetFullPath() + " from " + realFilename.GetFullPath());
+    } else {
+        logger_base.info("LoadSequence: Loading sequence " + GetFullPath());
+    }
+
+    _sidecar.reset();
+    _writeSidecar = false;
+    if (SequenceSidecar::IsEnabled()) {
+        _sidecar = SequenceSidecar::Open(realFilename.GetFullPath().ToStdString());
+        if (_sidecar != nullptr && !_sidecar->LoadSkeleton(seqDocument)) {
+            logger_base.warn("LoadSequence: Sidecar skeleton could not be loaded ... falling back to the XML file.");
+            _sidecar.reset();
+        }
+        _writeSidecar = _sidecar == nullptr && realFilename.GetFullPath() == GetFullPath();
+    }
+
+    if (_sidecar == nullptr && !seqDocument.Load(realFilename.GetFullPath())) {
+        logger_base.error("LoadSequence: XML file load failed.");
+        return false;
+    }
+    is_open = true;
+
+    wxXmlNode* root = seqDocument.GetRoot();
+    ExpandCompressedData(root);
     supports_model_blending = "true" == root->GetAttribute("ModelBlending", "false");
 
     if (NeedsTimesCorrected()) {
@@ -1216,6 +1279,15 @@ bool xLightsXmlFile::LoadSequence(const wxString& ShowDir, bool ignore_audio, co
         }
     }
 
+    if (_sidecar != nullptr) {
+        for (const auto& it : _sidecar->GetModelNames()) {
+            models.push_back(wxString::FromUTF8(it));
+        }
+        for (const auto& it : _sidecar->GetTimingNames()) {
+            timing_list.push_back(wxString::FromUTF8(it));
+        }
+    }
+
     if (mediaFileName != "") {
         ObtainAccessToURL(mediaFileName);
         logger_base.debug("LoadSequence: Creating audio manager");
@@ -1235,6 +1307,7 @@ bool xLightsXmlFile::LoadSequence(const wxString& ShowDir, bool ignore_audio, co
 
 void xLightsXmlFile::CleanUpEffects() const
 {
+    FillDocument();
     wxXmlNode* root = seqDocument.GetRoot();
     wxXmlNode* node = nullptr;
 
@@ -2568,6 +2641,7 @@ wxArrayString xLightsXmlFile::GetTimingList(const SequenceElements& seq_elements
 
 bool xLightsXmlFile::Save()
 {
+    FillDocument();
     UpdateVersion();
     return seqDocument.Save(GetFullPath());
 }
@@ -2642,6 +2716,9 @@ void xLightsXmlFile::AddJukebox(wxXmlNode* node)
 // function used to save sequence data
 void xLightsXmlFile::Save(SequenceElements& seq_elements)
 {
+    // every section the sidecar could fill in is rebuilt below
+    _sidecar.reset();
+
     wxXmlNode* root = seqDocument.GetRoot();
 
     root->DeleteAttribute("ModelBlending");
@@ -2839,6 +2916,16 @@ void xLightsXmlFile::Save(SequenceElements& seq_elements)
     }
     UpdateVersion();
 
+    std::vector<std::string> savedModels;
+    std::vector<std::string> savedTimings;
+    for (wxXmlNode* e = elements_node->GetChildren(); e != nullptr; e = e->GetNext()) {
+        if (e->GetAttribute("type") == "model") {
+            savedModels.push_back(e->GetAttribute("name").ToUTF8().data());
+        } else if (e->GetAttribute("type") == "timing") {
+            savedTimings.push_back(e->GetAttribute("name").ToUTF8().data());
+        }
+    }
+
 #ifdef USE_COMPRESSION
     for (wxXmlNode* e = root->GetChildren(); e != nullptr; e = e->GetNext()) {
         wxString name = e->GetName();
@@ -2872,6 +2959,26 @@ void xLightsXmlFile::Save(SequenceElements& seq_elements)
 
     seqDocument.Save(GetFullPath());
     MarkNewFileRevision(GetFullPath());
+
+    if (SequenceSidecar::IsEnabled()) {
+        SequenceSidecar::Write(GetFullPath().ToStdString(), seqDocument, seq_elements, savedModels, savedTimings);
+    } else {
+        SequenceSidecar::Remove(GetFullPath().ToStdString());
+    }
+}
+
+void xLightsXmlFile::WriteSidecar(SequenceElements& elements)
+{
+    _writeSidecar = false;
+    std::vector<std::string> modelNames;
+    for (const auto& it : models) {
+        modelNames.push_back(it.ToUTF8().data());
+    }
+    std::vector<std::string> timingNames;
+    for (const auto& it : timing_list) {
+        timingNames.push_back(it.ToUTF8().data());
+    }
+    SequenceSidecar::Write(GetFullPath().ToStdString(), seqDocument, elements, modelNames, timingNames);
 }
 
 bool xLightsXmlFile::TimingAlreadyExists(const std::string & section, xLightsFrame* xLightsParent)
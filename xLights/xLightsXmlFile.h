@@ -13,11 +13,13 @@
 #include <wx/filename.h>
 #include <wx/xml/xml.h>
 #include "sequencer/SequenceElements.h"
+#include "sequencer/SequenceSidecar.h"
 #include "DataLayer.h"
 #include "AudioManager.h"
 #include "Vixen3.h"
 
 #include <array>
+#include <memory>
 
 class SequenceElements;  // forward declaration needed due to circular dependency
 class xLightsFrame;
@@ -52,8 +54,24 @@ public:
     void Save(SequenceElements& elements);
     wxXmlDocument& GetXmlDocument()
     {
+        FillDocument();
         return seqDocument;
     }
+    // the document as it was loaded, if that was from the sidecar the sections it holds are still empty
+    wxXmlDocument& GetLoadedXmlDocument()
+    {
+        return seqDocument;
+    }
+    const SequenceSidecar* GetSidecar() const
+    {
+        return _sidecar.get();
+    }
+    // true if the sequence was loaded from its own xml and the sidecar was missing or stale
+    bool ShouldWriteSidecar() const
+    {
+        return _writeSidecar;
+    }
+    void WriteSidecar(SequenceElements& elements);
     DataLayerSet& GetDataLayers()
     {
         return mDataLayers;
@@ -197,7 +215,8 @@ public:
     static bool IsXmlSequence(wxFileName& fname);
 
 private:
-    wxXmlDocument seqDocument;
+    // both mutable as the sections held by the sidecar are only filled in when first needed
+    mutable wxXmlDocument seqDocument;
     wxArrayString models;
     std::array<wxString, (int)HEADER_INFO_TYPES::NUM_TYPES> header_info;
     wxArrayString timing_list;
@@ -213,8 +232,11 @@ private:
     bool sequence_loaded = false; // flag to indicate the sequencer has been loaded with this xml data
     DataLayerSet mDataLayers;
     AudioManager* audio = nullptr;
+    mutable std::unique_ptr<SequenceSidecar> _sidecar;
+    bool _writeSidecar = false;
 
     void CreateNew();
+    void FillDocument() const;
     bool LoadSequence(const wxString& ShowDir, bool ignore_audio, const wxFileName &realFilename);
     bool LoadV3Sequence();
     bool Save();
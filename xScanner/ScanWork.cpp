@@ -69,6 +69,7 @@ void WorkManager::Start()
 	if (!_started) {
 		logger_base.debug("Starting work.");
 		_started = true;
+		_probes.Start();
 		for (const auto& it : _threadsHTTP) {
 			it->Run();
 		}
@@ -97,11 +98,15 @@ void WorkManager::Stop()
 	for (const auto& it : _threadsOther) {
 		it->Terminate();
 	}
+	_probes.Stop();
+	logger_base.debug("%s", (const char*)_probes.GetStats().c_str());
 	_started = false;
 }
 
 WorkManager::~WorkManager()
 {
+	_probes.Stop();
+
 	while (_threadsHTTP.size() > 0) {
 		ScanThread* t = _threadsHTTP.back();
 		_threadsHTTP.pop_back();
@@ -167,7 +172,12 @@ void WorkManager::AddHTTP(const std::string& ip, int port, const std::string& pr
 	if (std::find(begin(_scannedHTTP), end(_scannedHTTP), h) == end(_scannedHTTP)) {
 		// start with a ping ... work flows from there
 		_scannedHTTP.push_back(h);
-		_queueHTTP.push(new HTTPWork(ip, port, proxy));
+		if (proxy == "") {
+			ProbeHTTP(ip, port);
+		}
+		else {
+			_queueHTTP.push(new HTTPWork(ip, port, proxy));
+		}
 	}
 }
 
@@ -178,8 +188,56 @@ void WorkManager::AddIP(const std::string& ip, const std::string& why, const std
 	if (std::find(begin(_scannedIP), end(_scannedIP), ip) == end(_scannedIP)) {
 		// start with a ping ... work flows from there
 		_scannedIP.push_back(ip);
-		_queuePing.push(new PingWork(ip, why, proxy));
+		if (proxy == "" && ProbeEngine::SupportsICMP()) {
+			ProbeIP(ip, why);
+		}
+		else {
+			_queuePing.push(new PingWork(ip, why, proxy));
+		}
+	}
+}
+
+void WorkManager::ProbeIP(const std::string& ip, const std::string& why)
+{
+	std::list<std::pair<std::string, std::string>> results;
+	if (!PingWork::AddNetworkResults(ip, why, results)) {
+		return;
 	}
+
+	ProbeRequest req;
+	req.type = ProbeType::ICMP;
+	req.ip = ip;
+	req.timeoutMS = FAST_TIMEOUT * 1000;
+	req.callback = [this, results](const ProbeResult& res) mutable {
+		results.push_back({ "PING", res.ok ? "OK" : "FAILED" });
+		if (res.ok) {
+			AddFoundIP(res.ip);
+		}
+		PublishResult(results);
+		AddHTTP(res.ip, 80); // we still try to open as it may be behind a http proxy
+	};
+	_probes.Submit(std::move(req));
+}
+
+void WorkManager::ProbeHTTP(const std::string& ip, int port)
+{
+	// only the connect is multiplexed, the page is still fetched with curl so redirects
+	// and https work as they always have
+	ProbeRequest req;
+	req.type = ProbeType::TCP_CONNECT;
+	req.ip = ip;
+	req.port = port;
+	req.timeoutMS = SLOW_TIMEOUT * 1000;
+	req.callback = [this](const ProbeResult& res) {
+		static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+		if (!res.ok) {
+			logger_base.debug("HTTP probe %s:%d failed %s.", (const char*)res.ip.c_str(), res.port, (const char*)res.error.c_str());
+			return;
+		}
+		_queueHTTP.push(new HTTPWork(res.ip, res.port, "", true));
+	};
+	_probes.Submit(std::move(req));
 }
 
 void WorkManager::AddClassDSubnet(const std::string& ip, const std::string& proxy)
@@ -203,20 +261,14 @@ void WorkManager::AddClassDSubnet(const std::string& ip, const std::string& prox
 
 #pragma region PingWork
 
-void PingWork::DoWork(WorkManager& workManager, wxSocketClient* client)
+bool PingWork::AddNetworkResults(const std::string& ip, const std::string& why, std::list<std::pair<std::string, std::string>>& results)
 {
-	static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
-
-	std::list<std::pair<std::string, std::string>> results;
-
-	logger_base.debug("PingWork %s", (const char*)_ip.c_str());
-
 	// First determine if public or private
 
 	// We only scan private networks
 	bool privateNetwork = true;
 
-	wxArrayString ipElements = wxSplit(_ip, '.');
+	wxArrayString ipElements = wxSplit(ip, '.');
 	if (ipElements.size() > 3) {
 		//looks like an IP address
 		int ip1 = wxAtoi(ipElements[0]);
@@ -258,14 +310,27 @@ void PingWork::DoWork(WorkManager& workManager, wxSocketClient* client)
 			privateNetwork = false;
 		}
 
-		results.push_back({ "IP", _ip });
+		results.push_back({ "IP", ip });
 		results.push_back({ "Type", "Ping" });
-		if (_why != "") {
-			results.push_back({ "Why", _why });
+		if (why != "") {
+			results.push_back({ "Why", why });
 		}
 		results.push_back({ "Network", wxString::Format("%d.%d.%d.0", ip1, ip2, ip3)});
 		results.push_back({ "Network Type", privateNetwork ? "Private" : "Public" });
+		return true;
+	}
+	return false;
+}
 
+void PingWork::DoWork(WorkManager& workManager, wxSocketClient* client)
+{
+	static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+	std::list<std::pair<std::string, std::string>> results;
+
+	logger_base.debug("PingWork %s", (const char*)_ip.c_str());
+
+	if (AddNetworkResults(_ip, _why, results)) {
 		auto const& result = IPOutput::Ping(_ip, _proxy);
 		if (result == IPOutput::PINGSTATE::PING_OK || result == IPOutput::PINGSTATE::PING_WEBOK) {
 			results.push_back({ "PING", "OK" });
@@ -339,10 +404,14 @@ void HTTPWork::DoWork(WorkManager& workManager, wxSocketClient* client)
 {
 	static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
 
-	std::list<std::pair<std::string, std::string>> results;
-
 	logger_base.debug("HTTPWork %s:%d Proxy: %s", (const char*)_ip.c_str(), _port, (const char*)_proxy.c_str());
 
+	if (_connected) {
+		// the probe engine has already made the connection
+		Fetch(workManager);
+		return;
+	}
+
 	wxIPV4address addr;
 	addr.Hostname(_ip);
 	addr.Service(_port);
@@ -351,45 +420,7 @@ void HTTPWork::DoWork(WorkManager& workManager, wxSocketClient* client)
 		if (client->Connect(addr)) {
 			client->Close();
 			logger_base.debug("    HTTP Connected.");
-			results.push_back({ "IP", _ip });
-			results.push_back({ "Type", "HTTP" });
-			if (_proxy != "") {
-				results.push_back({ "Web", wxString::Format("Via proxy %s OK on port %d", _proxy, _port) });
-			}
-			else {
-				results.push_back({ "Web", wxString::Format("Direct OK on port %d", _port) });
-			}
-
-			try {
-                logger_base.debug("    Getting the web page.");
-                std::string page = Curl::HTTPSGet(_proxy + _ip, "", "", SLOW_TIMEOUT);
-                logger_base.debug("    Got the web page.");
-
-				if (page != "") {
-                    logger_base.debug("    Getting the title.");
-                    std::string title = GetTitle(page);
-                    logger_base.debug("    Got the title.");
-                    if (title != "") {
-						results.push_back({ "Title", title });
-					}
-
-                    logger_base.debug("    Determining controller type.");
-                    std::string controller = GetControllerTypeBasedOnPageContent(page);
-                    logger_base.debug("    Got the controller type.");
-                    if (controller != "") {
-						results.push_back({ "Controller", controller });
-					}
-				}
-			}
-			catch (...) {
-
-			}
-
-			PublishResult(workManager, results);
-
-			workManager.AddWork(new FPPWork(_ip, _proxy));
-			workManager.AddWork(new FalconWork(_ip, _proxy));
-			workManager.AddWork(new xScheduleWork(_ip));
+			Fetch(workManager);
 		}
 		else {
 			logger_base.debug("    HTTP Connect failed.");
@@ -400,6 +431,53 @@ void HTTPWork::DoWork(WorkManager& workManager, wxSocketClient* client)
 	}
 }
 
+void HTTPWork::Fetch(WorkManager& workManager)
+{
+	static log4cpp::Category& logger_base = log4cpp::Category::getInstance(std::string("log_base"));
+
+	std::list<std::pair<std::string, std::string>> results;
+
+	results.push_back({ "IP", _ip });
+	results.push_back({ "Type", "HTTP" });
+	if (_proxy != "") {
+		results.push_back({ "Web", wxString::Format("Via proxy %s OK on port %d", _proxy, _port) });
+	}
+	else {
+		results.push_back({ "Web", wxString::Format("Direct OK on port %d", _port) });
+	}
+
+	try {
+		logger_base.debug("    Getting the web page.");
+		std::string page = Curl::HTTPSGet(_proxy + _ip, "", "", SLOW_TIMEOUT);
+		logger_base.debug("    Got the web page.");
+
+		if (page != "") {
+			logger_base.debug("    Getting the title.");
+			std::string title = GetTitle(page);
+			logger_base.debug("    Got the title.");
+			if (title != "") {
+				results.push_back({ "Title", title });
+			}
+
+			logger_base.debug("    Determining controller type.");
+			std::string controller = GetControllerTypeBasedOnPageContent(page);
+			logger_base.debug("    Got the controller type.");
+			if (controller != "") {
+				results.push_back({ "Controller", controller });
+			}
+		}
+	}
+	catch (...) {
+
+	}
+
+	PublishResult(workManager, results);
+
+	workManager.AddWork(new FPPWork(_ip, _proxy));
+	workManager.AddWork(new FalconWork(_ip, _proxy));
+	workManager.AddWork(new xScheduleWork(_ip));
+}
+
 #pragma endregion
 
 #pragma region FPPWork
@@ -12,6 +12,7 @@
 #include <atomic>
 
 #include "../xLights/outputs/OutputManager.h"
+#include "../xLights/utils/ProbeEngine.h"
 
 // seed with ... xLights defined stuff
 // seed with networks we are attached to
@@ -168,6 +169,12 @@ protected:
     bool _started = false;
     bool _singleThreaded = false;
 
+    // direct (non proxied) ping and http probes are multiplexed on one thread rather than
+    // tying up a blocking scan thread per address
+    ProbeEngine _probes;
+    void ProbeIP(const std::string& ip, const std::string& why);
+    void ProbeHTTP(const std::string& ip, int port);
+
 public:
     WorkManager();
     virtual ~WorkManager();
@@ -178,6 +185,7 @@ public:
     }
     void Restart()
     {
+        _probes.Cancel();
         while (_queuePing.size() > 0)             {
             _queuePing.pop();
         }
@@ -234,7 +242,7 @@ public:
     }
     std::string GetPendingWork()
     {
-        return wxString::Format("HTTP %d : Ping %d : Other %d", (int)_queueHTTP.size(), (int)_queuePing.size(), (int)_queueOther.size());
+        return wxString::Format("HTTP %d : Ping %d : Other %d : Probes %d", (int)_queueHTTP.size(), (int)_queuePing.size(), (int)_queueOther.size(), (int)(_probes.GetPendingCount() + _probes.GetInFlightCount()));
     }
     void AddHTTP(const std::string& ip, int port, const std::string& proxy = "");
     void AddIP(const std::string& ip, const std::string& why, const std::string& proxy = "");
@@ -313,6 +321,8 @@ protected:
 public:
     PingWork(const std::string& ip, const std::string& why, const std::string& proxy = "") : ScanWork(WorkType::WTPING) { _ip = ip; _proxy = proxy; _why = why; }
     virtual ~PingWork() {}
+    // adds the address and network classification results, returns false if the ip is not valid
+    static bool AddNetworkResults(const std::string& ip, const std::string& why, std::list<std::pair<std::string, std::string>>& results);
     virtual void DoWork(WorkManager& workManager, wxSocketClient* client) override;
 };
 
@@ -344,12 +354,14 @@ protected:
     std::string _ip;
     int _port = 80;
     std::string _proxy;
+    bool _connected = false;
 
-    std::string GetTitle(const std::string& page);
-    std::string GetControllerTypeBasedOnPageContent(const std::string& page);
+    void Fetch(WorkManager& workManager);
 
 public:
-    HTTPWork(const std::string& ip, int port = 80, const std::string& proxy = "") : ScanWork(WorkType::WTHTTP) { _ip = ip; _port = port; _proxy = proxy; }
+    static std::string GetTitle(const std::string& page);
+    static std::string GetControllerTypeBasedOnPageContent(const std::string& page);
+    HTTPWork(const std::string& ip, int port = 80, const std::string& proxy = "", bool connected = false) : ScanWork(WorkType::WTHTTP) { _ip = ip; _port = port; _proxy = proxy; _connected = connected; }
     virtual ~HTTPWork() {}
     virtual void DoWork(WorkManager& workManager, wxSocketClient* client) override;
     virtual bool IsMainThread() override { return true; }